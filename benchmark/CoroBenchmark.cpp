@@ -0,0 +1,219 @@
+// Compares the C++20 coroutine client (CoroClient on a single-threaded IoLoop) with the
+// callbacks of the async Client, which are run by the thread pool via
+// RegisterWaitForSingleObject. Built with -DNAMEDPIPE_COROUTINES=ON only.
+// 1. dispatch: resuming a coroutine by the loop (co_await loop.Schedule()) vs. a round trip of
+//    the thread pool wait callback, which signals an event back to the waiting thread;
+// 2. sequential calls of SetIntegerValue: co_await of CoroClient::Call vs. Client::Call().Get()
+//    of the async and the sync clients;
+// 3. [inflight] coroutines, which call SetIntegerValue concurrently on one connection.
+// Starts a NamedPipeServer process on a private pipe name, the results table is printed at the
+// end.
+//
+// Usage: NamedPipeCoroBench <path to NamedPipeServer> [requests] [inflight]
+
+#include <windows.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "CallFuture.h"
+#include "Client.h"
+#include "CoroClient.h"
+#include "CustomClass.h"
+#include "IoLoop.h"
+#include "ResponseParser.h"
+#include "ServerProcess.h"
+#include "Task.h"
+
+namespace {
+
+constexpr size_t kDispatchesCount = 1000000;
+constexpr size_t kThreadPoolDispatchesCount = 100000;
+
+struct BenchmarkResult {
+  std::string name;
+  size_t operations = 0;
+  std::chrono::nanoseconds elapsed{0};
+};
+
+template <class Function>
+BenchmarkResult Measure(const std::string& name, Function&& function) {
+  BenchmarkResult result;
+  result.name = name;
+  const auto begin = std::chrono::steady_clock::now();
+  result.operations = function();
+  result.elapsed = std::chrono::steady_clock::now() - begin;
+  return result;
+}
+
+Task<size_t> ScheduleMany(IoLoop& loop, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    co_await loop.Schedule();
+  }
+  co_return count;
+}
+
+struct PingPong {
+  HANDLE ping = nullptr;
+  HANDLE pong = nullptr;
+};
+
+void CALLBACK OnPing(PVOID context, BOOLEAN /*timed_out*/) {
+  SetEvent(static_cast<PingPong*>(context)->pong);
+}
+
+size_t ThreadPoolPingPong(size_t count) {
+  PingPong ping_pong;
+  ping_pong.ping = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+  ping_pong.pong = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+  // the same registration as the async reads of Pipe, but not WT_EXECUTEONLYONCE - the callback
+  // is run by the pool for every signal
+  HANDLE wait_handle = nullptr;
+  size_t done = 0;
+  if (RegisterWaitForSingleObject(&wait_handle, ping_pong.ping, OnPing, &ping_pong, INFINITE,
+                                  WT_EXECUTEDEFAULT)) {
+    for (; done < count; ++done) {
+      SetEvent(ping_pong.ping);
+      WaitForSingleObject(ping_pong.pong, INFINITE);
+    }
+    UnregisterWaitEx(wait_handle, INVALID_HANDLE_VALUE);
+  }
+  CloseHandle(ping_pong.ping);
+  CloseHandle(ping_pong.pong);
+  return done;
+}
+
+Task<ClassHandle> CreateInstance(CoroClient& client) {
+  const auto [success, handle] = co_await client.Create<CustomClass>(52, "coro");
+  co_return success ? handle : ClassHandle{-1};
+}
+
+Task<size_t> CallMany(CoroClient& client, ClassHandle handle, size_t count) {
+  size_t succeeded = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const auto [success, changed] =
+        co_await client.Call<&CustomClass::SetIntegerValue>(handle, static_cast<int>(i));
+    if (success) {
+      ++succeeded;
+    }
+  }
+  co_return succeeded;
+}
+
+size_t CallManyConcurrently(IoLoop& loop, CoroClient& client, ClassHandle handle, size_t count,
+                            size_t inflight) {
+  std::vector<Task<size_t>> tasks;
+  for (size_t i = 0; i < inflight; ++i) {
+    tasks.push_back(CallMany(client, handle, count / inflight));
+    tasks.back().Start();
+  }
+  size_t succeeded = 0;
+  for (auto& task : tasks) {
+    while (!task.IsDone() && loop.RunOnce(INFINITE)) {
+    }
+    succeeded += task.TakeResult();
+  }
+  return succeeded;
+}
+
+size_t ClientCallMany(Client& client, ClassHandle handle, size_t count) {
+  size_t succeeded = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (client.Call<&CustomClass::SetIntegerValue>(handle, static_cast<int>(i)).Get().first) {
+      ++succeeded;
+    }
+  }
+  return succeeded;
+}
+
+void RunClient(const std::string& name, const std::string& pipe_name, ExecutionPolicy policy,
+               size_t requests, std::vector<BenchmarkResult>& results) {
+  Client client(pipe_name, nullptr, std::make_shared<ResponseParser>(), policy);
+  if (!client.Connect()) {
+    std::cerr << "ERROR - failed to connect to " << pipe_name << std::endl;
+    return;
+  }
+  const auto [success, handle] = client.Create(52, "client").Get();
+  if (!success) {
+    std::cerr << "ERROR - failed to create an instance" << std::endl;
+    return;
+  }
+  results.push_back(Measure(name, [&] { return ClientCallMany(client, handle, requests); }));
+}
+
+void PrintResult(const BenchmarkResult& result) {
+  const double seconds = std::chrono::duration<double>(result.elapsed).count();
+  const double ns_per_op =
+      result.operations > 0
+          ? std::chrono::duration<double, std::nano>(result.elapsed).count() / result.operations
+          : 0.0;
+  const double throughput = seconds > 0 ? result.operations / seconds : 0.0;
+
+  std::cout << std::left << std::setw(36) << result.name << std::right << std::setw(10)
+            << result.operations << std::setw(12) << std::fixed << std::setprecision(1)
+            << ns_per_op << std::setw(14) << std::setprecision(0) << throughput << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: NamedPipeCoroBench <path to NamedPipeServer> [requests] [inflight]"
+              << std::endl;
+    return -1;
+  }
+
+  const std::string server_path = argv[1];
+  const size_t requests = argc > 2 ? std::stoul(argv[2]) : 20000;
+  const size_t inflight = argc > 3 ? std::max<size_t>(std::stoul(argv[3]), 1) : 16;
+
+  std::vector<BenchmarkResult> results;
+  IoLoop loop;
+  if (!loop.IsValid()) {
+    return -1;
+  }
+  results.push_back(Measure("dispatch/coroutine", [&] {
+    auto task = ScheduleMany(loop, kDispatchesCount);
+    return loop.Run(task);
+  }));
+  results.push_back(Measure("dispatch/thread pool wait", [] {
+    return ThreadPoolPingPong(kThreadPoolDispatchesCount);
+  }));
+
+  const std::string pipe_name =
+      "\\\\.\\pipe\\coro_benchmark_" + std::to_string(GetCurrentProcessId());
+  auto processes = StartServers(server_path, pipe_name, 1);
+  if (processes.empty()) {
+    return -1;
+  }
+
+  {
+    CoroClient client(loop, pipe_name);
+    auto create = CreateInstance(client);
+    const auto handle = client.Connect() ? loop.Run(create) : ClassHandle{-1};
+    if (handle != -1) {
+      results.push_back(Measure("calls/coroutine", [&] {
+        auto task = CallMany(client, handle, requests);
+        return loop.Run(task);
+      }));
+      results.push_back(
+          Measure("calls/coroutine inflight:" + std::to_string(inflight),
+                  [&] { return CallManyConcurrently(loop, client, handle, requests, inflight); }));
+    } else {
+      std::cerr << "ERROR - failed to create an instance via the coroutine client" << std::endl;
+    }
+  }
+  RunClient("calls/async client", pipe_name, ExecutionPolicy::Async, requests, results);
+  RunClient("calls/sync client", pipe_name, ExecutionPolicy::Sync, requests, results);
+  StopServers(processes);
+
+  std::cout << "\nrequests=" << requests << "\n\n"
+            << std::left << std::setw(36) << "case" << std::right << std::setw(10) << "ops"
+            << std::setw(12) << "ns/op" << std::setw(14) << "ops/s" << std::endl;
+  for (const auto& result : results) {
+    PrintResult(result);
+  }
+  return 0;
+}
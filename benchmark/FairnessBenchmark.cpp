@@ -0,0 +1,235 @@
+// Latency of a well-behaved client next to a noisy neighbour, with and without the deficit round
+// robin of the server (see FairScheduler.h). The well-behaved client calls SetIntegerValue one by
+// one every millisecond. The noisy one floods SetStringValue calls with large values via many
+// connections and keeps a fixed number of them outstanding on each, so the server has more busy
+// connection threads than cores. Without the scheduler the threads of the well-behaved client
+// wait for the CPU with all the others; with it at most <slots> requests are executed at once,
+// and the well-behaved request waits at most one round of the other clients. With the byte cost
+// the large values of the noisy client cost it proportionally more of every round.
+// The server shares the slots between the client processes, so the noisy client is another
+// process of this benchmark (--noisy), which returns its calls per second as the exit code.
+// Every case runs a fresh NamedPipeServer process.
+//
+// Usage: NamedPipeFairnessBench <path to NamedPipeServer> [seconds] [noisy connections]
+//                               [value bytes] [slots]
+//        NamedPipeFairnessBench --noisy <pipe name> <connections> <value bytes> <milliseconds>
+
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Client.h"
+#include "ClientRequest.h"
+#include "CustomClass.h"
+#include "LatencyHistogram.h"
+#include "RemoteCall.h"
+#include "ResponseParser.h"
+#include "ServerProcess.h"
+
+namespace {
+
+constexpr std::chrono::milliseconds kCallInterval{1};
+// outstanding calls of the noisy client per connection
+constexpr size_t kNoisyOutstanding = 16;
+// the noisy client saturates the server first
+constexpr std::chrono::milliseconds kNoisyWarmup{1000};
+
+struct FairnessCase {
+  std::string name;
+  bool has_noisy_client = false;
+  std::string server_arguments;
+};
+
+struct FairnessResult {
+  std::string name;
+  HistogramSnapshot latencies;
+  DWORD noisy_calls_per_second = 0;
+};
+
+// Completions of the noisy calls - shared with the callbacks, which can be called after the case.
+struct NoisyCounters {
+  std::atomic<uint64_t> outstanding = 0;
+  std::atomic<uint64_t> completed = 0;
+};
+
+std::string GetPipeName(size_t case_index) {
+  return "\\\\.\\pipe\\fairness_benchmark_" + std::to_string(case_index) + "_" +
+         std::to_string(GetCurrentProcessId());
+}
+
+// Floods the server for the duration. Returns the completed calls per second.
+DWORD RunNoisyClient(const std::string& pipe_name, size_t connections_count, size_t value_bytes,
+                     std::chrono::milliseconds duration) {
+  auto counters = std::make_shared<NoisyCounters>();
+  Client client(pipe_name, nullptr, std::make_shared<ResponseParser>(), ExecutionPolicy::Async, 1,
+                connections_count);
+  const auto [success, handle] =
+      client.Connect() ? client.Create(1, "noisy").Get() : std::make_pair(false, -1);
+  if (!success) {
+    std::cerr << "ERROR - failed to create the noisy instance" << std::endl;
+    return 0;
+  }
+
+  RawDataType data;
+  AppendMethodCall<&CustomClass::SetStringValue>(data, handle, std::string(value_bytes, 'n'));
+  auto on_completed = [counters](auto) {
+    --counters->outstanding;
+    ++counters->completed;
+  };
+  const ClientRequest request(data, true, on_completed, on_completed);
+
+  const auto max_outstanding = kNoisyOutstanding * connections_count;
+  const auto begin = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - begin < duration) {
+    if (counters->outstanding.load() >= max_outstanding) {
+      std::this_thread::yield();
+      continue;
+    }
+    // the failed call is completed by its failure callback too
+    ++counters->outstanding;
+    client.Execute(request);
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  return static_cast<DWORD>(counters->completed.load() / seconds);
+}
+
+// Runs the noisy client in another process of this benchmark. hProcess is nullptr on failure.
+PROCESS_INFORMATION StartNoisyClient(const std::string& pipe_name, size_t connections_count,
+                                     size_t value_bytes, std::chrono::milliseconds duration) {
+  char path[MAX_PATH] = {};
+  GetModuleFileName(nullptr, path, MAX_PATH);
+  std::string command_line = "\"" + std::string(path) + "\" --noisy " + pipe_name + " " +
+                             std::to_string(connections_count) + " " +
+                             std::to_string(value_bytes) + " " +
+                             std::to_string(duration.count());
+
+  STARTUPINFO startup_info = {};
+  startup_info.cb = sizeof(startup_info);
+  PROCESS_INFORMATION process_info = {};
+  if (!CreateProcess(nullptr, &command_line[0], nullptr, nullptr, FALSE, CREATE_NO_WINDOW,
+                     nullptr, nullptr, &startup_info, &process_info)) {
+    std::cerr << "ERROR - failed to start: " << command_line << ", error=" << GetLastError()
+              << std::endl;
+    process_info = {};
+  }
+  return process_info;
+}
+
+FairnessResult RunCase(const FairnessCase& fairness_case, size_t case_index,
+                       const std::string& server_path, std::chrono::seconds duration,
+                       size_t noisy_connections, size_t value_bytes) {
+  FairnessResult result;
+  result.name = fairness_case.name;
+  const auto pipe_name = GetPipeName(case_index);
+  auto processes = StartServers(server_path, pipe_name, 1, fairness_case.server_arguments);
+  if (processes.empty()) {
+    return result;
+  }
+
+  PROCESS_INFORMATION noisy_process = {};
+  if (fairness_case.has_noisy_client) {
+    // the noisy client outlives the measurement
+    noisy_process = StartNoisyClient(pipe_name, noisy_connections, value_bytes,
+                                     2 * kNoisyWarmup + duration);
+    if (!noisy_process.hProcess) {
+      StopServers(processes);
+      return result;
+    }
+    std::this_thread::sleep_for(kNoisyWarmup);
+  }
+
+  {
+    Client client(pipe_name, nullptr, std::make_shared<ResponseParser>(), ExecutionPolicy::Sync);
+    const auto [success, handle] =
+        client.Connect() ? client.Create(2, "calm").Get() : std::make_pair(false, -1);
+    if (success) {
+      LatencyHistogram histogram;
+      const auto begin = std::chrono::steady_clock::now();
+      auto next_call = begin;
+      for (int value = 0; std::chrono::steady_clock::now() - begin < duration; ++value) {
+        std::this_thread::sleep_until(next_call);
+        next_call += kCallInterval;
+
+        const auto call_begin = std::chrono::steady_clock::now();
+        if (client.Call<&CustomClass::SetIntegerValue>(handle, value).Get().first) {
+          histogram.Record(static_cast<uint64_t>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - call_begin)
+                  .count()));
+        }
+      }
+      result.latencies.Add(histogram);
+    } else {
+      std::cerr << "ERROR - failed to create the instance" << std::endl;
+    }
+
+    if (noisy_process.hProcess) {
+      WaitForSingleObject(noisy_process.hProcess, INFINITE);
+      GetExitCodeProcess(noisy_process.hProcess, &result.noisy_calls_per_second);
+      CloseHandle(noisy_process.hThread);
+      CloseHandle(noisy_process.hProcess);
+    }
+  }
+  StopServers(processes);
+  return result;
+}
+
+void PrintResult(const FairnessResult& result) {
+  const auto& latencies = result.latencies;
+  std::cout << std::left << std::setw(30) << result.name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(10) << latencies.count << std::setw(10)
+            << latencies.GetPercentile(50) / 1e3 << std::setw(10)
+            << latencies.GetPercentile(99) / 1e3 << std::setw(10)
+            << latencies.GetPercentile(99.9) / 1e3 << std::setw(16)
+            << result.noisy_calls_per_second << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc == 6 && std::string(argv[1]) == "--noisy") {
+    return static_cast<int>(RunNoisyClient(argv[2], std::stoul(argv[3]), std::stoul(argv[4]),
+                                           std::chrono::milliseconds(std::stoul(argv[5]))));
+  }
+  if (argc < 2) {
+    std::cerr << "Usage: NamedPipeFairnessBench <path to NamedPipeServer> [seconds] "
+                 "[noisy connections] [value bytes] [slots]"
+              << std::endl;
+    return -1;
+  }
+
+  const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const std::string server_path = argv[1];
+  const auto duration = std::chrono::seconds(argc > 2 ? std::stoul(argv[2]) : 5);
+  const size_t noisy_connections = argc > 3 ? std::stoul(argv[3]) : 2 * cores;
+  const size_t value_bytes = argc > 4 ? std::stoul(argv[4]) : 2048;
+  const size_t slots = argc > 5 ? std::stoul(argv[5]) : cores;
+
+  const auto fair_slots = "--fair-slots " + std::to_string(slots);
+  const std::vector<FairnessCase> cases = {
+      {"alone", false, ""},
+      {"noisy neighbour", true, ""},
+      {"noisy neighbour, drr frames", true, fair_slots},
+      {"noisy neighbour, drr bytes", true, fair_slots + " --fair-cost bytes"}};
+  std::vector<FairnessResult> results;
+  for (size_t i = 0; i < cases.size(); ++i) {
+    results.push_back(
+        RunCase(cases[i], i, server_path, duration, noisy_connections, value_bytes));
+  }
+
+  std::cout << "\nnoisy connections=" << noisy_connections << " value=" << value_bytes
+            << " bytes slots=" << slots << " duration=" << duration.count() << "s\n\n"
+            << std::left << std::setw(30) << "case" << std::right << std::setw(10) << "calls"
+            << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10)
+            << "p99.9 us" << std::setw(16) << "noisy calls/s" << std::endl;
+  for (const auto& result : results) {
+    PrintResult(result);
+  }
+  return 0;
+}
@@ -0,0 +1,308 @@
+// Headless load generator: sends the weighted mix of the WorkloadGenerator from many threads
+// via one shared Client and reports the throughput and the latency percentiles per operation.
+//
+// With --rate the requests are sent on a fixed schedule (open loop) and the response latency is
+// measured from the scheduled send time, not from the actual one. So a stall of the server is
+// counted for every request, which should have been sent during it, rather than for the one
+// request, which waited for it (coordinated omission correction). The service latency - from the
+// actual send time - is reported too. Without --rate every thread sends its next request right
+// after the previous one is completed (closed loop) and both latencies are the same.
+//
+// Usage: NamedPipeBench [--server <path to NamedPipeServer> | --pipe <pipe name>]
+//                       [--duration <seconds>] [--threads <count>] [--rate <requests/s>]
+//                       [--pool <connections>] [--instances <count>]
+//                       [--mix <operation>=<weight>,...] [--json <path>]
+
+#include <windows.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Client.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include "ResponseParser.h"
+#include "ServerProcess.h"
+#include "WorkloadGenerator.h"
+
+namespace {
+
+struct BenchmarkOptions {
+  WorkloadConfig workload;
+  std::string server_path;
+  std::string pipe_name = "\\\\.\\pipe\\demo_pipe";
+  // 0 - a connection per thread
+  size_t pool_size = 0;
+  std::string json_path;
+};
+
+// Latencies of one thread - it's the only writer.
+struct ThreadStats {
+  std::array<LatencyHistogram, kWorkloadOperationsCount> service;
+  std::array<LatencyHistogram, kWorkloadOperationsCount> response;
+  uint64_t failed = 0;
+};
+
+struct OperationResult {
+  HistogramSnapshot service;
+  HistogramSnapshot response;
+};
+
+struct BenchmarkResult {
+  // indexed by WorkloadOperation, the last one - all the operations
+  std::vector<OperationResult> operations;
+  uint64_t failed = 0;
+  std::chrono::nanoseconds elapsed{0};
+};
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions& options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string arg = argv[i];
+    const std::string value = argv[i + 1];
+    if (arg == "--server") {
+      options.server_path = value;
+    } else if (arg == "--pipe") {
+      options.pipe_name = value;
+    } else if (arg == "--duration") {
+      options.workload.duration = std::chrono::seconds(std::stoul(value));
+    } else if (arg == "--threads") {
+      options.workload.threads_count = std::max<size_t>(std::stoul(value), 1);
+    } else if (arg == "--rate") {
+      options.workload.rate = std::stod(value);
+    } else if (arg == "--pool") {
+      options.pool_size = std::stoul(value);
+    } else if (arg == "--instances") {
+      options.workload.initial_instances = std::stoul(value);
+    } else if (arg == "--mix") {
+      auto [success, weights] = WorkloadGenerator::ParseMix(value);
+      if (!success) {
+        std::cerr << "ERROR - invalid mix=" << value << std::endl;
+        return false;
+      }
+      options.workload.weights = weights;
+    } else if (arg == "--json") {
+      options.json_path = value;
+    } else {
+      std::cerr << "ERROR - unknown option=" << arg << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+void RunThread(Client& client, WorkloadGenerator& generator, const WorkloadConfig& config,
+               std::chrono::steady_clock::time_point begin, std::atomic<uint64_t>& scheduled,
+               ThreadStats& stats) {
+  const auto end = begin + config.duration;
+  const auto interval =
+      config.rate > 0 ? std::chrono::duration<double, std::nano>(1e9 / config.rate)
+                      : std::chrono::duration<double, std::nano>(0);
+  while (true) {
+    auto intended = std::chrono::steady_clock::now();
+    if (config.rate > 0) {
+      // the schedule is shared - a late thread takes the overdue requests of the others:
+      const auto sequence = scheduled.fetch_add(1, std::memory_order_relaxed);
+      intended = begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                             interval * static_cast<double>(sequence));
+      if (intended >= end) {
+        break;
+      }
+      // sleep is too coarse for the last milliseconds:
+      while (intended - std::chrono::steady_clock::now() > std::chrono::milliseconds(2)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      while (std::chrono::steady_clock::now() < intended) {
+        std::this_thread::yield();
+      }
+    } else if (intended >= end) {
+      break;
+    }
+
+    const auto operation = generator.NextOperation();
+    const auto request = generator.CreateRequest(operation);
+    const auto sent = std::chrono::steady_clock::now();
+    if (config.rate <= 0) {
+      intended = sent;
+    }
+    if (!client.Execute(request)) {
+      ++stats.failed;
+      continue;
+    }
+    const auto completed = std::chrono::steady_clock::now();
+    const auto index = static_cast<size_t>(operation);
+    stats.service[index].Record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(completed - sent).count());
+    stats.response[index].Record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(completed - intended).count());
+  }
+}
+
+BenchmarkResult RunBenchmark(const BenchmarkOptions& options) {
+  BenchmarkResult result;
+  const auto& config = options.workload;
+  const auto pool_size = options.pool_size > 0 ? options.pool_size : config.threads_count;
+  Client client(options.pipe_name, nullptr, std::make_shared<ResponseParser>(),
+                ExecutionPolicy::Sync, 1, pool_size);
+  if (!client.Connect()) {
+    std::cerr << "ERROR - failed to connect to " << options.pipe_name << std::endl;
+    return result;
+  }
+
+  WorkloadGenerator generator(config);
+  for (size_t i = 0; i < config.initial_instances; ++i) {
+    client.Execute(generator.CreateRequest(WorkloadOperation::Create));
+  }
+
+  std::vector<std::unique_ptr<ThreadStats>> stats;
+  std::vector<std::thread> threads;
+  std::atomic<uint64_t> scheduled = 0;
+  generator.Start();
+  const auto begin = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < config.threads_count; ++t) {
+    stats.push_back(std::make_unique<ThreadStats>());
+    threads.emplace_back(RunThread, std::ref(client), std::ref(generator), std::cref(config),
+                         begin, std::ref(scheduled), std::ref(*stats.back()));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  result.elapsed = std::chrono::steady_clock::now() - begin;
+
+  result.operations.resize(kWorkloadOperationsCount + 1);
+  auto& total = result.operations.back();
+  for (const auto& thread_stats : stats) {
+    for (size_t i = 0; i < kWorkloadOperationsCount; ++i) {
+      result.operations[i].service.Add(thread_stats->service[i]);
+      result.operations[i].response.Add(thread_stats->response[i]);
+      total.service.Add(thread_stats->service[i]);
+      total.response.Add(thread_stats->response[i]);
+    }
+    result.failed += thread_stats->failed;
+  }
+  return result;
+}
+
+const char* GetResultName(size_t index) {
+  return index < kWorkloadOperationsCount
+             ? WorkloadGenerator::GetOperationName(static_cast<WorkloadOperation>(index))
+             : "all";
+}
+
+void PrintLatency(const char* name, const HistogramSnapshot& histogram) {
+  std::cout << std::setw(10) << name;
+  for (const auto percentile : {50.0, 90.0, 99.0, 99.9, 100.0}) {
+    std::cout << std::setw(12) << histogram.GetPercentile(percentile) / 1e3;
+  }
+  std::cout << std::endl;
+}
+
+void PrintResult(const BenchmarkOptions& options, const BenchmarkResult& result) {
+  const double seconds = std::chrono::duration<double>(result.elapsed).count();
+  std::cout << "\nthreads=" << options.workload.threads_count << ", rate="
+            << (options.workload.rate > 0 ? std::to_string(options.workload.rate) : "closed loop")
+            << ", elapsed=" << std::fixed << std::setprecision(2) << seconds
+            << "s, failed=" << result.failed << "\n\n"
+            << std::left << std::setw(16) << "operation" << std::right << std::setw(10)
+            << "requests" << std::setw(12) << "requests/s" << std::setw(10) << "latency"
+            << std::setw(12) << "p50, us" << std::setw(12) << "p90, us" << std::setw(12)
+            << "p99, us" << std::setw(12) << "p99.9, us" << std::setw(12) << "max, us"
+            << std::endl;
+  for (size_t i = 0; i < result.operations.size(); ++i) {
+    const auto& operation = result.operations[i];
+    if (operation.service.count == 0) {
+      continue;
+    }
+    std::cout << std::left << std::setw(16) << GetResultName(i) << std::right << std::setw(10)
+              << operation.service.count << std::setw(12) << std::setprecision(0)
+              << operation.service.count / seconds << std::setprecision(1);
+    PrintLatency("response", operation.response);
+    std::cout << std::setw(38) << "";
+    PrintLatency("service", operation.service);
+  }
+}
+
+void WriteLatencyJson(std::ostream& out, const HistogramSnapshot& histogram) {
+  out << "{\"p50_us\":" << histogram.GetPercentile(50) / 1e3
+      << ",\"p90_us\":" << histogram.GetPercentile(90) / 1e3
+      << ",\"p99_us\":" << histogram.GetPercentile(99) / 1e3
+      << ",\"p999_us\":" << histogram.GetPercentile(99.9) / 1e3
+      << ",\"max_us\":" << histogram.GetPercentile(100) / 1e3 << "}";
+}
+
+bool WriteJson(const std::string& path, const BenchmarkOptions& options,
+               const BenchmarkResult& result) {
+  const auto& config = options.workload;
+  const double seconds = std::chrono::duration<double>(result.elapsed).count();
+  std::ofstream file(path, std::ios::trunc);
+  file << std::fixed << std::setprecision(3);
+  file << "{\n  \"config\": {\"threads\":" << config.threads_count
+       << ",\"rate\":" << config.rate << ",\"duration_s\":" << config.duration.count()
+       << ",\"mix\":{";
+  for (size_t i = 0; i < kWorkloadOperationsCount; ++i) {
+    file << (i > 0 ? "," : "") << "\"" << GetResultName(i) << "\":" << config.weights[i];
+  }
+  file << "}},\n  \"elapsed_s\": " << seconds << ",\n  \"failed\": " << result.failed
+       << ",\n  \"operations\": [";
+  bool is_first = true;
+  for (size_t i = 0; i < result.operations.size(); ++i) {
+    const auto& operation = result.operations[i];
+    if (operation.service.count == 0) {
+      continue;
+    }
+    file << (is_first ? "\n" : ",\n") << "    {\"name\":\"" << GetResultName(i)
+         << "\",\"requests\":" << operation.service.count
+         << ",\"throughput\":" << operation.service.count / seconds << ",\"response\":";
+    WriteLatencyJson(file, operation.response);
+    file << ",\"service\":";
+    WriteLatencyJson(file, operation.service);
+    file << "}";
+    is_first = false;
+  }
+  file << "\n  ]\n}\n";
+  return static_cast<bool>(file.flush());
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchmarkOptions options;
+  if (!ParseOptions(argc, argv, options)) {
+    std::cerr << "Usage: NamedPipeBench [--server <path to NamedPipeServer> | --pipe <pipe name>] "
+                 "[--duration <seconds>] [--threads <count>] [--rate <requests/s>] "
+                 "[--pool <connections>] [--instances <count>] "
+                 "[--mix <operation>=<weight>,...] [--json <path>]"
+              << std::endl;
+    return -1;
+  }
+  // the client logs every request otherwise:
+  Logger::SetLevel(LogLevel::Error);
+
+  std::vector<PROCESS_INFORMATION> processes;
+  if (!options.server_path.empty()) {
+    options.pipe_name = "\\\\.\\pipe\\load_benchmark_" + std::to_string(GetCurrentProcessId());
+    processes = StartServers(options.server_path, options.pipe_name, 1);
+    if (processes.empty()) {
+      return -1;
+    }
+  }
+
+  const auto result = RunBenchmark(options);
+  StopServers(processes);
+  if (result.operations.empty()) {
+    return -1;
+  }
+
+  PrintResult(options, result);
+  if (!options.json_path.empty() && !WriteJson(options.json_path, options, result)) {
+    std::cerr << "ERROR - failed to write " << options.json_path << std::endl;
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,158 @@
+// Measures the per-request cost of logging on the server's request path (RequestParser ->
+// CustomClassParser -> CustomClass::SetIntegerValue -> the response callback) for each runtime
+// log level, with the sync, the async and the binary Logger. The log streams are redirected to
+// nowhere, so only the cost of the formatting and the synchronization is measured.
+// Messages below NAMEDPIPE_MIN_LOG_LEVEL are compiled out - rebuild with
+// -DNAMEDPIPE_MIN_LOG_LEVEL=OFF to see the cost of the request without any logging.
+//
+// Usage: NamedPipeLogBench [threads] [requests per thread]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ClassRegistry.h"
+#include "CustomClass.h"
+#include "DataSerializer.h"
+#include "Logger.h"
+#include "RequestParser.h"
+#include "ServerResponse.h"
+
+namespace {
+
+constexpr size_t kInstancesCount = 1024;
+constexpr auto kBinaryLogPath = "NamedPipeLogBench.bin";
+
+// Discards everything written to the stream.
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+RawDataType CreateSetValueRequest(RequestId request_id, ClassHandle handle, int value) {
+  std::stringstream ss;
+  ss << "#r";
+  DataSerializer::Serialize<RequestId>(ss, request_id);
+  ss << "#";
+  DataSerializer::Serialize<std::string>(ss, CustomClass::kClassName);
+  DataSerializer::Serialize<ClassHandle>(ss, handle);
+  ss << "#m";
+  DataSerializer::Serialize<std::string>(ss, "SetIntegerValue");
+  DataSerializer::Serialize<int>(ss, value);
+  return DataSerializer::ConvertToRawData(ss.str());
+}
+
+struct BenchmarkResult {
+  std::string level;
+  std::string mode;
+  size_t requests = 0;
+  std::chrono::nanoseconds elapsed{0};
+};
+
+BenchmarkResult RunRequests(const std::string& level, const std::string& mode,
+                            const std::vector<RawDataType>& requests, size_t threads_count,
+                            size_t requests_per_thread) {
+  std::atomic_bool start = false;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&, t] {
+      const RequestParser parser(t);
+      while (!start) {
+        std::this_thread::yield();
+      }
+      for (size_t i = 0; i < requests_per_thread; ++i) {
+        ServerResponse response;
+        parser.ParseRequest(requests[(t * requests_per_thread + i) % requests.size()], response);
+        response.HandleSuccess(static_cast<ServerResponse::ClientId>(t));
+      }
+    });
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  start = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // the async messages are written, when the requests are already processed - include that:
+  Logger::StopAsync();
+
+  BenchmarkResult result;
+  result.level = level;
+  result.mode = mode;
+  result.requests = threads_count * requests_per_thread;
+  result.elapsed = std::chrono::steady_clock::now() - begin;
+  return result;
+}
+
+void PrintResult(const BenchmarkResult& result) {
+  const double seconds = std::chrono::duration<double>(result.elapsed).count();
+  const double throughput = seconds > 0 ? result.requests / seconds : 0.0;
+  const double ns_per_request =
+      result.requests > 0 ? static_cast<double>(result.elapsed.count()) / result.requests : 0;
+
+  std::cout << std::left << std::setw(8) << result.level << std::setw(8) << result.mode
+            << std::right << std::setw(12) << result.requests << std::setw(16) << std::fixed
+            << std::setprecision(0) << throughput << std::setw(14) << std::setprecision(1)
+            << ns_per_request << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t threads_count = argc > 1 ? std::stoul(argv[1]) : 8;
+  const size_t requests_per_thread = argc > 2 ? std::stoul(argv[2]) : 20000;
+
+  const std::vector<std::pair<std::string, LogLevel>> levels = {{"trace", LogLevel::Trace},
+                                                                {"debug", LogLevel::Debug},
+                                                                {"info", LogLevel::Info},
+                                                                {"error", LogLevel::Error},
+                                                                {"off", LogLevel::Off}};
+
+  // nothing is logged during the setup:
+  Logger::SetLevel(LogLevel::Off);
+  auto& registry = ClassRegistry<CustomClass>::GetInstance();
+  std::vector<RawDataType> requests;
+  for (size_t i = 0; i < kInstancesCount; ++i) {
+    const auto handle = registry.Create(static_cast<int>(i));
+    requests.push_back(CreateSetValueRequest(static_cast<RequestId>(i), handle, 42));
+  }
+
+  NullBuffer null_buffer;
+  auto* cout_buffer = std::cout.rdbuf(&null_buffer);
+  auto* cerr_buffer = std::cerr.rdbuf(&null_buffer);
+
+  std::vector<BenchmarkResult> results;
+  for (const auto& [name, level] : levels) {
+    Logger::SetLevel(level);
+    results.push_back(RunRequests(name, "sync", requests, threads_count, requests_per_thread));
+
+    LoggerConfig config;
+    config.overflow_policy = LogOverflowPolicy::Block;
+    Logger::StartAsync(config);
+    results.push_back(RunRequests(name, "async", requests, threads_count, requests_per_thread));
+
+    config.binary_log_path = kBinaryLogPath;
+    Logger::StartAsync(config);
+    results.push_back(RunRequests(name, "binary", requests, threads_count, requests_per_thread));
+  }
+  std::remove(kBinaryLogPath);
+
+  std::cout.rdbuf(cout_buffer);
+  std::cerr.rdbuf(cerr_buffer);
+
+  std::cout << "threads=" << threads_count << ", requests per thread=" << requests_per_thread
+            << ", compiled min level=" << NAMEDPIPE_MIN_LOG_LEVEL << " (0 - trace, 4 - off)\n\n"
+            << std::left << std::setw(8) << "level" << std::setw(8) << "logger" << std::right
+            << std::setw(12) << "requests" << std::setw(16) << "requests/s" << std::setw(14)
+            << "ns/request" << std::endl;
+  for (const auto& result : results) {
+    PrintResult(result);
+  }
+  return 0;
+}
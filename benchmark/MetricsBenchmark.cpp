@@ -0,0 +1,80 @@
+// Measures the cost of recording into the ServerMetrics from many threads at once: the latency
+// histogram alone, the StageTimer (the histogram plus two clock reads) and the traffic counters.
+// Every thread records into its own histograms, so the cost shouldn't grow with the threads.
+//
+// Usage: NamedPipeMetricsBench [threads] [events per thread]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ServerMetrics.h"
+
+namespace {
+
+// Returns nanoseconds per event.
+double RunThreads(size_t threads_count, size_t events_per_thread,
+                  const std::function<void(size_t)>& record) {
+  std::atomic_bool start = false;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&] {
+      // the thread's histograms are allocated on the first record:
+      record(0);
+      while (!start) {
+        std::this_thread::yield();
+      }
+      for (size_t i = 0; i < events_per_thread; ++i) {
+        record(i);
+      }
+    });
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  start = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const auto elapsed = std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - begin);
+  // threads run in parallel - the cost of one event is the time of one thread's event:
+  const auto parallel_threads =
+      std::max<size_t>(std::min<size_t>(threads_count, std::thread::hardware_concurrency()), 1);
+  return elapsed.count() * parallel_threads / (threads_count * events_per_thread);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t threads_count = argc > 1 ? std::stoul(argv[1]) : 8;
+  const size_t events_per_thread = argc > 2 ? std::stoul(argv[2]) : 10000000;
+  auto& metrics = ServerMetrics::GetInstance();
+
+  const std::vector<std::pair<std::string, std::function<void(size_t)>>> cases = {
+      {"histogram",
+       [&](size_t i) {
+         // latencies spread over ~1us..1ms:
+         const auto latency = std::chrono::nanoseconds(1000 + (i & 0xFFFFF));
+         metrics.RecordLatency(MetricsStage::Parse, latency);
+       }},
+      {"timer", [](size_t) { StageTimer timer(MetricsStage::Parse); }},
+      {"counters", [&](size_t i) { metrics.RecordRequest(64 + (i & 0xFF)); }}};
+
+  std::cout << "threads=" << threads_count << ", events per thread=" << events_per_thread
+            << "\n\n"
+            << std::left << std::setw(12) << "record" << std::right << std::setw(12)
+            << "ns/event" << std::endl;
+  for (const auto& [name, record] : cases) {
+    const auto ns_per_event = RunThreads(threads_count, events_per_thread, record);
+    std::cout << std::left << std::setw(12) << name << std::right << std::setw(12) << std::fixed
+              << std::setprecision(1) << ns_per_event << std::endl;
+  }
+
+  std::cout << "\n" << metrics.GetSnapshot().ToString();
+  return 0;
+}
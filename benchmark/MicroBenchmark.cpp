@@ -0,0 +1,833 @@
+// Microbenchmarks of the hot paths: DataSerializer and RegularTypeParaser for every value type in
+// both wire encodings (see WireFormat.h), CustomClass::Serialize/Deserialize,
+// RequestParser::ParseRequest on representative frames of both encodings,
+// ResponseParser::ParseResponse on representative frames, ClassRegistry::Create and
+// GetClassObjectByHandle from many threads at once, the PendingRequestTable of the client and a
+// tick of its deadlines, a read buffer of the BufferPool next to a freshly allocated one, and sync
+// round trips with the small values and the 16 KB strings between a Client and a Server, which
+// runs in this process.
+//
+// Every case reports ns/op and the heap allocations of the op - the count and the bytes - which
+// are counted by the replaced global operator new of this executable in all the threads. The
+// results can be saved as the baseline (--save-baseline) and compared with it on the next run
+// (--baseline): a case, which is slower by more than --threshold percent or allocates more, is
+// reported as a regression and the exit code is 1. The round trips with primitive values must
+// not allocate at all after the warm-up - otherwise they fail regardless of the baseline. They are
+// run for kRoundTripIterations requests, unless --iterations is given, and a round trip, which
+// didn't get its response (including a failed connect or create), fails the run as well.
+// The sizes of the representative request frames in both encodings are reported after the cases.
+//
+// Usage: NamedPipeMicrobench [--iterations <count>] [--threads <count>] [--filter <substring>]
+//                            [--baseline <path>] [--save-baseline <path>]
+//                            [--threshold <percent>]
+
+#include <windows.h>
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ClassRegistry.h"
+#include "BufferPool.h"
+#include "Client.h"
+#include "ClientRequest.h"
+#include "CustomClass.h"
+#include "DataDeserializer.h"
+#include "DataSerializer.h"
+#include "Logger.h"
+#include "PendingRequestTable.h"
+#include "RemoteCall.h"
+#include "RequestParser.h"
+#include "ResponseParser.h"
+#include "Server.h"
+#include "ServerResponse.h"
+
+namespace {
+
+// Heap allocations of one thread - every thread counts into its own slot, so the counting doesn't
+// contend, and the slots are summed up. Constant-initialized, so they are usable from the
+// operator new before anything else is constructed.
+struct alignas(64) AllocationCounters {
+  std::atomic<uint64_t> count = 0;
+  std::atomic<uint64_t> bytes = 0;
+};
+constexpr size_t kMaxCountedThreads = 256;
+AllocationCounters g_allocations[kMaxCountedThreads];
+std::atomic<size_t> g_counted_threads = 0;
+thread_local size_t t_allocations_slot = kMaxCountedThreads;
+
+struct AllocationTotals {
+  uint64_t count = 0;
+  uint64_t bytes = 0;
+};
+
+void CountAllocation(size_t size) {
+  if (t_allocations_slot == kMaxCountedThreads) {
+    // threads over the limit share the slots
+    t_allocations_slot = g_counted_threads.fetch_add(1) % kMaxCountedThreads;
+  }
+  auto& counters = g_allocations[t_allocations_slot];
+  counters.count.fetch_add(1, std::memory_order_relaxed);
+  counters.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+AllocationTotals GetAllocations() {
+  AllocationTotals totals;
+  const auto threads_count = std::min(g_counted_threads.load(), kMaxCountedThreads);
+  for (size_t i = 0; i < threads_count; ++i) {
+    totals.count += g_allocations[i].count.load(std::memory_order_relaxed);
+    totals.bytes += g_allocations[i].bytes.load(std::memory_order_relaxed);
+  }
+  return totals;
+}
+
+// Results of the ops are written here, so the compiler can't drop the ops.
+thread_local volatile size_t t_sink = 0;
+
+// Ops, which failed - e.g. the round trip, which didn't get the response. Any of them fails the
+// run, so the checks of the round trips can't pass without sending anything.
+std::atomic<uint64_t> g_failed_ops_count = 0;
+// Responses of the round trips, which are counted by their callbacks.
+std::atomic<uint64_t> g_responses_count = 0;
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  CountAllocation(size);
+  if (void* ptr = std::malloc(size > 0 ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return ::operator new(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+constexpr size_t kInstancesCount = 1024;
+constexpr size_t kDefaultIterations = 200000;
+// the round trips, which must not allocate, are run longer to catch the rare allocations
+constexpr size_t kRoundTripIterations = 1000000;
+// calls, which are joined by the WhenAll
+constexpr size_t kWhenAllCallsCount = 8;
+// deadline of the outstanding requests of the tick cases - far beyond the ticks of the run
+constexpr uint64_t kFarDeadlineTick = uint64_t{1} << 32;
+// More allocations per op than in the baseline are a regression (ops of the contended cases
+// amortize the growth of the containers, so their counts are fractional):
+constexpr double kAllocationsTolerance = 0.05;
+
+struct BenchmarkOptions {
+  // 0 - the default of the case
+  size_t iterations = 0;
+  size_t threads_count = 8;
+  std::string filter;
+  std::string baseline_path;
+  std::string save_baseline_path;
+  double threshold_percent = 10.0;
+};
+
+struct MicroCase {
+  std::string name;
+  // The case is run by BenchmarkOptions::threads_count threads at once.
+  bool is_contended = false;
+  // Runs the op the given number of times, the argument of the op is its index.
+  std::function<void(size_t first, size_t count)> run;
+  // Any allocation after the warm-up fails the case.
+  bool must_not_allocate = false;
+  // Iterations, unless they are given by --iterations. 0 - kDefaultIterations.
+  size_t default_iterations = 0;
+};
+
+struct MicroResult {
+  std::string name;
+  double ns_per_op = 0;
+  double bytes_per_op = 0;
+  double allocs_per_op = 0;
+  // allocations of all the ops
+  uint64_t allocations_count = 0;
+  // failed ops, including the warm-up ones
+  uint64_t failures_count = 0;
+};
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions& options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string arg = argv[i];
+    const std::string value = argv[i + 1];
+    if (arg == "--iterations") {
+      options.iterations = std::max<size_t>(std::stoul(value), 1);
+    } else if (arg == "--threads") {
+      options.threads_count = std::max<size_t>(std::stoul(value), 1);
+    } else if (arg == "--filter") {
+      options.filter = value;
+    } else if (arg == "--baseline") {
+      options.baseline_path = value;
+    } else if (arg == "--save-baseline") {
+      options.save_baseline_path = value;
+    } else if (arg == "--threshold") {
+      options.threshold_percent = std::stod(value);
+    } else {
+      std::cerr << "ERROR - unknown option=" << arg << std::endl;
+      return false;
+    }
+  }
+  return (argc % 2) == 1;
+}
+
+// ---- Frames:
+// <body> - the request, as it's passed to the Client, without the request id header.
+RawDataType CreateBody(const std::function<void(std::ostream&)>& body) {
+  std::stringstream ss;
+  body(ss);
+  return DataSerializer::ConvertToRawData(ss.str());
+}
+
+// #r<request id><body>
+RawDataType CreateFrame(const std::function<void(std::ostream&)>& body) {
+  std::stringstream ss;
+  ss << "#r";
+  DataSerializer::Serialize<RequestId>(ss, 1);
+  body(ss);
+  return DataSerializer::ConvertToRawData(ss.str());
+}
+
+// #<class name>[<handle>]#m<method>
+std::ostream& SerializeMethodCall(std::ostream& ss, ClassHandle handle,
+                                  const std::string& method) {
+  ss << "#";
+  DataSerializer::Serialize<std::string>(ss, CustomClass::kClassName);
+  DataSerializer::Serialize<ClassHandle>(ss, handle);
+  ss << "#m";
+  DataSerializer::Serialize<std::string>(ss, method);
+  return ss;
+}
+
+// #r<request id><call> - the frame of the typed call in the encoding.
+RawDataType CreateCallFrame(WireEncoding encoding,
+                            const std::function<void(RawDataType&, WireEncoding)>& call) {
+  RawDataType data;
+  data.push_back('#');
+  data.push_back('r');
+  DataSerializer::AppendToRawData<RequestId>(data, 1, encoding);
+  call(data, encoding);
+  return data;
+}
+
+// Representative typed calls, which are appended in the given encoding - both the compact request
+// cases and the frame sizes are of them.
+using AppendCall = std::function<void(RawDataType&, WireEncoding)>;
+
+std::vector<std::pair<std::string, AppendCall>> GetCalls(ClassHandle handle,
+                                                         const std::string& value) {
+  return {
+      {"create",
+       [](RawDataType& data, WireEncoding encoding) { AppendCreateCall(data, encoding); }},
+      {"set_integer_value",
+       [handle](RawDataType& data, WireEncoding encoding) {
+         AppendMethodCall<&CustomClass::SetIntegerValue>(data, encoding, handle, 7);
+       }},
+      {"set_string_value",
+       [handle, value](RawDataType& data, WireEncoding encoding) {
+         AppendMethodCall<&CustomClass::SetStringValue>(data, encoding, handle, value);
+       }},
+      {"print_to_string",
+       [handle](RawDataType& data, WireEncoding encoding) {
+         AppendMethodCall<&CustomClass::PrintToString>(data, encoding, handle);
+       }},
+      {"get",
+       [handle](RawDataType& data, WireEncoding encoding) {
+         data.push_back('#');
+         DataSerializer::AppendToRawData<std::string>(data, CustomClass::kClassName, encoding);
+         DataSerializer::AppendToRawData<ClassHandle>(data, handle, encoding);
+         data.push_back('#');
+         data.push_back('g');
+       }},
+  };
+}
+
+// ---- Cases:
+template <class Type>
+MicroCase CreateSerializeCase(const std::string& name, Type value) {
+  return MicroCase{"serialize/" + name, false, [value](size_t, size_t count) {
+                     for (size_t i = 0; i < count; ++i) {
+                       t_sink = DataSerializer::SerializeToRawData<Type>(value).size();
+                     }
+                   }};
+}
+
+// The compact cases are named parse/compact/<name>.
+template <class Type>
+MicroCase CreateParseCase(const std::string& name, Type value,
+                          WireEncoding encoding = WireEncoding::Fixed) {
+  RawDataType data;
+  DataSerializer::AppendToRawData<Type>(data, value, encoding);
+  return MicroCase{
+      std::string("parse/") + (encoding == WireEncoding::Compact ? "compact/" : "") + name, false,
+      [data = std::move(data)](size_t, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+          size_t idx = 0;
+          t_sink = RegularTypeParaser::Parse<Type>(data, idx).first ? idx : 0;
+        }
+      }};
+}
+
+MicroCase CreateRequestCase(const std::string& name, RawDataType frame) {
+  return MicroCase{"request/" + name, false, [frame = std::move(frame)](size_t, size_t count) {
+                     // the response is reused, as it's done by the Server
+                     const RequestParser parser(0);
+                     ServerResponse response;
+                     for (size_t i = 0; i < count; ++i) {
+                       t_sink = parser.ParseRequest(frame, response) ? 1 : 0;
+                     }
+                   }};
+}
+
+// The response is parsed for the registered request, as it's done by the Client.
+MicroCase CreateResponseCase(const std::string& name, RawDataType body) {
+  RawDataType frame = CreateFrame([&](std::ostream& ss) { ss.write(body.data(), body.size()); });
+  // the parser is created once, as its table of the requests is pre-sized
+  return MicroCase{"response/" + name, false,
+                   [frame = std::move(frame),
+                    parser = std::make_shared<ResponseParser>()](size_t, size_t count) {
+                     for (size_t i = 0; i < count; ++i) {
+                       parser->RegisterRequest(1, ClientRequest(RawDataType{}, true));
+                       t_sink = parser->ParseResponse(frame) ? 1 : 0;
+                     }
+                   }};
+}
+
+// Registering and completing a request from many threads at once, with or without a deadline.
+MicroCase CreatePendingCase(const std::string& name, uint64_t timeout_ticks) {
+  return MicroCase{"pending/" + name, true,
+                   [timeout_ticks](size_t first, size_t count) {
+                     static PendingRequestTable table;
+                     const ClientRequest request(RawDataType{}, true);
+                     for (size_t i = first; i < first + count; ++i) {
+                       const auto request_id = static_cast<RequestId>(i);
+                       table.Insert(request_id, request, 0, timeout_ticks);
+                       t_sink = table.Extract(request_id).first ? 1 : 0;
+                     }
+                   },
+                   true};
+}
+
+// A tick of the deadlines with many outstanding requests, which don't expire yet - its cost
+// doesn't depend on their number. The table is filled on the first run.
+MicroCase CreateTickCase(const std::string& name, size_t outstanding_count) {
+  return MicroCase{"pending/tick/outstanding:" + name, false,
+                   [outstanding_count](size_t, size_t count) {
+                     // outstanding count -> the table and its current tick
+                     static std::map<size_t, std::pair<std::unique_ptr<PendingRequestTable>,
+                                                       uint64_t>>
+                         tables;
+                     auto& [table, tick] = tables[outstanding_count];
+                     if (!table) {
+                       table = std::make_unique<PendingRequestTable>(outstanding_count * 2);
+                       const ClientRequest request(RawDataType{}, true);
+                       for (size_t i = 0; i < outstanding_count; ++i) {
+                         table->Insert(static_cast<RequestId>(i), request, 0,
+                                       kFarDeadlineTick + i);
+                       }
+                     }
+                     std::vector<std::pair<RequestId, ClientRequest>> expired;
+                     for (size_t i = 0; i < count; ++i) {
+                       table->ExtractExpired(++tick, expired);
+                       t_sink = expired.size();
+                     }
+                   },
+                   true};
+}
+
+// A read buffer of the async Pipe, which is shared with the response callback and released by
+// it: from the BufferPool or allocated for every read, as it was before the pool.
+MicroCase CreateReadBufferCase(const std::string& name, bool is_pooled, size_t size) {
+  return MicroCase{"buffer/" + name, false,
+                   [is_pooled, size](size_t, size_t count) {
+                     for (size_t i = 0; i < count; ++i) {
+                       if (is_pooled) {
+                         auto buffer = BufferPool::GetInstance().Acquire(size);
+                         buffer.GetMutableData().resize(size);
+                         const auto shared = buffer;
+                         t_sink = shared.GetData().size();
+                       } else {
+                         auto data = std::make_shared<RawDataType>(size);
+                         const auto shared = data;
+                         t_sink = shared->size();
+                       }
+                     }
+                   },
+                   is_pooled};
+}
+
+// Sync client of the Server, which runs in this process, so the allocations of both sides are
+// counted. The server is started on the first use and neither of them is stopped - the process
+// exits with them. nullptr - failed to connect, the round trips fail then.
+Client* GetRoundTripClient() {
+  static Client* client = [] {
+    const std::string pipe_name =
+        "\\\\.\\pipe\\NamedPipeMicrobench_" + std::to_string(GetCurrentProcessId());
+    std::thread([pipe_name] { Server(pipe_name).Start(); }).detach();
+    // the Client retries the connection only every 5 seconds:
+    for (size_t i = 0; i < 100 && !WaitNamedPipe(pipe_name.c_str(), NMPWAIT_USE_DEFAULT_WAIT);
+         ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto* client =
+        new Client(pipe_name, nullptr, std::make_shared<ResponseParser>(), ExecutionPolicy::Sync);
+    return client->Connect() ? client : nullptr;
+  }();
+  return client;
+}
+
+// body - the request without the request id header, which is added by the Client.
+// The large values are allocated by the parsers, so only the primitive ones must not allocate.
+MicroCase CreateRoundTripCase(const std::string& name, RawDataType body, bool wait_for_response,
+                              bool must_not_allocate = true) {
+  // the callback only counts the responses - it doesn't capture anything, so doesn't allocate
+  const ClientRequest request(
+      std::move(body), wait_for_response, [](std::any) { ++g_responses_count; }, nullptr);
+  return MicroCase{"roundtrip/" + name, false,
+                   [request, wait_for_response](size_t, size_t count) {
+                     auto* client = GetRoundTripClient();
+                     if (!client) {
+                       g_failed_ops_count += count;
+                       return;
+                     }
+                     for (size_t i = 0; i < count; ++i) {
+                       // the sync request is completed before Execute() returns
+                       const auto responses_count = g_responses_count.load();
+                       const bool success =
+                           client->Execute(request) &&
+                           (!wait_for_response || g_responses_count.load() > responses_count);
+                       if (!success) {
+                         ++g_failed_ops_count;
+                       }
+                     }
+                   },
+                   must_not_allocate, must_not_allocate ? kRoundTripIterations : 0};
+}
+
+// Instance for the round trips, which is created via the round trip client, so the client knows
+// its owner. -1 - failed to create.
+ClassHandle CreateRoundTripInstance() {
+  auto* client = GetRoundTripClient();
+  if (!client) {
+    return -1;
+  }
+  RawDataType body{'#'};
+  DataSerializer::AppendToRawData<std::string>(body, CustomClass::kClassName);
+  body.push_back('#');
+  body.push_back('c');
+  ClassHandle handle = -1;
+  client->Execute(ClientRequest(std::move(body), true,
+                                [&handle](std::any any) {
+                                  if (const auto* value = std::any_cast<int>(&any)) {
+                                    handle = *value;
+                                  }
+                                },
+                                nullptr));
+  return handle;
+}
+
+std::vector<MicroCase> CreateCases(const std::vector<ClassHandle>& handles,
+                                   ClassHandle round_trip_handle) {
+  const std::string kString = "The quick brown fox jumps over the lazy dog";
+  const std::string kLargeString(16 * 1024, 'x');
+  const ClassHandle handle = handles.front();
+  const CustomClass instance(42, kString);
+
+  std::vector<MicroCase> cases = {
+      CreateSerializeCase<bool>("bool", true),
+      CreateSerializeCase<int>("int", 123456789),
+      CreateSerializeCase<double>("double", 3.14159),
+      CreateSerializeCase<std::string>("string", kString),
+      CreateParseCase<bool>("bool", true),
+      CreateParseCase<int>("int", 123456789),
+      CreateParseCase<double>("double", 3.14159),
+      CreateParseCase<std::string>("string", kString),
+      CreateParseCase<bool>("bool", true, WireEncoding::Compact),
+      CreateParseCase<int>("int", 123456789, WireEncoding::Compact),
+      CreateParseCase<int>("int:small", 7, WireEncoding::Compact),
+      CreateParseCase<std::string>("string", kString, WireEncoding::Compact),
+      {"custom_class/serialize", false,
+       [instance](size_t, size_t count) {
+         for (size_t i = 0; i < count; ++i) {
+           t_sink = instance.Serialize().size();
+         }
+       }},
+      {"custom_class/deserialize", false,
+       [serialized = instance.Serialize()](size_t, size_t count) {
+         for (size_t i = 0; i < count; ++i) {
+           t_sink = CustomClass::Deserialize(serialized).ival_;
+         }
+       }},
+      CreateRequestCase("int",
+                        CreateFrame([](std::ostream& ss) {
+                          DataSerializer::Serialize<int>(ss, 123456789);
+                        })),
+      CreateRequestCase("string",
+                        CreateFrame([&](std::ostream& ss) {
+                          DataSerializer::Serialize<std::string>(ss, kString);
+                        })),
+      CreateRequestCase("create", CreateFrame([](std::ostream& ss) {
+                          ss << "#";
+                          DataSerializer::Serialize<std::string>(ss, CustomClass::kClassName);
+                          ss << "#c";
+                        })),
+      CreateRequestCase("set_integer_value", CreateFrame([&](std::ostream& ss) {
+                          SerializeMethodCall(ss, handle, "SetIntegerValue");
+                          DataSerializer::Serialize<int>(ss, 7);
+                        })),
+      CreateRequestCase("set_string_value", CreateFrame([&](std::ostream& ss) {
+                          SerializeMethodCall(ss, handle, "SetStringValue");
+                          DataSerializer::Serialize<std::string>(ss, kString);
+                        })),
+      CreateRequestCase("print_to_string", CreateFrame([&](std::ostream& ss) {
+                          SerializeMethodCall(ss, handle, "PrintToString");
+                        })),
+      CreateRequestCase("get", CreateFrame([&](std::ostream& ss) {
+                          ss << "#";
+                          DataSerializer::Serialize<std::string>(ss, CustomClass::kClassName);
+                          DataSerializer::Serialize<ClassHandle>(ss, handle);
+                          ss << "#g";
+                        })),
+      CreateResponseCase("bool", DataSerializer::SerializeToRawData<bool>(true)),
+      CreateResponseCase("int", DataSerializer::SerializeToRawData<int>(123456789)),
+      CreateResponseCase("string", DataSerializer::SerializeToRawData<std::string>(kString)),
+      CreatePendingCase("no_deadline", 0),
+      CreatePendingCase("deadline", 100),
+      CreateTickCase("1K", 1024),
+      CreateTickCase("256K", 256 * 1024),
+      CreateReadBufferCase("pooled:4K", true, 4 * 1024),
+      CreateReadBufferCase("allocated:4K", false, 4 * 1024),
+      {"registry/create", true,
+       [](size_t first, size_t count) {
+         auto& registry = ClassRegistry<CustomClass>::GetInstance();
+         for (size_t i = first; i < first + count; ++i) {
+           t_sink = registry.Create(static_cast<int>(i));
+         }
+       }},
+      {"registry/get", true,
+       [&handles](size_t first, size_t count) {
+         auto& registry = ClassRegistry<CustomClass>::GetInstance();
+         for (size_t i = first; i < first + count; ++i) {
+           t_sink = registry.GetClassObjectByHandle(handles[i % handles.size()]).lock() ? 1 : 0;
+         }
+       }},
+      CreateRoundTripCase("int", DataSerializer::SerializeToRawData<int>(123456789), false),
+      CreateRoundTripCase("set_integer_value",
+                          CreateBody([&](std::ostream& ss) {
+                            SerializeMethodCall(ss, round_trip_handle, "SetIntegerValue");
+                            DataSerializer::Serialize<int>(ss, 7);
+                          }),
+                          true),
+      // the string is set first - the get returns it
+      CreateRoundTripCase("set_string_value:16K",
+                          CreateBody([&](std::ostream& ss) {
+                            SerializeMethodCall(ss, round_trip_handle, "SetStringValue");
+                            DataSerializer::Serialize<std::string>(ss, kLargeString);
+                          }),
+                          true, false),
+      CreateRoundTripCase("get:16K",
+                          CreateBody([&](std::ostream& ss) {
+                            ss << "#";
+                            DataSerializer::Serialize<std::string>(ss, CustomClass::kClassName);
+                            DataSerializer::Serialize<ClassHandle>(ss, round_trip_handle);
+                            ss << "#g";
+                          }),
+                          true, false),
+      {"call/set_integer_value", false,
+       [round_trip_handle](size_t, size_t count) {
+         auto* client = GetRoundTripClient();
+         if (!client) {
+           g_failed_ops_count += count;
+           return;
+         }
+         for (size_t i = 0; i < count; ++i) {
+           const auto [success, value] =
+               client->Call<&CustomClass::SetIntegerValue>(round_trip_handle, 7).Get();
+           if (!success) {
+             ++g_failed_ops_count;
+           }
+           t_sink = value ? 1 : 0;
+         }
+       },
+       true, kRoundTripIterations},
+      {"call/when_all/calls:" + std::to_string(kWhenAllCallsCount), false,
+       [round_trip_handle](size_t, size_t count) {
+         auto* client = GetRoundTripClient();
+         if (!client) {
+           g_failed_ops_count += count;
+           return;
+         }
+         std::vector<CallFuture<bool>> futures;
+         for (size_t i = 0; i < count; ++i) {
+           futures.clear();
+           futures.reserve(kWhenAllCallsCount);
+           for (size_t call = 0; call < kWhenAllCallsCount; ++call) {
+             futures.push_back(client->Call<&CustomClass::SetIntegerValue>(
+                 round_trip_handle, static_cast<int>(call)));
+           }
+           if (!WhenAll(std::move(futures)).Get().first) {
+             ++g_failed_ops_count;
+           }
+         }
+       }},
+  };
+  // the fixed ones are the request cases above
+  for (const auto& [name, append] : GetCalls(handle, kString)) {
+    cases.push_back(
+        CreateRequestCase("compact/" + name, CreateCallFrame(WireEncoding::Compact, append)));
+  }
+  return cases;
+}
+
+// Bytes per request frame - the request id and the call - in both encodings.
+void PrintFrameSizes(ClassHandle handle, const std::string& filter) {
+  const std::string kString = "The quick brown fox jumps over the lazy dog";
+  bool is_header_printed = false;
+  for (const auto& [name, append] : GetCalls(handle, kString)) {
+    if (("frame/" + name).find(filter) == std::string::npos) {
+      continue;
+    }
+    if (!is_header_printed) {
+      std::cout << "\n"
+                << std::left << std::setw(36) << "frame" << std::right << std::setw(12)
+                << "fixed B" << std::setw(12) << "compact B" << std::endl;
+      is_header_printed = true;
+    }
+    std::cout << std::left << std::setw(36) << "frame/" + name << std::right << std::setw(12)
+              << CreateCallFrame(WireEncoding::Fixed, append).size() << std::setw(12)
+              << CreateCallFrame(WireEncoding::Compact, append).size() << std::endl;
+  }
+}
+
+// ---- Runs:
+MicroResult RunCase(const MicroCase& micro_case, size_t iterations) {
+  const auto failures = g_failed_ops_count.load();
+  micro_case.run(0, iterations / 10 + 1);  // warm-up
+
+  const auto allocations = GetAllocations();
+  const auto begin = std::chrono::steady_clock::now();
+  micro_case.run(0, iterations);
+  const auto elapsed =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin);
+  const auto allocations_after = GetAllocations();
+
+  MicroResult result;
+  result.name = micro_case.name;
+  result.ns_per_op = elapsed.count() / iterations;
+  result.allocations_count = allocations_after.count - allocations.count;
+  result.bytes_per_op =
+      static_cast<double>(allocations_after.bytes - allocations.bytes) / iterations;
+  result.allocs_per_op = static_cast<double>(result.allocations_count) / iterations;
+  result.failures_count = g_failed_ops_count.load() - failures;
+  return result;
+}
+
+MicroResult RunContendedCase(const MicroCase& micro_case, size_t threads_count,
+                             size_t iterations) {
+  const size_t ops_per_thread = std::max<size_t>(iterations / threads_count, 1);
+  const auto failures = g_failed_ops_count.load();
+  std::atomic_bool start = false;
+  std::atomic<size_t> warmed_up_count = 0;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&, t] {
+      const size_t first = t * ops_per_thread;
+      micro_case.run(first, ops_per_thread / 10 + 1);  // warm-up
+      ++warmed_up_count;
+      while (!start) {
+        std::this_thread::yield();
+      }
+      micro_case.run(first, ops_per_thread);
+    });
+  }
+
+  while (warmed_up_count < threads_count) {
+    std::this_thread::yield();
+  }
+  const auto allocations = GetAllocations();
+  const auto begin = std::chrono::steady_clock::now();
+  start = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const auto elapsed =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin);
+  const auto allocations_after = GetAllocations();
+  // threads run in parallel - the cost of one op is the time of one thread's op:
+  const auto parallel_threads =
+      std::max<size_t>(std::min<size_t>(threads_count, std::thread::hardware_concurrency()), 1);
+  const double ops_count = static_cast<double>(threads_count * ops_per_thread);
+
+  MicroResult result;
+  result.name = micro_case.name + "/threads:" + std::to_string(threads_count);
+  result.ns_per_op = elapsed.count() * parallel_threads / ops_count;
+  result.allocations_count = allocations_after.count - allocations.count;
+  result.bytes_per_op = (allocations_after.bytes - allocations.bytes) / ops_count;
+  result.allocs_per_op = result.allocations_count / ops_count;
+  result.failures_count = g_failed_ops_count.load() - failures;
+  return result;
+}
+
+// ---- Baseline:
+// One line per case: <name> <ns/op> <bytes/op> <allocs/op>, lines starting with '#' are comments.
+std::map<std::string, MicroResult> LoadBaseline(const std::string& path) {
+  std::map<std::string, MicroResult> baseline;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    MicroResult result;
+    std::istringstream ss(line);
+    if (ss >> result.name >> result.ns_per_op >> result.bytes_per_op >> result.allocs_per_op) {
+      baseline[result.name] = result;
+    }
+  }
+  return baseline;
+}
+
+bool SaveBaseline(const std::string& path, const std::vector<MicroResult>& results) {
+  std::ofstream file(path, std::ios::trunc);
+  file << "# NamedPipeMicrobench baseline: <name> <ns/op> <bytes/op> <allocs/op>\n"
+       << std::fixed << std::setprecision(2);
+  for (const auto& result : results) {
+    file << result.name << " " << result.ns_per_op << " " << result.bytes_per_op << " "
+         << result.allocs_per_op << "\n";
+  }
+  return static_cast<bool>(file.flush());
+}
+
+bool IsRegression(const MicroResult& result, const MicroResult& baseline,
+                  double threshold_percent) {
+  return result.ns_per_op > baseline.ns_per_op * (1.0 + threshold_percent / 100.0) ||
+         result.allocs_per_op > baseline.allocs_per_op + kAllocationsTolerance;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchmarkOptions options;
+  if (!ParseOptions(argc, argv, options)) {
+    std::cerr << "Usage: NamedPipeMicrobench [--iterations <count>] [--threads <count>] "
+                 "[--filter <substring>] [--baseline <path>] [--save-baseline <path>] "
+                 "[--threshold <percent>]"
+              << std::endl;
+    return -1;
+  }
+
+  // only the cost of the ops is measured, not the cost of the console:
+  Logger::SetLevel(LogLevel::Off);
+  std::vector<ClassHandle> handles;
+  for (size_t i = 0; i < kInstancesCount; ++i) {
+    handles.push_back(ClassRegistry<CustomClass>::GetInstance().Create(static_cast<int>(i)));
+  }
+
+  std::map<std::string, MicroResult> baseline;
+  if (!options.baseline_path.empty()) {
+    baseline = LoadBaseline(options.baseline_path);
+    if (baseline.empty()) {
+      std::cerr << "ERROR - no results in the baseline=" << options.baseline_path << std::endl;
+      return -1;
+    }
+  }
+
+  std::cout << "iterations="
+            << (options.iterations > 0 ? std::to_string(options.iterations)
+                                       : std::to_string(kDefaultIterations) + " (round trips " +
+                                             std::to_string(kRoundTripIterations) + ")")
+            << ", threads=" << options.threads_count
+            << "\n\n"
+            << std::left << std::setw(36) << "case" << std::right << std::setw(12) << "ns/op"
+            << std::setw(12) << "B/op" << std::setw(12) << "allocs/op"
+            << (baseline.empty() ? "" : "    vs baseline") << std::endl;
+
+  // the round trips with the invalid handle fail, so does the run
+  const auto round_trip_handle = CreateRoundTripInstance();
+  if (round_trip_handle < 0) {
+    std::cerr << "ERROR - failed to create the instance of the round trips" << std::endl;
+  }
+
+  std::vector<MicroResult> results;
+  size_t regressions_count = 0;
+  size_t allocating_count = 0;
+  size_t failed_count = 0;
+  for (const auto& micro_case : CreateCases(handles, round_trip_handle)) {
+    if (micro_case.name.find(options.filter) == std::string::npos) {
+      continue;
+    }
+    const size_t iterations =
+        options.iterations > 0 ? options.iterations
+        : micro_case.default_iterations > 0 ? micro_case.default_iterations
+                                            : kDefaultIterations;
+    const auto result = micro_case.is_contended
+                            ? RunContendedCase(micro_case, options.threads_count, iterations)
+                            : RunCase(micro_case, iterations);
+    results.push_back(result);
+
+    std::cout << std::left << std::setw(36) << result.name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(12) << result.ns_per_op << std::setw(12)
+              << result.bytes_per_op << std::setw(12) << std::setprecision(2)
+              << result.allocs_per_op;
+    if (auto iter = baseline.find(result.name); iter != baseline.end()) {
+      const double change = (result.ns_per_op / iter->second.ns_per_op - 1.0) * 100.0;
+      std::cout << std::setw(10) << std::showpos << std::setprecision(1) << change << "%"
+                << std::noshowpos;
+      if (IsRegression(result, iter->second, options.threshold_percent)) {
+        std::cout << "  REGRESSION";
+        ++regressions_count;
+      }
+    } else if (!baseline.empty()) {
+      std::cout << "       new";
+    }
+    if (micro_case.must_not_allocate && result.allocations_count > 0) {
+      std::cout << "  ALLOCATES";
+      ++allocating_count;
+    }
+    if (result.failures_count > 0) {
+      std::cout << "  FAILED " << result.failures_count << " op(s)";
+      ++failed_count;
+    }
+    std::cout << std::endl;
+  }
+
+  PrintFrameSizes(handles.front(), options.filter);
+
+  if (!options.save_baseline_path.empty() &&
+      !SaveBaseline(options.save_baseline_path, results)) {
+    std::cerr << "ERROR - failed to write " << options.save_baseline_path << std::endl;
+    return -1;
+  }
+  if (allocating_count > 0) {
+    std::cout << "\n"
+              << allocating_count << " case(s) allocate, but must not after the warm-up"
+              << std::endl;
+  }
+  if (failed_count > 0) {
+    std::cout << "\n"
+              << failed_count << " case(s) failed - their checks are not valid" << std::endl;
+  }
+  if (regressions_count > 0) {
+    std::cout << "\n" << regressions_count << " regression(s) against " << options.baseline_path
+              << " (threshold " << options.threshold_percent << "%)" << std::endl;
+  }
+  return regressions_count > 0 || allocating_count > 0 || failed_count > 0 ? 1 : 0;
+}
@@ -0,0 +1,250 @@
+// Goodput of the overloaded server with and without the deadline propagation (see
+// RequestControl.h): an async Client sends PrintToString calls at a fixed rate, which is a few
+// times the capacity of the server, and every call has a timeout. Without the propagation the
+// server executes and answers every queued call, so the queue grows and, soon, every response
+// comes after its timeout - the server is busy with the calls, which nobody waits for. With it
+// the server drops the expired and the cancelled calls, and spends its time on the ones, which
+// can still be answered in time. With the admission control (see AdmissionControl.h) the server
+// also rejects the calls, which have waited too long, and the client backs off, so the latency
+// of the succeeded calls stays bounded by the admission target instead of the timeout.
+// The capacity is measured first by the sync calls one by one, then every case runs a fresh
+// NamedPipeServer process, so the backlog of the previous case doesn't affect it.
+// goodput - calls, which were completed successfully (before their timeout), per second of the
+// sending. rejected - calls, which were rejected as busy. p99 - latency of the succeeded calls.
+//
+// Usage: NamedPipeOverloadBench <path to NamedPipeServer> [seconds] [overload factor]
+//                               [timeout ms] [admission target us]
+
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Client.h"
+#include "ClientRequest.h"
+#include "CustomClass.h"
+#include "RemoteCall.h"
+#include "ResponseParser.h"
+#include "ServerProcess.h"
+
+namespace {
+
+constexpr std::chrono::seconds kCapacityDuration{1};
+
+// Completions of the calls - shared with the callbacks, which can be called after the case.
+struct CallCounters {
+  std::atomic<uint64_t> succeeded = 0;
+  std::atomic<uint64_t> failed = 0;
+  std::atomic<uint64_t> rejected = 0;
+  std::mutex mutex;
+  // of the succeeded calls
+  std::vector<std::chrono::steady_clock::duration> latencies;
+};
+
+struct OverloadResult {
+  std::string name;
+  uint64_t sent = 0;
+  uint64_t succeeded = 0;
+  uint64_t failed = 0;
+  uint64_t rejected = 0;
+  std::chrono::steady_clock::duration p99_latency{0};
+  std::chrono::nanoseconds elapsed{0};
+};
+
+// Case of the benchmark: the client and the server options.
+struct OverloadCase {
+  std::string name;
+  bool propagate_deadlines = false;
+  std::string server_arguments;
+};
+
+std::string GetPipeName(const std::string& name) {
+  return "\\\\.\\pipe\\overload_benchmark_" + name + "_" +
+         std::to_string(GetCurrentProcessId());
+}
+
+RawDataType CreateCallData(ClassHandle handle) {
+  RawDataType data;
+  AppendMethodCall<&CustomClass::PrintToString>(data, handle);
+  return data;
+}
+
+// Calls per second, which the server completes one by one.
+double MeasureCapacity(const std::string& server_path) {
+  const auto pipe_name = GetPipeName("capacity");
+  auto processes = StartServers(server_path, pipe_name, 1);
+  if (processes.empty()) {
+    return 0;
+  }
+
+  double capacity = 0;
+  {
+    Client client(pipe_name, nullptr, std::make_shared<ResponseParser>(), ExecutionPolicy::Sync);
+    const auto [success, handle] =
+        client.Connect() ? client.Create(52, "overload").Get() : std::make_pair(false, -1);
+    if (success) {
+      const auto data = CreateCallData(handle);
+      uint64_t count = 0;
+      const auto begin = std::chrono::steady_clock::now();
+      auto now = begin;
+      for (; now - begin < kCapacityDuration; now = std::chrono::steady_clock::now()) {
+        if (client.Execute(ClientRequest(data, true))) {
+          ++count;
+        }
+      }
+      capacity = count / std::chrono::duration<double>(now - begin).count();
+    } else {
+      std::cerr << "ERROR - failed to create an instance" << std::endl;
+    }
+  }
+  StopServers(processes);
+  return capacity;
+}
+
+OverloadResult RunCase(const OverloadCase& overload_case, const std::string& server_path,
+                       double rate, std::chrono::seconds duration,
+                       std::chrono::milliseconds timeout) {
+  OverloadResult result;
+  result.name = overload_case.name;
+  // a pipe per case, so the late writes of the previous one don't reach the server
+  static size_t case_index = 0;
+  const auto pipe_name = GetPipeName("case" + std::to_string(case_index++));
+  auto processes = StartServers(server_path, pipe_name, 1, overload_case.server_arguments);
+  if (processes.empty()) {
+    return result;
+  }
+
+  auto counters = std::make_shared<CallCounters>();
+  {
+    Client client(pipe_name, nullptr, std::make_shared<ResponseParser>(), ExecutionPolicy::Async);
+    const auto [success, handle] =
+        client.Connect() ? client.Create(52, "overload").Get() : std::make_pair(false, -1);
+    if (!success) {
+      std::cerr << "ERROR - failed to create an instance" << std::endl;
+      StopServers(processes);
+      return result;
+    }
+    client.SetRequestTimeout(timeout);
+    client.SetDeadlinePropagation(overload_case.propagate_deadlines);
+
+    const auto data = CreateCallData(handle);
+    auto on_failure = [counters](int error) {
+      ++counters->failed;
+      if (error == ERROR_BUSY) {
+        ++counters->rejected;
+      }
+    };
+    const auto interval = std::chrono::duration<double, std::nano>(1e9 / rate);
+    const auto begin = std::chrono::steady_clock::now();
+    const auto end = begin + duration;
+    // open loop - the calls are sent on schedule, no matter how many are outstanding
+    for (uint64_t sequence = 0;; ++sequence) {
+      const auto intended =
+          begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      interval * static_cast<double>(sequence));
+      if (intended >= end) {
+        break;
+      }
+      while (std::chrono::steady_clock::now() < intended) {
+        std::this_thread::yield();
+      }
+      const auto send_time = std::chrono::steady_clock::now();
+      auto on_success = [counters, send_time](std::any) {
+        const auto latency = std::chrono::steady_clock::now() - send_time;
+        ++counters->succeeded;
+        std::lock_guard<std::mutex> locker(counters->mutex);
+        counters->latencies.push_back(latency);
+      };
+      if (client.Execute(ClientRequest(data, true, on_success, on_failure))) {
+        ++result.sent;
+      }
+    }
+    result.elapsed = std::chrono::steady_clock::now() - begin;
+
+    // every call is completed by its response or by its timeout
+    const auto drain_end = std::chrono::steady_clock::now() + timeout + std::chrono::seconds(2);
+    while (counters->succeeded + counters->failed < result.sent &&
+           std::chrono::steady_clock::now() < drain_end) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    result.succeeded = counters->succeeded;
+    result.failed = counters->failed;
+    result.rejected = counters->rejected;
+    std::lock_guard<std::mutex> locker(counters->mutex);
+    auto& latencies = counters->latencies;
+    if (!latencies.empty()) {
+      const auto p99 = std::next(latencies.begin(), latencies.size() * 99 / 100);
+      std::nth_element(latencies.begin(), p99, latencies.end());
+      result.p99_latency = *p99;
+    }
+  }
+  StopServers(processes);
+  return result;
+}
+
+void PrintResult(const OverloadResult& result) {
+  const double seconds = std::chrono::duration<double>(result.elapsed).count();
+  const double goodput = seconds > 0 ? result.succeeded / seconds : 0.0;
+  const double succeeded_percent =
+      result.sent > 0 ? 100.0 * result.succeeded / static_cast<double>(result.sent) : 0.0;
+
+  const double p99_ms = std::chrono::duration<double, std::milli>(result.p99_latency).count();
+
+  std::cout << std::left << std::setw(28) << result.name << std::right << std::setw(10)
+            << result.sent << std::setw(12) << result.succeeded << std::setw(10)
+            << result.failed << std::setw(10) << result.rejected << std::setw(12) << std::fixed
+            << std::setprecision(1) << succeeded_percent << std::setw(14)
+            << std::setprecision(0) << goodput << std::setw(10) << std::setprecision(1) << p99_ms
+            << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: NamedPipeOverloadBench <path to NamedPipeServer> [seconds] "
+                 "[overload factor] [timeout ms] [admission target us]"
+              << std::endl;
+    return -1;
+  }
+
+  const std::string server_path = argv[1];
+  const auto duration = std::chrono::seconds(argc > 2 ? std::stoul(argv[2]) : 5);
+  const double overload_factor = argc > 3 ? std::max(std::stod(argv[3]), 1.0) : 3.0;
+  const auto timeout = std::chrono::milliseconds(argc > 4 ? std::stoul(argv[4]) : 50);
+  const auto admission_target = argc > 5 ? std::stoul(argv[5]) : 5000;
+
+  const auto capacity = MeasureCapacity(server_path);
+  if (capacity <= 0) {
+    return -1;
+  }
+  const auto rate = capacity * overload_factor;
+
+  const std::vector<OverloadCase> cases = {
+      {"without deadlines", false, ""},
+      {"with deadlines and cancels", true, ""},
+      {"with admission control", true,
+       "--admission-target " + std::to_string(admission_target)}};
+  std::vector<OverloadResult> results;
+  for (const auto& overload_case : cases) {
+    results.push_back(RunCase(overload_case, server_path, rate, duration, timeout));
+  }
+
+  std::cout << "\ncapacity=" << std::fixed << std::setprecision(0) << capacity
+            << " calls/s offered=" << rate << " calls/s timeout=" << timeout.count()
+            << "ms admission target=" << admission_target << "us duration=" << duration.count()
+            << "s\n\n"
+            << std::left << std::setw(28) << "case" << std::right << std::setw(10) << "sent"
+            << std::setw(12) << "succeeded" << std::setw(10) << "failed" << std::setw(10)
+            << "rejected" << std::setw(12) << "succeeded%" << std::setw(14) << "goodput/s"
+            << std::setw(10) << "p99 ms" << std::endl;
+  for (const auto& result : results) {
+    PrintResult(result);
+  }
+  return 0;
+}
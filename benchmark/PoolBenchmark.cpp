@@ -0,0 +1,159 @@
+// Measures the aggregate request throughput of one Client shared by many application threads,
+// depending on the number of the threads and the size of the connection pool.
+// Starts a NamedPipeServer process on a private pipe name. For each pool size one sync client
+// creates some instances, then every thread calls SetIntegerValue on them via Client::Execute().
+// The client logs every request, the results table is printed at the end.
+//
+// Usage: NamedPipePoolBench <path to NamedPipeServer> [requests per thread] [max threads]
+//                           [max pool size]
+
+#include <windows.h>
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Client.h"
+#include "ClientRequest.h"
+#include "CustomClass.h"
+#include "DataSerializer.h"
+#include "ResponseParser.h"
+#include "ServerProcess.h"
+
+namespace {
+
+constexpr size_t kInstancesCount = 64;
+
+ClientRequest CreateInstanceRequest(std::mutex& mutex, std::vector<ClassHandle>& handles) {
+  std::stringstream ss;
+  ss << "#";
+  DataSerializer::Serialize<std::string>(ss, CustomClass::kClassName);
+  ss << "#c";
+  auto on_created = [&mutex, &handles](std::any any) {
+    std::lock_guard<std::mutex> locker(mutex);
+    handles.push_back(std::any_cast<int>(any));
+  };
+  return ClientRequest{DataSerializer::ConvertToRawData(ss.str()), true, on_created, nullptr};
+}
+
+ClientRequest CreateSetValueRequest(ClassHandle handle, int value) {
+  std::stringstream ss;
+  ss << "#";
+  DataSerializer::Serialize<std::string>(ss, CustomClass::kClassName);
+  DataSerializer::Serialize<ClassHandle>(ss, handle);
+  ss << "#m";
+  DataSerializer::Serialize<std::string>(ss, "SetIntegerValue");
+  DataSerializer::Serialize<int>(ss, value);
+  return ClientRequest{DataSerializer::ConvertToRawData(ss.str()), true};
+}
+
+struct BenchmarkResult {
+  size_t pool_size = 0;
+  size_t threads_count = 0;
+  size_t requests = 0;
+  std::chrono::nanoseconds elapsed{0};
+};
+
+std::vector<BenchmarkResult> RunPool(const std::string& pipe_name, size_t pool_size,
+                                     size_t max_threads, size_t requests_per_thread) {
+  std::vector<BenchmarkResult> results;
+  Client client(pipe_name, nullptr, std::make_shared<ResponseParser>(), ExecutionPolicy::Sync,
+                1, pool_size);
+  if (!client.Connect()) {
+    std::cerr << "ERROR - failed to connect to " << pipe_name << std::endl;
+    return results;
+  }
+
+  std::mutex handles_mutex;
+  std::vector<ClassHandle> handles;
+  for (size_t i = 0; i < kInstancesCount; ++i) {
+    client.Execute(CreateInstanceRequest(handles_mutex, handles));
+  }
+  if (handles.empty()) {
+    std::cerr << "ERROR - failed to create instances" << std::endl;
+    return results;
+  }
+
+  for (size_t threads_count = 1; threads_count <= max_threads; threads_count *= 2) {
+    std::atomic<size_t> requests = 0;
+    std::vector<std::thread> threads;
+    const auto begin = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads_count; ++t) {
+      threads.emplace_back([&, t] {
+        size_t succeeded = 0;
+        for (size_t i = 0; i < requests_per_thread; ++i) {
+          const auto handle = handles[(t * requests_per_thread + i) % handles.size()];
+          if (client.Execute(CreateSetValueRequest(handle, static_cast<int>(i)))) {
+            ++succeeded;
+          }
+        }
+        requests += succeeded;
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    BenchmarkResult result;
+    result.pool_size = pool_size;
+    result.threads_count = threads_count;
+    result.elapsed = std::chrono::steady_clock::now() - begin;
+    result.requests = requests;
+    results.push_back(result);
+  }
+  return results;
+}
+
+void PrintResult(const BenchmarkResult& result) {
+  const double seconds = std::chrono::duration<double>(result.elapsed).count();
+  const double throughput = seconds > 0 ? result.requests / seconds : 0.0;
+
+  std::cout << std::setw(8) << result.pool_size << std::setw(10) << result.threads_count
+            << std::setw(12) << result.requests << std::setw(14) << std::fixed
+            << std::setprecision(1) << seconds * 1000 << std::setw(16) << std::setprecision(0)
+            << throughput << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: NamedPipePoolBench <path to NamedPipeServer> [requests per thread] "
+                 "[max threads] [max pool size]"
+              << std::endl;
+    return -1;
+  }
+
+  const std::string server_path = argv[1];
+  const size_t requests_per_thread = argc > 2 ? std::stoul(argv[2]) : 2000;
+  const size_t max_threads = argc > 3 ? std::stoul(argv[3]) : 16;
+  const size_t max_pool_size = argc > 4 ? std::stoul(argv[4]) : 8;
+
+  const std::string pipe_name =
+      "\\\\.\\pipe\\pool_benchmark_" + std::to_string(GetCurrentProcessId());
+  auto processes = StartServers(server_path, pipe_name, 1);
+  if (processes.empty()) {
+    return -1;
+  }
+
+  std::vector<BenchmarkResult> results;
+  for (size_t pool_size = 1; pool_size <= max_pool_size; pool_size *= 2) {
+    auto pool_results = RunPool(pipe_name, pool_size, max_threads, requests_per_thread);
+    results.insert(results.end(), pool_results.begin(), pool_results.end());
+  }
+  StopServers(processes);
+
+  std::cout << "\nrequests per thread=" << requests_per_thread << "\n\n"
+            << std::setw(8) << "pool" << std::setw(10) << "threads" << std::setw(12)
+            << "requests" << std::setw(14) << "elapsed, ms" << std::setw(16) << "requests/s"
+            << std::endl;
+  for (const auto& result : results) {
+    PrintResult(result);
+  }
+  return 0;
+}
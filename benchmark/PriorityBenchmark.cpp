@@ -0,0 +1,224 @@
+// Latency of the urgent reads next to a bulk load on the same connection, with and without the
+// priorities of the requests (see SendLanes.h and FrameQueue.h). One async Client with a single
+// connection keeps a fixed number of the bulk requests outstanding - creates and SetStringValue
+// calls with large values, which are sent in chunks - and reads an instance via #g every
+// millisecond, waiting for each read. Without the priorities the read is queued behind the bulk
+// frames in the client and on the server; with the high priority it overtakes them, and waits
+// for a few chunks, which are already written, at most.
+// Every case runs a fresh NamedPipeServer process.
+//
+// Usage: NamedPipePriorityBench <path to NamedPipeServer> [seconds] [bulk outstanding]
+//                               [value bytes]
+
+#include <windows.h>
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Client.h"
+#include "ClientRequest.h"
+#include "CustomClass.h"
+#include "DataSerializer.h"
+#include "LatencyHistogram.h"
+#include "RemoteCall.h"
+#include "ResponseParser.h"
+#include "ServerProcess.h"
+
+namespace {
+
+constexpr std::chrono::milliseconds kReadInterval{1};
+
+struct PriorityCase {
+  std::string name;
+  bool has_bulk_load = false;
+  RequestPriority read_priority = RequestPriority::Normal;
+  RequestPriority bulk_priority = RequestPriority::Normal;
+};
+
+struct PriorityResult {
+  std::string name;
+  HistogramSnapshot latencies;
+  uint64_t bulk_calls = 0;
+  std::chrono::nanoseconds elapsed{0};
+};
+
+// Completions of the bulk calls - shared with the callbacks, which can be called after the case.
+struct BulkCounters {
+  std::atomic<uint64_t> outstanding = 0;
+  std::atomic<uint64_t> completed = 0;
+};
+
+std::string GetPipeName(size_t case_index) {
+  return "\\\\.\\pipe\\priority_benchmark_" + std::to_string(case_index) + "_" +
+         std::to_string(GetCurrentProcessId());
+}
+
+// #<class name><handle>#g - the request of the serialized instance.
+RawDataType CreateGetData(ClassHandle handle) {
+  RawDataType data;
+  data.push_back('#');
+  DataSerializer::AppendToRawData<std::string>(data, CustomClass::kClassName);
+  DataSerializer::AppendToRawData<ClassHandle>(data, handle);
+  data.push_back('#');
+  data.push_back('g');
+  return data;
+}
+
+// Sends the creates and the uploads one after another till the stop flag is set.
+void RunBulkLoad(Client& client, ClassHandle handle, size_t bulk_outstanding, size_t value_bytes,
+                 RequestPriority priority, const std::atomic<bool>& is_stopped,
+                 std::shared_ptr<BulkCounters> counters) {
+  auto on_completed = [counters](auto) {
+    --counters->outstanding;
+    ++counters->completed;
+  };
+  RawDataType create_data;
+  AppendCreateCall(create_data, 1, std::string("bulk"));
+  RawDataType upload_data;
+  AppendMethodCall<&CustomClass::SetStringValue>(upload_data, handle,
+                                                 std::string(value_bytes, 'b'));
+  std::vector<ClientRequest> requests = {
+      ClientRequest(create_data, true, on_completed, on_completed),
+      ClientRequest(upload_data, true, on_completed, on_completed)};
+  for (auto& request : requests) {
+    request.SetPriority(priority);
+  }
+
+  for (size_t sequence = 0; !is_stopped.load();) {
+    if (counters->outstanding.load() >= bulk_outstanding) {
+      std::this_thread::yield();
+      continue;
+    }
+    // the failed call is completed by its failure callback too
+    ++counters->outstanding;
+    client.Execute(requests[sequence++ % requests.size()]);
+  }
+}
+
+// Sends the read and waits for its response. Returns false, if the read has failed.
+bool ExecuteRead(Client& client, const RawDataType& data, RequestPriority priority) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  auto future = promise->get_future();
+  ClientRequest request(
+      data, true, [promise](std::any) { promise->set_value(true); },
+      [promise](int) { promise->set_value(false); });
+  request.SetPriority(priority);
+  return client.Execute(request) && future.get();
+}
+
+PriorityResult RunCase(const PriorityCase& priority_case, size_t case_index,
+                       const std::string& server_path, std::chrono::seconds duration,
+                       size_t bulk_outstanding, size_t value_bytes) {
+  PriorityResult result;
+  result.name = priority_case.name;
+  const auto pipe_name = GetPipeName(case_index);
+  auto processes = StartServers(server_path, pipe_name, 1);
+  if (processes.empty()) {
+    return result;
+  }
+
+  auto counters = std::make_shared<BulkCounters>();
+  {
+    // one connection - the reads and the bulk load share it
+    Client client(pipe_name, nullptr, std::make_shared<ResponseParser>(), ExecutionPolicy::Async);
+    const auto [read_success, read_handle] =
+        client.Connect() ? client.Create(1, "read").Get() : std::make_pair(false, -1);
+    const auto [bulk_success, bulk_handle] = client.Create(2, "bulk").Get();
+    if (!read_success || !bulk_success) {
+      std::cerr << "ERROR - failed to create the instances" << std::endl;
+      StopServers(processes);
+      return result;
+    }
+
+    std::atomic<bool> is_stopped = false;
+    std::thread bulk_thread;
+    if (priority_case.has_bulk_load) {
+      bulk_thread = std::thread(RunBulkLoad, std::ref(client), bulk_handle, bulk_outstanding,
+                                value_bytes, priority_case.bulk_priority, std::cref(is_stopped),
+                                counters);
+      // the bulk load fills the lanes and the pipe first
+      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+
+    const auto data = CreateGetData(read_handle);
+    LatencyHistogram histogram;
+    const auto bulk_begin = counters->completed.load();
+    const auto begin = std::chrono::steady_clock::now();
+    auto next_read = begin;
+    while (std::chrono::steady_clock::now() - begin < duration) {
+      std::this_thread::sleep_until(next_read);
+      next_read += kReadInterval;
+
+      const auto read_begin = std::chrono::steady_clock::now();
+      if (ExecuteRead(client, data, priority_case.read_priority)) {
+        histogram.Record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - read_begin)
+                .count()));
+      }
+    }
+    result.elapsed = std::chrono::steady_clock::now() - begin;
+    result.bulk_calls = counters->completed.load() - bulk_begin;
+    result.latencies.Add(histogram);
+
+    is_stopped = true;
+    if (bulk_thread.joinable()) {
+      bulk_thread.join();
+    }
+  }
+  StopServers(processes);
+  return result;
+}
+
+void PrintResult(const PriorityResult& result) {
+  const double seconds = std::chrono::duration<double>(result.elapsed).count();
+  const auto& latencies = result.latencies;
+  std::cout << std::left << std::setw(30) << result.name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(10) << latencies.count << std::setw(10)
+            << latencies.GetPercentile(50) / 1e3 << std::setw(10)
+            << latencies.GetPercentile(99) / 1e3 << std::setw(10)
+            << latencies.GetPercentile(99.9) / 1e3 << std::setw(14) << std::setprecision(0)
+            << (seconds > 0 ? result.bulk_calls / seconds : 0.0) << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: NamedPipePriorityBench <path to NamedPipeServer> [seconds] "
+                 "[bulk outstanding] [value bytes]"
+              << std::endl;
+    return -1;
+  }
+
+  const std::string server_path = argv[1];
+  const auto duration = std::chrono::seconds(argc > 2 ? std::stoul(argv[2]) : 5);
+  const size_t bulk_outstanding = argc > 3 ? std::stoul(argv[3]) : 64;
+  const size_t value_bytes = argc > 4 ? std::stoul(argv[4]) : 16 * 1024;
+
+  const std::vector<PriorityCase> cases = {
+      {"idle", false, RequestPriority::Normal, RequestPriority::Normal},
+      {"bulk load, same priority", true, RequestPriority::Normal, RequestPriority::Normal},
+      {"bulk load, high priority", true, RequestPriority::High, RequestPriority::Bulk}};
+  std::vector<PriorityResult> results;
+  for (size_t i = 0; i < cases.size(); ++i) {
+    results.push_back(
+        RunCase(cases[i], i, server_path, duration, bulk_outstanding, value_bytes));
+  }
+
+  std::cout << "\nbulk outstanding=" << bulk_outstanding << " value=" << value_bytes
+            << " bytes duration=" << duration.count() << "s\n\n"
+            << std::left << std::setw(30) << "case" << std::right << std::setw(10) << "reads"
+            << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10)
+            << "p99.9 us" << std::setw(14) << "bulk calls/s" << std::endl;
+  for (const auto& result : results) {
+    PrintResult(result);
+  }
+  return 0;
+}
@@ -0,0 +1,98 @@
+// Replays the traffic, which was captured by NamedPipeServer --capture <path>, against a server
+// and reports how long it took, so server builds can be compared on the real traffic.
+// The captured clients are replayed by the simulated clients - each has its own Client and
+// thread. Without --fast the requests are sent at the captured pace, so the elapsed time shows
+// only, whether the server keeps up. With --fast they are sent as fast as possible.
+//
+// Usage: NamedPipeReplayBench <capture> [--server <path to NamedPipeServer> | --pipe <pipe name>]
+//                             [--clients <count>] [--fast]
+
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CaptureReplay.h"
+#include "Client.h"
+#include "Logger.h"
+#include "ResponseParser.h"
+#include "ServerProcess.h"
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: NamedPipeReplayBench <capture> [--server <path to NamedPipeServer> | "
+                 "--pipe <pipe name>] [--clients <count>] [--fast]"
+              << std::endl;
+    return -1;
+  }
+
+  const std::string capture_path = argv[1];
+  std::string server_path;
+  std::string pipe_name = "\\\\.\\pipe\\demo_pipe";
+  size_t clients_count = 4;
+  auto pace = ReplayPace::Recorded;
+  for (int i = 2; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--server" && has_value) {
+      server_path = argv[++i];
+    } else if (arg == "--pipe" && has_value) {
+      pipe_name = argv[++i];
+    } else if (arg == "--clients" && has_value) {
+      clients_count = std::stoul(argv[++i]);
+    } else if (arg == "--fast") {
+      pace = ReplayPace::AsFastAsPossible;
+    } else {
+      std::cerr << "ERROR - unknown option=" << arg << std::endl;
+      return -1;
+    }
+  }
+  // the clients log every request otherwise:
+  Logger::SetLevel(LogLevel::Error);
+
+  auto replay = CaptureReplay::Open(capture_path, clients_count, pace);
+  if (!replay) {
+    return -1;
+  }
+
+  std::vector<PROCESS_INFORMATION> processes;
+  if (!server_path.empty()) {
+    pipe_name = "\\\\.\\pipe\\replay_benchmark_" + std::to_string(GetCurrentProcessId());
+    processes = StartServers(server_path, pipe_name, 1);
+    if (processes.empty()) {
+      return -1;
+    }
+  }
+
+  std::atomic<size_t> failed_clients = 0;
+  std::vector<std::thread> threads;
+  replay->Start();
+  const auto begin = std::chrono::steady_clock::now();
+  for (size_t client = 0; client < replay->GetClientsCount(); ++client) {
+    threads.emplace_back([&, client] {
+      Client replay_client(pipe_name, std::make_shared<CaptureReplaySource>(replay, client),
+                           std::make_shared<ResponseParser>(), ExecutionPolicy::Sync);
+      if (!replay_client.Start()) {
+        ++failed_clients;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin);
+  StopServers(processes);
+
+  const auto requests = replay->GetRequestsCount();
+  std::cout << "capture=" << capture_path << ", clients=" << replay->GetClientsCount()
+            << ", pace=" << (pace == ReplayPace::Recorded ? "recorded" : "fast") << "\n"
+            << "requests=" << requests << ", elapsed=" << std::fixed << std::setprecision(3)
+            << elapsed.count() << "s, requests/s=" << std::setprecision(0)
+            << requests / elapsed.count() << ", unmapped handles=" << replay->GetUnmappedCount()
+            << ", failed clients=" << failed_clients << std::endl;
+  return failed_clients > 0 ? -1 : 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// Helpers to run NamedPipeServer processes from the benchmarks.
+
+#include <windows.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Sharding.h"
+
+// Starts a NamedPipeServer process per shard on the pipe_name (shards_count = 1 - a single
+// regular server) and waits until all of them create their pipes.
+// arguments - additional options of the servers, e.g. "--admission-target 5000".
+inline std::vector<PROCESS_INFORMATION> StartServers(const std::string& server_path,
+                                                     const std::string& pipe_name,
+                                                     size_t shards_count,
+                                                     const std::string& arguments = "") {
+  std::vector<PROCESS_INFORMATION> processes;
+  for (size_t shard = 0; shard < shards_count; ++shard) {
+    std::string command_line = "\"" + server_path + "\" --pipe " + pipe_name;
+    if (!arguments.empty()) {
+      command_line += " " + arguments;
+    }
+    if (shards_count > 1) {
+      command_line += " --shards " + std::to_string(shards_count) + " --shard " +
+                      std::to_string(shard);
+    }
+
+    STARTUPINFO startup_info = {};
+    startup_info.cb = sizeof(startup_info);
+    PROCESS_INFORMATION process_info = {};
+    // no console - the servers' logs would slow down the measurement
+    if (!CreateProcess(nullptr, &command_line[0], nullptr, nullptr, FALSE, CREATE_NO_WINDOW,
+                       nullptr, nullptr, &startup_info, &process_info)) {
+      std::cerr << "ERROR - failed to start: " << command_line << ", error=" << GetLastError()
+                << std::endl;
+      break;
+    }
+    processes.push_back(process_info);
+  }
+
+  // wait until every server creates its pipe:
+  for (size_t shard = 0; shard < processes.size(); ++shard) {
+    const auto server_pipe_name =
+        shards_count > 1 ? GetShardPipeName(pipe_name, shard) : pipe_name;
+    for (size_t retry = 0; retry < 100 && !WaitNamedPipe(server_pipe_name.c_str(), 100);
+         ++retry) {
+      Sleep(50);
+    }
+  }
+  return processes;
+}
+
+inline void StopServers(std::vector<PROCESS_INFORMATION>& processes) {
+  for (auto& process : processes) {
+    TerminateProcess(process.hProcess, 0);
+    WaitForSingleObject(process.hProcess, INFINITE);
+    CloseHandle(process.hThread);
+    CloseHandle(process.hProcess);
+  }
+  processes.clear();
+}
@@ -0,0 +1,177 @@
+// Measures the request throughput of the sharded server depending on the number of shards.
+// For each shards count starts a NamedPipeServer process per shard (on a private pipe name) and
+// drives them by concurrent sync clients: every client creates some instances and then mutates
+// them. The instances count is requested at the end via the fanned out #n request.
+// The client logs every request, the results table is printed at the end.
+//
+// Usage: NamedPipeShardBench <path to NamedPipeServer> [client threads] [requests per thread]
+//                            [max shards]
+
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Client.h"
+#include "ClientRequest.h"
+#include "CustomClass.h"
+#include "DataSerializer.h"
+#include "IDataSource.h"
+#include "ResponseParser.h"
+#include "ServerProcess.h"
+
+namespace {
+
+constexpr size_t kInstancesPerClient = 64;
+
+RawDataType CreateClassCommand(const std::string& command) {
+  std::stringstream ss;
+  ss << "#";
+  DataSerializer::Serialize<std::string>(ss, CustomClass::kClassName);
+  ss << command;
+  return DataSerializer::ConvertToRawData(ss.str());
+}
+
+// Creates kInstancesPerClient instances and then calls SetIntegerValue on them round-robin.
+// Works only with the sync client - the handle of the created instance is required right away.
+class ShardWorkload : public IDataSource {
+ public:
+  explicit ShardWorkload(size_t requests_count) : requests_count_(requests_count) {}
+
+  ClientRequest ReadRequest() override {
+    const auto request_idx = requests_sent_++;
+    if (handles_.empty() || request_idx < kInstancesPerClient) {
+      auto on_created = [this](std::any any) { handles_.push_back(std::any_cast<int>(any)); };
+      return ClientRequest{CreateClassCommand("#c"), true, on_created, nullptr};
+    }
+
+    std::stringstream ss;
+    ss << "#";
+    DataSerializer::Serialize<std::string>(ss, CustomClass::kClassName);
+    DataSerializer::Serialize<ClassHandle>(ss, handles_[request_idx % handles_.size()]);
+    ss << "#m";
+    DataSerializer::Serialize<std::string>(ss, "SetIntegerValue");
+    DataSerializer::Serialize<int>(ss, static_cast<int>(request_idx));
+    return ClientRequest{DataSerializer::ConvertToRawData(ss.str()), true};
+  }
+
+  bool IsGood() const override { return requests_sent_ < requests_count_; }
+
+ private:
+  const size_t requests_count_;
+  size_t requests_sent_ = 0;
+  std::vector<ClassHandle> handles_;
+};
+
+// Single #n request - number of instances on all the shards.
+class CountWorkload : public IDataSource {
+ public:
+  ClientRequest ReadRequest() override {
+    is_sent_ = true;
+    auto on_counted = [this](std::any any) { count_ = std::any_cast<int>(any); };
+    return ClientRequest{CreateClassCommand("#n"), true, on_counted, nullptr};
+  }
+
+  bool IsGood() const override { return !is_sent_; }
+
+  int GetCount() const { return count_; }
+
+ private:
+  bool is_sent_ = false;
+  int count_ = -1;
+};
+
+struct BenchmarkResult {
+  size_t shards_count = 0;
+  size_t requests = 0;
+  int instances = 0;
+  std::chrono::nanoseconds elapsed{0};
+};
+
+BenchmarkResult RunShards(const std::string& server_path, size_t shards_count,
+                          size_t threads_count, size_t requests_per_thread) {
+  const std::string pipe_name = "\\\\.\\pipe\\shard_benchmark_" +
+                                std::to_string(GetCurrentProcessId()) + "_" +
+                                std::to_string(shards_count);
+
+  BenchmarkResult result;
+  result.shards_count = shards_count;
+  auto processes = StartServers(server_path, pipe_name, shards_count);
+  if (processes.size() != shards_count) {
+    StopServers(processes);
+    return result;
+  }
+
+  std::atomic<size_t> requests = 0;
+  std::vector<std::thread> threads;
+  const auto begin = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&] {
+      auto workload = std::make_shared<ShardWorkload>(requests_per_thread);
+      Client client(pipe_name, workload, std::make_shared<ResponseParser>(),
+                    ExecutionPolicy::Sync, shards_count);
+      if (client.Start()) {
+        requests += requests_per_thread;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  result.elapsed = std::chrono::steady_clock::now() - begin;
+  result.requests = requests;
+
+  auto count_workload = std::make_shared<CountWorkload>();
+  Client client(pipe_name, count_workload, std::make_shared<ResponseParser>(),
+                ExecutionPolicy::Sync, shards_count);
+  client.Start();
+  result.instances = count_workload->GetCount();
+
+  StopServers(processes);
+  return result;
+}
+
+void PrintResult(const BenchmarkResult& result) {
+  const double seconds = std::chrono::duration<double>(result.elapsed).count();
+  const double throughput = seconds > 0 ? result.requests / seconds : 0.0;
+
+  std::cout << std::setw(8) << result.shards_count << std::setw(12) << result.requests
+            << std::setw(12) << result.instances << std::setw(14) << std::fixed
+            << std::setprecision(1) << seconds * 1000 << std::setw(16) << std::setprecision(0)
+            << throughput << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: NamedPipeShardBench <path to NamedPipeServer> [client threads] "
+                 "[requests per thread] [max shards]"
+              << std::endl;
+    return -1;
+  }
+
+  const std::string server_path = argv[1];
+  const size_t threads_count = argc > 2 ? std::stoul(argv[2]) : 16;
+  const size_t requests_per_thread = argc > 3 ? std::stoul(argv[3]) : 5000;
+  const size_t max_shards = argc > 4 ? std::stoul(argv[4]) : 8;
+
+  std::vector<BenchmarkResult> results;
+  for (size_t shards_count = 1; shards_count <= max_shards; shards_count *= 2) {
+    results.push_back(RunShards(server_path, shards_count, threads_count, requests_per_thread));
+  }
+
+  std::cout << "\nclient threads=" << threads_count
+            << ", requests per thread=" << requests_per_thread << "\n\n"
+            << std::setw(8) << "shards" << std::setw(12) << "requests" << std::setw(12)
+            << "instances" << std::setw(14) << "elapsed, ms" << std::setw(16) << "requests/s"
+            << std::endl;
+  for (const auto& result : results) {
+    PrintResult(result);
+  }
+  return 0;
+}
@@ -0,0 +1,128 @@
+// Measures how fast the server can serve requests after restart from the mapped snapshot and
+// how much a background snapshot stalls concurrent mutations.
+//
+// Usage: NamedPipeSnapshotBench [instances] [snapshot path]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ClassRegistry.h"
+#include "CustomClass.h"
+#include "DataSerializer.h"
+#include "RegistrySnapshot.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ToMilliseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Same format as CustomClass::Serialize, but without constructing (and logging) CustomClass.
+std::string SerializeInstance(int ival, const std::string& str) {
+  std::stringstream ss;
+  DataSerializer::Serialize<int>(ss, ival);
+  DataSerializer::Serialize<std::string>(ss, str);
+  return ss.str();
+}
+
+bool WriteSyntheticSnapshot(const std::string& path, size_t instances_count) {
+  SnapshotWriter writer(GetSnapshotSlotPath(path, 0));
+  if (!writer.Begin()) {
+    return false;
+  }
+  for (size_t i = 0; i < instances_count; ++i) {
+    const auto handle = static_cast<ClassHandle>(i);
+    if (!writer.Add(handle, SerializeInstance(handle, "snapshot instance"))) {
+      return false;
+    }
+  }
+  return writer.Finish(1, 0, static_cast<ClassHandle>(instances_count));
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t instances_count = argc > 1 ? std::stoul(argv[1]) : 5000000;
+  const std::string path = argc > 2 ? argv[2] : "snapshot_benchmark.snap";
+  std::remove(GetSnapshotSlotPath(path, 0).c_str());
+  std::remove(GetSnapshotSlotPath(path, 1).c_str());
+
+  // 1. Snapshot of the "previous run" of the server:
+  auto begin = Clock::now();
+  if (!WriteSyntheticSnapshot(path, instances_count)) {
+    std::cerr << "ERROR - failed to write the snapshot!" << std::endl;
+    return -1;
+  }
+  std::cout << "wrote " << instances_count << " instances in "
+            << ToMilliseconds(Clock::now() - begin) << " ms" << std::endl;
+
+  // 2. Restart - map the snapshot and serve the first read:
+  auto& registry = ClassRegistry<CustomClass>::GetInstance();
+  begin = Clock::now();
+  auto snapshot = OpenLatestSnapshot(path);
+  if (!snapshot) {
+    std::cerr << "ERROR - failed to map the snapshot!" << std::endl;
+    return -1;
+  }
+  registry.AttachSnapshot(snapshot);
+  const auto first_read = registry.GetSerialized(static_cast<ClassHandle>(instances_count / 2));
+  std::cout << "restart to the first served read: " << ToMilliseconds(Clock::now() - begin)
+            << " ms (success=" << first_read.first << ")" << std::endl;
+
+  // 3. Random reads served from the mapped memory (the first pass pages the file in):
+  std::mt19937 random(42);
+  std::uniform_int_distribution<ClassHandle> distribution(
+      0, static_cast<ClassHandle>(instances_count - 1));
+  constexpr size_t kReadsCount = 1000000;
+  size_t bytes_read = 0;
+  begin = Clock::now();
+  for (size_t i = 0; i < kReadsCount; ++i) {
+    bytes_read += registry.GetSerialized(distribution(random)).second.size();
+  }
+  std::cout << "random #g reads: "
+            << std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / kReadsCount
+            << " ns/read (" << bytes_read << " bytes)" << std::endl;
+
+  // 4. Background snapshot while another thread keeps mutating (materializing) instances:
+  std::atomic_bool is_done = false;
+  std::atomic<int64_t> max_stall_ns = 0;
+  size_t mutations = 0;
+  std::thread mutator([&] {
+    std::mt19937 mutator_random(7);
+    while (!is_done) {
+      const auto start = Clock::now();
+      registry.Mutate(distribution(mutator_random), [](CustomClass& instance) {
+        instance.ival_ = -1;
+        return true;
+      });
+      const auto stall = Clock::now() - start;
+      max_stall_ns = std::max<int64_t>(
+          max_stall_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(stall).count());
+      ++mutations;
+    }
+  });
+
+  begin = Clock::now();
+  const bool success = registry.WriteSnapshot(path);
+  const auto snapshot_duration = Clock::now() - begin;
+  is_done = true;
+  mutator.join();
+
+  std::cout << "background snapshot: " << ToMilliseconds(snapshot_duration)
+            << " ms (success=" << success << "), concurrent mutations=" << mutations
+            << ", max mutation latency=" << max_stall_ns / 1000.0 << " us" << std::endl;
+
+  registry.AttachSnapshot(nullptr);
+  snapshot.reset();
+  std::remove(GetSnapshotSlotPath(path, 0).c_str());
+  std::remove(GetSnapshotSlotPath(path, 1).c_str());
+  return 0;
+}
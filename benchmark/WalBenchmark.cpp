@@ -0,0 +1,126 @@
+// Measures the mutation throughput of ClassRegistry with the write-ahead log attached,
+// for each durability level (and without the log as a baseline).
+//
+// Usage: NamedPipeWalBench [threads] [mutations per thread] [log path]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ClassRegistry.h"
+#include "CustomClass.h"
+#include "WriteAheadLog.h"
+
+namespace {
+
+constexpr size_t kInstancesCount = 1024;
+
+struct BenchmarkResult {
+  std::string name;
+  size_t mutations = 0;
+  std::chrono::nanoseconds elapsed{0};
+};
+
+BenchmarkResult RunMutations(const std::string& name, const std::vector<ClassHandle>& handles,
+                             size_t threads_count, size_t mutations_per_thread) {
+  auto& registry = ClassRegistry<CustomClass>::GetInstance();
+
+  std::atomic_bool start = false;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&, t] {
+      while (!start) {
+        std::this_thread::yield();
+      }
+      for (size_t i = 0; i < mutations_per_thread; ++i) {
+        const auto handle = handles[(t * mutations_per_thread + i) % handles.size()];
+        registry.Mutate(handle, [i](CustomClass& instance) {
+          instance.ival_ = static_cast<int>(i);
+          return true;
+        });
+      }
+    });
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  start = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  BenchmarkResult result;
+  result.name = name;
+  result.mutations = threads_count * mutations_per_thread;
+  result.elapsed = std::chrono::steady_clock::now() - begin;
+  return result;
+}
+
+BenchmarkResult RunWithLog(const std::string& name, WalDurability durability,
+                           const std::string& path, const std::vector<ClassHandle>& handles,
+                           size_t threads_count, size_t mutations_per_thread) {
+  std::remove(path.c_str());
+
+  auto log = std::make_shared<WriteAheadLog>(path, durability);
+  if (!log->Open()) {
+    std::cerr << "ERROR - can't open the log=" << path << std::endl;
+    return BenchmarkResult{name};
+  }
+
+  auto& registry = ClassRegistry<CustomClass>::GetInstance();
+  registry.AttachLog(log);
+  auto result = RunMutations(name, handles, threads_count, mutations_per_thread);
+  registry.AttachLog(nullptr);
+
+  // the cost of writing the last group is a part of the benchmark:
+  const auto close_begin = std::chrono::steady_clock::now();
+  log->Close();
+  result.elapsed += std::chrono::steady_clock::now() - close_begin;
+
+  std::remove(path.c_str());
+  return result;
+}
+
+void PrintResult(const BenchmarkResult& result) {
+  const double seconds = std::chrono::duration<double>(result.elapsed).count();
+  const double throughput = seconds > 0 ? result.mutations / seconds : 0.0;
+  const double ns_per_op =
+      result.mutations > 0 ? static_cast<double>(result.elapsed.count()) / result.mutations : 0;
+
+  std::cout << std::left << std::setw(20) << result.name << std::right << std::setw(12)
+            << result.mutations << std::setw(16) << std::fixed << std::setprecision(0)
+            << throughput << std::setw(14) << std::setprecision(1) << ns_per_op << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t threads_count = argc > 1 ? std::stoul(argv[1]) : 8;
+  const size_t mutations_per_thread = argc > 2 ? std::stoul(argv[2]) : 20000;
+  const std::string path = argc > 3 ? argv[3] : "wal_benchmark.log";
+
+  auto& registry = ClassRegistry<CustomClass>::GetInstance();
+  std::vector<ClassHandle> handles;
+  for (size_t i = 0; i < kInstancesCount; ++i) {
+    handles.push_back(registry.Create(static_cast<int>(i), std::string("benchmark instance")));
+  }
+
+  std::cout << "threads=" << threads_count << ", mutations per thread=" << mutations_per_thread
+            << "\n\n"
+            << std::left << std::setw(20) << "durability" << std::right << std::setw(12)
+            << "mutations" << std::setw(16) << "mutations/s" << std::setw(14) << "ns/mutation"
+            << std::endl;
+
+  PrintResult(RunMutations("no log", handles, threads_count, mutations_per_thread));
+  PrintResult(RunWithLog("none", WalDurability::None, path, handles, threads_count,
+                         mutations_per_thread));
+  PrintResult(RunWithLog("batched", WalDurability::Batched, path, handles, threads_count,
+                         mutations_per_thread));
+  // every mutation waits for the flush - use less iterations to keep the run short:
+  PrintResult(RunWithLog("per-request", WalDurability::PerRequest, path, handles, threads_count,
+                         std::max<size_t>(mutations_per_thread / 20, 1)));
+  return 0;
+}
@@ -0,0 +1,173 @@
+#include "WorkloadGenerator.h"
+
+#include <any>
+#include <exception>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include "CustomClass.h"
+#include "DataSerializer.h"
+
+namespace {
+constexpr const char* kOperationNames[] = {
+    "SendInt",       "SendDouble",      "SendString",     "Create", "PrintToCout",
+    "PrintToString", "SetIntegerValue", "SetStringValue", "Get"};
+static_assert(std::size(kOperationNames) == kWorkloadOperationsCount);
+
+std::mt19937_64& GetRandomEngine() {
+  thread_local std::mt19937_64 engine{std::random_device{}()};
+  return engine;
+}
+
+std::ostream& SerializeClassName(std::ostream& stream) {
+  stream << "#";
+  DataSerializer::Serialize<std::string>(stream, CustomClass::kClassName);
+  return stream;
+}
+
+std::ostream& SerializeMethodCall(std::ostream& stream, ClassHandle handle,
+                                  const std::string& method_name) {
+  SerializeClassName(stream);
+  DataSerializer::Serialize<ClassHandle>(stream, handle);
+  stream << "#m";
+  DataSerializer::Serialize<std::string>(stream, method_name);
+  return stream;
+}
+}  // namespace
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig& config) : config_(config) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < kWorkloadOperationsCount; ++i) {
+    sum += config_.weights[i];
+    weights_sum_[i] = sum;
+  }
+  Start();
+}
+
+ClientRequest WorkloadGenerator::ReadRequest() { return CreateRequest(NextOperation()); }
+
+bool WorkloadGenerator::IsGood() const { return std::chrono::steady_clock::now() < end_time_; }
+
+void WorkloadGenerator::Start() {
+  end_time_ = std::chrono::steady_clock::now() + config_.duration;
+}
+
+WorkloadOperation WorkloadGenerator::NextOperation() const {
+  const auto total = weights_sum_.back();
+  if (total == 0) {
+    return WorkloadOperation::SendInt;
+  }
+  const auto value = std::uniform_int_distribution<uint64_t>(0, total - 1)(GetRandomEngine());
+  size_t index = 0;
+  while (weights_sum_[index] <= value) {
+    ++index;
+  }
+  return static_cast<WorkloadOperation>(index);
+}
+
+ClientRequest WorkloadGenerator::CreateRequest(WorkloadOperation operation) {
+  std::pair<bool, ClassHandle> handle{false, 0};
+  if (operation >= WorkloadOperation::PrintToCout) {
+    handle = GetRandomHandle();
+    if (!handle.first) {
+      operation = WorkloadOperation::Create;
+    }
+  }
+
+  std::stringstream ss;
+  bool wait_for_response = true;
+  ClientRequest::SuccessCallbackType on_success = nullptr;
+  auto& engine = GetRandomEngine();
+  switch (operation) {
+    case WorkloadOperation::SendInt:
+      DataSerializer::Serialize<int>(ss, static_cast<int>(engine()));
+      wait_for_response = false;
+      break;
+    case WorkloadOperation::SendDouble:
+      DataSerializer::Serialize<double>(ss, std::uniform_real_distribution<double>()(engine));
+      wait_for_response = false;
+      break;
+    case WorkloadOperation::SendString:
+      DataSerializer::Serialize<std::string>(ss, "workload string " + std::to_string(engine()));
+      wait_for_response = false;
+      break;
+    case WorkloadOperation::Create:
+      SerializeClassName(ss) << "#c";
+      on_success = [this](std::any any) {
+        std::lock_guard<std::mutex> locker(handles_mutex_);
+        handles_.push_back(std::any_cast<ClassHandle>(any));
+      };
+      break;
+    case WorkloadOperation::PrintToCout:
+      SerializeMethodCall(ss, handle.second, "PrintToCout");
+      wait_for_response = false;
+      break;
+    case WorkloadOperation::PrintToString:
+      SerializeMethodCall(ss, handle.second, "PrintToString");
+      break;
+    case WorkloadOperation::SetIntegerValue:
+      SerializeMethodCall(ss, handle.second, "SetIntegerValue");
+      DataSerializer::Serialize<int>(ss, static_cast<int>(engine()));
+      break;
+    case WorkloadOperation::SetStringValue:
+      SerializeMethodCall(ss, handle.second, "SetStringValue");
+      DataSerializer::Serialize<std::string>(ss, "value " + std::to_string(engine()));
+      break;
+    case WorkloadOperation::Get:
+      SerializeClassName(ss);
+      DataSerializer::Serialize<ClassHandle>(ss, handle.second);
+      ss << "#g";
+      break;
+    case WorkloadOperation::OperationsCount:
+      break;
+  }
+
+  return ClientRequest{DataSerializer::ConvertToRawData(ss.str()), wait_for_response, on_success,
+                       nullptr};
+}
+
+size_t WorkloadGenerator::GetInstancesCount() const {
+  std::lock_guard<std::mutex> locker(handles_mutex_);
+  return handles_.size();
+}
+
+const char* WorkloadGenerator::GetOperationName(WorkloadOperation operation) {
+  return kOperationNames[static_cast<size_t>(operation)];
+}
+
+std::pair<bool, std::array<uint32_t, kWorkloadOperationsCount>> WorkloadGenerator::ParseMix(
+    const std::string& mix) {
+  std::array<uint32_t, kWorkloadOperationsCount> weights{};
+  std::stringstream ss(mix);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    const auto separator = item.find('=');
+    if (separator == std::string::npos) {
+      return std::make_pair(false, weights);
+    }
+    const auto name = item.substr(0, separator);
+    size_t index = 0;
+    while (index < kWorkloadOperationsCount && name != kOperationNames[index]) {
+      ++index;
+    }
+    if (index == kWorkloadOperationsCount) {
+      return std::make_pair(false, weights);
+    }
+    try {
+      weights[index] = static_cast<uint32_t>(std::stoul(item.substr(separator + 1)));
+    } catch (const std::exception&) {
+      return std::make_pair(false, weights);
+    }
+  }
+  return std::make_pair(true, weights);
+}
+
+std::pair<bool, ClassHandle> WorkloadGenerator::GetRandomHandle() const {
+  std::lock_guard<std::mutex> locker(handles_mutex_);
+  if (handles_.empty()) {
+    return std::make_pair(false, ClassHandle{0});
+  }
+  const auto index =
+      std::uniform_int_distribution<size_t>(0, handles_.size() - 1)(GetRandomEngine());
+  return std::make_pair(true, handles_[index]);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ClientRequest.h"
+#include "IDataSource.h"
+#include "Types.h"
+
+// Operations of the workload - every request, which DemoSimulator can send.
+enum class WorkloadOperation : uint8_t {
+  SendInt = 0,
+  SendDouble,
+  SendString,
+  Create,
+  PrintToCout,
+  PrintToString,
+  SetIntegerValue,
+  SetStringValue,
+  Get,
+  OperationsCount
+};
+
+constexpr size_t kWorkloadOperationsCount =
+    static_cast<size_t>(WorkloadOperation::OperationsCount);
+
+struct WorkloadConfig {
+  // Relative weights of the operations in the mix, indexed by WorkloadOperation.
+  // PrintToCout is off by default - the console of the server would be measured instead.
+  std::array<uint32_t, kWorkloadOperationsCount> weights = {1, 1, 1, 1, 0, 1, 4, 2, 2};
+  std::chrono::seconds duration = std::chrono::seconds(10);
+  // Requests per second of all the threads together. 0 - closed loop: every thread sends the
+  // next request right after the previous one is completed.
+  double rate = 0.0;
+  size_t threads_count = 4;
+  // Created before the measurement, so the method calls and gets have the instances to use.
+  size_t initial_instances = 64;
+};
+
+// Generator of the weighted random requests of the WorkloadConfig. Can be shared by many
+// threads. It's good, till the duration since Start() is over.
+class WorkloadGenerator : public IDataSource {
+ public:
+  explicit WorkloadGenerator(const WorkloadConfig& config);
+
+  ClientRequest ReadRequest() override;
+  bool IsGood() const override;
+
+  // Starts the duration of the workload.
+  void Start();
+
+  WorkloadOperation NextOperation() const;
+  // The instances, which are created by the requests, are used by the next method calls and
+  // gets. Without any instance they are replaced by a create.
+  ClientRequest CreateRequest(WorkloadOperation operation);
+
+  size_t GetInstancesCount() const;
+
+  static const char* GetOperationName(WorkloadOperation operation);
+  // Parses the mix like "SetIntegerValue=4,Get=1" - other operations get the weight 0.
+  static std::pair<bool, std::array<uint32_t, kWorkloadOperationsCount>> ParseMix(
+      const std::string& mix);
+
+ private:
+  std::pair<bool, ClassHandle> GetRandomHandle() const;
+
+ private:
+  const WorkloadConfig config_;
+  // cumulative weights of the operations
+  std::array<uint64_t, kWorkloadOperationsCount> weights_sum_{};
+  std::chrono::steady_clock::time_point end_time_;
+
+  mutable std::mutex handles_mutex_;
+  std::vector<ClassHandle> handles_;
+};
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "ClientRequest.h"
+#include "DataDeserializer.h"
+#include "ProfiledMutex.h"
+
+// Typed results of the client calls (see Client::Call): a CallFuture<Type> is completed with the
+// value of the response, which is parsed right into its shared state - no std::any, no casts and
+// no exceptions. Failures are reported by the error code - GetLastError() of the failed
+// send/read, or ERROR_INVALID_DATA, if the response isn't a Type.
+//
+// The shared states are pooled per type, so a call doesn't allocate its state, once the pool has
+// grown to the number of the outstanding calls.
+
+enum class CallStatus { Pending = 0, Succeeded, Failed };
+
+// Free states of the State type. The states are never freed while the process is running - the
+// pool is as large as the maximum of the outstanding calls (but not more than kMaxFreeStates).
+template <class State>
+class CallStatePool {
+ public:
+  static CallStatePool& GetInstance() {
+    static CallStatePool instance;
+    return instance;
+  }
+
+  ~CallStatePool() {
+    for (auto* state : free_states_) {
+      delete state;
+    }
+  }
+
+  // The state is reset to the pending one with a single reference.
+  State* Acquire() {
+    State* state = nullptr;
+    {
+      std::lock_guard<ProfiledMutex> locker(mutex_);
+      if (!free_states_.empty()) {
+        state = free_states_.back();
+        free_states_.pop_back();
+      }
+    }
+    if (!state) {
+      state = new State();
+    }
+    state->Reset();
+    return state;
+  }
+
+  void Recycle(State* state) {
+    {
+      std::lock_guard<ProfiledMutex> locker(mutex_);
+      if (free_states_.size() < kMaxFreeStates) {
+        free_states_.push_back(state);
+        return;
+      }
+    }
+    delete state;
+  }
+
+ private:
+  static constexpr size_t kMaxFreeStates = 4096;
+
+  CallStatePool() = default;
+
+  ProfiledMutex mutex_{"CallStatePool::mutex_"};
+  std::vector<State*> free_states_;
+};
+
+// Untyped part of the shared state: the status, the waiting and the reference counting.
+// References are held by the CallFuture, by the registered request (till it's completed) and by
+// the children of the WhenAll (till they are completed).
+class CallStateBase : public ICallCompletion {
+ public:
+  void AddRef() { refs_.fetch_add(1, std::memory_order_relaxed); }
+  void Release() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Recycle();
+    }
+  }
+
+  // The request keeps a reference till its first completion via ICallCompletion.
+  void AttachRequest() {
+    AddRef();
+    has_request_.store(true, std::memory_order_relaxed);
+  }
+
+  CallStatus GetStatus() const {
+    std::lock_guard<std::mutex> locker(mutex_);
+    return status_;
+  }
+  int GetError() const {
+    std::lock_guard<std::mutex> locker(mutex_);
+    return error_;
+  }
+
+  // Returns true, if the call succeeded.
+  bool Wait() const {
+    std::unique_lock<std::mutex> locker(mutex_);
+    ready_.wait(locker, [this] { return status_ != CallStatus::Pending; });
+    return status_ == CallStatus::Succeeded;
+  }
+  // Returns false, if the call is still pending after the timeout.
+  bool WaitFor(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> locker(mutex_);
+    return ready_.wait_for(locker, timeout, [this] { return status_ != CallStatus::Pending; });
+  }
+
+  // The first completion wins - the later ones are ignored.
+  void SetFailure(int error) {
+    std::unique_lock<std::mutex> locker(mutex_);
+    if (status_ == CallStatus::Pending) {
+      Complete(locker, CallStatus::Failed, error);
+    }
+  }
+
+  void CompleteWithFailure(int error) override {
+    SetFailure(error);
+    DetachRequest();
+  }
+
+  // The parent is notified, when the state is completed (right away, if it's already completed),
+  // and is referenced till then.
+  void SetParent(CallStateBase* parent) {
+    std::unique_lock<std::mutex> locker(mutex_);
+    if (status_ != CallStatus::Pending) {
+      locker.unlock();
+      parent->OnChildCompleted();
+      return;
+    }
+    parent->AddRef();
+    parent_ = parent;
+  }
+
+ protected:
+  CallStateBase() = default;
+
+  // non-movable, non-copyable
+  CallStateBase(const CallStateBase& other) = delete;
+  CallStateBase& operator=(const CallStateBase& other) = delete;
+
+  void ResetBase() {
+    std::lock_guard<std::mutex> locker(mutex_);
+    status_ = CallStatus::Pending;
+    error_ = 0;
+    parent_ = nullptr;
+    refs_.store(1, std::memory_order_relaxed);
+    has_request_.store(false, std::memory_order_relaxed);
+  }
+
+  inline bool IsPending() const { return status_ == CallStatus::Pending; }
+
+  // Should be called under the locked mutex_ of the pending state, after the value is set.
+  // Unlocks it and notifies the waiters and the parent.
+  void Complete(std::unique_lock<std::mutex>& locker, CallStatus status, int error) {
+    status_ = status;
+    error_ = error;
+    auto* parent = std::exchange(parent_, nullptr);
+    locker.unlock();
+    ready_.notify_all();
+    if (parent) {
+      parent->OnChildCompleted();
+      parent->Release();
+    }
+  }
+
+  void DetachRequest() {
+    if (has_request_.exchange(false, std::memory_order_acq_rel)) {
+      Release();
+    }
+  }
+
+  virtual void OnChildCompleted() {}
+  // Returns the state to its pool.
+  virtual void Recycle() = 0;
+
+ protected:
+  mutable std::mutex mutex_;
+
+ private:
+  mutable std::condition_variable ready_;
+  CallStatus status_ = CallStatus::Pending;
+  int error_ = 0;
+  CallStateBase* parent_ = nullptr;
+  std::atomic<int> refs_ = 1;
+  std::atomic_bool has_request_ = false;
+};
+
+template <class Type>
+class CallState : public CallStateBase {
+ public:
+  // Should be called before the state is reused.
+  void Reset() {
+    ResetBase();
+    value_ = Type{};
+  }
+
+  // The first completion wins - the later ones are ignored.
+  void SetValue(Type value) {
+    std::unique_lock<std::mutex> locker(mutex_);
+    if (IsPending()) {
+      value_ = std::move(value);
+      Complete(locker, CallStatus::Succeeded, 0);
+    }
+  }
+
+  void CompleteWithResponse(const RawDataType& data, size_t seek_idx) override {
+    if constexpr (kIsResponseType) {
+      if (auto [success, value] = RegularTypeParaser::Parse<Type>(data, seek_idx); success) {
+        SetValue(std::move(value));
+      } else {
+        SetFailure(ERROR_INVALID_DATA);
+      }
+    } else {
+      // the state of the WhenAll isn't completed by the responses
+      SetFailure(ERROR_INVALID_DATA);
+    }
+    DetachRequest();
+  }
+
+  // Valid only after the successful Wait() - the value isn't changed after the completion.
+  inline const Type& GetValue() const { return value_; }
+
+  friend class CallStatePool<CallState<Type>>;
+
+ protected:
+  CallState() = default;
+
+  // Types, which can be parsed from the response (see RegularTypeParaser).
+  static constexpr bool kIsResponseType =
+      std::is_same_v<Type, bool> || std::is_same_v<Type, int> || std::is_same_v<Type, double> ||
+      std::is_same_v<Type, std::string>;
+
+ private:
+  void Recycle() override { CallStatePool<CallState<Type>>::GetInstance().Recycle(this); }
+
+ private:
+  Type value_{};
+};
+
+template <class Type>
+class CallFuture {
+ public:
+  CallFuture() = default;
+  // Adopts the reference of the caller.
+  explicit CallFuture(CallState<Type>* state) : state_(state) {}
+  ~CallFuture() {
+    if (state_) {
+      state_->Release();
+    }
+  }
+
+  CallFuture(CallFuture&& other) noexcept : state_(std::exchange(other.state_, nullptr)) {}
+  CallFuture& operator=(CallFuture&& other) noexcept {
+    std::swap(state_, other.state_);
+    return *this;
+  }
+
+  // non-copyable
+  CallFuture(const CallFuture& other) = delete;
+  CallFuture& operator=(const CallFuture& other) = delete;
+
+  inline bool IsValid() const { return state_ != nullptr; }
+  bool IsReady() const { return state_ && state_->GetStatus() != CallStatus::Pending; }
+  // Error of the failed call.
+  int GetError() const { return state_ ? state_->GetError() : ERROR_INVALID_HANDLE; }
+
+  // Blocks till the call is completed. Returns true, if it succeeded.
+  bool Wait() const { return state_ && state_->Wait(); }
+  // Returns false, if the call is still pending after the timeout.
+  bool WaitFor(std::chrono::milliseconds timeout) const {
+    return state_ && state_->WaitFor(timeout);
+  }
+
+  // Blocks till the call is completed.
+  std::pair<bool, Type> Get() const {
+    if (!Wait()) {
+      return std::make_pair(false, Type{});
+    }
+    return std::make_pair(true, state_->GetValue());
+  }
+
+  // Should be used by the Client and by the WhenAll only:
+  inline CallState<Type>* GetState() const { return state_; }
+
+ private:
+  CallState<Type>* state_ = nullptr;
+};
+
+// State of the WhenAll: completed with the values of all the calls, when all of them are
+// completed, or with the error of the first failed one.
+template <class Type>
+class WhenAllState : public CallState<std::vector<Type>> {
+ public:
+  void Reset() {
+    CallState<std::vector<Type>>::Reset();
+    pending_count_ = 0;
+  }
+
+  // Should be called once, before the state is returned to the caller.
+  void WaitFor(std::vector<CallFuture<Type>> futures) {
+    futures_ = std::move(futures);
+    // + 1 - the state isn't completed, till all the children are attached
+    pending_count_ = futures_.size() + 1;
+    for (auto& future : futures_) {
+      if (auto* state = future.GetState()) {
+        state->SetParent(this);
+      } else {
+        OnChildCompleted();
+      }
+    }
+    OnChildCompleted();
+  }
+
+  friend class CallStatePool<WhenAllState<Type>>;
+
+ private:
+  WhenAllState() = default;
+
+  void OnChildCompleted() override {
+    if (pending_count_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+
+    std::vector<Type> values;
+    values.reserve(futures_.size());
+    for (const auto& future : futures_) {
+      auto [success, value] = future.Get();
+      if (!success) {
+        this->SetFailure(future.GetError());
+        return;
+      }
+      values.push_back(std::move(value));
+    }
+    this->SetValue(std::move(values));
+  }
+
+  void Recycle() override {
+    // the children are released, so they are recycled as well
+    futures_.clear();
+    CallStatePool<WhenAllState<Type>>::GetInstance().Recycle(this);
+  }
+
+ private:
+  std::vector<CallFuture<Type>> futures_;
+  std::atomic<size_t> pending_count_ = 0;
+};
+
+// Future of all the calls, e.g. of a method called on many instances. The futures are consumed.
+template <class Type>
+CallFuture<std::vector<Type>> WhenAll(std::vector<CallFuture<Type>> futures) {
+  auto* state = CallStatePool<WhenAllState<Type>>::GetInstance().Acquire();
+  state->WaitFor(std::move(futures));
+  return CallFuture<std::vector<Type>>(state);
+}
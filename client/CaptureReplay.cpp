@@ -0,0 +1,270 @@
+#include "CaptureReplay.h"
+
+#include <algorithm>
+#include <any>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include "CaptureFormat.h"
+#include "DataSerializer.h"
+#include "Logger.h"
+#include "RequestControl.h"
+#include "Tracer.h"
+#include "WireFormat.h"
+
+static constexpr auto kLogTag = "CaptureReplay";
+
+namespace {
+// Skips the request id, the trace, the deadline, the send time and the priority headers of the
+// frame: #r<int>[#t<trace context>][#d<deadline>][#q<send time>][#p<priority>]. The deadline of
+// the captured request is long passed. The long requests are captured, once the server has
+// assembled their chunks, and the replaying Client chunks them again.
+bool ReadRequestId(const char* data, size_t size, size_t& idx, RequestId& request_id) {
+  if (size < 2 || data[0] != '#' || data[1] != 'r') {
+    return false;
+  }
+  idx = 2;
+  if (!ReadWireInt(data, size, idx, request_id)) {
+    return false;
+  }
+  if (idx + TraceContext::kHeaderSize <= size && data[idx] == '#' && data[idx + 1] == 't') {
+    idx += TraceContext::kHeaderSize;
+  }
+  if (idx + RequestControl::kDeadlineHeaderSize <= size && data[idx] == '#' &&
+      data[idx + 1] == 'd') {
+    idx += RequestControl::kDeadlineHeaderSize;
+  }
+  if (idx + RequestControl::kSendTimeHeaderSize <= size && data[idx] == '#' &&
+      data[idx + 1] == 'q') {
+    idx += RequestControl::kSendTimeHeaderSize;
+  }
+  if (idx + RequestControl::kPriorityHeaderSize <= size && data[idx] == '#' &&
+      data[idx + 1] == 'p') {
+    idx += RequestControl::kPriorityHeaderSize;
+  }
+  return true;
+}
+
+// CustomClass command: #<string class name>[<int handle>]#<command>. Returns the offset right
+// after the class name, 0 - not a CustomClass command.
+size_t SkipClassName(const char* data, size_t size) {
+  size_t idx = 1;
+  size_t name_size = 0;
+  if (size < 2 || data[0] != '#' || !ReadWireStringSize(data, size, idx, name_size)) {
+    return 0;
+  }
+  return idx + name_size;
+}
+
+uint64_t GetFramesKey(uint32_t client_id, RequestId request_id) {
+  return (static_cast<uint64_t>(client_id) << 32) | static_cast<uint32_t>(request_id);
+}
+}  // namespace
+
+CaptureReplay::~CaptureReplay() {
+  if (view_) {
+    UnmapViewOfFile(view_);
+  }
+  if (mapping_handle_) {
+    CloseHandle(mapping_handle_);
+  }
+  if (file_handle_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_handle_);
+  }
+}
+
+std::shared_ptr<CaptureReplay> CaptureReplay::Open(const std::string& path, size_t clients_count,
+                                                   ReplayPace pace) {
+  std::shared_ptr<CaptureReplay> replay(new CaptureReplay());
+  replay->pace_ = pace;
+  replay->file_handle_ = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (replay->file_handle_ == INVALID_HANDLE_VALUE) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't open the capture=" << path
+                                       << ", error=" << GetLastError()));
+    return nullptr;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(replay->file_handle_, &size) ||
+      static_cast<uint64_t>(size.QuadPart) < sizeof(CaptureFileHeader)) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - the capture=" << path
+                                       << " is too short"));
+    return nullptr;
+  }
+  replay->file_size_ = static_cast<uint64_t>(size.QuadPart);
+
+  replay->mapping_handle_ =
+      CreateFileMapping(replay->file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (replay->mapping_handle_) {
+    replay->view_ = reinterpret_cast<const char*>(
+        MapViewOfFile(replay->mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (!replay->view_) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't map the capture=" << path
+                                       << ", error=" << GetLastError()));
+    return nullptr;
+  }
+
+  if (std::memcmp(replay->view_, kCaptureMagic, sizeof(kCaptureMagic)) != 0) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - " << path
+                                       << " is not a capture of NamedPipeServer"));
+    return nullptr;
+  }
+
+  if (!replay->Index(std::max<size_t>(clients_count, 1))) {
+    return nullptr;
+  }
+  replay->Start();
+  return replay;
+}
+
+bool CaptureReplay::Index(size_t clients_count) {
+  clients_.resize(clients_count);
+  // sent requests, which wait for their responses: client and request id -> simulated client
+  // and index of the frame
+  std::unordered_map<uint64_t, std::pair<size_t, size_t>> requests;
+  bool is_first = true;
+
+  uint64_t offset = sizeof(CaptureFileHeader);
+  while (offset + sizeof(CaptureFrameHeader) <= file_size_) {
+    CaptureFrameHeader header;
+    std::memcpy(&header, view_ + offset, sizeof(header));
+    offset += sizeof(header);
+    const bool is_response = (header.size & kCaptureResponseFlag) != 0;
+    const size_t size = header.size & ~kCaptureResponseFlag;
+    if (offset + size > file_size_) {
+      // the tail of the terminated server
+      Logger::LogError(Logger::to_string(std::stringstream()
+                                         << kLogTag << ": the last frame is incomplete, offset="
+                                         << offset));
+      break;
+    }
+    const char* data = view_ + offset;
+    offset += size;
+
+    size_t idx = 0;
+    RequestId request_id = 0;
+    if (!ReadRequestId(data, size, idx, request_id)) {
+      continue;
+    }
+    const auto key = GetFramesKey(header.client_id, request_id);
+
+    if (!is_response) {
+      if (is_first) {
+        first_timestamp_ns_ = header.timestamp_ns;
+        is_first = false;
+      }
+      ReplayFrame frame;
+      frame.timestamp_ns = header.timestamp_ns;
+      frame.data = data + idx;
+      frame.size = static_cast<uint32_t>(size - idx);
+      const auto name_end = SkipClassName(frame.data, frame.size);
+      size_t handle_end = name_end;
+      int handle = 0;
+      if (name_end > 0 && ReadWireInt(frame.data, frame.size, handle_end, handle)) {
+        frame.handle_offset = static_cast<uint32_t>(name_end);
+      }
+
+      const size_t client = header.client_id % clients_count;
+      requests[key] = std::make_pair(client, clients_[client].size());
+      clients_[client].push_back(frame);
+      continue;
+    }
+
+    auto iter = requests.find(key);
+    if (iter == requests.end()) {
+      continue;
+    }
+    auto& frame = clients_[iter->second.first][iter->second.second];
+    requests.erase(iter);
+    frame.wait_for_response = true;
+
+    // The response of the create is the handle:
+    const auto name_end = SkipClassName(frame.data, frame.size);
+    int handle = 0;
+    if (name_end > 0 && name_end + 2 <= frame.size && frame.data[name_end] == '#' &&
+        frame.data[name_end + 1] == 'c' && ReadWireInt(data, size, idx, handle)) {
+      frame.created_handle = handle;
+    }
+  }
+
+  Logger::LogDebug(Logger::to_string(std::stringstream()
+                                     << kLogTag << ": indexed " << GetRequestsCount()
+                                     << " requests for " << clients_count << " clients"));
+  return true;
+}
+
+void CaptureReplay::Start() { start_time_ = std::chrono::steady_clock::now(); }
+
+size_t CaptureReplay::GetRequestsCount() const {
+  size_t count = 0;
+  for (const auto& frames : clients_) {
+    count += frames.size();
+  }
+  return count;
+}
+
+ClientRequest CaptureReplay::CreateRequest(const ReplayFrame& frame) {
+  RawDataType data;
+  if (frame.handle_offset > 0) {
+    // the mapped handle is serialized in the encoding of the captured one, so its size can differ
+    ClassHandle handle = 0;
+    size_t handle_end = frame.handle_offset;
+    ReadWireInt(frame.data, frame.size, handle_end, handle);
+    {
+      std::lock_guard<std::mutex> locker(handles_mutex_);
+      if (auto iter = handles_.find(handle); iter != handles_.end()) {
+        handle = iter->second;
+      } else {
+        ++unmapped_count_;
+      }
+    }
+    const auto* handle_data = frame.data + frame.handle_offset;
+    const auto encoding = static_cast<uint8_t>(*handle_data) == 'i' ? WireEncoding::Fixed
+                                                                    : WireEncoding::Compact;
+    data.reserve(frame.size + DataSerializer::kMaxIntSize);
+    data.insert(data.end(), frame.data, handle_data);
+    DataSerializer::AppendToRawData<ClassHandle>(data, handle, encoding);
+    data.insert(data.end(), frame.data + handle_end, frame.data + frame.size);
+  } else {
+    data.assign(frame.data, frame.data + frame.size);
+  }
+
+  ClientRequest::SuccessCallbackType on_success = nullptr;
+  if (frame.created_handle >= 0) {
+    on_success = [this, captured = frame.created_handle](std::any any) {
+      if (const auto* handle = std::any_cast<ClassHandle>(&any)) {
+        std::lock_guard<std::mutex> locker(handles_mutex_);
+        handles_[captured] = *handle;
+      }
+    };
+  }
+  return ClientRequest{std::move(data), frame.wait_for_response, on_success, nullptr};
+}
+
+void CaptureReplay::WaitForFrame(const ReplayFrame& frame) const {
+  if (pace_ == ReplayPace::Recorded) {
+    const auto delay = std::chrono::nanoseconds(frame.timestamp_ns - first_timestamp_ns_);
+    std::this_thread::sleep_until(start_time_ + delay);
+  }
+}
+
+// ---- CaptureReplaySource:
+CaptureReplaySource::CaptureReplaySource(std::shared_ptr<CaptureReplay> replay, size_t client)
+    : replay_(std::move(replay)), frames_(replay_->clients_.at(client)) {}
+
+ClientRequest CaptureReplaySource::ReadRequest() {
+  if (!IsGood()) {
+    return ClientRequest{};
+  }
+  const auto& frame = frames_[next_frame_++];
+  replay_->WaitForFrame(frame);
+  return replay_->CreateRequest(frame);
+}
+
+bool CaptureReplaySource::IsGood() const { return next_frame_ < frames_.size(); }
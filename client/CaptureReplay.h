@@ -0,0 +1,105 @@
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ClientRequest.h"
+#include "IDataSource.h"
+#include "Types.h"
+
+enum class ReplayPace {
+  // Requests are sent at the times they were received by the captured server.
+  Recorded = 0,
+  // Every request is sent right after the previous one of the same simulated client.
+  AsFastAsPossible
+};
+
+// Memory-mapped capture of the server traffic (see CaptureFormat.h and TrafficCapture), which is
+// replayed by N simulated clients: the requests of the captured client are sent by the simulated
+// client client_id % N, see CaptureReplaySource.
+//
+// The requests are replayed without their request ids and trace headers - the replaying Client
+// adds its own. Handles in the requests are remapped: the handle, which the captured server
+// returned to a create, is replaced by the handle, which the replay server returns to it.
+class CaptureReplay {
+ public:
+  ~CaptureReplay();
+
+  // Maps the file and indexes its requests. Returns nullptr if the capture is missing or invalid.
+  static std::shared_ptr<CaptureReplay> Open(const std::string& path, size_t clients_count,
+                                             ReplayPace pace);
+
+  // Starts the clock of the recorded pace.
+  void Start();
+
+  inline size_t GetClientsCount() const { return clients_.size(); }
+  size_t GetRequestsCount() const;
+  // Requests, which referred to a handle, which wasn't created by the replay (yet).
+  inline size_t GetUnmappedCount() const { return unmapped_count_.load(); }
+
+  friend class CaptureReplaySource;
+
+ private:
+  // Request in the mapped file.
+  struct ReplayFrame {
+    uint64_t timestamp_ns = 0;
+    // without the request id and the trace header
+    const char* data = nullptr;
+    uint32_t size = 0;
+    // offset of the serialized instance handle in the data, 0 - the request has no handle
+    uint32_t handle_offset = 0;
+    // handle, which the captured server returned to the create, -1 - not a create
+    ClassHandle created_handle = -1;
+    bool wait_for_response = false;
+  };
+
+ private:
+  CaptureReplay() = default;
+
+  // non-movable, non-copyable
+  CaptureReplay(const CaptureReplay& other) = delete;
+  CaptureReplay& operator=(const CaptureReplay& other) = delete;
+
+  bool Index(size_t clients_count);
+  ClientRequest CreateRequest(const ReplayFrame& frame);
+  void WaitForFrame(const ReplayFrame& frame) const;
+
+ private:
+  HANDLE file_handle_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_handle_ = nullptr;
+  const char* view_ = nullptr;
+  uint64_t file_size_ = 0;
+
+  ReplayPace pace_ = ReplayPace::Recorded;
+  std::chrono::steady_clock::time_point start_time_;
+  uint64_t first_timestamp_ns_ = 0;
+
+  // frames of each simulated client
+  std::vector<std::vector<ReplayFrame>> clients_;
+
+  // captured handle -> replayed handle
+  std::mutex handles_mutex_;
+  std::unordered_map<ClassHandle, ClassHandle> handles_;
+  std::atomic<size_t> unmapped_count_ = 0;
+};
+
+// Requests of one simulated client of the CaptureReplay.
+class CaptureReplaySource : public IDataSource {
+ public:
+  CaptureReplaySource(std::shared_ptr<CaptureReplay> replay, size_t client);
+
+  // In ReplayPace::Recorded blocks till the time of the request.
+  ClientRequest ReadRequest() override;
+  bool IsGood() const override;
+
+ private:
+  const std::shared_ptr<CaptureReplay> replay_;
+  const std::vector<CaptureReplay::ReplayFrame>& frames_;
+  size_t next_frame_ = 0;
+};
@@ -8,18 +8,22 @@ ClassRepository& ClassRepository::GetInstance() {
 }
 
 bool ClassRepository::RegisterClassHandle(ClassHandle handle) {
-  if (ContainsClassHandle(handle)) {
+  // check and insert under one lock - handles can be registered from several threads
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  if (std::find(handles_.begin(), handles_.end(), handle) != handles_.end()) {
     return false;
   }
 
-  {
-    std::lock_guard<std::mutex> locker(mutex_);
-    handles_.push_back(handle);
-  }
+  handles_.push_back(handle);
   return true;
 }
 
+std::vector<ClassHandle> ClassRepository::GetAllHandles() const {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  return handles_;
+}
+
 bool ClassRepository::ContainsClassHandle(ClassHandle handle) const {
-  std::lock_guard<std::mutex> locker(mutex_);
+  std::lock_guard<ProfiledMutex> locker(mutex_);
   return std::find(handles_.begin(), handles_.end(), handle) != handles_.end();
 }
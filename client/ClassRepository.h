@@ -1,7 +1,7 @@
 #pragma once
 
-#include <mutex>
 #include <vector>
+#include "ProfiledMutex.h"
 #include "Types.h"
 
 // Class to manage the instances of current CustomClass objects created on the
@@ -13,12 +13,12 @@ class ClassRepository {
   bool RegisterClassHandle(ClassHandle handle);
   bool ContainsClassHandle(ClassHandle handle) const;
 
-  inline std::vector<ClassHandle> GetAllHandles() const { return handles_; }
+  std::vector<ClassHandle> GetAllHandles() const;
 
  private:
   // methods of this class can be called both sync and async.
   // so, this means that it can be called from different theads.
   // Thus, synchronization needed.
-  mutable std::mutex mutex_;
+  mutable ProfiledMutex mutex_{"ClassRepository::mutex_"};
   std::vector<ClassHandle> handles_;
 };
\ No newline at end of file
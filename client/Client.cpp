@@ -1,30 +1,294 @@
 #include "Client.h"
 
+#include <algorithm>
+#include <iterator>
+#include <mutex>
 #include <sstream>
 #include <thread>
+#include "BufferPool.h"
 #include "ClientRequest.h"
+#include "DataDeserializer.h"
 #include "DataSerializer.h"
 #include "IDataSource.h"
 #include "Logger.h"
 #include "Pipe.h"
+#include "RequestControl.h"
 #include "ResponseParser.h"
+#include "Sharding.h"
+#include "Tracer.h"
 
 static constexpr auto kLogTag = "Client";
 
-static RawDataType CreateRequestIdData(RequestId request) {
-  std::stringstream ss;
-  ss << "#r";
-  DataSerializer::Serialize<int>(ss, request);
+// The request id and all the control headers, which can precede the data of the request.
+static constexpr size_t kMaxFrameHeadersSize =
+    2 + DataSerializer::kMaxIntSize + TraceContext::kHeaderSize +
+    RequestControl::kDeadlineHeaderSize + RequestControl::kSendTimeHeaderSize +
+    RequestControl::kPriorityHeaderSize;
 
-  return DataSerializer::ConvertToRawData(ss.str());
+static void AppendRequestIdData(RawDataType& data, RequestId request, WireEncoding encoding) {
+  data.push_back('#');
+  data.push_back('r');
+  DataSerializer::AppendToRawData<int>(data, request, encoding);
 }
 
-Client::Client(const std::string& pipe_name, std::shared_ptr<IDataSource> data_source,
-               std::shared_ptr<ResponseParser> parser, ExecutionPolicy exec_policy)
+// Offset of the trace header in the sent data and in the response - right after #r<request id>,
+// whose size depends on the encoding.
+static size_t GetTraceHeaderOffset(const RawDataType& data) {
+  size_t idx = 2;
+  return RegularTypeParaser::Parse<RequestId>(data, idx).first ? idx : data.size();
+}
+
+namespace {
+std::vector<std::string> GetShardPipeNames(const std::string& pipe_name, size_t shards_count) {
+  if (shards_count <= 1) {
+    return {pipe_name};
+  }
+
+  std::vector<std::string> pipe_names;
+  for (size_t shard = 0; shard < shards_count; ++shard) {
+    pipe_names.push_back(GetShardPipeName(pipe_name, shard));
+  }
+  return pipe_names;
+}
+
+// Passes the response through the router and parses it, when it's complete.
+void ParseResponse(ShardRouter& router, ResponseParser& parser, RawDataType& data) {
+  // The response of the traced request echoes its trace header - record the spans and remove it:
+  const auto trace_offset = GetTraceHeaderOffset(data);
+  size_t idx = trace_offset;
+  const auto [is_traced, trace] = Tracer::ParseHeader(data, idx);
+  if (is_traced) {
+    const auto now = Tracer::Now();
+    Tracer::RecordSpan(trace.trace_id, "client.roundtrip", trace.client_send_ns, now);
+    Tracer::RecordSpan(trace.trace_id, "pipe.response", trace.server_send_ns, now);
+    data.erase(std::next(data.begin(), trace_offset), std::next(data.begin(), idx));
+  }
+  const TraceSpan parse_span(trace.trace_id, "client.parse");
+
+  if (router.HandleResponse(data)) {
+    parser.ParseResponse(data);
+  }
+}
+
+// Trace of the sent data. Not traced - the trace id is 0.
+TraceContext GetTraceContext(const RawDataType& data_to_send) {
+  size_t idx = GetTraceHeaderOffset(data_to_send);
+  return Tracer::ParseHeader(data_to_send, idx).second;
+}
+
+// Stamps the send time into the trace header of the traced request.
+void StampSendTime(RawDataType& data_to_send, TraceContext& trace) {
+  trace.client_send_ns = Tracer::Now();
+  Tracer::WriteHeader(data_to_send, GetTraceHeaderOffset(data_to_send), trace);
+}
+
+// Stamps the send time header of the request, if it has one - right before the write, so the
+// server measures the whole delay of the request till its execution.
+void StampQueueTime(RawDataType& data_to_send) {
+  size_t idx = GetTraceHeaderOffset(data_to_send);
+  Tracer::ParseHeader(data_to_send, idx);
+  RequestControl::ParseDeadline(data_to_send, idx);
+  const auto offset = idx;
+  if (RequestControl::ParseSendTime(data_to_send, idx).first) {
+    RequestControl::WriteSendTime(data_to_send, offset, Tracer::Now());
+  }
+}
+
+// Chunk of the long frame, which starts at the offset (see RequestControl.h).
+void AppendFrameChunk(RawDataType& chunk, const RawDataType& data_to_send, RequestId request_id,
+                      size_t offset) {
+  const auto size = std::min(RequestControl::kMaxChunkPayload, data_to_send.size() - offset);
+  const RequestControl::ChunkHeader header{request_id, offset == 0,
+                                           offset + size == data_to_send.size()};
+  RequestControl::AppendChunk(chunk, header, data_to_send.data() + offset, size);
+}
+
+// Writes the frame, the long one - in chunks, so it fits into the read buffer of the server.
+bool SendFrameSync(Pipe& pipe, RequestId request_id, const RawDataType& data_to_send) {
+  if (data_to_send.size() <= RequestControl::kMaxChunkPayload) {
+    return pipe.SendDataToServerSync(data_to_send);
+  }
+  thread_local RawDataType t_chunk;
+  for (size_t offset = 0; offset < data_to_send.size();
+       offset += RequestControl::kMaxChunkPayload) {
+    t_chunk.clear();
+    AppendFrameChunk(t_chunk, data_to_send, request_id, offset);
+    if (!pipe.SendDataToServerSync(t_chunk)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Queues the frame of the async request into the lanes, the long one - in chunks, so the urgent
+// frames can be written between them. The short frame is written from its pooled buffer as is,
+// the long one is copied once into the chunks of another pooled buffer, and every chunk is written
+// from its slice. The callbacks are of the last chunk.
+void QueueWrites(SendLanes& lanes, RequestId request_id, SharedBuffer frame,
+                 RequestPriority priority, bool wait_for_response,
+                 Pipe::WriteAsyncResponseCallback callback,
+                 Pipe::WriteAsyncFailureCallback failure_callback) {
+  SendLanes::Write write;
+  write.priority = priority;
+  write.request_id = request_id;
+  write.wait_for_response = wait_for_response;
+  const auto& data_to_send = frame.GetData();
+  if (data_to_send.size() <= RequestControl::kMaxChunkPayload) {
+    write.data = BufferSlice(std::move(frame));
+    write.callback = std::move(callback);
+    write.failure_callback = std::move(failure_callback);
+    lanes.Push(std::move(write));
+    return;
+  }
+
+  const auto chunks_count = (data_to_send.size() + RequestControl::kMaxChunkPayload - 1) /
+                            RequestControl::kMaxChunkPayload;
+  auto buffer = BufferPool::GetInstance().Acquire(
+      data_to_send.size() + chunks_count * RequestControl::kChunkHeaderSize);
+  auto& chunks = buffer.GetMutableData();
+  for (size_t offset = 0; offset < data_to_send.size();
+       offset += RequestControl::kMaxChunkPayload) {
+    const auto chunk_offset = chunks.size();
+    AppendFrameChunk(chunks, data_to_send, request_id, offset);
+    write.data = BufferSlice(buffer, chunk_offset, chunks.size() - chunk_offset);
+    write.is_last = offset + RequestControl::kMaxChunkPayload >= data_to_send.size();
+    if (write.is_last) {
+      write.callback = std::move(callback);
+      write.failure_callback = std::move(failure_callback);
+    }
+    lanes.Push(write);
+  }
+}
+
+// Request, whose frame can't be written, with the error.
+struct FailedWrite {
+  RequestId request_id = -1;
+  Pipe::WriteAsyncFailureCallback failure_callback;
+  DWORD error = ERROR_SUCCESS;
+};
+// The failure callbacks are called outside the lock of the connection.
+using FailedWrites = std::vector<FailedWrite>;
+
+void CallFailedWrites(const FailedWrites& failed) {
+  for (const auto& write : failed) {
+    if (write.failure_callback) {
+      write.failure_callback(write.error);
+    }
+  }
+}
+
+// The request, whose chunk can't be written, fails - and its queued chunks are dropped.
+// Should be called under the connection's lock.
+void FailWrite(ConnectionPool::Connection& connection, const SendLanes::Write& write,
+               DWORD error, FailedWrites& failed) {
+  if (write.is_last) {
+    failed.push_back(FailedWrite{write.request_id, write.failure_callback, error});
+  } else if (auto last = connection.lanes.Drop(write.priority, write.request_id); last.first) {
+    failed.push_back(
+        FailedWrite{write.request_id, std::move(last.second.failure_callback), error});
+  }
+}
+
+void PumpWrites(const std::shared_ptr<ConnectionPool::Connection>& connection,
+                FailedWrites& failed);
+
+// The overlapped write is completed: the next frames of the connection are written, then the
+// callback of the request is called.
+void HandleWriteCompletion(const std::weak_ptr<ConnectionPool::Connection>& weak_connection,
+                           const SendLanes::Write& write, bool success, DWORD error) {
+  auto connection = weak_connection.lock();
+  // The write can be completed after Client is destroyed:
+  if (!connection) {
+    return;
+  }
+
+  FailedWrites failed;
+  {
+    std::lock_guard<ProfiledMutex> locker(connection->mutex);
+    connection->lanes.Complete(write.data.GetSize());
+    if (!success) {
+      FailWrite(*connection, write, error, failed);
+    }
+    PumpWrites(connection, failed);
+  }
+  CallFailedWrites(failed);
+  if (success && write.callback) {
+    write.callback(write.request_id, write.wait_for_response);
+  }
+}
+
+// Writes the queued frames of the connection, while the lanes let them.
+// Should be called under the connection's lock.
+void PumpWrites(const std::shared_ptr<ConnectionPool::Connection>& connection,
+                FailedWrites& failed) {
+  const auto weak_connection = std::weak_ptr<ConnectionPool::Connection>(connection);
+  while (true) {
+    auto next = connection->lanes.Pop();
+    if (!next.first) {
+      break;
+    }
+    const auto& write = next.second;
+    auto handle_written = [weak_connection, write](RequestId, bool) {
+      HandleWriteCompletion(weak_connection, write, true, ERROR_SUCCESS);
+    };
+    auto handle_failed = [weak_connection, write](DWORD error) {
+      HandleWriteCompletion(weak_connection, write, false, error);
+    };
+    if (!connection->pipe->SendDataToServerAsync(write.data, handle_written, write.request_id,
+                                                 write.wait_for_response, handle_failed)) {
+      const auto error = GetLastError();
+      connection->lanes.Complete(write.data.GetSize());
+      FailWrite(*connection, write, error, failed);
+    }
+  }
+}
+
+// If the server has closed the pipe, reconnects the connection.
+// Should be called under the connection's lock right after the failed operation.
+void ReconnectIfClosed(ConnectionPool& pool, ConnectionPool::Connection& connection,
+                       DWORD error) {
+  if (error == ERROR_NO_DATA && !pool.Reconnect(connection)) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - failed to reconnect to pipe="
+                                       << pool.GetPipeName()));
+  }
+}
+}  // namespace
+
+Client::Client(const std::vector<std::string>& endpoints,
+               std::shared_ptr<IDataSource> data_source, std::shared_ptr<ResponseParser> parser,
+               ExecutionPolicy exec_policy, size_t pool_size)
     : exec_policy_(exec_policy),
+      pool_size_(pool_size),
       data_source_(std::move(data_source)),
       parser_(std::move(parser)),
-      pipe_(std::make_shared<Pipe>(pipe_name, exec_policy)) {}
+      router_(std::make_shared<ShardRouter>()) {
+  for (const auto& pipe_name : endpoints) {
+    const auto endpoint = router_->AddEndpoint(pipe_name);
+    pools_[endpoint] = std::make_shared<ConnectionPool>(pipe_name, exec_policy, pool_size);
+  }
+  // Sync requests hold their connection till the response is read, so there is nothing to cancel
+  if (parser_ && exec_policy_ == ExecutionPolicy::Async) {
+    parser_->SetExpiryCallback(
+        [this](const std::vector<RequestId>& request_ids) { CancelExpiredRequests(request_ids); });
+  }
+}
+
+Client::Client(const std::string& pipe_name, std::shared_ptr<IDataSource> data_source,
+               std::shared_ptr<ResponseParser> parser, ExecutionPolicy exec_policy,
+               size_t shards_count, size_t pool_size)
+    : Client(GetShardPipeNames(pipe_name, shards_count), std::move(data_source),
+             std::move(parser), exec_policy, pool_size) {
+  // a single server is the only partition - its handles are passed as is
+  router_->SetHandlePartitions(std::max<size_t>(shards_count, 1));
+}
+
+Client::~Client() {
+  // the parser can outlive the client
+  if (parser_ && exec_policy_ == ExecutionPolicy::Async) {
+    parser_->SetExpiryCallback(nullptr);
+  }
+}
 
 bool Client::Start() {
   if (!data_source_ || !parser_) {
@@ -33,7 +297,7 @@ bool Client::Start() {
     return false;
   }
 
-  if (!ConnectToPipe()) {
+  if (!Connect()) {
     Logger::LogError("ERROR - failed to connect - terminating a client!");
     return false;
   }
@@ -41,57 +305,218 @@ bool Client::Start() {
   // keep getting while there are some data in a stream
   while (data_source_->IsGood()) {
     auto request = data_source_->ReadRequest();
-    auto data = request.GetData();
-    if (data.empty()) {
+    if (request.GetData().empty()) {
       // no data to send - retry!
       continue;
     }
 
-    auto request_id = ++request_id_counter_;
-    parser_->RegisterRequest(request_id, request);
+    // Failed request is skipped, unless the client lost the connection to the server:
+    if (!Execute(request) && !IsConnected()) {
+      Logger::LogError("ERROR - failed to connect - terminating a client!");
+      return false;
+    }
+  }
+  return true;
+}
 
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << kLogTag << ": sending request=" << request_id
-                            << ", data=" << DataSerializer::ConvertRawDataToString(data)));
+bool Client::Connect() {
+  for (const auto endpoint : router_->GetEndpoints()) {
+    auto pool = GetPool(endpoint);
+    if (!pool || !pool->Connect()) {
+      return false;
+    }
+  }
+  return true;
+}
 
-    // adding the request id data to the sending data:
-    auto data_to_send = CreateRequestIdData(request_id);
-    data_to_send.insert(data_to_send.end(), data.begin(), data.end());
+bool Client::IsConnected() const {
+  std::lock_guard<ProfiledMutex> locker(pools_mutex_);
+  return std::all_of(pools_.begin(), pools_.end(),
+                     [](const auto& item) { return item.second->IsConnected(); });
+}
 
-    bool result = true;
-    // Processing request - either sync or async:
-    if (exec_policy_ == ExecutionPolicy::Sync) {
-      if (!ExecuteRequestSync(request_id, data_to_send, request)) {
-        result = false;
-      }
-    } else {
-      if (!ExecuteRequestAsync(request_id, data_to_send, request)) {
-        result = false;
-      }
-    }
+bool Client::Execute(const ClientRequest& request) {
+  const auto& data = request.GetData();
+  if (data.empty()) {
+    return false;
+  }
 
-    if (result == false) {
-      // if request fails and the pipe is being closed -
-      // try to connect to server
-      if (GetLastError() == ERROR_NO_DATA) {
-        Logger::LogDebug("Trying to reconnect to server...");
-        pipe_->DisconnectFromServer();
-        if (!ConnectToPipe()) {
-          Logger::LogError("ERROR - failed to connect - terminating a client!");
-          return false;
-        }
-      } else {
-        Logger::LogError("ERROR - terminating client!");
-        return false;
-      }
+  // the overloaded server has asked to back off
+  if (const auto backoff = parser_->GetBackoff(); backoff.count() > 0) {
+    std::this_thread::sleep_for(backoff);
+  }
+
+  // Request ids are allocated without a lock - only the uniqueness is needed:
+  const auto request_id = request_id_counter_.fetch_add(1, std::memory_order_relaxed) + 1;
+  const auto trace_id = Tracer::SampleTrace();
+  const TraceSpan execute_span(trace_id, "client.execute");
+  const auto route = router_->Route(data, request_id, request.NeedToWaitForResponse(),
+                                     request.GetRoutingKey());
+  if (!route.is_valid) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - no endpoint for a request="
+                                       << request_id << " - skipping it!"));
+    return false;
+  }
+  // only the requests, which get a response, are completed by the parser
+  std::chrono::milliseconds timeout{0};
+  if (request.NeedToWaitForResponse()) {
+    timeout = request.GetTimeout().count() > 0 ? request.GetTimeout() : request_timeout_.load();
+    parser_->RegisterRequest(request_id, request, timeout);
+  }
+
+  NAMEDPIPE_LOG_DEBUG(kLogTag << ": sending request=" << request_id << ", data="
+                      << DataSerializer::ConvertRawDataToString(data));
+
+  // adding the request id data (and the trace header of the sampled request) to the sending data.
+  // Sync requests are completed before Execute() returns, so their data is built in the buffer of
+  // the thread, which isn't reallocated for the next requests:
+  thread_local RawDataType t_sync_data_to_send;
+  // The async frame is built right in the pooled buffer, which it's written from:
+  SharedBuffer async_frame;
+  if (exec_policy_ == ExecutionPolicy::Async) {
+    async_frame = BufferPool::GetInstance().Acquire(kMaxFrameHeadersSize + data.size());
+  }
+  auto& data_to_send = exec_policy_ == ExecutionPolicy::Sync ? t_sync_data_to_send
+                                                             : async_frame.GetMutableData();
+  data_to_send.clear();
+  AppendRequestIdData(data_to_send, request_id, wire_encoding_.load());
+  if (trace_id != 0) {
+    Tracer::AppendHeader(data_to_send, TraceContext{trace_id});
+  }
+  // The fanned out responses are merged, so the status of the dropped one can't be told apart:
+  if (timeout.count() > 0 && !route.is_fan_out && propagate_deadlines_.load()) {
+    RequestControl::AppendDeadline(
+        data_to_send,
+        Tracer::Now() + std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count());
+  }
+  // Only the awaited requests can get the busy response instead of the regular one - it's sent
+  // by the server, if there is the send time header. The fanned out ones can't, as above.
+  if (request.NeedToWaitForResponse() && !route.is_fan_out) {
+    RequestControl::AppendSendTime(data_to_send, 0);
+  }
+  if (request.GetPriority() != RequestPriority::Normal) {
+    RequestControl::AppendPriority(data_to_send, request.GetPriority());
+  }
+  ShardRouter::AppendRequestData(data_to_send, data, route);
+
+  bool result = false;
+  // Processing request - either sync or async:
+  if (route.is_fan_out) {
+    result = exec_policy_ == ExecutionPolicy::Sync
+                 ? ExecuteFanOutSync(request_id, data_to_send, route)
+                 : ExecuteFanOutAsync(request_id, std::move(async_frame), request, route);
+  } else if (auto pool = GetPool(route.endpoint)) {
+    result = exec_policy_ == ExecutionPolicy::Sync
+                 ? ExecuteRequestSync(request_id, data_to_send, request, *pool)
+                 : ExecuteRequestAsync(request_id, std::move(async_frame), request, *pool);
+  }
+
+  if (!result) {
+    const auto error = GetLastError();
+    router_->CancelRequest(request_id);
+    parser_->CancelRequest(request_id, error);
+  }
+  return result;
+}
+
+CallFuture<ClassHandle> Client::Create() {
+  thread_local RawDataType t_data;
+  t_data.clear();
+  AppendCreateCall(t_data, wire_encoding_.load());
+  return ExecuteCall<ClassHandle, true>(t_data);
+}
+
+CallFuture<ClassHandle> Client::Create(int ival) {
+  thread_local RawDataType t_data;
+  t_data.clear();
+  AppendCreateCall(t_data, wire_encoding_.load(), ival);
+  return ExecuteCall<ClassHandle, true>(t_data);
+}
+
+CallFuture<ClassHandle> Client::Create(int ival, const std::string& str) {
+  thread_local RawDataType t_data;
+  t_data.clear();
+  AppendCreateCall(t_data, wire_encoding_.load(), ival, str);
+  return ExecuteCall<ClassHandle, true>(t_data);
+}
+
+bool Client::AddEndpoint(const std::string& pipe_name) {
+  // the handles of another server would collide with the ones of the shards
+  if (router_->HasHandlePartitions()) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't add endpoint=" << pipe_name
+                                       << " to the shards of the server"));
+    return false;
+  }
+
+  auto pool = std::make_shared<ConnectionPool>(pipe_name, exec_policy_, pool_size_);
+  if (!pool->Connect()) {
+    return false;
+  }
+
+  // under the lock, so the routed requests don't see the endpoint without the pool
+  std::lock_guard<ProfiledMutex> locker(pools_mutex_);
+  const auto endpoint = router_->AddEndpoint(pipe_name);
+  pools_[endpoint] = std::move(pool);
+
+  Logger::LogDebug(Logger::to_string(std::stringstream() << kLogTag << ": added endpoint="
+                                                         << endpoint << ", pipe=" << pipe_name));
+  return true;
+}
+
+bool Client::RemoveEndpoint(const std::string& pipe_name) {
+  std::shared_ptr<ConnectionPool> pool;
+  {
+    std::lock_guard<ProfiledMutex> locker(pools_mutex_);
+    auto [found, endpoint] = router_->FindEndpoint(pipe_name);
+    if (!found || !router_->RemoveEndpoint(endpoint)) {
+      return false;
     }
+    pool = std::move(pools_[endpoint]);
+    pools_.erase(endpoint);
   }
+
+  pool->Disconnect();
   return true;
 }
 
-bool Client::ExecuteRequestSync(RequestId request_id, const RawDataType& data_to_send,
-                                const ClientRequest& request) {
-  if (!pipe_->SendDataToServerSync(data_to_send)) {
+std::shared_ptr<ConnectionPool> Client::GetPool(size_t endpoint) const {
+  std::lock_guard<ProfiledMutex> locker(pools_mutex_);
+  auto iter = pools_.find(endpoint);
+  return iter != pools_.end() ? iter->second : nullptr;
+}
+
+bool Client::ExecuteRequestSync(RequestId request_id, RawDataType& data_to_send,
+                                const ClientRequest& request, ConnectionPool& pool) {
+  auto trace = GetTraceContext(data_to_send);
+  const auto queue_begin = trace.IsTraced() ? Tracer::Now() : 0;
+  auto connection = pool.Acquire();
+  bool sent = false;
+  bool is_read = false;
+  // read into the buffer of the thread, which isn't reallocated for the next responses
+  thread_local RawDataType t_response;
+  {
+    // the response must be read before the next request is sent via this connection
+    std::lock_guard<ProfiledMutex> locker(connection->mutex);
+    if (trace.IsTraced()) {
+      Tracer::RecordSpan(trace.trace_id, "client.queue", queue_begin, Tracer::Now());
+      StampSendTime(data_to_send, trace);
+    }
+    StampQueueTime(data_to_send);
+    {
+      const TraceSpan send_span(trace.trace_id, "client.send");
+      sent = SendFrameSync(*connection->pipe, request_id, data_to_send);
+    }
+    if (!sent) {
+      ReconnectIfClosed(pool, *connection, GetLastError());
+    } else if (request.NeedToWaitForResponse()) {
+      is_read = connection->pipe->ReadDataFromServerSync(t_response);
+    }
+  }
+  ConnectionPool::Release(*connection);
+
+  if (!sent) {
     Logger::LogError(Logger::to_string(std::stringstream()
                                        << kLogTag << ": ERROR - failed to sync send a  request="
                                        << request_id));
@@ -100,75 +525,263 @@ bool Client::ExecuteRequestSync(RequestId request_id, const RawDataType& data_to
   }
 
   if (request.NeedToWaitForResponse()) {
-    auto data = pipe_->ReadDataFromServerSync();
-    if (!data.first) {
+    if (!is_read) {
+      const auto error = GetLastError();
       Logger::LogError(Logger::to_string(std::stringstream() << "ERROR: Failed to read pipe!"));
+      router_->CancelRequest(request_id);
+      parser_->CancelRequest(request_id, error);
     } else {
-      parser_->ParseResponse(data.second);
+      ParseResponse(*router_, *parser_, t_response);
     }
   }
 
   return true;
 }
 
-bool Client::ExecuteRequestAsync(RequestId request_id, const RawDataType& data_to_send,
-                                 const ClientRequest& request) {
-  auto weak_parser = std::weak_ptr<ResponseParser>(parser_);
-  auto handle_read_response = [weak_parser](RawDataType data) {
-    // Response can be received after Client is destroyed - need to handle that:
-    auto parser = weak_parser.lock();
-    if (!parser) {
-      return;
+bool Client::ExecuteRequestAsync(RequestId request_id, SharedBuffer frame,
+                                 const ClientRequest& request, ConnectionPool& pool) {
+  auto& data_to_send = frame.GetMutableData();
+  auto trace = GetTraceContext(data_to_send);
+  const auto queue_begin = trace.IsTraced() ? Tracer::Now() : 0;
+  auto connection = pool.Acquire();
+  auto weak_connection = std::weak_ptr<ConnectionPool::Connection>(connection);
+  auto parse_response = GetParseResponseCallback();
+  // Any response can be read by the callback of any request sent via the connection - only the
+  // number of outstanding requests matters here, the response is matched by its request id.
+  auto handle_read_response = [weak_connection, parse_response](SharedBuffer buffer) {
+    if (auto connection = weak_connection.lock()) {
+      ConnectionPool::Release(*connection);
     }
-    parser->ParseResponse(std::move(data));
+    parse_response(std::move(buffer));
   };
-
-  auto weak_pipe = std::weak_ptr<Pipe>(pipe_);
-  auto handle_write_response = [handle_read_response, weak_pipe](RequestId request_id,
-                                                                 bool read_data) {
-    auto pipe = weak_pipe.lock();
+  auto handle_write_response = [handle_read_response, weak_connection](RequestId request_id,
+                                                                       bool read_data) {
+    auto connection = weak_connection.lock();
     // Response can be received after Client is destroyed:
-    if (!pipe) {
+    if (!connection) {
+      return;
+    }
+    NAMEDPIPE_LOG_TRACE(kLogTag
+                        << ": Received async reponse on write data to server, request_id="
+                        << request_id << "; wait_for_response=" << read_data);
+    if (!read_data) {
+      ConnectionPool::Release(*connection);
       return;
     }
-#ifndef NDEBUG
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << kLogTag
-                            << ": Received async reponse on write data to server, request_id="
-                            << request_id << "; wait_for_response=" << read_data));
-#endif
-    if (read_data) {
-      pipe->ReadDataFromServerAsync(handle_read_response);
+
+    std::lock_guard<ProfiledMutex> locker(connection->mutex);
+    if (!connection->pipe->ReadDataFromServerAsync(handle_read_response)) {
+      ConnectionPool::Release(*connection);
     }
   };
 
-  if (!pipe_->SendDataToServerAsync(data_to_send, handle_write_response, request_id,
-                                    request.NeedToWaitForResponse())) {
+  // The request, which is queued behind the others, fails, when its frame can't be written:
+  auto weak_parser = std::weak_ptr<ResponseParser>(parser_);
+  auto weak_router = std::weak_ptr<ShardRouter>(router_);
+  auto handle_write_failure = [weak_connection, weak_parser, weak_router,
+                               request_id](DWORD error) {
+    if (auto connection = weak_connection.lock()) {
+      ConnectionPool::Release(*connection);
+    }
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - failed to async send a request="
+                                       << request_id << ", error=" << error));
+    auto parser = weak_parser.lock();
+    auto router = weak_router.lock();
+    if (parser && router) {
+      router->CancelRequest(request_id);
+      parser->CancelRequest(request_id, error);
+    }
+  };
+
+  FailedWrites failed;
+  DWORD error = ERROR_SUCCESS;
+  {
+    // the lock guards the pipe from being reconnected meanwhile
+    std::lock_guard<ProfiledMutex> locker(connection->mutex);
+    if (trace.IsTraced()) {
+      Tracer::RecordSpan(trace.trace_id, "client.queue", queue_begin, Tracer::Now());
+      StampSendTime(data_to_send, trace);
+    }
+    StampQueueTime(data_to_send);
+    const TraceSpan send_span(trace.trace_id, "client.send");
+    QueueWrites(connection->lanes, request_id, std::move(frame), request.GetPriority(),
+                request.NeedToWaitForResponse(), handle_write_response, handle_write_failure);
+    PumpWrites(connection, failed);
+
+    // the request, which fails right away, is failed by Execute()
+    const auto own_write =
+        std::find_if(failed.begin(), failed.end(),
+                     [request_id](const auto& write) { return write.request_id == request_id; });
+    if (own_write != failed.end()) {
+      error = own_write->error;
+      failed.erase(own_write);
+      ReconnectIfClosed(pool, *connection, error);
+    }
+  }
+  CallFailedWrites(failed);
+
+  if (error != ERROR_SUCCESS) {
+    ConnectionPool::Release(*connection);
     Logger::LogError(Logger::to_string(std::stringstream()
                                        << kLogTag << ": ERROR - failed to async send a request="
                                        << request_id << "!"));
+    SetLastError(error);
     return false;
   }
+  return true;
+}
+
+bool Client::ExecuteFanOutSync(RequestId request_id, RawDataType& data_to_send,
+                               const ShardRoute& route) {
+  auto trace = GetTraceContext(data_to_send);
+  const auto queue_begin = trace.IsTraced() ? Tracer::Now() : 0;
+  std::vector<std::shared_ptr<ConnectionPool>> pools;
+  for (const auto endpoint : route.fan_out_endpoints) {
+    auto pool = GetPool(endpoint);
+    if (!pool) {
+      // the endpoint was removed meanwhile
+      return false;
+    }
+    pools.push_back(std::move(pool));
+  }
+
+  // The connections are locked in the order of endpoints, thus, concurrent fan outs can't
+  // deadlock.
+  std::vector<std::shared_ptr<ConnectionPool::Connection>> connections;
+  std::vector<std::unique_lock<ProfiledMutex>> lockers;
+  for (auto& pool : pools) {
+    connections.push_back(pool->Acquire());
+    lockers.emplace_back(connections.back()->mutex);
+  }
+  if (trace.IsTraced()) {
+    Tracer::RecordSpan(trace.trace_id, "client.queue", queue_begin, Tracer::Now());
+  }
+
+  // Send to all the endpoints first, so they process the request in parallel:
+  size_t sent_count = 0;
+  for (; sent_count < connections.size(); ++sent_count) {
+    auto& connection = *connections[sent_count];
+    if (trace.IsTraced()) {
+      StampSendTime(data_to_send, trace);
+    }
+    const TraceSpan send_span(trace.trace_id, "client.send");
+    if (!SendFrameSync(*connection.pipe, request_id, data_to_send)) {
+      Logger::LogError(Logger::to_string(std::stringstream()
+                                         << kLogTag << ": ERROR - failed to fan out a request="
+                                         << request_id));
+      ReconnectIfClosed(*pools[sent_count], connection, GetLastError());
+      break;
+    }
+  }
+
+  // The responses must be read from all the connections, which the request was sent to:
+  std::vector<RawDataType> responses;
+  for (size_t idx = 0; idx < sent_count; ++idx) {
+    auto data = connections[idx]->pipe->ReadDataFromServerSync();
+    if (!data.first) {
+      Logger::LogError(Logger::to_string(std::stringstream() << "ERROR: Failed to read pipe!"));
+    } else {
+      responses.push_back(std::move(data.second));
+    }
+  }
 
+  lockers.clear();
+  for (auto& connection : connections) {
+    ConnectionPool::Release(*connection);
+  }
+
+  if (sent_count < connections.size()) {
+    return false;
+  }
+  for (auto& response : responses) {
+    ParseResponse(*router_, *parser_, response);
+  }
+  if (responses.size() < connections.size()) {
+    router_->CancelRequest(request_id);
+    parser_->CancelRequest(request_id, ERROR_BROKEN_PIPE);
+  }
   return true;
 }
 
-bool Client::ConnectToPipe() {
-  size_t retry_iteration = 0;
-  constexpr auto wait_timeout = 20000;  // seconds
-  while (!pipe_->Connect()) {
-    if (++retry_iteration == 100) {
-      Logger::LogError(Logger::to_string(
-          std::stringstream() << kLogTag
-                              << ": ERROR - TIMEOUT, failed to connect to pipe. Exiting...!"));
+bool Client::ExecuteFanOutAsync(RequestId request_id, SharedBuffer frame,
+                                const ClientRequest& request, const ShardRoute& route) {
+  std::vector<std::shared_ptr<ConnectionPool>> pools;
+  for (const auto endpoint : route.fan_out_endpoints) {
+    auto pool = GetPool(endpoint);
+    if (!pool) {
+      // the endpoint was removed meanwhile
       return false;
     }
-    Logger::LogError(Logger::to_string(std::stringstream()
-                                       << kLogTag
-                                       << ": ERROR - NO INSTANCE of pipe is "
-                                          "created. Will retry in 5 seconds!"));
-    std::this_thread::sleep_for(std::chrono::seconds(5));
+    pools.push_back(std::move(pool));
   }
 
+  // Responses are collected by the router, the last one is merged with the others and parsed.
+  for (size_t i = 0; i < pools.size(); ++i) {
+    // every connection stamps its send time into its own frame, the last one takes the original
+    SharedBuffer pool_frame;
+    if (i + 1 < pools.size()) {
+      const auto& data = frame.GetData();
+      pool_frame = BufferPool::GetInstance().Acquire(data.size());
+      pool_frame.GetMutableData().assign(data.begin(), data.end());
+    } else {
+      pool_frame = std::move(frame);
+    }
+    if (!ExecuteRequestAsync(request_id, std::move(pool_frame), request, *pools[i])) {
+      return false;
+    }
+  }
   return true;
 }
+
+void Client::CancelExpiredRequests(const std::vector<RequestId>& request_ids) {
+  if (!propagate_deadlines_.load()) {
+    return;
+  }
+
+  std::vector<std::shared_ptr<ConnectionPool>> pools;
+  {
+    std::lock_guard<ProfiledMutex> locker(pools_mutex_);
+    for (const auto& item : pools_) {
+      pools.push_back(item.second);
+    }
+  }
+
+  for (size_t first = 0; first < request_ids.size();) {
+    // the frame is kept alive by its slices till the overlapped writes complete
+    auto buffer = BufferPool::GetInstance().Acquire(0);
+    first += RequestControl::AppendCancel(buffer.GetMutableData(), request_ids, first);
+    SendLanes::Write write;
+    write.data = BufferSlice(std::move(buffer));
+    // the cancels overtake the queued requests
+    write.priority = RequestPriority::High;
+    for (const auto& pool : pools) {
+      for (const auto& connection : pool->GetConnections()) {
+        FailedWrites failed;
+        {
+          std::lock_guard<ProfiledMutex> locker(connection->mutex);
+          if (connection->pipe->IsConnected()) {
+            connection->lanes.Push(write);
+            PumpWrites(connection, failed);
+          }
+        }
+        CallFailedWrites(failed);
+      }
+    }
+  }
+}
+
+Pipe::ReadAsyncResponseCallback Client::GetParseResponseCallback() const {
+  auto weak_parser = std::weak_ptr<ResponseParser>(parser_);
+  auto weak_router = std::weak_ptr<ShardRouter>(router_);
+  return [weak_parser, weak_router](SharedBuffer buffer) {
+    // Response can be received after Client is destroyed - need to handle that:
+    auto parser = weak_parser.lock();
+    auto router = weak_router.lock();
+    if (!parser || !router) {
+      return;
+    }
+    // parsed in the pooled buffer, which it's read into
+    ParseResponse(*router, *parser, buffer.GetMutableData());
+  };
+}
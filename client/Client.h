@@ -1,41 +1,173 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include "BufferPool.h"
+#include "CallFuture.h"
+#include "ClientRequest.h"
+#include "ConnectionPool.h"
+#include "Pipe.h"
+#include "ProfiledMutex.h"
+#include "RemoteCall.h"
+#include "ShardRouter.h"
 #include "Types.h"
 
 class IDataSource;
-class ClientRequest;
-class Pipe;
 class ResponseParser;
 
 // Starting point of Client application.
 // When creating this class, you can specify next parameters:
-//	1. name of the pipe which should be created
+//	1. endpoints - names of the server pipes. The client keeps a pool of connections per endpoint
+//	   and routes requests between them via the ShardRouter;
 //	2. data_source, from which client will read data requests to server;
 //	3. parser - Parser of server responses on client's requests
-//	4. exec_policy - Sync or Async calls to server.
+//	4. exec_policy - Sync or Async calls to server;
+//	5. pool_size - number of connections per endpoint (see ConnectionPool).
 //
 // After you created a server, you can call a blocking Start() method, which
 // will send data to the pipe until there will be data in data_source.
+// Alternatively, after Connect() the requests can be sent via Execute() from many threads.
 class Client {
  public:
+  Client(const std::vector<std::string>& endpoints, std::shared_ptr<IDataSource> data_source,
+         std::shared_ptr<ResponseParser> parser, ExecutionPolicy exec_policy,
+         size_t pool_size = 1);
+
+  // shards_count - number of shards of NamedPipeServer --shards <count> (see Sharding.h).
   Client(const std::string& pipe_name, std::shared_ptr<IDataSource> data_source,
-         std::shared_ptr<ResponseParser> parser, ExecutionPolicy exec_policy);
+         std::shared_ptr<ResponseParser> parser, ExecutionPolicy exec_policy,
+         size_t shards_count = 1, size_t pool_size = 1);
+  ~Client();
 
   bool Start();
 
+  // Connects to all the endpoints.
+  bool Connect();
+  bool IsConnected() const;
+
+  // Sends the request and, in Sync mode, waits for the response. Thread-safe.
+  // In Sync mode it mustn't be called from the callbacks of the requests - the request and the
+  // response are kept in the buffers of the thread, which are reused by the next request.
+  // The awaited request can be rejected by the overloaded server - then it's completed with
+  // ERROR_BUSY, and the next requests are held back by Execute() for the time, which the server
+  // has asked for (see AdmissionControl).
+  bool Execute(const ClientRequest& request);
+
+  // Typed call of the CustomClass method, e.g. Call<&CustomClass::SetIntegerValue>(handle, 750).
+  // The future is completed with the result of the method (see CallFuture.h and RemoteCall.h) -
+  // in Sync mode before Call() returns.
+  template <auto Method, class... Args>
+  CallFuture<RemoteResultType<Method>> Call(ClassHandle handle, const Args&... args);
+  // Same, but with the priority of the request, e.g. the urgent reads next to the bulk uploads.
+  template <auto Method, class... Args>
+  CallFuture<RemoteResultType<Method>> Call(RequestPriority priority, ClassHandle handle,
+                                            const Args&... args);
+  // Typed creates of the CustomClass instance - the future is completed with its handle.
+  CallFuture<ClassHandle> Create();
+  CallFuture<ClassHandle> Create(int ival);
+  CallFuture<ClassHandle> Create(int ival, const std::string& str);
+
+  // Timeout of the requests, which don't set their own one (0 - they wait for the response
+  // forever, the default). The expired request is completed with ERROR_TIMEOUT.
+  inline void SetRequestTimeout(std::chrono::milliseconds timeout) { request_timeout_ = timeout; }
+  // Whether the deadlines of the requests with a timeout are sent to the server, and the expired
+  // requests are cancelled there (Async mode only), so the server doesn't spend its time on them
+  // (see RequestControl.h). Enabled by default.
+  inline void SetDeadlinePropagation(bool enabled) { propagate_deadlines_ = enabled; }
+  // Encoding of the request ids and the typed calls (see WireFormat.h) - the compact one shrinks
+  // the frames of the small values, the server answers in the encoding of the request. The data
+  // of the ClientRequests is sent as is. Fixed by default.
+  inline void SetWireEncoding(WireEncoding encoding) { wire_encoding_ = encoding; }
+
+  // Endpoints can be added and removed while the client is running. Only the creates are
+  // rebalanced - existing instances stay on the endpoints, which created them.
+  bool AddEndpoint(const std::string& pipe_name);
+  bool RemoveEndpoint(const std::string& pipe_name);
+
  private:
-  bool ConnectToPipe();
-  bool ExecuteRequestSync(RequestId request_id, const RawDataType& data_to_send,
-                          const ClientRequest& request);
-  bool ExecuteRequestAsync(RequestId request_id, const RawDataType& data_to_send,
-                           const ClientRequest& request);
+  std::shared_ptr<ConnectionPool> GetPool(size_t endpoint) const;
+
+  // Executes the call, which is in the data. The data is left empty, but with its capacity.
+  template <class Type, bool kHasResponse>
+  CallFuture<Type> ExecuteCall(RawDataType& data,
+                               RequestPriority priority = RequestPriority::Normal);
+
+  // The send time is stamped into the trace header of data_to_send, if the request is traced.
+  bool ExecuteRequestSync(RequestId request_id, RawDataType& data_to_send,
+                          const ClientRequest& request, ConnectionPool& pool);
+  // The frame is written from its pooled buffer as is, so it's not changed after the call.
+  bool ExecuteRequestAsync(RequestId request_id, SharedBuffer frame, const ClientRequest& request,
+                           ConnectionPool& pool);
+
+  // Sends the request to all the endpoints, the router merges their responses.
+  bool ExecuteFanOutSync(RequestId request_id, RawDataType& data_to_send,
+                         const ShardRoute& route);
+  bool ExecuteFanOutAsync(RequestId request_id, SharedBuffer frame, const ClientRequest& request,
+                          const ShardRoute& route);
+
+  Pipe::ReadAsyncResponseCallback GetParseResponseCallback() const;
+
+  // Sends the cancel frames of the timed out requests to all the connections - it isn't known,
+  // which connection the request was sent via.
+  void CancelExpiredRequests(const std::vector<RequestId>& request_ids);
 
  private:
-  RequestId request_id_counter_ = 0;
+  std::atomic<RequestId> request_id_counter_ = 0;
+  std::atomic<std::chrono::milliseconds> request_timeout_{std::chrono::milliseconds{0}};
+  std::atomic<bool> propagate_deadlines_ = true;
+  std::atomic<WireEncoding> wire_encoding_ = WireEncoding::Fixed;
   ExecutionPolicy exec_policy_;
+  const size_t pool_size_;
   std::shared_ptr<IDataSource> data_source_;
   std::shared_ptr<ResponseParser> parser_;
-  std::shared_ptr<Pipe> pipe_;
-};
\ No newline at end of file
+  // Router is shared with the async callbacks, which can outlive the client:
+  std::shared_ptr<ShardRouter> router_;
+
+  // endpoint id -> pool of connections
+  mutable ProfiledMutex pools_mutex_{"Client::pools_mutex_"};
+  std::unordered_map<size_t, std::shared_ptr<ConnectionPool>> pools_;
+};
+
+template <auto Method, class... Args>
+CallFuture<RemoteResultType<Method>> Client::Call(ClassHandle handle, const Args&... args) {
+  return Call<Method>(RequestPriority::Normal, handle, args...);
+}
+
+template <auto Method, class... Args>
+CallFuture<RemoteResultType<Method>> Client::Call(RequestPriority priority, ClassHandle handle,
+                                                  const Args&... args) {
+  // the request is built in the buffer of the thread, which isn't reallocated for the next calls
+  thread_local RawDataType t_data;
+  t_data.clear();
+  AppendMethodCall<Method>(t_data, wire_encoding_.load(), handle, args...);
+  return ExecuteCall<RemoteResultType<Method>,
+                     RemoteMethodSignature<decltype(Method)>::kHasResponse>(t_data, priority);
+}
+
+template <class Type, bool kHasResponse>
+CallFuture<Type> Client::ExecuteCall(RawDataType& data, RequestPriority priority) {
+  auto* state = CallStatePool<CallState<Type>>::GetInstance().Acquire();
+  CallFuture<Type> future(state);
+  if constexpr (kHasResponse) {
+    state->AttachRequest();
+  }
+
+  ClientRequest request(std::move(data), kHasResponse, state);
+  request.SetPriority(priority);
+  const bool result = Execute(request);
+  data = request.ReleaseData();
+  data.clear();
+
+  if (!result) {
+    // the registered request is already completed - otherwise the failure releases it:
+    state->CompleteWithFailure(GetLastError());
+  } else if constexpr (!kHasResponse) {
+    state->SetValue(true);
+  }
+  return future;
+}
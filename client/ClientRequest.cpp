@@ -8,15 +8,37 @@ ClientRequest::ClientRequest(RawDataType data, bool wait_for_response,
                              FailureCallbackType failure_callback)
     : data_(std::move(data)),
       wait_for_response_(wait_for_response),
-      succes_callback_(succes_callback),
-      failure_callback_(failure_callback) {}
+      succes_callback_(std::move(succes_callback)),
+      failure_callback_(std::move(failure_callback)) {}
+
+ClientRequest::ClientRequest(RawDataType data, bool wait_for_response,
+                             ICallCompletion* completion)
+    : data_(std::move(data)), wait_for_response_(wait_for_response), completion_(completion) {}
+
+ClientRequest ClientRequest::WithoutData() const {
+  ClientRequest request(RawDataType{}, wait_for_response_, succes_callback_, failure_callback_);
+  request.completion_ = completion_;
+  request.timeout_ = timeout_;
+  request.priority_ = priority_;
+  return request;
+}
+
 void ClientRequest::HandleSuccess(std::any result) {
   if (succes_callback_) {
     succes_callback_(std::move(result));
   }
 }
 
+void ClientRequest::HandleResponse(const RawDataType& data, size_t seek_idx) {
+  if (completion_) {
+    completion_->CompleteWithResponse(data, seek_idx);
+  }
+}
+
 void ClientRequest::HandleFailure(int error) {
+  if (completion_) {
+    completion_->CompleteWithFailure(error);
+  }
   if (failure_callback_) {
     failure_callback_(error);
   }
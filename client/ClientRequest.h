@@ -1,9 +1,23 @@
 #pragma once
 
 #include <any>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <utility>
 #include "Types.h"
 
+// Typed completion of the request (see CallFuture.h) - the value of the response is parsed
+// straight into it, instead of being passed to the success callback as std::any.
+class ICallCompletion {
+ public:
+  virtual ~ICallCompletion() = default;
+
+  // seek_idx - offset of the value in the response.
+  virtual void CompleteWithResponse(const RawDataType& data, size_t seek_idx) = 0;
+  virtual void CompleteWithFailure(int error) = 0;
+};
+
 // Class which encapsulate the user's request.
 // Also, it will process the server's response on user's request.
 // So, you can provide the callbacks, which will handle success or failed state
@@ -19,20 +33,50 @@ class ClientRequest final {
   explicit ClientRequest(RawDataType data, bool wait_for_response = false);
   ClientRequest(RawDataType data, bool wait_for_response, SuccessCallbackType succes_callback,
                 FailureCallbackType failure_callback);
+  // The completion isn't owned - it must stay alive till the request is completed.
+  ClientRequest(RawDataType data, bool wait_for_response, ICallCompletion* completion);
 
   inline bool NeedToWaitForResponse() const { return wait_for_response_; }
 
-  // TODO: maybe avoid copying?
-  inline RawDataType GetData() const { return data_; }
+  // The request fails with ERROR_TIMEOUT, if its response isn't received within the timeout.
+  // 0 - the default timeout of the Client.
+  inline void SetTimeout(std::chrono::milliseconds timeout) { timeout_ = timeout; }
+  inline std::chrono::milliseconds GetTimeout() const { return timeout_; }
+
+  // The urgent requests overtake the queued bulk ones in the client and on the server (see
+  // RequestControl.h). Normal by default.
+  inline void SetPriority(RequestPriority priority) { priority_ = priority; }
+  inline RequestPriority GetPriority() const { return priority_; }
+
+  // The create request with a routing key is placed on the endpoint chosen by consistent hashing
+  // of the key (see ShardRouter), so the same key lands on the same endpoint, and adding or
+  // removing an endpoint moves only ~1/N of the keys. Creates without a key are sent round-robin.
+  inline void SetRoutingKey(uint64_t key) { routing_key_ = std::make_pair(true, key); }
+  inline std::pair<bool, uint64_t> GetRoutingKey() const { return routing_key_; }
+
+  inline const RawDataType& GetData() const { return data_; }
+  // Moves the data out, so its buffer can be reused for the next request.
+  inline RawDataType ReleaseData() { return std::move(data_); }
+
+  // Copy of the request with the callbacks only - enough to handle the response.
+  ClientRequest WithoutData() const;
+
+  inline bool HasCompletion() const { return completion_ != nullptr; }
 
   // Invoke the response object with successful result
   void HandleSuccess(std::any result);
+  // Passes the response to the completion - seek_idx is the offset of the value.
+  void HandleResponse(const RawDataType& data, size_t seek_idx);
   // Invoke the response object with failed result and GLE
   void HandleFailure(int error);
 
  private:
   RawDataType data_;
   bool wait_for_response_ = false;
+  std::chrono::milliseconds timeout_{0};
+  RequestPriority priority_ = RequestPriority::Normal;
+  std::pair<bool, uint64_t> routing_key_{false, 0};
   SuccessCallbackType succes_callback_;
   FailureCallbackType failure_callback_;
+  ICallCompletion* completion_ = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "ConnectionPool.h"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include "Logger.h"
+
+static constexpr auto kLogTag = "ConnectionPool";
+
+namespace {
+std::vector<std::shared_ptr<ConnectionPool::Connection>> CreateConnections(
+    const std::string& pipe_name, ExecutionPolicy exec_policy, size_t pool_size) {
+  std::vector<std::shared_ptr<ConnectionPool::Connection>> connections;
+  for (size_t i = 0; i < std::max<size_t>(pool_size, 1); ++i) {
+    connections.push_back(std::make_shared<ConnectionPool::Connection>(pipe_name, exec_policy));
+  }
+  return connections;
+}
+}  // namespace
+
+ConnectionPool::ConnectionPool(const std::string& pipe_name, ExecutionPolicy exec_policy,
+                               size_t pool_size)
+    : pipe_name_(pipe_name), connections_(CreateConnections(pipe_name, exec_policy, pool_size)) {}
+
+bool ConnectionPool::Connect() {
+  for (auto& connection : connections_) {
+    std::lock_guard<ProfiledMutex> locker(connection->mutex);
+    if (!ConnectToPipe(*connection->pipe)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ConnectionPool::Disconnect() {
+  for (auto& connection : connections_) {
+    std::lock_guard<ProfiledMutex> locker(connection->mutex);
+    connection->pipe->DisconnectFromServer();
+  }
+}
+
+bool ConnectionPool::IsConnected() const {
+  return std::all_of(connections_.begin(), connections_.end(),
+                     [](const auto& connection) { return connection->pipe->IsConnected(); });
+}
+
+bool ConnectionPool::Reconnect(Connection& connection) {
+  Logger::LogDebug("Trying to reconnect to server...");
+  connection.pipe->DisconnectFromServer();
+  return ConnectToPipe(*connection.pipe);
+}
+
+std::shared_ptr<ConnectionPool::Connection> ConnectionPool::Acquire() {
+  // The counters are read without any lock - a slightly stale value only makes the choice a bit
+  // less balanced.
+  auto least_loaded = connections_.front();
+  auto least_outstanding = least_loaded->outstanding_requests.load(std::memory_order_relaxed);
+  for (size_t i = 1; i < connections_.size() && least_outstanding > 0; ++i) {
+    const auto outstanding = connections_[i]->outstanding_requests.load(std::memory_order_relaxed);
+    if (outstanding < least_outstanding) {
+      least_loaded = connections_[i];
+      least_outstanding = outstanding;
+    }
+  }
+
+  least_loaded->outstanding_requests.fetch_add(1, std::memory_order_relaxed);
+  return least_loaded;
+}
+
+void ConnectionPool::Release(Connection& connection) {
+  connection.outstanding_requests.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool ConnectionPool::ConnectToPipe(Pipe& pipe) {
+  size_t retry_iteration = 0;
+  while (!pipe.Connect()) {
+    if (++retry_iteration == 100) {
+      Logger::LogError(Logger::to_string(
+          std::stringstream() << kLogTag
+                              << ": ERROR - TIMEOUT, failed to connect to pipe. Exiting...!"));
+      return false;
+    }
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag
+                                       << ": ERROR - NO INSTANCE of pipe is "
+                                          "created. Will retry in 5 seconds!"));
+    std::this_thread::sleep_for(std::chrono::seconds(5));
+  }
+
+  return true;
+}
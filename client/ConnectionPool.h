@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Pipe.h"
+#include "ProfiledMutex.h"
+#include "SendLanes.h"
+#include "Types.h"
+
+// Pool of connections (pipe instances) to one server endpoint.
+// The server processes requests of one connection sequentially, so a few connections let
+// concurrent requests of the client be processed in parallel. Requests are spread over the
+// connections by the least-outstanding-requests rule.
+class ConnectionPool {
+ public:
+  struct Connection {
+    Connection(const std::string& pipe_name, ExecutionPolicy exec_policy)
+        : pipe(std::make_shared<Pipe>(pipe_name, exec_policy)) {}
+
+    std::shared_ptr<Pipe> pipe;
+    // Requests, which were assigned to this connection and are not completed yet.
+    std::atomic<size_t> outstanding_requests = 0;
+    // Sync request and its response must not interleave with other requests on the same pipe.
+    ProfiledMutex mutex{"ConnectionPool::Connection::mutex"};
+    // Async frames, which wait for their turn to be written. Guarded by the mutex.
+    SendLanes lanes;
+  };
+
+ public:
+  ConnectionPool(const std::string& pipe_name, ExecutionPolicy exec_policy, size_t pool_size);
+
+  // Connects all the connections. If there is no instance of the pipe, retries for a while.
+  bool Connect();
+  void Disconnect();
+  bool IsConnected() const;
+
+  // Reconnects the connection, which was closed by the server.
+  bool Reconnect(Connection& connection);
+
+  // Connection with the least number of outstanding requests. The number is incremented, so
+  // Release() should be called when the request is completed.
+  std::shared_ptr<Connection> Acquire();
+  static void Release(Connection& connection);
+
+  inline const std::string& GetPipeName() const { return pipe_name_; }
+  inline const std::vector<std::shared_ptr<Connection>>& GetConnections() const {
+    return connections_;
+  }
+
+ private:
+  static bool ConnectToPipe(Pipe& pipe);
+
+ private:
+  const std::string pipe_name_;
+  const std::vector<std::shared_ptr<Connection>> connections_;
+};
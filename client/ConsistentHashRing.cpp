@@ -0,0 +1,50 @@
+#include "ConsistentHashRing.h"
+
+ConsistentHashRing::ConsistentHashRing(size_t virtual_nodes) : virtual_nodes_(virtual_nodes) {}
+
+void ConsistentHashRing::Add(size_t endpoint_id, const std::string& name) {
+  for (size_t node = 0; node < virtual_nodes_; ++node) {
+    // on collision the point stays with the first endpoint - it doesn't matter for the balance
+    ring_.insert({Hash(name + "#" + std::to_string(node)), endpoint_id});
+  }
+}
+
+void ConsistentHashRing::Remove(size_t endpoint_id) {
+  for (auto iter = ring_.begin(); iter != ring_.end();) {
+    if (iter->second == endpoint_id) {
+      iter = ring_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+std::pair<bool, size_t> ConsistentHashRing::Find(uint64_t key) const {
+  if (ring_.empty()) {
+    return std::make_pair(false, size_t{0});
+  }
+
+  auto iter = ring_.lower_bound(Hash(key));
+  if (iter == ring_.end()) {
+    iter = ring_.begin();  // wrap around
+  }
+  return std::make_pair(true, iter->second);
+}
+
+uint64_t ConsistentHashRing::Hash(uint64_t key) {
+  // splitmix64 finalizer - sequential keys (like request ids) are spread over the whole ring
+  key += 0x9e3779b97f4a7c15ull;
+  key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+  key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+  return key ^ (key >> 31);
+}
+
+uint64_t ConsistentHashRing::Hash(const std::string& str) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  for (const char ch : str) {
+    hash ^= static_cast<unsigned char>(ch);
+    hash *= 1099511628211ull;
+  }
+  return Hash(hash);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+// Consistent hash ring of endpoints.
+// Every endpoint is placed on the ring at virtual_nodes points (hashes of its name), and a key
+// belongs to the first endpoint clockwise from the hash of the key. Thus, adding or removing an
+// endpoint moves only the keys between its points and the preceding ones - about 1/N of all keys,
+// the rest of the keys stay where they were.
+class ConsistentHashRing {
+ public:
+  explicit ConsistentHashRing(size_t virtual_nodes = 128);
+
+  void Add(size_t endpoint_id, const std::string& name);
+  void Remove(size_t endpoint_id);
+
+  // Endpoint owning the key. Returns false if the ring is empty.
+  std::pair<bool, size_t> Find(uint64_t key) const;
+
+  inline bool IsEmpty() const { return ring_.empty(); }
+
+  static uint64_t Hash(uint64_t key);
+  static uint64_t Hash(const std::string& str);
+
+ private:
+  const size_t virtual_nodes_;
+  // point on the ring -> endpoint id
+  std::map<uint64_t, size_t> ring_;
+};
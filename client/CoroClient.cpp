@@ -0,0 +1,169 @@
+#include "CoroClient.h"
+
+#include <sstream>
+#include "DataSerializer.h"
+#include "Logger.h"
+
+static constexpr auto kLogTag = "CoroClient";
+
+static constexpr DWORD kBufSize = 4096;
+// The value of the response follows #r<request id>.
+static constexpr size_t kResponseValueOffset = 2 + 1 + sizeof(RequestId);
+
+bool CoroClient::PipeIoAwaiter::await_suspend(std::coroutine_handle<> awaiting) noexcept {
+  operation.awaiting = awaiting;
+  const BOOL success = is_write ? WriteFile(pipe_handle, data, size, nullptr, &operation)
+                                : ReadFile(pipe_handle, data, size, nullptr, &operation);
+  // The completion is queued to the port even if the operation is completed right away:
+  const auto error = success ? 0 : GetLastError();
+  if (error != 0 && error != ERROR_IO_PENDING && error != ERROR_MORE_DATA) {
+    operation.result.error = error;
+    return false;
+  }
+  return true;
+}
+
+CoroClient::CoroClient(IoLoop& loop, const std::string& pipe_name)
+    : loop_(loop), pipe_name_(pipe_name) {}
+
+CoroClient::~CoroClient() {
+  if (pipe_handle_ == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  // The pending read is completed with ERROR_OPERATION_ABORTED - the reader must process it,
+  // before the pipe is closed:
+  CancelIoEx(pipe_handle_, nullptr);
+  while (!reader_.IsDone() && loop_.RunOnce(INFINITE)) {
+  }
+  CloseHandle(pipe_handle_);
+}
+
+bool CoroClient::Connect() {
+  if (pipe_handle_ != INVALID_HANDLE_VALUE) {
+    return IsConnected();
+  }
+
+  pipe_handle_ = CreateFile(pipe_name_.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+  if (pipe_handle_ == INVALID_HANDLE_VALUE) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't open the pipe="
+                                       << pipe_name_ << ", error=" << GetLastError()));
+    return false;
+  }
+
+  // Responses of the requests in flight mustn't be merged by the reads:
+  DWORD mode = PIPE_READMODE_MESSAGE;
+  if (!SetNamedPipeHandleState(pipe_handle_, &mode, nullptr, nullptr) ||
+      !loop_.Associate(pipe_handle_)) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't set up the pipe="
+                                       << pipe_name_ << ", error=" << GetLastError()));
+    CloseHandle(pipe_handle_);
+    pipe_handle_ = INVALID_HANDLE_VALUE;
+    return false;
+  }
+
+  is_reading_ = true;
+  reader_ = ReadResponses();
+  reader_.Start();
+  return IsConnected();
+}
+
+Task<bool> CoroClient::Execute(const RawDataType& body, bool wait_for_response,
+                               RawDataType& response, size_t& value_idx) {
+  if (!IsConnected()) {
+    co_return false;
+  }
+
+  const auto request_id = ++request_id_counter_;
+  RawDataType data;
+  data.reserve(kResponseValueOffset + body.size());
+  data.push_back('#');
+  data.push_back('r');
+  DataSerializer::AppendToRawData<RequestId>(data, request_id);
+  data.insert(data.end(), body.begin(), body.end());
+
+  // registered before the write, as the response can be read before the write is completed
+  PendingResponse pending;
+  if (wait_for_response) {
+    pending_responses_[request_id] = &pending;
+  }
+
+  const auto write = co_await PipeIoAwaiter{pipe_handle_, true, data.data(),
+                                            static_cast<DWORD>(data.size())};
+  if (write.error != 0) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - failed to send a request="
+                                       << request_id << ", error=" << write.error));
+    pending_responses_.erase(request_id);
+    co_return false;
+  }
+  if (!wait_for_response) {
+    co_return true;
+  }
+
+  if (!co_await ResponseAwaiter{pending}) {
+    co_return false;
+  }
+  response = std::move(pending.data);
+  value_idx = kResponseValueOffset;
+  co_return true;
+}
+
+Task<void> CoroClient::ReadResponses() {
+  RawDataType data;
+  while (true) {
+    // the rest of the long message is read right after the already read part
+    size_t size = 0;
+    DWORD error = 0;
+    do {
+      data.resize(size + kBufSize);
+      const auto read = co_await PipeIoAwaiter{pipe_handle_, false, data.data() + size,
+                                               kBufSize};
+      size += read.bytes_transferred;
+      error = read.error;
+    } while (error == ERROR_MORE_DATA);
+    if (error != 0) {
+      Logger::LogDebug(Logger::to_string(std::stringstream()
+                                         << kLogTag << ": stopped reading the pipe=" << pipe_name_
+                                         << ", error=" << error));
+      break;
+    }
+    data.resize(size);
+
+    size_t idx = 2;
+    if (data.size() < idx || data[0] != '#' || data[1] != 'r') {
+      continue;
+    }
+    const auto [success, request_id] = RegularTypeParaser::Parse<RequestId>(data, idx);
+    auto iter = success ? pending_responses_.find(request_id) : pending_responses_.end();
+    if (iter == pending_responses_.end()) {
+      Logger::LogError(Logger::to_string(std::stringstream()
+                                         << kLogTag << ": ERROR - unexpected response="
+                                         << request_id));
+      continue;
+    }
+
+    auto& pending = *iter->second;
+    pending_responses_.erase(iter);
+    // the buffer of the pending response is reused by the next read
+    pending.data.swap(data);
+    pending.is_received = true;
+    pending.is_completed = true;
+    if (pending.awaiting) {
+      pending.awaiting.resume();
+    }
+  }
+
+  // nothing will be received - the waiting coroutines are resumed with the failure
+  is_reading_ = false;
+  auto pending_responses = std::move(pending_responses_);
+  pending_responses_.clear();
+  for (auto& [request_id, pending] : pending_responses) {
+    pending->is_completed = true;
+    if (pending->awaiting) {
+      pending->awaiting.resume();
+    }
+  }
+}
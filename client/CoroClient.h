@@ -0,0 +1,132 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include "CustomClass.h"
+#include "DataDeserializer.h"
+#include "IoLoop.h"
+#include "RemoteCall.h"
+#include "Task.h"
+#include "Types.h"
+
+// Client with the C++20 coroutine interface (NAMEDPIPE_COROUTINES build option), e.g.
+//
+//   auto [success, handle] = co_await client.Create<CustomClass>(52, "x");
+//   auto [called, changed] = co_await client.Call<&CustomClass::SetIntegerValue>(handle, 750);
+//
+// The coroutine is suspended till the response with its request id is read, and is resumed by
+// the thread of the IoLoop - the requests of many coroutines are in flight on one connection at
+// once, and no thread pool thread is involved (unlike the callbacks of the async Client).
+// The client must be used and destroyed by the thread of the loop, when no calls are in flight.
+class CoroClient {
+ public:
+  CoroClient(IoLoop& loop, const std::string& pipe_name);
+  ~CoroClient();
+
+  // Opens the pipe and starts reading the responses.
+  bool Connect();
+  inline bool IsConnected() const { return pipe_handle_ != INVALID_HANDLE_VALUE && is_reading_; }
+
+  // Creates an instance via one of the CustomClass ctors: none, int or int and a string.
+  template <class Class, class... Args>
+  Task<std::pair<bool, ClassHandle>> Create(Args... args);
+
+  // Calls the method of the instance (see RemoteCall.h).
+  template <auto Method, class... Args>
+  Task<std::pair<bool, RemoteResultType<Method>>> Call(ClassHandle handle, Args... args);
+
+ private:
+  // Response, which a coroutine waits for.
+  struct PendingResponse {
+    std::coroutine_handle<> awaiting;
+    RawDataType data;
+    bool is_completed = false;
+    bool is_received = false;
+  };
+
+  struct ResponseAwaiter {
+    PendingResponse& pending;
+
+    bool await_ready() noexcept { return pending.is_completed; }
+    void await_suspend(std::coroutine_handle<> awaiting) noexcept { pending.awaiting = awaiting; }
+    bool await_resume() noexcept { return pending.is_received; }
+  };
+
+  // Overlapped read or write of the pipe.
+  struct PipeIoAwaiter {
+    HANDLE pipe_handle;
+    bool is_write;
+    char* data;
+    DWORD size;
+    IoOperation operation;
+
+    bool await_ready() noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    IoResult await_resume() noexcept { return operation.result; }
+  };
+
+ private:
+  // non-movable, non-copyable
+  CoroClient(const CoroClient& other) = delete;
+  CoroClient& operator=(const CoroClient& other) = delete;
+
+  // Sends the body with a new request id and, if wait_for_response, waits for the response -
+  // its value is at value_idx.
+  Task<bool> Execute(const RawDataType& body, bool wait_for_response, RawDataType& response,
+                     size_t& value_idx);
+  // Reads the responses and resumes the coroutines, which wait for them, till the pipe is closed.
+  Task<void> ReadResponses();
+
+  // Arguments of the creates, as they are serialized:
+  static inline int ToWireValue(int value) { return value; }
+  static inline std::string_view ToWireValue(std::string_view value) { return value; }
+
+ private:
+  IoLoop& loop_;
+  const std::string pipe_name_;
+  HANDLE pipe_handle_ = INVALID_HANDLE_VALUE;
+
+  RequestId request_id_counter_ = 0;
+  std::unordered_map<RequestId, PendingResponse*> pending_responses_;
+  Task<void> reader_;
+  bool is_reading_ = false;
+};
+
+template <class Class, class... Args>
+Task<std::pair<bool, ClassHandle>> CoroClient::Create(Args... args) {
+  static_assert(std::is_same_v<Class, CustomClass>, "only CustomClass instances can be created");
+  RawDataType body;
+  AppendCreateCall(body, ToWireValue(args)...);
+
+  RawDataType response;
+  size_t idx = 0;
+  if (!co_await Execute(body, true, response, idx)) {
+    co_return std::make_pair(false, ClassHandle{-1});
+  }
+  co_return RegularTypeParaser::Parse<ClassHandle>(response, idx);
+}
+
+template <auto Method, class... Args>
+Task<std::pair<bool, RemoteResultType<Method>>> CoroClient::Call(ClassHandle handle,
+                                                                 Args... args) {
+  using ResultType = RemoteResultType<Method>;
+  constexpr bool kHasResponse = RemoteMethodSignature<decltype(Method)>::kHasResponse;
+  RawDataType body;
+  AppendMethodCall<Method>(body, handle, args...);
+
+  RawDataType response;
+  size_t idx = 0;
+  if (!co_await Execute(body, kHasResponse, response, idx)) {
+    co_return std::make_pair(false, ResultType{});
+  }
+  if constexpr (kHasResponse) {
+    co_return RegularTypeParaser::Parse<ResultType>(response, idx);
+  } else {
+    // void method - the call is completed, when it's sent
+    co_return std::make_pair(true, true);
+  }
+}
@@ -9,7 +9,7 @@
 #include "Logger.h"
 
 static constexpr auto kLogTag = "DemoSimulator";
-static constexpr auto kTotalDemos = 11;
+static constexpr auto kTotalDemos = 13;
 
 static constexpr auto kInvalidClassHandle = -1;
 
@@ -232,6 +232,44 @@ ClientRequest DemoSimulator::ReadRequest() {
                                   << exc.what() << "!"));
         }
       };
+    } break;
+    case 11: {
+      CreateCustomClassRequest(ss);
+      ss << "#n";  // #n - number of instances
+      wait_for_response = true;
+      Logger::LogDebug(Logger::to_string(
+          std::stringstream() << kLogTag << ": Client wil request the number of CustomClass "
+                                            "instances"));
+      success_callback = [](std::any any) {
+        try {
+          const int count = std::any_cast<int>(any);
+          Logger::LogDebug(Logger::to_string(
+              std::stringstream() << kLogTag << ": Server has " << count
+                                  << " CustomClass instances"));
+        } catch (const std::bad_any_cast& exc) {
+          Logger::LogError(Logger::to_string(
+              std::stringstream() << kLogTag << ": parse error - can't cast to int, err="
+                                  << exc.what() << "!"));
+        }
+      };
+    } break;
+    case 12: {
+      ss << "#a";  // #a - admin request, the metrics of the server
+      wait_for_response = true;
+      Logger::LogDebug(Logger::to_string(std::stringstream()
+                                         << kLogTag << ": Client wil request the server metrics"));
+      success_callback = [](std::any any) {
+        try {
+          const std::string metrics = std::any_cast<std::string>(any);
+          Logger::Log(LogLevel::Info, Logger::to_string(std::stringstream()
+                                                        << kLogTag << ": Server metrics:\n"
+                                                        << metrics));
+        } catch (const std::bad_any_cast& exc) {
+          Logger::LogError(Logger::to_string(
+              std::stringstream() << kLogTag << ": parse error - can't cast to std::string, err="
+                                  << exc.what() << "!"));
+        }
+      };
     }
   }
 
@@ -329,7 +367,7 @@ int DemoSimulator::GetDemoIndex() const {
       while (true) {
         if (curr_iteration_ == 0) {
           Logger::LogDebug(Logger::to_string(
-              std::stringstream() << "Please, choose the demo index from 0 to 10. Type help in "
+              std::stringstream() << "Please, choose the demo index from 0 to 12. Type help in "
                                      "order to show the help again:"));
         }
         std::string input;
@@ -389,24 +427,29 @@ void DemoSimulator::PrintHelp() const {
                            "random CustomClass object. Server will send a bool indicating "
                            "success of this operation.\n"
                         << " 10 - Request a CustomClass object with specific handle from server. "
-                           "Server will send serialized version of the CustomClass object.\n"));
+                           "Server will send serialized version of the CustomClass object.\n"
+                        << " 11 - Request the number of CustomClass objects on server. In the "
+                           "sharded mode it is requested from every shard. Server will send "
+                           "int as a response.\n"
+                        << " 12 - Request the latency percentiles and traffic counters of the "
+                           "server. Server will send std::string as a response.\n"));
 
   switch (mode_) {
     case SimulationMode::STEP_BY_STEP:
       Logger::LogDebug(
           "This demo runs in step-by-step mode, means it will execute all "
-          "demos from 0 to 10 in sequantual mode with some small sleep between "
+          "demos from 0 to 12 in sequantual mode with some small sleep between "
           "demos.");
       break;
     case SimulationMode::RANDOM:
       Logger::LogDebug(
           "This demo runs in random mode. This means it will pick a demo index "
-          "at random from 0 till 10 and will execute that demo.");
+          "at random from 0 till 12 and will execute that demo.");
       break;
     case SimulationMode::MANUAL:
       Logger::LogDebug(
           "This demo runs in manual mode. You need manually run a demo by "
-          "entering the demo index from 0 to 10.");
+          "entering the demo index from 0 to 12.");
       break;
   }
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "IoLoop.h"
+
+#include <sstream>
+#include "Logger.h"
+
+static constexpr auto kLogTag = "IoLoop";
+
+IoLoop::IoLoop() {
+  // one thread - the one, which runs the loop
+  port_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+  if (!port_) {
+    Logger::LogError(Logger::to_string(
+        std::stringstream() << kLogTag
+                            << ": ERROR - can't create the completion port, error="
+                            << GetLastError()));
+  }
+}
+
+IoLoop::~IoLoop() {
+  if (port_) {
+    CloseHandle(port_);
+  }
+}
+
+bool IoLoop::Associate(HANDLE handle) {
+  if (!port_ || CreateIoCompletionPort(handle, port_, 0, 0) != port_) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't associate the handle="
+                                       << handle << ", error=" << GetLastError()));
+    return false;
+  }
+  return true;
+}
+
+bool IoLoop::RunOnce(DWORD timeout_ms) {
+  if (!port_) {
+    return false;
+  }
+
+  DWORD bytes_transferred = 0;
+  ULONG_PTR key = 0;
+  OVERLAPPED* overlapped = nullptr;
+  const BOOL success =
+      GetQueuedCompletionStatus(port_, &bytes_transferred, &key, &overlapped, timeout_ms);
+  if (!overlapped) {
+    // Post() passes the coroutine as the key:
+    if (!success || key == 0) {
+      return false;
+    }
+    std::coroutine_handle<>::from_address(reinterpret_cast<void*>(key)).resume();
+    return true;
+  }
+
+  auto* operation = static_cast<IoOperation*>(overlapped);
+  operation->result.bytes_transferred = bytes_transferred;
+  operation->result.error = success ? 0 : GetLastError();
+  operation->awaiting.resume();
+  return true;
+}
+
+bool IoLoop::Post(std::coroutine_handle<> coroutine) {
+  return port_ &&
+         PostQueuedCompletionStatus(port_, 0, reinterpret_cast<ULONG_PTR>(coroutine.address()),
+                                    nullptr);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <windows.h>
+#include <coroutine>
+#include "Task.h"
+
+struct IoResult {
+  DWORD bytes_transferred = 0;
+  // 0 - succeeded, otherwise GetLastError() of the operation (e.g. ERROR_MORE_DATA).
+  DWORD error = 0;
+};
+
+// Overlapped operation of the IoLoop: the coroutine, which awaits it, is resumed by the loop with
+// its result.
+struct IoOperation : OVERLAPPED {
+  IoOperation() : OVERLAPPED{} {}
+
+  std::coroutine_handle<> awaiting;
+  IoResult result;
+};
+
+// Single-threaded event loop of the coroutines (see CoroClient). The overlapped I/O of the
+// associated handles is completed to the I/O completion port of the loop, and the thread, which
+// runs the loop, resumes the coroutines, which await the I/O. The coroutines, the loop and its
+// handles must be used by that thread only.
+class IoLoop {
+ public:
+  IoLoop();
+  ~IoLoop();
+
+  inline bool IsValid() const { return port_ != nullptr; }
+
+  // The handle must be opened with FILE_FLAG_OVERLAPPED.
+  bool Associate(HANDLE handle);
+
+  // Runs the task and processes the completions till it's done. Returns its result.
+  template <class Type>
+  Type Run(Task<Type>& task) {
+    task.Start();
+    while (!task.IsDone() && RunOnce(INFINITE)) {
+    }
+    return task.TakeResult();
+  }
+
+  // Processes one completion or a scheduled coroutine. false - timeout or the port is closed.
+  bool RunOnce(DWORD timeout_ms);
+
+  // Awaiter, which resumes the coroutine by the loop - after the completions, which are
+  // already queued.
+  struct ScheduleAwaiter {
+    IoLoop& loop;
+
+    bool await_ready() noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+      return loop.Post(awaiting);
+    }
+    void await_resume() noexcept {}
+  };
+  inline ScheduleAwaiter Schedule() { return ScheduleAwaiter{*this}; }
+
+ private:
+  // non-movable, non-copyable
+  IoLoop(const IoLoop& other) = delete;
+  IoLoop& operator=(const IoLoop& other) = delete;
+
+  bool Post(std::coroutine_handle<> coroutine);
+
+ private:
+  HANDLE port_ = nullptr;
+};
@@ -0,0 +1,128 @@
+#include "PendingRequestTable.h"
+
+#include <mutex>
+
+PendingRequestTable::PendingRequestTable(size_t capacity) {
+  size_t shard_capacity = 16;
+  while (shard_capacity * kShardsCount < capacity) {
+    shard_capacity *= 2;
+  }
+  for (auto& shard : shards_) {
+    shard.slots.resize(shard_capacity);
+    shard.timers.Reserve(shard_capacity);
+  }
+}
+
+bool PendingRequestTable::Insert(RequestId request_id, const ClientRequest& request,
+                                 uint64_t current_tick, uint64_t deadline_tick) {
+  auto& shard = GetShard(request_id);
+  std::lock_guard<ProfiledMutex> locker(shard.mutex);
+
+  if ((shard.size + 1) * 4 > shard.slots.size() * 3) {
+    Grow(shard);
+  }
+  auto& slot = shard.slots[FindSlot(shard, request_id)];
+  if (slot.is_used) {
+    return false;
+  }
+
+  slot.request_id = request_id;
+  slot.is_used = true;
+  // The data isn't needed to handle the response, so it isn't copied:
+  slot.request = request.WithoutData();
+  slot.timer = TimerWheel::kInvalidTimer;
+  if (deadline_tick != 0) {
+    if (shard.timers.GetSize() == 0) {
+      // nothing expires - just moves the wheel to the current tick
+      shard.timers.Advance(current_tick, shard.expired_ids);
+    }
+    slot.timer = shard.timers.Schedule(deadline_tick, request_id);
+  }
+  ++shard.size;
+  return true;
+}
+
+std::pair<bool, ClientRequest> PendingRequestTable::Extract(RequestId request_id) {
+  auto& shard = GetShard(request_id);
+  std::lock_guard<ProfiledMutex> locker(shard.mutex);
+
+  const auto idx = FindSlot(shard, request_id);
+  if (!shard.slots[idx].is_used) {
+    return std::make_pair(false, ClientRequest{});
+  }
+  shard.timers.Cancel(shard.slots[idx].timer);
+  return std::make_pair(true, RemoveSlot(shard, idx));
+}
+
+void PendingRequestTable::ExtractExpired(
+    uint64_t tick, std::vector<std::pair<RequestId, ClientRequest>>& expired) {
+  for (auto& shard : shards_) {
+    std::lock_guard<ProfiledMutex> locker(shard.mutex);
+    shard.timers.Advance(tick, shard.expired_ids);
+    for (const auto request_id : shard.expired_ids) {
+      // the timer is already freed by the wheel
+      const auto idx = FindSlot(shard, request_id);
+      if (shard.slots[idx].is_used) {
+        expired.emplace_back(request_id, RemoveSlot(shard, idx));
+      }
+    }
+    shard.expired_ids.clear();
+  }
+}
+
+size_t PendingRequestTable::GetSize() const {
+  size_t size = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<ProfiledMutex> locker(shard.mutex);
+    size += shard.size;
+  }
+  return size;
+}
+
+size_t PendingRequestTable::GetHomeSlot(const Shard& shard, RequestId request_id) {
+  // the shard is chosen by the low bits, the slot - by the rest of them
+  return (static_cast<uint32_t>(request_id) / kShardsCount) & (shard.slots.size() - 1);
+}
+
+size_t PendingRequestTable::FindSlot(const Shard& shard, RequestId request_id) {
+  const auto mask = shard.slots.size() - 1;
+  auto idx = GetHomeSlot(shard, request_id);
+  while (shard.slots[idx].is_used && shard.slots[idx].request_id != request_id) {
+    idx = (idx + 1) & mask;
+  }
+  return idx;
+}
+
+ClientRequest PendingRequestTable::RemoveSlot(Shard& shard, size_t idx) {
+  const auto mask = shard.slots.size() - 1;
+  auto request = std::move(shard.slots[idx].request);
+
+  // The next slot is moved to the hole, unless its home slot is between the hole and it - then
+  // the lookups, which start from the home slot, wouldn't reach it:
+  auto hole = idx;
+  for (auto next = (hole + 1) & mask; shard.slots[next].is_used; next = (next + 1) & mask) {
+    const auto home = GetHomeSlot(shard, shard.slots[next].request_id);
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      shard.slots[hole] = std::move(shard.slots[next]);
+      hole = next;
+    }
+  }
+
+  auto& slot = shard.slots[hole];
+  slot.is_used = false;
+  slot.timer = TimerWheel::kInvalidTimer;
+  // the moved-out callbacks don't keep their captures alive till the slot is reused
+  slot.request = ClientRequest{};
+  --shard.size;
+  return request;
+}
+
+void PendingRequestTable::Grow(Shard& shard) {
+  auto slots = std::move(shard.slots);
+  shard.slots = std::vector<Slot>(slots.size() * 2);
+  for (auto& slot : slots) {
+    if (slot.is_used) {
+      shard.slots[FindSlot(shard, slot.request_id)] = std::move(slot);
+    }
+  }
+}
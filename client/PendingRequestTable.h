@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "ClientRequest.h"
+#include "ProfiledMutex.h"
+#include "TimerWheel.h"
+#include "Types.h"
+
+// Outstanding requests of the ResponseParser, which wait for their responses.
+// The request ids are increasing, so the table is sharded by the id and every shard is a
+// pre-sized open-addressing (linear probing) table, where the consecutive ids get the consecutive
+// slots: a lookup rarely probes more than one slot, and the requests of different shards don't
+// contend for a lock. The removed slot is filled by shifting the next ones back, so there are no
+// tombstones. Each shard has the TimerWheel of the deadlines of its requests under the same lock.
+// The table grows when it's 3/4 full, otherwise inserting and extracting doesn't allocate.
+class PendingRequestTable {
+ public:
+  static constexpr size_t kDefaultCapacity = 4096;
+
+  explicit PendingRequestTable(size_t capacity = kDefaultCapacity);
+
+  // deadline_tick - tick of the TimerWheel, after which the request expires, 0 - no deadline.
+  // current_tick - the current one, so an idle wheel is moved to it.
+  bool Insert(RequestId request_id, const ClientRequest& request, uint64_t current_tick,
+              uint64_t deadline_tick);
+  // false - the request isn't in the table (completed, cancelled or expired).
+  std::pair<bool, ClientRequest> Extract(RequestId request_id);
+  // Moves the requests, which expire till the tick, to expired - with their ids, so they can be
+  // cancelled on the server.
+  void ExtractExpired(uint64_t tick, std::vector<std::pair<RequestId, ClientRequest>>& expired);
+
+  size_t GetSize() const;
+
+ private:
+  static constexpr size_t kShardsCount = 16;
+
+  struct Slot {
+    RequestId request_id = 0;
+    bool is_used = false;
+    TimerWheel::TimerId timer = TimerWheel::kInvalidTimer;
+    ClientRequest request;
+  };
+
+  struct Shard {
+    mutable ProfiledMutex mutex{"PendingRequestTable::Shard::mutex"};
+    // the size is a power of 2
+    std::vector<Slot> slots;
+    size_t size = 0;
+    TimerWheel timers;
+    // ids of the expired requests, reused by every tick
+    std::vector<RequestId> expired_ids;
+  };
+
+  inline Shard& GetShard(RequestId request_id) {
+    return shards_[static_cast<uint32_t>(request_id) % kShardsCount];
+  }
+  static size_t GetHomeSlot(const Shard& shard, RequestId request_id);
+  // Index of the slot of the request or of the empty slot, where it would be inserted.
+  static size_t FindSlot(const Shard& shard, RequestId request_id);
+  // Frees the slot and shifts back the next slots, which are displaced from their home slots.
+  static ClientRequest RemoveSlot(Shard& shard, size_t idx);
+  static void Grow(Shard& shard);
+
+ private:
+  std::array<Shard, kShardsCount> shards_;
+};
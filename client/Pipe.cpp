@@ -23,9 +23,11 @@ struct WriteResponseData {
       UnregisterWait(wait_handle);
     }
   }
+  BufferSlice data;
   RequestId request_id;
   bool wait_for_response;
   Pipe::WriteAsyncResponseCallback callback;
+  Pipe::WriteAsyncFailureCallback failure_callback;
   LPOVERLAPPED overlapped;
   HANDLE completion_event = INVALID_HANDLE_VALUE;
   HANDLE pipe_handle = INVALID_HANDLE_VALUE;
@@ -35,9 +37,7 @@ struct WriteResponseData {
 // callback to handle the async write request to server
 void CALLBACK HandleAsyncResponseOnWriteToServer(_In_ PVOID lpParameter,
                                                  _In_ BOOLEAN TimerOrWaitFired) {
-#ifndef NDEBUG
-  Logger::LogDebug("Received Async write response from server...");
-#endif
+  NAMEDPIPE_LOG_TRACE("Received Async write response from server...");
   auto* data = reinterpret_cast<WriteResponseData*>(lpParameter);
   if (!data) {
     Logger::LogError(Logger::to_string(std::stringstream()
@@ -45,13 +45,17 @@ void CALLBACK HandleAsyncResponseOnWriteToServer(_In_ PVOID lpParameter,
     return;
   }
 
-  if (auto callback = data->callback) {
+  if (data->callback || data->failure_callback) {
     DWORD bytes_written = 0;
     if (!GetOverlappedResult(data->pipe_handle, data->overlapped, &bytes_written, true)) {
+      const auto error = GetLastError();
       Logger::LogError(Logger::to_string(
           std::stringstream() << kLogTag << ": ERROR - failed to get overlapped results!"));
-    } else {
-      callback(data->request_id, data->wait_for_response);
+      if (data->failure_callback) {
+        data->failure_callback(error);
+      }
+    } else if (data->callback) {
+      data->callback(data->request_id, data->wait_for_response);
     }
   }
 
@@ -68,7 +72,7 @@ struct ReadResponseData {
       UnregisterWait(wait_handle);
     }
   }
-  std::shared_ptr<RawDataType> data;
+  SharedBuffer buffer;
   Pipe::ReadAsyncResponseCallback callback;
   LPOVERLAPPED overlapped;
   HANDLE completion_event;
@@ -79,9 +83,7 @@ struct ReadResponseData {
 // callback to handle asycn response from server
 void CALLBACK HandleAsyncReadResponseFromServer(_In_ PVOID lpParameter,
                                                 _In_ BOOLEAN TimerOrWaitFired) {
-#ifndef NDEBUG
-  Logger::LogDebug("Received Sync read response from server...");
-#endif
+  NAMEDPIPE_LOG_TRACE("Received Sync read response from server...");
   auto* response_data = reinterpret_cast<ReadResponseData*>(lpParameter);
   if (!response_data) {
     Logger::LogError(Logger::to_string(
@@ -96,10 +98,8 @@ void CALLBACK HandleAsyncReadResponseFromServer(_In_ PVOID lpParameter,
       Logger::LogError(Logger::to_string(
           std::stringstream() << kLogTag << ": ERROR - failed to get overlapped results!"));
     } else {
-      auto data = response_data->data;
-      data->resize(bytes_written);
-
-      callback(*data.get());
+      response_data->buffer.GetMutableData().resize(bytes_written);
+      callback(std::move(response_data->buffer));
     }
   }
 
@@ -199,9 +199,8 @@ bool Pipe::SendDataToServerSync(const RawDataType& data) {
                                        << pipe_handle_ << ", error=" << GetLastError()));
     return false;
   } else {
-    Logger::LogDebug(Logger::to_string(std::stringstream()
-                                       << kLogTag << ": send data to pipe=" << pipe_handle_
-                                       << ", bytes=" << bytes_written));
+    NAMEDPIPE_LOG_TRACE(kLogTag << ": send data to pipe=" << pipe_handle_ << ", bytes="
+                        << bytes_written);
   }
 
   return true;
@@ -210,14 +209,20 @@ bool Pipe::SendDataToServerSync(const RawDataType& data) {
 // Block the thread and wait for the response from pipe (via ReadData)
 std::pair<bool, RawDataType> Pipe::ReadDataFromServerSync() {
   RawDataType res;
+  const bool success = ReadDataFromServerSync(res);
+  return std::make_pair(success, std::move(res));
+}
 
-  RawDataType tmp(kBufSize);
+bool Pipe::ReadDataFromServerSync(RawDataType& data) {
+  size_t size = 0;
   BOOL success = false;
   do {
-    // Read the server's response from the pipe.
-    DWORD bytes_read;
-    success = ReadFile(pipe_handle_, tmp.data(), tmp.size() * sizeof(RawDataType::value_type),
-                       &bytes_read,
+    // Read the server's response from the pipe - the rest of the long message is read right
+    // after the already read part.
+    data.resize(size + kBufSize);
+    DWORD bytes_read = 0;
+    success = ReadFile(pipe_handle_, data.data() + size,
+                       kBufSize * sizeof(RawDataType::value_type), &bytes_read,
                        nullptr);  // not overlapped  - sync
 
     if (!success && GetLastError() != ERROR_MORE_DATA) {
@@ -225,24 +230,26 @@ std::pair<bool, RawDataType> Pipe::ReadDataFromServerSync() {
       break;
     }
 
-    res.insert(res.end(), tmp.begin(), std::next(tmp.begin(), bytes_read));
-
+    size += bytes_read;
   } while (!success);  // repeat loop if ERROR_MORE_DATA
 
   if (!success) {
     Logger::LogError(Logger::to_string(std::stringstream()
                                        << kLogTag << ": ERROR - failed to read from pipe, error="
                                        << GetLastError()));
-    return std::make_pair(false, RawDataType{});
+    data.clear();
+    return false;
   }
 
-  return std::make_pair(true, res);
+  data.resize(size);
+  return true;
 }
 
-bool Pipe::SendDataToServerAsync(const RawDataType& data, WriteAsyncResponseCallback callback,
-                                 RequestId request_id, bool wait_for_response) {
+bool Pipe::SendDataToServerAsync(const BufferSlice& data, WriteAsyncResponseCallback callback,
+                                 RequestId request_id, bool wait_for_response,
+                                 WriteAsyncFailureCallback failure_callback) {
   constexpr auto kCharSize = sizeof(RawDataType::value_type);
-  DWORD bytes_to_write = data.size() * kCharSize;
+  DWORD bytes_to_write = data.GetSize() * kCharSize;
 
   DWORD bytes_written = 0;
   bool success = true;
@@ -256,7 +263,7 @@ bool Pipe::SendDataToServerAsync(const RawDataType& data, WriteAsyncResponseCall
   overlapped->Internal = 0;
   overlapped->InternalHigh = 0;
 
-  success = WriteFile(pipe_handle_, data.data(), bytes_to_write, &bytes_written, overlapped);
+  success = WriteFile(pipe_handle_, data.GetData(), bytes_to_write, &bytes_written, overlapped);
   // If the overlapped operation on pipe is still in progress (ERROR_IO_PENDING), no need to return
   // Just schedule the call and wait when the CompletionEvent object will be signalled
   if (!success && GetLastError() != ERROR_IO_PENDING) {
@@ -266,17 +273,16 @@ bool Pipe::SendDataToServerAsync(const RawDataType& data, WriteAsyncResponseCall
                                        << pipe_handle_ << ", error=" << GetLastError()));
     return false;
   } else {
-#ifndef NDEBUG
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << kLogTag << ": async send data to pipe=" << pipe_handle_));
-#endif
+    NAMEDPIPE_LOG_TRACE(kLogTag << ": async send data to pipe=" << pipe_handle_);
   }
 
   // register callback
   WriteResponseData* response = new WriteResponseData();
   response->overlapped = overlapped;
   response->pipe_handle = pipe_handle_;
+  response->data = data;
   response->callback = callback;
+  response->failure_callback = std::move(failure_callback);
   response->request_id = request_id;
   response->wait_for_response = wait_for_response;
   response->completion_event = completion_event;
@@ -302,7 +308,9 @@ bool Pipe::ReadDataFromServerAsync(ReadAsyncResponseCallback callback) {
     DWORD bytes_read;
 
     LPOVERLAPPED overlapped = new OVERLAPPED;
-    auto data = std::make_shared<RawDataType>(kBufSize);
+    auto buffer = BufferPool::GetInstance().Acquire(kBufSize);
+    auto& data = buffer.GetMutableData();
+    data.resize(kBufSize);
     auto completion_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 
     overlapped->hEvent = completion_event;
@@ -311,7 +319,7 @@ bool Pipe::ReadDataFromServerAsync(ReadAsyncResponseCallback callback) {
     overlapped->Internal = 0;
     overlapped->InternalHigh = 0;
 
-    success = ReadFile(pipe_handle_, data->data(), data->size() * sizeof(RawDataType::value_type),
+    success = ReadFile(pipe_handle_, data.data(), data.size() * sizeof(RawDataType::value_type),
                        &bytes_read,
                        overlapped);  // overlapped - async
 
@@ -325,15 +333,13 @@ bool Pipe::ReadDataFromServerAsync(ReadAsyncResponseCallback callback) {
       return false;
 	}
 	else {
-#ifndef NDEBUG
-		Logger::LogDebug(Logger::to_string(
-			std::stringstream() << kLogTag << ": async read data to pipe=" << pipe_handle_ << " get_last_error=" << GetLastError()));
-#endif
+      NAMEDPIPE_LOG_TRACE(kLogTag << ": async read data to pipe=" << pipe_handle_
+                          << " get_last_error=" << GetLastError());
 	}
 
     ReadResponseData* response = new ReadResponseData();
     response->overlapped = overlapped;
-    response->data = data;
+    response->buffer = std::move(buffer);
     response->pipe_handle = pipe_handle_;
     response->callback = callback;
     response->completion_event = completion_event;
@@ -6,12 +6,14 @@
 #include <utility>
 
 #include <windows.h>
+#include "BufferPool.h"
 #include "Types.h"
 
 class Pipe final {
  public:
   using WriteAsyncResponseCallback = std::function<void(RequestId, bool)>;
-  using ReadAsyncResponseCallback = std::function<void(RawDataType)>;
+  using ReadAsyncResponseCallback = std::function<void(SharedBuffer)>;
+  using WriteAsyncFailureCallback = std::function<void(DWORD)>;
 
  public:
   Pipe(const std::string& name, ExecutionPolicy exec_policy);
@@ -33,11 +35,17 @@ class Pipe final {
   bool SendDataToServerSync(const RawDataType& data);
   // Block the thread and wait for the response from pipe (via ReadData)
   std::pair<bool, RawDataType> ReadDataFromServerSync();
+  // Same, but reads into the given data, so a reused buffer isn't reallocated.
+  bool ReadDataFromServerSync(RawDataType& data);
 
   // ----- Async execution:
-  bool SendDataToServerAsync(const RawDataType& data,
+  // The data isn't copied - the slice keeps its buffer alive till the write is completed. The
+  // failure callback is called with the error, if the started write fails.
+  bool SendDataToServerAsync(const BufferSlice& data,
                              WriteAsyncResponseCallback callback,
-                             RequestId request_id, bool wait_for_response);
+                             RequestId request_id, bool wait_for_response,
+                             WriteAsyncFailureCallback failure_callback = nullptr);
+  // The response is read into a buffer of the BufferPool, which is passed to the callback.
   bool ReadDataFromServerAsync(ReadAsyncResponseCallback callback);
 
  private:
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "CustomClass.h"
+#include "DataSerializer.h"
+#include "Types.h"
+
+// Methods of the CustomClass, which can be called by Client::Call<&CustomClass::Method>: the name
+// of the method on the wire and its signature, from which the arguments and the result type are
+// deduced. The server answers the call of a void method with nothing - the call is completed,
+// when it's sent, with the value true.
+template <auto Method>
+struct RemoteMethod;
+
+template <>
+struct RemoteMethod<&CustomClass::PrintToCout> {
+  static constexpr auto kName = "PrintToCout";
+};
+template <>
+struct RemoteMethod<&CustomClass::PrintToString> {
+  static constexpr auto kName = "PrintToString";
+};
+template <>
+struct RemoteMethod<&CustomClass::SetIntegerValue> {
+  static constexpr auto kName = "SetIntegerValue";
+};
+template <>
+struct RemoteMethod<&CustomClass::SetStringValue> {
+  static constexpr auto kName = "SetStringValue";
+};
+
+template <class MethodType>
+struct RemoteMethodSignature;
+
+template <class Result, class Class, class... Params>
+struct RemoteMethodSignature<Result (Class::*)(Params...)> {
+  using ResultType = std::conditional_t<std::is_void_v<Result>, bool, Result>;
+  static constexpr bool kHasResponse = !std::is_void_v<Result>;
+
+  template <class... Args>
+  static void AppendArguments(RawDataType& data, WireEncoding encoding, const Args&... args) {
+    static_assert(sizeof...(Args) == sizeof...(Params), "wrong number of the method arguments");
+    (DataSerializer::AppendToRawData<std::decay_t<Params>>(data, args, encoding), ...);
+  }
+};
+
+template <class Result, class Class, class... Params>
+struct RemoteMethodSignature<Result (Class::*)(Params...) const>
+    : RemoteMethodSignature<Result (Class::*)(Params...)> {};
+
+// Type of the CallFuture value of Client::Call<Method>.
+template <auto Method>
+using RemoteResultType = typename RemoteMethodSignature<decltype(Method)>::ResultType;
+
+// #<class name><handle>#m<method name><arguments> - the request of the call, the values are in
+// the given encoding (see WireFormat.h).
+template <auto Method, class... Args>
+void AppendMethodCall(RawDataType& data, WireEncoding encoding, ClassHandle handle,
+                      const Args&... args) {
+  data.push_back('#');
+  DataSerializer::AppendToRawData<std::string>(data, CustomClass::kClassName, encoding);
+  DataSerializer::AppendToRawData<ClassHandle>(data, handle, encoding);
+  data.push_back('#');
+  data.push_back('m');
+  DataSerializer::AppendToRawData<std::string_view>(data, RemoteMethod<Method>::kName, encoding);
+  RemoteMethodSignature<decltype(Method)>::AppendArguments(data, encoding, args...);
+}
+
+template <auto Method, class... Args>
+void AppendMethodCall(RawDataType& data, ClassHandle handle, const Args&... args) {
+  AppendMethodCall<Method>(data, WireEncoding::Fixed, handle, args...);
+}
+
+// #<class name>#c<arguments> - the request of the create. The arguments are the ones of the
+// CustomClass ctors: none, int or int and std::string.
+template <class... Args>
+void AppendCreateCall(RawDataType& data, WireEncoding encoding, const Args&... args) {
+  data.push_back('#');
+  DataSerializer::AppendToRawData<std::string>(data, CustomClass::kClassName, encoding);
+  data.push_back('#');
+  data.push_back('c');
+  (DataSerializer::AppendToRawData<Args>(data, args, encoding), ...);
+}
+
+template <class... Args>
+void AppendCreateCall(RawDataType& data, const Args&... args) {
+  AppendCreateCall(data, WireEncoding::Fixed, args...);
+}
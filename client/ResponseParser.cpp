@@ -1,14 +1,32 @@
 #include "ResponseParser.h"
 
+#include <windows.h>
 #include "ClassRepository.h"
 #include "CustomClass.h"
 #include "DataDeserializer.h"
+#include "RequestControl.h"
 
 #include <sstream>
 #include "Logger.h"
 
 static constexpr auto kLogTag = "ResponseParser";
 
+// Resolution of the request timeouts - the request expires up to a tick after its deadline.
+static constexpr std::chrono::milliseconds kTick{10};
+
+ResponseParser::ResponseParser() : start_time_(std::chrono::steady_clock::now()) {}
+
+ResponseParser::~ResponseParser() {
+  {
+    std::lock_guard<std::mutex> locker(expiry_mutex_);
+    is_closed_ = true;
+  }
+  expiry_cv_.notify_one();
+  if (expiry_thread_.joinable()) {
+    expiry_thread_.join();
+  }
+}
+
 bool ResponseParser::ParseResponse(const RawDataType& data) {
   size_t idx = 0;
 
@@ -16,56 +34,145 @@ bool ResponseParser::ParseResponse(const RawDataType& data) {
   auto request_id = ParseRequestId(data, idx);
   std::any any_value;
 
+  // the server has dropped the request - it's expired or cancelled
+  if (auto [is_status, error] = RequestControl::ParseStatus(data, idx); is_status) {
+    NAMEDPIPE_LOG_DEBUG(kLogTag << ": [request_id=" << request_id
+                        << "] The server dropped the request, error=" << error);
+    CancelRequest(request_id, error);
+    return true;
+  }
+  // the overloaded server has rejected the request - the next ones are held back for a while
+  if (auto [is_busy, retry_after_us] = RequestControl::ParseBusy(data, idx); is_busy) {
+    NAMEDPIPE_LOG_DEBUG(kLogTag << ": [request_id=" << request_id
+                        << "] The server is busy, retry after=" << retry_after_us << "us");
+    const auto backoff_until = GetCurrentTime() + retry_after_us;
+    auto current = backoff_until_us_.load(std::memory_order_relaxed);
+    while (current < backoff_until &&
+           !backoff_until_us_.compare_exchange_weak(current, backoff_until,
+                                                    std::memory_order_relaxed)) {
+    }
+    CancelRequest(request_id, ERROR_BUSY);
+    return true;
+  }
+
   if (ParseCustomClassResponse(data)) {
     return true;
-  } else if (auto [success, value] = RegularTypeParaser::Parse<bool>(data, idx); success) {
-#ifndef NDEBUG  // just for debug purposes
-    Logger::LogDebug(Logger::to_string(std::stringstream()
-                                       << "[request_id=" << request_id
-                                       << "] Received bool value from server: " << value));
-#endif
+  }
+
+  auto [is_registered, request] = ExtractRequest(request_id);
+  // typed calls parse the value themselves (see CallFuture.h):
+  if (request.HasCompletion()) {
+    request.HandleResponse(data, idx);
+    return true;
+  }
+
+  if (auto [success, value] = RegularTypeParaser::Parse<bool>(data, idx); success) {
+    NAMEDPIPE_LOG_DEBUG("[request_id=" << request_id << "] Received bool value from server: "
+                        << value);
     any_value = value;
   } else if (auto [success, value] = RegularTypeParaser::Parse<int>(data, idx); success) {
-#ifndef NDEBUG  // just for debug purposes
-    Logger::LogDebug(Logger::to_string(std::stringstream()
-                                       << "[request_id=" << request_id
-                                       << "] Received int value from server: " << value));
-#endif
+    NAMEDPIPE_LOG_DEBUG("[request_id=" << request_id << "] Received int value from server: "
+                        << value);
     any_value = value;
   } else if (auto [success, value] = RegularTypeParaser::Parse<double>(data, idx); success) {
-#ifndef NDEBUG  // just for debug purposes
-    Logger::LogDebug(Logger::to_string(std::stringstream()
-                                       << "[request_id=" << request_id
-                                       << "] Received double value from server: " << value));
-#endif
+    NAMEDPIPE_LOG_DEBUG("[request_id=" << request_id << "] Received double value from server: "
+                        << value);
     any_value = value;
   } else if (auto [success, value] = RegularTypeParaser::Parse<std::string>(data, idx); success) {
-#ifndef NDEBUG  // just for debug purposes
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << "[request_id=" << request_id
-                            << "] Received std::string value from client: " << value.c_str()));
-#endif
+    NAMEDPIPE_LOG_DEBUG("[request_id=" << request_id
+                        << "] Received std::string value from client: " << value.c_str());
     any_value = value;
   } else {
     // TODO: handle error!
     Logger::LogError(Logger::to_string(std::stringstream()
                                        << kLogTag << ": Can't parse a request=" << request_id));
+    request.HandleFailure(ERROR_INVALID_DATA);
     return false;
   }
 
   // Notifying the ClientRequest about response
-  {
-    std::lock_guard<std::mutex> locker(requests_mutex_);
+  if (is_registered) {
+    request.HandleSuccess(std::move(any_value));
+  }
 
-    decltype(requests_)::iterator iter = requests_.find(request_id);
+  return true;
+}
 
-    if (iter != requests_.end()) {
-      iter->second.HandleSuccess(any_value);
-      requests_.erase(iter);
-    }
+void ResponseParser::CancelRequest(RequestId request_id, int error) {
+  if (auto [is_registered, request] = ExtractRequest(request_id); is_registered) {
+    request.HandleFailure(error);
   }
+}
 
-  return true;
+void ResponseParser::SetExpiryCallback(ExpiryCallback callback) {
+  std::lock_guard<ProfiledMutex> locker(expiry_callback_mutex_);
+  expiry_callback_ = std::move(callback);
+}
+
+std::pair<bool, ClientRequest> ResponseParser::ExtractRequest(RequestId request_id) {
+  return requests_.Extract(request_id);
+}
+
+uint64_t ResponseParser::GetCurrentTick() const {
+  return static_cast<uint64_t>((std::chrono::steady_clock::now() - start_time_) / kTick);
+}
+
+uint64_t ResponseParser::GetCurrentTime() const {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - start_time_)
+                                   .count());
+}
+
+std::chrono::microseconds ResponseParser::GetBackoff() const {
+  const auto backoff_until = backoff_until_us_.load(std::memory_order_relaxed);
+  if (backoff_until == 0) {
+    return std::chrono::microseconds{0};
+  }
+  const auto now = GetCurrentTime();
+  return std::chrono::microseconds(backoff_until > now ? backoff_until - now : 0);
+}
+
+void ResponseParser::StartExpiryThread() {
+  if (is_expiry_started_.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::lock_guard<std::mutex> locker(expiry_mutex_);
+  if (!is_expiry_started_ && !is_closed_) {
+    expiry_thread_ = std::thread(&ResponseParser::ExpiryLoop, this);
+    is_expiry_started_ = true;
+  }
+}
+
+void ResponseParser::ExpiryLoop() {
+  auto is_closed = [this] { return is_closed_.load(); };
+  std::vector<std::pair<RequestId, ClientRequest>> expired;
+  std::vector<RequestId> expired_ids;
+  std::unique_lock<std::mutex> locker(expiry_mutex_);
+  while (!is_closed_) {
+    expiry_cv_.wait_for(locker, kTick, is_closed);
+
+    locker.unlock();
+    requests_.ExtractExpired(GetCurrentTick(), expired);
+    if (!expired.empty()) {
+      Logger::LogError(Logger::to_string(std::stringstream()
+                                         << kLogTag << ": ERROR - " << expired.size()
+                                         << " request(s) timed out"));
+    }
+    // completed out of the lock of the table, as the responses are
+    for (auto& [request_id, request] : expired) {
+      request.HandleFailure(ERROR_TIMEOUT);
+      expired_ids.push_back(request_id);
+    }
+    if (!expired_ids.empty()) {
+      std::lock_guard<ProfiledMutex> callback_locker(expiry_callback_mutex_);
+      if (expiry_callback_) {
+        expiry_callback_(expired_ids);
+      }
+    }
+    expired.clear();
+    expired_ids.clear();
+    locker.lock();
+  }
 }
 
 bool ResponseParser::ParseCustomClassResponse(const RawDataType& data) const {
@@ -75,7 +182,7 @@ bool ResponseParser::ParseCustomClassResponse(const RawDataType& data) const {
   }
 
   // Check that class name is the same as the CustomClass:
-  if (auto [success, str] = RegularTypeParaser::Parse<std::string>(data, idx); success) {
+  if (auto [success, str] = RegularTypeParaser::Parse<std::string_view>(data, idx); success) {
     if (str != CustomClass::kClassName) {
       return false;
     }
@@ -85,10 +192,9 @@ bool ResponseParser::ParseCustomClassResponse(const RawDataType& data) const {
 
   // perform actual checking the command:
   if (auto [success, handle] = ParseCreateClassResponse(data, idx); success) {
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << kLogTag
-                            << ": Server successfully created a CustomClass instance with handle: "
-                            << handle));
+    NAMEDPIPE_LOG_DEBUG(kLogTag
+                        << ": Server successfully created a CustomClass instance with handle: "
+                        << handle);
     if (!ClassRepository::GetInstance().RegisterClassHandle(handle)) {
       Logger::LogError(
           Logger::to_string(std::stringstream()
@@ -132,13 +238,16 @@ RequestId ResponseParser::ParseRequestId(const RawDataType& request, size_t& see
   return -1;
 }
 
-bool ResponseParser::RegisterRequest(RequestId request_id, ClientRequest request) {
-  std::lock_guard<std::mutex> locker(requests_mutex_);
-
-  if (requests_.count(request_id) > 0) {
-    return false;
+bool ResponseParser::RegisterRequest(RequestId request_id, const ClientRequest& request,
+                                     std::chrono::milliseconds timeout) {
+  if (timeout.count() <= 0) {
+    return requests_.Insert(request_id, request, 0, 0);
   }
 
-  requests_[request_id] = request;
-  return true;
+  StartExpiryThread();
+  const auto current_tick = GetCurrentTick();
+  // rounded up, so the request doesn't expire before its timeout
+  const auto timeout_ticks =
+      static_cast<uint64_t>((timeout + kTick - std::chrono::milliseconds{1}) / kTick);
+  return requests_.Insert(request_id, request, current_tick, current_tick + timeout_ticks);
 }
\ No newline at end of file
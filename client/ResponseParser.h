@@ -1,9 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <mutex>
-#include <unordered_map>
+#include <thread>
 #include <utility>
+#include <vector>
 #include "ClientRequest.h"
+#include "PendingRequestTable.h"
+#include "ProfiledMutex.h"
 #include "Types.h"
 
 // Parser of server responses.
@@ -11,23 +18,61 @@
 // purposes by injecting corresponding mock objects.
 class ResponseParser {
  public:
-  ResponseParser() = default;
-  virtual ~ResponseParser() = default;
+  // Ids of the requests, which have just timed out.
+  using ExpiryCallback = std::function<void(const std::vector<RequestId>&)>;
+
+ public:
+  ResponseParser();
+  virtual ~ResponseParser();
 
   // Register the sent request. We expect that in future will receive a response
-  // from that request.
-  bool RegisterRequest(RequestId request_id, ClientRequest request);
+  // from that request. If it isn't received within the timeout (0 - no timeout), the request is
+  // completed with ERROR_TIMEOUT, and the late response is dropped.
+  bool RegisterRequest(RequestId request_id, const ClientRequest& request,
+                       std::chrono::milliseconds timeout = std::chrono::milliseconds{0});
+  // Completes the registered request with the failure - no response will be parsed for it.
+  void CancelRequest(RequestId request_id, int error);
+
+  // Called by the expiry thread after the timed out requests are completed, e.g. the Client
+  // cancels them on the server. Once it returns, the previous callback isn't called anymore.
+  void SetExpiryCallback(ExpiryCallback callback);
 
   virtual bool ParseResponse(const RawDataType& data);
 
+  // How long the client should wait before sending the next request - the server has rejected a
+  // request as it's overloaded (see AdmissionControl). Zero - no backoff.
+  std::chrono::microseconds GetBackoff() const;
+
  private:
   RequestId ParseRequestId(const RawDataType& request, size_t& seek_idx) const;
+  // Unregisters the request, so it's completed out of the lock. false - it isn't registered.
+  std::pair<bool, ClientRequest> ExtractRequest(RequestId request_id);
+
+  // Tick of the deadlines since the parser is created.
+  uint64_t GetCurrentTick() const;
+  // Started by the first request with a timeout - completes the expired requests every tick.
+  void StartExpiryThread();
+  void ExpiryLoop();
+
+  // Microseconds since the parser is created.
+  uint64_t GetCurrentTime() const;
 
   bool ParseCustomClassResponse(const RawDataType& data) const;
   std::pair<bool, ClassHandle> ParseCreateClassResponse(const RawDataType& data,
                                                         size_t& seek_idx) const;
 
  private:
-  std::mutex requests_mutex_;
-  std::unordered_map<RequestId, ClientRequest> requests_;
+  PendingRequestTable requests_;
+  const std::chrono::steady_clock::time_point start_time_;
+  // GetCurrentTime(), till which the requests are held back
+  std::atomic<uint64_t> backoff_until_us_ = 0;
+
+  std::atomic<bool> is_expiry_started_ = false;
+  std::atomic<bool> is_closed_ = false;
+  std::mutex expiry_mutex_;
+  std::condition_variable expiry_cv_;
+  std::thread expiry_thread_;
+
+  ProfiledMutex expiry_callback_mutex_{"ResponseParser::expiry_callback_mutex_"};
+  ExpiryCallback expiry_callback_;
 };
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "SendLanes.h"
+
+#include <algorithm>
+
+void SendLanes::Push(Write write) {
+  lanes_[static_cast<size_t>(write.priority)].push_back(std::move(write));
+}
+
+std::pair<bool, SendLanes::Write> SendLanes::Pop() {
+  for (auto& lane : lanes_) {
+    if (lane.empty()) {
+      continue;
+    }
+    // the frame, which is longer than the limit, is written alone
+    const auto bytes = lane.front().data.GetSize();
+    if (in_flight_bytes_ != 0 && in_flight_bytes_ + bytes > kMaxInFlightBytes) {
+      break;
+    }
+    in_flight_bytes_ += bytes;
+    auto write = std::move(lane.front());
+    lane.pop_front();
+    return std::make_pair(true, std::move(write));
+  }
+  return std::make_pair(false, Write{});
+}
+
+void SendLanes::Complete(size_t bytes) {
+  in_flight_bytes_ -= std::min(bytes, in_flight_bytes_);
+}
+
+std::pair<bool, SendLanes::Write> SendLanes::Drop(RequestPriority priority,
+                                                  RequestId request_id) {
+  auto& lane = lanes_[static_cast<size_t>(priority)];
+  std::pair<bool, Write> last(false, Write{});
+  for (auto iter = lane.begin(); iter != lane.end();) {
+    if (iter->request_id != request_id) {
+      ++iter;
+      continue;
+    }
+    if (iter->is_last) {
+      last = std::make_pair(true, std::move(*iter));
+    }
+    iter = lane.erase(iter);
+  }
+  return last;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <utility>
+#include "BufferPool.h"
+#include "Pipe.h"
+#include "Types.h"
+
+// Frames of the async requests, which wait to be written to one connection (see Client).
+// The overlapped writes of a pipe are completed in their order, so the urgent frame, which is
+// written behind a backlog of the bulk ones, waits for all of them. Thus, only kMaxInFlightBytes
+// of the frames are written at once, and the rest wait in a lane per priority: once a write is
+// completed, the next frame is taken from the highest priority lane. The long requests are sent
+// in chunks (see RequestControl.h), so the urgent frame waits for a few chunks at most.
+// NOTE: the lanes aren't thread-safe - they are guarded by the mutex of the connection.
+class SendLanes {
+ public:
+  static constexpr size_t kMaxInFlightBytes = 8 * 1024;
+
+  struct Write {
+    // the chunks of a request are the slices of one pooled buffer
+    BufferSlice data;
+    RequestPriority priority = RequestPriority::Normal;
+    RequestId request_id = -1;
+    bool wait_for_response = false;
+    // false - a chunk, which isn't the last one of the request
+    bool is_last = true;
+    // of the last chunk only - the request is written
+    Pipe::WriteAsyncResponseCallback callback;
+    // of the last chunk only - the request can't be written
+    Pipe::WriteAsyncFailureCallback failure_callback;
+  };
+
+  void Push(Write write);
+  // The next frame, which can be written now - its bytes are in flight till Complete().
+  std::pair<bool, Write> Pop();
+  void Complete(size_t bytes);
+  // Removes the queued chunks of the request, which can't be written anymore. Returns its last
+  // chunk, if it's queued.
+  std::pair<bool, Write> Drop(RequestPriority priority, RequestId request_id);
+
+ private:
+  std::array<std::deque<Write>, kRequestPrioritiesCount> lanes_;
+  size_t in_flight_bytes_ = 0;
+};
@@ -0,0 +1,279 @@
+#include "ShardRouter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <sstream>
+#include "DataDeserializer.h"
+#include "DataSerializer.h"
+#include "Logger.h"
+#include "Sharding.h"
+
+static constexpr auto kLogTag = "ShardRouter";
+
+namespace {
+// Client-side handles are unique in the process, so the ClassRepository, which is shared by all
+// the clients, can be keyed by them.
+std::atomic<ClassHandle> g_client_handles_counter{0};
+
+// Parses the request id header (#r<request id>) of the response.
+std::pair<bool, RequestId> ParseRequestIdHeader(const RawDataType& response, size_t& seek_idx) {
+  size_t idx = seek_idx;
+  if (response.size() < idx + 2 || response[idx++] != '#' || response[idx++] != 'r') {
+    return std::make_pair(false, RequestId{0});
+  }
+  auto result = RegularTypeParaser::Parse<RequestId>(response, idx);
+  if (result.first) {
+    seek_idx = idx;
+  }
+  return result;
+}
+}  // namespace
+
+ShardRouter::ShardRouter(const std::vector<std::string>& endpoints) {
+  for (const auto& endpoint : endpoints) {
+    AddEndpoint(endpoint);
+  }
+}
+
+void ShardRouter::SetHandlePartitions(size_t partitions_count) {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  partitions_count_ = partitions_count;
+}
+
+bool ShardRouter::HasHandlePartitions() const {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  return partitions_count_ > 0;
+}
+
+size_t ShardRouter::AddEndpoint(const std::string& name) {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  const auto endpoint_id = endpoint_ids_counter_++;
+  endpoints_.emplace_back(endpoint_id, name);
+  ring_.Add(endpoint_id, name);
+  return endpoint_id;
+}
+
+bool ShardRouter::RemoveEndpoint(size_t endpoint_id) {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  auto iter = std::find_if(endpoints_.begin(), endpoints_.end(),
+                           [endpoint_id](const auto& item) { return item.first == endpoint_id; });
+  if (iter == endpoints_.end()) {
+    return false;
+  }
+  endpoints_.erase(iter);
+  ring_.Remove(endpoint_id);
+
+  size_t lost_count = 0;
+  for (auto owner = endpoint_handles_.begin(); owner != endpoint_handles_.end();) {
+    if (owner->second.endpoint == endpoint_id) {
+      owner = endpoint_handles_.erase(owner);
+      ++lost_count;
+    } else {
+      ++owner;
+    }
+  }
+  if (lost_count > 0) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": " << lost_count << " instances of removed "
+                                       << "endpoint=" << endpoint_id << " became unreachable"));
+  }
+  return true;
+}
+
+std::pair<bool, size_t> ShardRouter::FindEndpoint(const std::string& name) const {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  for (const auto& [endpoint_id, endpoint_name] : endpoints_) {
+    if (endpoint_name == name) {
+      return std::make_pair(true, endpoint_id);
+    }
+  }
+  return std::make_pair(false, size_t{0});
+}
+
+std::vector<size_t> ShardRouter::GetEndpoints() const {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  std::vector<size_t> endpoint_ids;
+  for (const auto& endpoint : endpoints_) {
+    endpoint_ids.push_back(endpoint.first);
+  }
+  return endpoint_ids;
+}
+
+ShardRoute ShardRouter::Route(const RawDataType& data, RequestId request_id,
+                              bool wait_for_response, std::pair<bool, uint64_t> routing_key) {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  if (endpoints_.empty()) {
+    return ShardRoute{false};
+  }
+
+  // Anything except the class commands (#<class name>...) can be served by any endpoint:
+  size_t idx = 0;
+  if (data.empty() || data[idx++] != '#' ||
+      !RegularTypeParaser::Parse<std::string_view>(data, idx).first) {
+    return RouteToAnyEndpoint();
+  }
+
+  ShardRoute route;
+  if (data.size() >= idx + 2 && data[idx] == '#') {
+    if (data[idx + 1] == 'c') {  // create
+      // the request id is fresh for every request - only a stable key makes the placement stable
+      route.endpoint = routing_key.first ? ring_.Find(routing_key.second).second
+                                         : RouteToAnyEndpoint().endpoint;
+      // the handles of the shards are unique as they are - nothing to remember
+      if (wait_for_response && partitions_count_ == 0) {
+        pending_requests_[request_id] = PendingRequest{true, -1, route.endpoint};
+      }
+      return route;
+    } else if (data[idx + 1] == 'n') {  // count instances
+      route.is_fan_out = true;
+      for (const auto& endpoint : endpoints_) {
+        route.fan_out_endpoints.push_back(endpoint.first);
+      }
+      if (wait_for_response) {
+        PendingRequest request;
+        request.fan_out_count = endpoints_.size();
+        pending_requests_[request_id] = std::move(request);
+      }
+      return route;
+    }
+  }
+
+  // All other commands start with the instance handle:
+  const auto handle_offset = idx;
+  auto [success, handle] = RegularTypeParaser::Parse<ClassHandle>(data, idx);
+  if (!success) {
+    return RouteToAnyEndpoint();
+  }
+  auto owner = endpoint_handles_.find(handle);
+  if (owner != endpoint_handles_.end()) {
+    route.endpoint = owner->second.endpoint;
+    route.handle_offset = handle_offset;
+    route.handle_end = idx;
+    route.endpoint_handle = owner->second.handle;
+  } else if (partitions_count_ > 0 && HasEndpoint(GetShardOfHandle(handle, partitions_count_))) {
+    route.endpoint = GetShardOfHandle(handle, partitions_count_);
+  } else {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - the owner of handle=" << handle
+                                       << " is unknown"));
+    route.is_valid = false;
+    return route;
+  }
+
+  const bool is_destroy = data.size() == idx + 2 && data[idx] == '#' && data[idx + 1] == 'd';
+  if (is_destroy && wait_for_response && route.handle_offset > 0) {
+    pending_requests_[request_id] = PendingRequest{false, handle, route.endpoint};
+  }
+  return route;
+}
+
+bool ShardRouter::HandleResponse(RawDataType& response) {
+  size_t idx = 0;
+  auto [has_request_id, request_id] = ParseRequestIdHeader(response, idx);
+  if (!has_request_id) {
+    return true;
+  }
+
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  auto pending = pending_requests_.find(request_id);
+  if (pending == pending_requests_.end()) {
+    return true;
+  }
+
+  auto& request = pending->second;
+  if (request.fan_out_count > 0) {
+    request.fan_out_responses.push_back(response);
+    if (request.fan_out_responses.size() < request.fan_out_count) {
+      return false;
+    }
+    response = MergeResponses(request.fan_out_responses);
+    pending_requests_.erase(pending);
+    return true;
+  }
+
+  if (request.is_create) {
+    const auto handle_offset = idx;
+    auto [success, handle] = RegularTypeParaser::Parse<ClassHandle>(response, idx);
+    if (success) {
+      const auto client_handle = g_client_handles_counter.fetch_add(1);
+      endpoint_handles_[client_handle] = EndpointHandle{request.endpoint, handle};
+
+      // the client-side handle in the encoding of the response
+      RawDataType client_handle_data;
+      DataSerializer::AppendToRawData<ClassHandle>(
+          client_handle_data, client_handle,
+          RegularTypeParaser::GetEncoding(response, handle_offset));
+      response.erase(std::next(response.begin(), handle_offset), std::next(response.begin(), idx));
+      response.insert(std::next(response.begin(), handle_offset), client_handle_data.begin(),
+                      client_handle_data.end());
+    }
+  } else if (auto [success, destroyed] = RegularTypeParaser::Parse<bool>(response, idx);
+             success && destroyed) {
+    endpoint_handles_.erase(request.handle);
+  }
+  pending_requests_.erase(pending);
+  return true;
+}
+
+void ShardRouter::CancelRequest(RequestId request_id) {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  pending_requests_.erase(request_id);
+}
+
+void ShardRouter::AppendRequestData(RawDataType& frame, const RawDataType& data,
+                                    const ShardRoute& route) {
+  if (route.handle_offset == 0) {
+    frame.insert(frame.end(), data.begin(), data.end());
+    return;
+  }
+
+  // the handle of the endpoint in the encoding of the client-side one
+  frame.insert(frame.end(), data.begin(), std::next(data.begin(), route.handle_offset));
+  DataSerializer::AppendToRawData<ClassHandle>(
+      frame, route.endpoint_handle, RegularTypeParaser::GetEncoding(data, route.handle_offset));
+  frame.insert(frame.end(), std::next(data.begin(), route.handle_end), data.end());
+}
+
+RawDataType ShardRouter::MergeResponses(const std::vector<RawDataType>& responses) {
+  if (responses.empty()) {
+    return RawDataType{};
+  }
+
+  // the request id header is the same in all the responses:
+  const auto& first = responses.front();
+  size_t header_size = 0;
+  if (!ParseRequestIdHeader(first, header_size).first) {
+    return first;
+  }
+
+  int sum = 0;
+  for (const auto& response : responses) {
+    size_t idx = header_size;
+    auto [success, value] = RegularTypeParaser::Parse<int>(response, idx);
+    if (!success) {
+      return first;
+    }
+    sum += value;
+  }
+
+  // the sum is in the encoding of the responses
+  RawDataType merged(first.begin(), std::next(first.begin(), header_size));
+  DataSerializer::AppendToRawData<int>(merged, sum, RegularTypeParaser::GetEncoding(first, 2));
+  return merged;
+}
+
+bool ShardRouter::HasEndpoint(size_t endpoint_id) const {
+  for (const auto& endpoint : endpoints_) {
+    if (endpoint.first == endpoint_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+ShardRoute ShardRouter::RouteToAnyEndpoint() {
+  ShardRoute route;
+  route.endpoint = endpoints_[next_endpoint_++ % endpoints_.size()].first;
+  return route;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ConsistentHashRing.h"
+#include "ProfiledMutex.h"
+#include "Types.h"
+
+// Destination of a request.
+struct ShardRoute {
+  // false - there is no endpoint, which can serve the request.
+  bool is_valid = true;
+  // The request is sent to every endpoint and their responses are merged into one.
+  bool is_fan_out = false;
+  size_t endpoint = 0;
+  // Endpoints of the fanned out request.
+  std::vector<size_t> fan_out_endpoints;
+  // The handle of the request [handle_offset, handle_end) is the client-side one, and it's
+  // replaced by the handle of the endpoint (see AppendRequestData()). 0 - the request is sent
+  // as is.
+  size_t handle_offset = 0;
+  size_t handle_end = 0;
+  ClassHandle endpoint_handle = -1;
+};
+
+// Routes requests between the server endpoints (pipes):
+//  - instances with a routing key are created on the endpoint chosen by consistent hashing of
+//    the key, so adding or removing an endpoint moves only ~1/N of the keys, the rest of the
+//    instances are created round-robin;
+//  - requests to an instance go to the endpoint, which created it;
+//  - bulk requests (counting instances - #n) are fanned out to all endpoints;
+//  - regular values can be served by any endpoint, so they are sent round-robin.
+//
+// Independent servers allocate the same handles, thus, the handle of the endpoint is replaced by
+// the client-side one in the create response (see HandleResponse()), which is unique in the
+// process, and the requests to it are sent to its endpoint with the handle of the endpoint.
+// Requests to the unknown handles are not routed.
+// The shards of NamedPipeServer allocate handles from the disjoint partitions (see Sharding.h),
+// so, when the endpoints are the shards (see SetHandlePartitions()), the handles are passed as
+// is, and the owner of any handle is known from the handle itself.
+// The router can be used from multiple threads.
+class ShardRouter {
+ public:
+  explicit ShardRouter(const std::vector<std::string>& endpoints = {});
+
+  // Endpoints [0, partitions_count) are the shards of NamedPipeServer --shards <count>, thus,
+  // the owner of the handle, which wasn't created via this router, is known from the handle.
+  // Should be called before any requests are routed.
+  void SetHandlePartitions(size_t partitions_count);
+  bool HasHandlePartitions() const;
+
+  // Returns the id of the added endpoint.
+  size_t AddEndpoint(const std::string& name);
+  // Instances created on the removed endpoint become unreachable.
+  bool RemoveEndpoint(size_t endpoint_id);
+  std::pair<bool, size_t> FindEndpoint(const std::string& name) const;
+  std::vector<size_t> GetEndpoints() const;
+
+  // data - request without the request id header.
+  // wait_for_response - whether HandleResponse() will be called for this request.
+  // routing_key - the key of the create request (see ClientRequest::SetRoutingKey()).
+  ShardRoute Route(const RawDataType& data, RequestId request_id, bool wait_for_response,
+                   std::pair<bool, uint64_t> routing_key = {false, 0});
+
+  // Should be called with every response on the routed requests - updates the handles.
+  // Responses can come in any order and from any thread.
+  // Returns whether the response should be parsed - false while responses on the fanned out
+  // request are collected, the last one is replaced by the merged response.
+  bool HandleResponse(RawDataType& response);
+  // Should be called if the request failed, so no response will come.
+  void CancelRequest(RequestId request_id);
+
+  // Appends the request data to the frame - with the handle of the endpoint, if the route has it.
+  static void AppendRequestData(RawDataType& frame, const RawDataType& data,
+                                const ShardRoute& route);
+
+  // Merges responses on the fanned out request into one response with the same request id.
+  // Int values (counters) are summed up, otherwise the first response is returned.
+  static RawDataType MergeResponses(const std::vector<RawDataType>& responses);
+
+ private:
+  // Should be called under the lock:
+  bool HasEndpoint(size_t endpoint_id) const;
+  ShardRoute RouteToAnyEndpoint();
+
+  // Instance created via the router on the independent endpoint.
+  struct EndpointHandle {
+    size_t endpoint = 0;
+    ClassHandle handle = -1;
+  };
+
+  // Create or destroy, which waits for the response to update the handles, or the fanned out
+  // request, which waits for the responses of all the endpoints.
+  struct PendingRequest {
+    bool is_create = false;
+    ClassHandle handle = -1;
+    size_t endpoint = 0;
+    size_t fan_out_count = 0;
+    std::vector<RawDataType> fan_out_responses;
+  };
+
+ private:
+  mutable ProfiledMutex mutex_{"ShardRouter::mutex_"};
+  // id -> name, in order of addition
+  std::vector<std::pair<size_t, std::string>> endpoints_;
+  size_t endpoint_ids_counter_ = 0;
+  size_t partitions_count_ = 0;
+  ConsistentHashRing ring_;
+  // client-side handle -> the endpoint, which created the instance, and its handle there.
+  // One entry per live instance created via the router: it's erased by the destroy response or
+  // by RemoveEndpoint(), so instances, which are never destroyed, keep their entries.
+  std::unordered_map<ClassHandle, EndpointHandle> endpoint_handles_;
+  std::unordered_map<RequestId, PendingRequest> pending_requests_;
+  size_t next_endpoint_ = 0;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+// Coroutine of the CoroClient (C++20, see NAMEDPIPE_COROUTINES). The task is lazy: its body runs,
+// when it's awaited or started, and the awaiting coroutine is resumed right after the body
+// returns - on the same thread, without a thread pool hop.
+// The client doesn't use exceptions - an exception, which leaves the body, terminates.
+template <class Type = void>
+class Task;
+
+class TaskPromiseBase {
+ public:
+  std::suspend_always initial_suspend() noexcept { return {}; }
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      auto continuation = handle.promise().continuation_;
+      return continuation ? continuation : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+  FinalAwaiter final_suspend() noexcept { return {}; }
+
+  void unhandled_exception() noexcept { std::terminate(); }
+
+  inline void SetContinuation(std::coroutine_handle<> continuation) {
+    continuation_ = continuation;
+  }
+
+ private:
+  std::coroutine_handle<> continuation_;
+};
+
+template <class Type>
+class TaskPromise : public TaskPromiseBase {
+ public:
+  Task<Type> get_return_object() noexcept;
+  void return_value(Type value) { value_ = std::move(value); }
+
+  inline Type TakeValue() { return std::move(value_); }
+
+ private:
+  Type value_{};
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+ public:
+  Task<void> get_return_object() noexcept;
+  void return_void() {}
+
+  inline void TakeValue() {}
+};
+
+template <class Type>
+class Task {
+ public:
+  using promise_type = TaskPromise<Type>;
+
+  Task() = default;
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task& operator=(Task&& other) noexcept {
+    std::swap(handle_, other.handle_);
+    return *this;
+  }
+
+  // non-copyable
+  Task(const Task& other) = delete;
+  Task& operator=(const Task& other) = delete;
+
+  inline bool IsDone() const { return !handle_ || handle_.done(); }
+
+  // Runs the body till its first suspension - used by the IoLoop for the tasks, which nobody
+  // awaits.
+  void Start() {
+    if (handle_ && !handle_.done()) {
+      handle_.resume();
+    }
+  }
+  // Should be called once, when the task is done.
+  Type TakeResult() { return handle_.promise().TakeValue(); }
+
+  struct Awaiter {
+    std::coroutine_handle<promise_type> handle;
+
+    bool await_ready() noexcept { return !handle || handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+      handle.promise().SetContinuation(awaiting);
+      return handle;
+    }
+    Type await_resume() { return handle.promise().TakeValue(); }
+  };
+  Awaiter operator co_await() const noexcept { return Awaiter{handle_}; }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <class Type>
+Task<Type> TaskPromise<Type>::get_return_object() noexcept {
+  return Task<Type>(std::coroutine_handle<TaskPromise<Type>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+  return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
@@ -0,0 +1,120 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+TimerWheel::TimerWheel(uint64_t current_tick) : current_tick_(current_tick) {
+  slots_.fill(kInvalidTimer);
+}
+
+TimerWheel::TimerId TimerWheel::Schedule(uint64_t expiry_tick, RequestId request_id) {
+  TimerId timer = free_timers_;
+  if (timer != kInvalidTimer) {
+    free_timers_ = timers_[timer].next;
+  } else {
+    timer = static_cast<TimerId>(timers_.size());
+    timers_.emplace_back();
+  }
+
+  auto& entry = timers_[timer];
+  entry.expiry_tick = std::max(expiry_tick, current_tick_ + 1);
+  entry.request_id = request_id;
+  Place(timer);
+  ++size_;
+  return timer;
+}
+
+void TimerWheel::Cancel(TimerId timer) {
+  if (timer >= timers_.size()) {
+    return;
+  }
+  Unlink(timer);
+  timers_[timer].next = free_timers_;
+  free_timers_ = timer;
+  --size_;
+}
+
+void TimerWheel::Advance(uint64_t tick, std::vector<RequestId>& expired) {
+  while (current_tick_ < tick) {
+    if (size_ == 0) {
+      // nothing to expire - the empty ticks are skipped at once
+      current_tick_ = tick;
+      return;
+    }
+    ++current_tick_;
+
+    // the higher levels are moved down, when all the lower ones have made a full turn:
+    for (size_t level = kLevelsCount - 1; level > 0; --level) {
+      if ((current_tick_ & ((uint64_t{1} << (kSlotBits * level)) - 1)) == 0) {
+        Cascade(level);
+      }
+    }
+
+    const auto slot = static_cast<uint32_t>(current_tick_ & kSlotMask);
+    auto timer = slots_[slot];
+    slots_[slot] = kInvalidTimer;
+    while (timer != kInvalidTimer) {
+      auto& entry = timers_[timer];
+      const auto next = entry.next;
+      if (entry.expiry_tick <= current_tick_) {
+        expired.push_back(entry.request_id);
+        entry.next = free_timers_;
+        free_timers_ = timer;
+        --size_;
+      } else {
+        Place(timer);
+      }
+      timer = next;
+    }
+  }
+}
+
+void TimerWheel::Place(TimerId timer) {
+  const auto expiry_tick = timers_[timer].expiry_tick;
+  const auto delta = expiry_tick - current_tick_;
+  size_t level = 0;
+  while (level + 1 < kLevelsCount && (delta >> (kSlotBits * (level + 1))) != 0) {
+    ++level;
+  }
+  // Beyond the top level - the timer waits in its furthest slot and is placed again, when the
+  // slot is cascaded:
+  const auto max_delta = (uint64_t{1} << (kSlotBits * kLevelsCount)) - 1;
+  const auto slot_tick = current_tick_ + std::min(delta, max_delta);
+  const auto slot = (slot_tick >> (kSlotBits * level)) & kSlotMask;
+  Link(timer, static_cast<uint32_t>(level * kSlotsCount + slot));
+}
+
+void TimerWheel::Link(TimerId timer, uint32_t slot) {
+  auto& entry = timers_[timer];
+  entry.slot = slot;
+  entry.prev = kInvalidTimer;
+  entry.next = slots_[slot];
+  if (entry.next != kInvalidTimer) {
+    timers_[entry.next].prev = timer;
+  }
+  slots_[slot] = timer;
+}
+
+void TimerWheel::Unlink(TimerId timer) {
+  auto& entry = timers_[timer];
+  if (entry.prev != kInvalidTimer) {
+    timers_[entry.prev].next = entry.next;
+  } else {
+    slots_[entry.slot] = entry.next;
+  }
+  if (entry.next != kInvalidTimer) {
+    timers_[entry.next].prev = entry.prev;
+  }
+}
+
+void TimerWheel::Cascade(size_t level) {
+  const auto slot =
+      static_cast<uint32_t>(level * kSlotsCount +
+                            ((current_tick_ >> (kSlotBits * level)) & kSlotMask));
+  auto timer = slots_[slot];
+  slots_[slot] = kInvalidTimer;
+  while (timer != kInvalidTimer) {
+    const auto next = timers_[timer].next;
+    Place(timer);
+    timer = next;
+  }
+}
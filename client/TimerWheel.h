@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Types.h"
+
+// Hierarchical timer wheel of the request deadlines (see PendingRequestTable).
+// The level 0 has a slot per tick, every next level has a slot per the whole previous level, so
+// scheduling and cancelling a timer is O(1), and a tick costs O(1) plus the expired timers - a
+// timer is moved to the lower level at most kLevelsCount times, no matter how many timers there
+// are. The timers are stored in a vector and linked by their indices, so after the warm-up the
+// wheel doesn't allocate.
+// NOTE: the wheel isn't thread-safe.
+class TimerWheel {
+ public:
+  using TimerId = uint32_t;
+  static constexpr TimerId kInvalidTimer = UINT32_MAX;
+
+  explicit TimerWheel(uint64_t current_tick = 0);
+
+  // Pre-allocates the timers, so scheduling them doesn't allocate.
+  inline void Reserve(size_t count) { timers_.reserve(count); }
+
+  // The timer of the request, which expires on the expiry_tick (on the next tick, if it's already
+  // passed).
+  TimerId Schedule(uint64_t expiry_tick, RequestId request_id);
+  void Cancel(TimerId timer);
+
+  // Advances the wheel till the tick - the ids of the expired requests are appended to expired.
+  void Advance(uint64_t tick, std::vector<RequestId>& expired);
+
+  inline uint64_t GetCurrentTick() const { return current_tick_; }
+  inline size_t GetSize() const { return size_; }
+
+ private:
+  static constexpr size_t kSlotBits = 6;
+  static constexpr size_t kSlotsCount = size_t{1} << kSlotBits;
+  static constexpr uint64_t kSlotMask = kSlotsCount - 1;
+  static constexpr size_t kLevelsCount = 4;
+
+  struct Timer {
+    uint64_t expiry_tick = 0;
+    RequestId request_id = 0;
+    // linked list of the slot (or of the free timers)
+    TimerId prev = kInvalidTimer;
+    TimerId next = kInvalidTimer;
+    uint32_t slot = 0;
+  };
+
+  // Links the timer into the slot, which corresponds to its expiry tick.
+  void Place(TimerId timer);
+  void Link(TimerId timer, uint32_t slot);
+  void Unlink(TimerId timer);
+  // Moves the timers of the slot of the level to the lower levels.
+  void Cascade(size_t level);
+
+ private:
+  uint64_t current_tick_;
+  size_t size_ = 0;
+  std::vector<Timer> timers_;
+  TimerId free_timers_ = kInvalidTimer;
+  // first timer of each slot of each level
+  std::array<TimerId, kSlotsCount * kLevelsCount> slots_;
+};
@@ -1,7 +1,13 @@
-﻿#include <iostream>
+﻿#include <cctype>
+#include <iostream>
+#include <string>
+#include <vector>
 #include "Client.h"
 #include "DemoSimulator.h"
+#include "Logger.h"
+#include "ProfiledMutex.h"
 #include "ResponseParser.h"
+#include "Tracer.h"
 
 int main(int argc, char** argv) {
   std::cout << "Hello. You are starting a NamedPipeClient!\n"
@@ -43,9 +49,45 @@ int main(int argc, char** argv) {
   const int kStepsCount = 512;  // Number of steps to execute
   auto data_source = std::make_shared<DemoSimulator>(simulation_mode, kStepsCount);
 
+  // Optional tracing of the sampled requests: --trace <path> [--trace-rate <fraction>] (0.001)
+  TraceConfig trace_config;
+  int arg_idx = 1;
+  for (; arg_idx + 1 < argc && argv[arg_idx][0] == '-'; arg_idx += 2) {
+    const std::string arg = argv[arg_idx];
+    if (arg == "--trace") {
+      trace_config.output_path = argv[arg_idx + 1];
+    } else if (arg == "--trace-rate") {
+      trace_config.sample_rate = std::stod(argv[arg_idx + 1]);
+    }
+  }
+
+  // Other arguments are either the shards count of NamedPipeServer --shards <count>, or the list
+  // of pipe names of the servers to use:
+  std::vector<std::string> endpoints;
   const std::string pipe_name = "\\\\.\\pipe\\demo_pipe";
-  Client client(pipe_name, data_source, parser, exec_policy);
-  if (!client.Start()) {
+  size_t shards_count = 1;
+  if (argc > arg_idx && std::isdigit(argv[arg_idx][0])) {
+    shards_count = std::stoul(argv[arg_idx]);
+  } else {
+    endpoints.assign(argv + arg_idx, argv + argc);
+  }
+
+  // the requests are logged in background, so the pipe callbacks don't wait for the console:
+  Logger::StartAsync();
+  if (!trace_config.output_path.empty()) {
+    trace_config.process_id = GetCurrentProcessId();
+    trace_config.process_name = "NamedPipeClient";
+    Tracer::Start(trace_config);
+  }
+
+  Client client = endpoints.empty()
+                      ? Client(pipe_name, data_source, parser, exec_policy, shards_count)
+                      : Client(endpoints, data_source, parser, exec_policy);
+  const bool is_succeeded = client.Start();
+  LockProfiler::LogReport();
+  Tracer::Stop();
+  Logger::StopAsync();
+  if (!is_succeeded) {
     std::cerr << "ERROR - exiting application with error - see logs!" << std::endl;
 	int stop = 0;
 	std::cin >> stop;
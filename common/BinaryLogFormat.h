@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Binary log file, which is written by the Logger (see LoggerConfig::binary_log_path) and
+// rendered to text by NamedPipeLogDecode:
+//   header: kBinaryLogMagic, u64 system clock and u64 steady clock (ns) at the start;
+//   records, each of them starts with u8 BinaryLogRecordType:
+//     Descriptor - u32 id, u8 level, string file, u32 line, u16 parts count, parts;
+//                  a part is u8 BinaryLogArgType, the Literal part is followed by a string;
+//     Event      - u32 descriptor id, u32 thread index, u64 steady clock (ns), u8 is truncated,
+//                  u16 payload size, payload - arguments of the non-literal parts in order;
+//     Dropped    - u64 number of the dropped events.
+// A string is u16 length and the bytes, numbers are written as they are in memory.
+// An event can precede its descriptor in the file.
+constexpr char kBinaryLogMagic[8] = {'N', 'P', 'B', 'L', 'O', 'G', '1', '\0'};
+
+enum class BinaryLogRecordType : uint8_t { Descriptor = 1, Event = 2, Dropped = 3 };
+
+enum class BinaryLogArgType : uint8_t {
+  Literal = 0,  // string literal - stored in the descriptor, not in the event
+  Int32,
+  UInt32,
+  Int64,
+  UInt64,
+  Double,
+  Bool,
+  Char,
+  Pointer,  // u64
+  String
+};
+
+// Format of the log call site.
+struct BinaryLogDescriptor {
+  uint32_t id = 0;
+  uint8_t level = 0;
+  std::string file;
+  uint32_t line = 0;
+  // type of each part and the text of literals
+  std::vector<std::pair<BinaryLogArgType, std::string>> parts;
+};
+
+// Event as it's buffered by the logging thread.
+struct BinaryLogEvent {
+  // Arguments, which don't fit, are truncated.
+  static constexpr size_t kMaxPayloadSize = 232;
+
+  uint32_t descriptor_id = 0;
+  uint16_t size = 0;
+  bool is_truncated = false;
+  uint64_t timestamp = 0;
+  char payload[kMaxPayloadSize];
+};
+
+// The records are built in memory and written by batches:
+template <typename T>
+void AppendBinaryValue(std::string& buffer, const T& value) {
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void AppendBinaryString(std::string& buffer, const std::string& value) {
+  const auto size = static_cast<uint16_t>(std::min<size_t>(value.size(), UINT16_MAX));
+  AppendBinaryValue(buffer, size);
+  buffer.append(value.data(), size);
+}
+
+template <typename T>
+bool ReadBinaryValue(std::istream& stream, T& value) {
+  return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+inline bool ReadBinaryString(std::istream& stream, std::string& value) {
+  uint16_t size = 0;
+  if (!ReadBinaryValue(stream, size)) {
+    return false;
+  }
+  value.resize(size);
+  return size == 0 || static_cast<bool>(stream.read(&value[0], size));
+}
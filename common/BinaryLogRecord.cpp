@@ -0,0 +1,59 @@
+#include "BinaryLogRecord.h"
+
+#include <algorithm>
+#include <chrono>
+
+BinaryLogRecord::BinaryLogRecord(BinaryLogSite& site) : site_(site) {
+  event_.descriptor_id = site.descriptor_id.load(std::memory_order_acquire);
+  event_.timestamp = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+  if (event_.descriptor_id == 0) {
+    descriptor_ = std::make_unique<BinaryLogDescriptor>();
+    descriptor_->level = static_cast<uint8_t>(site.level);
+    descriptor_->file = site.file;
+    descriptor_->line = static_cast<uint32_t>(site.line);
+  }
+}
+
+BinaryLogRecord::~BinaryLogRecord() {
+  if (descriptor_) {
+    // concurrent first messages register a descriptor each - any of them can be used later
+    const auto descriptor_id = Logger::RegisterBinaryDescriptor(std::move(*descriptor_));
+    uint32_t unregistered = 0;
+    site_.descriptor_id.compare_exchange_strong(unregistered, descriptor_id,
+                                                std::memory_order_acq_rel);
+    event_.descriptor_id = descriptor_id;
+  }
+  Logger::WriteBinary(event_);
+}
+
+void BinaryLogRecord::AddPart(BinaryLogArgType type) {
+  if (descriptor_) {
+    descriptor_->parts.emplace_back(type, std::string());
+  }
+}
+
+void BinaryLogRecord::AppendBytes(const void* data, size_t size) {
+  if (event_.is_truncated || event_.size + size > BinaryLogEvent::kMaxPayloadSize) {
+    event_.is_truncated = true;
+    return;
+  }
+  std::memcpy(event_.payload + event_.size, data, size);
+  event_.size += static_cast<uint16_t>(size);
+}
+
+void BinaryLogRecord::AppendString(const char* data, size_t size) {
+  AddPart(BinaryLogArgType::String);
+  if (event_.is_truncated || event_.size + sizeof(uint16_t) > BinaryLogEvent::kMaxPayloadSize) {
+    event_.is_truncated = true;
+    return;
+  }
+
+  const size_t available = BinaryLogEvent::kMaxPayloadSize - event_.size - sizeof(uint16_t);
+  const auto length = static_cast<uint16_t>(std::min(size, available));
+  AppendBytes(&length, sizeof(length));
+  AppendBytes(data, length);
+  event_.is_truncated = length < size;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include "BinaryLogFormat.h"
+#include "Logger.h"
+
+// Call site of the levelled log macro (see NAMEDPIPE_LOG). The descriptor of the site is
+// registered, when the message is logged for the first time.
+struct BinaryLogSite {
+  BinaryLogSite(LogLevel level, const char* file, int line)
+      : level(level), file(file), line(line) {}
+
+  const LogLevel level;
+  const char* const file;
+  const int line;
+  // 0 - not registered yet
+  std::atomic<uint32_t> descriptor_id = 0;
+};
+
+// Binary log message - the stream expression of the log macro is applied to it instead of
+// std::stringstream. Only the raw bytes of the arguments are appended, string literals are
+// stored once in the descriptor. The event is written to the log in the destructor.
+// NOTE: char arrays are taken as string literals, use std::string for the dynamic text.
+class BinaryLogRecord {
+ public:
+  explicit BinaryLogRecord(BinaryLogSite& site);
+  ~BinaryLogRecord();
+
+  BinaryLogRecord(const BinaryLogRecord&) = delete;
+  BinaryLogRecord& operator=(const BinaryLogRecord&) = delete;
+
+  template <typename T>
+  BinaryLogRecord& operator<<(const T& value) {
+    if constexpr (std::is_array_v<T>) {
+      if (descriptor_) {
+        descriptor_->parts.emplace_back(BinaryLogArgType::Literal, std::string(value));
+      }
+    } else if constexpr (std::is_same_v<T, bool>) {
+      Append(BinaryLogArgType::Bool, static_cast<uint8_t>(value));
+    } else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> ||
+                         std::is_same_v<T, unsigned char>) {
+      Append(BinaryLogArgType::Char, static_cast<char>(value));
+    } else if constexpr (std::is_enum_v<T>) {
+      *this << static_cast<std::underlying_type_t<T>>(value);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+      if constexpr (sizeof(T) <= sizeof(int32_t)) {
+        Append(BinaryLogArgType::Int32, static_cast<int32_t>(value));
+      } else {
+        Append(BinaryLogArgType::Int64, static_cast<int64_t>(value));
+      }
+    } else if constexpr (std::is_integral_v<T>) {
+      if constexpr (sizeof(T) <= sizeof(uint32_t)) {
+        Append(BinaryLogArgType::UInt32, static_cast<uint32_t>(value));
+      } else {
+        Append(BinaryLogArgType::UInt64, static_cast<uint64_t>(value));
+      }
+    } else if constexpr (std::is_floating_point_v<T>) {
+      Append(BinaryLogArgType::Double, static_cast<double>(value));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      AppendString(value.data(), value.size());
+    } else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+      AppendString(value ? value : "", value ? std::strlen(value) : 0);
+    } else if constexpr (std::is_pointer_v<T>) {
+      Append(BinaryLogArgType::Pointer, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+    } else {
+      // other types are formatted as they are in the text log:
+      std::ostringstream ss;
+      ss << value;
+      const auto str = ss.str();
+      AppendString(str.data(), str.size());
+    }
+    return *this;
+  }
+
+ private:
+  template <typename T>
+  void Append(BinaryLogArgType type, T value) {
+    AddPart(type);
+    AppendBytes(&value, sizeof(value));
+  }
+
+  void AddPart(BinaryLogArgType type);
+  void AppendBytes(const void* data, size_t size);
+  void AppendString(const char* data, size_t size);
+
+ private:
+  BinaryLogSite& site_;
+  // Descriptor is built only by the first message of the site:
+  std::unique_ptr<BinaryLogDescriptor> descriptor_;
+  BinaryLogEvent event_;
+};
@@ -0,0 +1,90 @@
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <utility>
+
+SharedBuffer::SharedBuffer(PooledBuffer* buffer) : buffer_(buffer) {
+  buffer_->ref_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+SharedBuffer::SharedBuffer(const SharedBuffer& other) : buffer_(other.buffer_) {
+  if (buffer_) {
+    buffer_->ref_count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+SharedBuffer::SharedBuffer(SharedBuffer&& other) noexcept : buffer_(other.buffer_) {
+  other.buffer_ = nullptr;
+}
+
+SharedBuffer& SharedBuffer::operator=(SharedBuffer other) noexcept {
+  std::swap(buffer_, other.buffer_);
+  return *this;
+}
+
+SharedBuffer::~SharedBuffer() {
+  // the writes of the other owners happen before the buffer is reused
+  if (buffer_ && buffer_->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    BufferPool::GetInstance().Release(buffer_);
+  }
+}
+
+BufferSlice::BufferSlice(SharedBuffer buffer)
+    : buffer_(std::move(buffer)), size_(buffer_.IsValid() ? buffer_.GetData().size() : 0) {}
+
+BufferSlice::BufferSlice(SharedBuffer buffer, size_t offset, size_t size)
+    : buffer_(std::move(buffer)), offset_(offset), size_(size) {}
+
+BufferSlice BufferSlice::Slice(size_t offset, size_t size) const {
+  offset = std::min(offset, size_);
+  return BufferSlice(buffer_, offset_ + offset, std::min(size, size_ - offset));
+}
+
+BufferPool::BufferPool() {
+  // returning a buffer doesn't allocate
+  for (auto& pooled : size_classes_) {
+    pooled.free_buffers.reserve(kMaxFreeBuffers);
+  }
+}
+
+BufferPool& BufferPool::GetInstance() {
+  static auto* instance = new BufferPool();
+  return *instance;
+}
+
+SharedBuffer BufferPool::Acquire(size_t capacity) {
+  const auto size_class = static_cast<size_t>(
+      std::distance(kSizeClasses.begin(),
+                    std::lower_bound(kSizeClasses.begin(), kSizeClasses.end(), capacity)));
+  PooledBuffer* buffer = nullptr;
+  if (size_class < kSizeClasses.size()) {
+    auto& pooled = size_classes_[size_class];
+    std::lock_guard<ProfiledMutex> locker(pooled.mutex);
+    if (!pooled.free_buffers.empty()) {
+      buffer = pooled.free_buffers.back();
+      pooled.free_buffers.pop_back();
+    }
+  }
+
+  if (!buffer) {
+    buffer = new PooledBuffer();
+    buffer->size_class = size_class;
+    buffer->data.reserve(size_class < kSizeClasses.size() ? kSizeClasses[size_class] : capacity);
+  }
+  return SharedBuffer(buffer);
+}
+
+void BufferPool::Release(PooledBuffer* buffer) {
+  if (buffer->size_class < kSizeClasses.size()) {
+    buffer->data.clear();
+    auto& pooled = size_classes_[buffer->size_class];
+    std::lock_guard<ProfiledMutex> locker(pooled.mutex);
+    if (pooled.free_buffers.size() < kMaxFreeBuffers) {
+      pooled.free_buffers.push_back(buffer);
+      return;
+    }
+  }
+  delete buffer;
+}
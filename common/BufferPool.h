@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ProfiledMutex.h"
+#include "Types.h"
+
+// Buffer of the BufferPool with its intrusive reference count.
+struct PooledBuffer {
+  std::atomic<uint32_t> ref_count = 0;
+  // index of the size class, BufferPool::kSizeClasses.size() - the buffer isn't pooled
+  size_t size_class = 0;
+  RawDataType data;
+};
+
+// Reference to a PooledBuffer - the copies share the buffer, and the last one returns it to the
+// pool. The data is a plain RawDataType, so the parsers and the pipes work with it as is.
+// NOTE: the reference count is thread-safe, but the data isn't - it's written by one owner, before
+// it's shared.
+class SharedBuffer {
+ public:
+  SharedBuffer() = default;
+  SharedBuffer(const SharedBuffer& other);
+  SharedBuffer(SharedBuffer&& other) noexcept;
+  SharedBuffer& operator=(SharedBuffer other) noexcept;
+  ~SharedBuffer();
+
+  inline bool IsValid() const { return buffer_ != nullptr; }
+  inline const RawDataType& GetData() const { return buffer_->data; }
+  inline RawDataType& GetMutableData() { return buffer_->data; }
+
+ private:
+  friend class BufferPool;
+  explicit SharedBuffer(PooledBuffer* buffer);
+
+ private:
+  PooledBuffer* buffer_ = nullptr;
+};
+
+// Part of the SharedBuffer, which keeps the whole buffer alive - e.g. the chunks of a frame are
+// written from one buffer without copies. The data is looked up by the offset on every access, so
+// the slice stays valid, while the buffer is still appended by its owner.
+class BufferSlice {
+ public:
+  BufferSlice() = default;
+  // the whole data of the buffer
+  explicit BufferSlice(SharedBuffer buffer);
+  BufferSlice(SharedBuffer buffer, size_t offset, size_t size);
+
+  inline const char* GetData() const {
+    return buffer_.IsValid() ? buffer_.GetData().data() + offset_ : nullptr;
+  }
+  inline size_t GetSize() const { return size_; }
+  inline const SharedBuffer& GetBuffer() const { return buffer_; }
+
+  // Part of this slice, which shares its buffer.
+  BufferSlice Slice(size_t offset, size_t size) const;
+
+ private:
+  SharedBuffer buffer_;
+  size_t offset_ = 0;
+  size_t size_ = 0;
+};
+
+// Process-wide pool of the I/O buffers of the client and the server - an overlapped read or a
+// queued write takes a buffer of its size class instead of allocating a new one, and the buffer
+// is returned, once the last SharedBuffer of it is destroyed. The returned buffer is cleared, but
+// keeps its capacity, so the reuse doesn't allocate. Every size class keeps up to kMaxFreeBuffers
+// free buffers; the buffers, which are longer than the largest class, aren't pooled.
+class BufferPool {
+ public:
+  static constexpr std::array<size_t, 4> kSizeClasses = {512, 4 * 1024, 16 * 1024, 64 * 1024};
+  static constexpr size_t kMaxFreeBuffers = 256;
+
+  // The pool is never destroyed - the buffers can be released by the completion callbacks,
+  // which are called after main() returns.
+  static BufferPool& GetInstance();
+
+  // Empty buffer, which can hold at least the capacity without reallocation.
+  SharedBuffer Acquire(size_t capacity);
+
+ private:
+  friend class SharedBuffer;
+
+  struct SizeClass {
+    ProfiledMutex mutex{"BufferPool::SizeClass::mutex"};
+    std::vector<PooledBuffer*> free_buffers;
+  };
+
+  BufferPool();
+  // Called by the last SharedBuffer of the buffer.
+  void Release(PooledBuffer* buffer);
+
+ private:
+  std::array<SizeClass, kSizeClasses.size()> size_classes_;
+};
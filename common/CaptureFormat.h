@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// Format of the traffic capture, which is written by the server (see TrafficCapture) and
+// replayed by the client (see CaptureReplay).
+//
+// File layout:
+//   <CaptureFileHeader><CaptureFrameHeader><frame>...
+// A frame is the raw data of one request as queued by the server - the long requests are
+// assembled from their chunks, the cancel frames are skipped - or of one response as sent by
+// it. Frames are appended in the order of their timestamps.
+
+struct CaptureFileHeader {
+  char magic[8];
+  // System time of the capture start, nanoseconds since the epoch.
+  uint64_t start_time_ns;
+};
+
+struct CaptureFrameHeader {
+  // Steady time since the capture start.
+  uint64_t timestamp_ns;
+  uint32_t client_id;
+  // Size of the frame - the high bit marks the responses.
+  uint32_t size;
+};
+
+static constexpr char kCaptureMagic[8] = {'N', 'P', 'C', 'A', 'P', 'T', '0', '1'};
+static constexpr uint32_t kCaptureResponseFlag = 0x80000000u;
+
+static_assert(sizeof(CaptureFileHeader) == 16, "Capture header must not be padded");
+static_assert(sizeof(CaptureFrameHeader) == 16, "Capture frame header must not be padded");
@@ -11,22 +11,19 @@ constexpr auto kLogTag = "CustomClass";
 const std::string CustomClass::kClassName = typeid(CustomClass).name();
 
 CustomClass::CustomClass() {
-  Logger::LogDebug(Logger::to_string(
-      std::stringstream() << kLogTag << ": created default CustomClass, this=" << this));
+  NAMEDPIPE_LOG_DEBUG(kLogTag << ": created default CustomClass, this=" << this);
 }
 
 CustomClass::CustomClass(int ival) : ival_(ival) {
-  Logger::LogDebug(Logger::to_string(std::stringstream()
-                                     << kLogTag << ": created CustomClass(int), this=" << this));
+  NAMEDPIPE_LOG_DEBUG(kLogTag << ": created CustomClass(int), this=" << this);
 }
 
 CustomClass::CustomClass(int ival, std::string str) : ival_(ival), str_(std::move(str)) {
-  Logger::LogDebug(Logger::to_string(
-      std::stringstream() << kLogTag << ": created CustomClass(int, std::string), this=" << this));
+  NAMEDPIPE_LOG_DEBUG(kLogTag << ": created CustomClass(int, std::string), this=" << this);
 }
 
 void CustomClass::PrintToCout() const {
-  Logger::LogDebug(Logger::to_string(std::stringstream() << kLogTag << ": " << PrintToString()));
+  NAMEDPIPE_LOG_INFO(kLogTag << ": " << PrintToString());
 }
 
 std::string CustomClass::PrintToString() const {
@@ -44,8 +41,7 @@ bool CustomClass::SetIntegerValue(int ival) {
   }
 
   ival_ = ival;
-  Logger::LogDebug(Logger::to_string(std::stringstream()
-                                     << kLogTag << ": change CustomClass::ival_ to=" << ival_));
+  NAMEDPIPE_LOG_DEBUG(kLogTag << ": change CustomClass::ival_ to=" << ival_);
   return true;
 }
 
@@ -55,8 +51,7 @@ bool CustomClass::SetStringValue(std::string str) {
   }
 
   str_ = std::move(str);
-  Logger::LogDebug(Logger::to_string(std::stringstream()
-                                     << kLogTag << ": change CustomClass::str_ to=" << str_));
+  NAMEDPIPE_LOG_DEBUG(kLogTag << ": change CustomClass::str_ to=" << str_);
   return true;
 }
 
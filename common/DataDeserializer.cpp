@@ -1,9 +1,16 @@
 #include "DataDeserializer.h"
 
+#include "WireFormat.h"
+
 template <>
 std::pair<bool, bool> RegularTypeParaser::Parse(const RawDataType& data, size_t& seek_index) {
   constexpr auto kBoolSize = sizeof(bool);
 
+  const auto tag = static_cast<uint8_t>(data[seek_index]);
+  if (tag == kCompactFalse || tag == kCompactTrue) {
+    ++seek_index;
+    return std::make_pair(true, tag == kCompactTrue);
+  }
   if (data[seek_index] != 'b' || (data.size() < seek_index + kBoolSize)) {
     return std::make_pair(false, false);
   }
@@ -14,24 +21,11 @@ std::pair<bool, bool> RegularTypeParaser::Parse(const RawDataType& data, size_t&
 
 template <>
 std::pair<bool, int> RegularTypeParaser::Parse(const RawDataType& data, size_t& seek_index) {
-  constexpr auto kIntSize = sizeof(int);
-
-  if (data[seek_index] != 'i' || (data.size() < seek_index + kIntSize)) {
+  int value = 0;
+  if (!ReadWireInt(data.data(), data.size(), seek_index, value)) {
     return std::make_pair(false, int{});
   }
-
-  union CastToInt {
-    int val;
-    char aux[kIntSize];
-  };
-
-  ++seek_index;
-  CastToInt u;
-  for (int i = 0; i < kIntSize; ++i) {
-    u.aux[i] = data[seek_index++];
-  }
-
-  return std::make_pair(true, u.val);
+  return std::make_pair(true, value);
 }
 
 template <>
@@ -59,21 +53,34 @@ std::pair<bool, double> RegularTypeParaser::Parse(const RawDataType& data, size_
 template <>
 std::pair<bool, std::string> RegularTypeParaser::Parse(const RawDataType& data,
                                                        size_t& seek_index) {
-  if (data[seek_index] != 's') {
+  size_t idx = seek_index;
+  size_t length = 0;
+  if (!ReadWireStringSize(data.data(), data.size(), idx, length)) {
     return std::make_pair(false, std::string{});
   }
 
-  size_t idx = seek_index + 1;
-  auto p = RegularTypeParaser::Parse<int>(data, idx);
-  if (!p.first || data.size() < idx + p.second) {
-    return std::make_pair(false, std::string{});
-  }
+  seek_index = idx + length;
+  return std::make_pair(true, std::string(data.data() + idx, length));
+}
 
-  std::string str(p.second, 0);
-  for (size_t i = 0; i < str.size(); ++i) {
-    str[i] = data[idx++];
+template <>
+std::pair<bool, std::string_view> RegularTypeParaser::Parse(const RawDataType& data,
+                                                            size_t& seek_index) {
+  size_t idx = seek_index;
+  size_t length = 0;
+  if (!ReadWireStringSize(data.data(), data.size(), idx, length)) {
+    return std::make_pair(false, std::string_view{});
   }
 
-  seek_index = idx;
-  return std::make_pair(true, str);
-}
\ No newline at end of file
+  seek_index = idx + length;
+  return std::make_pair(true, std::string_view(data.data() + idx, length));
+}
+
+WireEncoding RegularTypeParaser::GetEncoding(const RawDataType& data, size_t seek_index) {
+  if (seek_index >= data.size()) {
+    return WireEncoding::Fixed;
+  }
+  const auto tag = static_cast<uint8_t>(data[seek_index]);
+  return tag == 'b' || tag == 'i' || tag == 'd' || tag == 's' ? WireEncoding::Fixed
+                                                              : WireEncoding::Compact;
+}
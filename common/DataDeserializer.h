@@ -1,13 +1,20 @@
 #pragma once
 
 #include <any>
+#include <string_view>
 #include <utility>
 #include "Types.h"
 
 // Deserializer of regular types from raw data.
-// Currently defined only for bool, int, double and std::string
+// Currently defined only for bool, int, double and std::string.
+// std::string_view is parsed from the same format as std::string, but refers to the data instead
+// of copying it - it's valid while the data isn't changed.
+// Both encodings of WireFormat.h are parsed, the compact varints are decoded by a word at once.
 class RegularTypeParaser {
  public:
   template <class Type>
   static std::pair<bool, Type> Parse(const RawDataType& data, size_t& seek_index);
+
+  // Encoding of the value at the seek index - e.g. of the request id to answer in the same one.
+  static WireEncoding GetEncoding(const RawDataType& data, size_t seek_index);
 };
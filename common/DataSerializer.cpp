@@ -1,5 +1,7 @@
 #include "DataSerializer.h"
 
+#include "WireFormat.h"
+
 template <>
 void DataSerializer::Serialize<bool>(std::ostream& stream, const bool& value) {
   stream << "b" << (value ? "1" : "0");
@@ -50,6 +52,69 @@ void DataSerializer::Serialize<std::string>(std::ostream& stream, const std::str
   }
 }
 
+template <>
+void DataSerializer::AppendToRawData<bool>(RawDataType& data, const bool& value,
+                                           WireEncoding encoding) {
+  if (encoding == WireEncoding::Compact) {
+    data.push_back(static_cast<char>(value ? kCompactTrue : kCompactFalse));
+    return;
+  }
+  data.push_back('b');
+  data.push_back(value ? '1' : '0');
+}
+
+template <>
+void DataSerializer::AppendToRawData<int>(RawDataType& data, const int& value,
+                                          WireEncoding encoding) {
+  if (encoding == WireEncoding::Compact) {
+    const auto zigzag = EncodeZigZag(value);
+    if (zigzag < kSmallIntLimit) {
+      data.push_back(static_cast<char>(kSmallIntTag | zigzag));
+    } else {
+      data.push_back(kCompactIntTag);
+      AppendVarint(data, zigzag);
+    }
+    return;
+  }
+  const auto* raw = reinterpret_cast<const char*>(&value);
+  data.push_back('i');
+  data.insert(data.end(), raw, raw + sizeof(int));
+}
+
+template <>
+void DataSerializer::AppendToRawData<double>(RawDataType& data, const double& value,
+                                             WireEncoding) {
+  const auto* raw = reinterpret_cast<const char*>(&value);
+  data.push_back('d');
+  data.insert(data.end(), raw, raw + sizeof(double));
+}
+
+template <>
+void DataSerializer::AppendToRawData<std::string_view>(RawDataType& data,
+                                                       const std::string_view& value,
+                                                       WireEncoding encoding) {
+  // the tag, the serialized size and the characters:
+  data.reserve(data.size() + kMaxIntSize + value.size());
+  if (encoding == WireEncoding::Compact) {
+    if (value.size() < kShortStringLimit) {
+      data.push_back(static_cast<char>(kShortStringTag | value.size()));
+    } else {
+      data.push_back(kCompactStringTag);
+      AppendVarint(data, static_cast<uint32_t>(value.size()));
+    }
+  } else {
+    data.push_back('s');
+    AppendToRawData<int>(data, static_cast<int>(value.size()));
+  }
+  data.insert(data.end(), value.begin(), value.end());
+}
+
+template <>
+void DataSerializer::AppendToRawData<std::string>(RawDataType& data, const std::string& value,
+                                                  WireEncoding encoding) {
+  AppendToRawData<std::string_view>(data, value, encoding);
+}
+
 RawDataType DataSerializer::ConvertToRawData(std::string str) {
   using IterType = decltype(str.begin());
   return RawDataType{std::move_iterator<IterType>(str.begin()),
@@ -3,6 +3,7 @@
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include "Types.h"
 
 // Helper class to serialize data into raw vector format!
@@ -11,14 +12,28 @@ class DataSerializer {
   template <class Type>
   static void Serialize(std::ostream& stream, const Type& value);
 
+  // Appends the serialized value to the data - doesn't allocate, if the data has the capacity.
+  // std::string_view is serialized as std::string. The encoding is described in WireFormat.h -
+  // the compact one doesn't change the doubles. Serialize always writes the fixed one, as the
+  // instances are persisted with it.
+  template <class Type>
+  static void AppendToRawData(RawDataType& data, const Type& value,
+                              WireEncoding encoding = WireEncoding::Fixed);
+
   template <class Type>
   static RawDataType SerializeToRawData(const Type& value) {
-    std::stringstream ss;
-    Serialize<Type>(ss, value);
-    return DataSerializer::ConvertToRawData(ss.str());
+    RawDataType data;
+    data.reserve(kMaxPrimitiveSize);
+    AppendToRawData<Type>(data, value);
+    return data;
   }
   static RawDataType ConvertToRawData(std::string str);
 
+  // Size of the serialized bool, int or double: the tag and the value.
+  static constexpr size_t kMaxPrimitiveSize = 1 + sizeof(double);
+  // Size of the serialized int of either encoding: the tag and the value or the longest varint.
+  static constexpr size_t kMaxIntSize = 1 + sizeof(int) + 1;
+
   static std::string ConvertRawDataToString(const RawDataType& data);
 
  private:
@@ -0,0 +1,43 @@
+#include "LatencyHistogram.h"
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) {
+  if (index < kSubBucketsCount) {
+    return index;
+  }
+  const size_t shift = index / kSubBucketsCount - 1;
+  const uint64_t sub_bucket = index - shift * kSubBucketsCount;
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+void HistogramSnapshot::Add(const LatencyHistogram& histogram) {
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    const auto value = histogram.buckets_[i].load(std::memory_order_relaxed);
+    buckets[i] += value;
+    count += value;
+  }
+  sum += histogram.sum_.load(std::memory_order_relaxed);
+}
+
+uint64_t HistogramSnapshot::GetPercentile(double percentile) const {
+  if (count == 0) {
+    return 0;
+  }
+  const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(count * percentile / 100.0));
+  uint64_t counted = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    counted += buckets[i];
+    if (counted >= rank) {
+      return LatencyHistogram::GetBucketUpperBound(i);
+    }
+  }
+  return LatencyHistogram::GetBucketUpperBound(buckets.size() - 1);
+}
+
+uint64_t HistogramSnapshot::CountBelow(uint64_t bound) const {
+  uint64_t counted = 0;
+  for (size_t i = 0; i < buckets.size() && LatencyHistogram::GetBucketUpperBound(i) <= bound;
+       ++i) {
+    counted += buckets[i];
+  }
+  return counted;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Log-linear (HDR-style) histogram of latencies in nanoseconds: every power of two is split into
+// kSubBucketsCount buckets, so the relative error of any percentile is below 1/kSubBucketsCount.
+// Written by one thread without any synchronization (or by many via RecordConcurrent), can be
+// read by any thread.
+class LatencyHistogram {
+ public:
+  static constexpr size_t kSubBucketBits = 4;
+  static constexpr size_t kSubBucketsCount = size_t{1} << kSubBucketBits;
+  // Longer latencies (~18 minutes) are counted in the last bucket.
+  static constexpr size_t kMaxValueBits = 40;
+  static constexpr size_t kBucketsCount =
+      (kMaxValueBits - kSubBucketBits + 1) * kSubBucketsCount;
+
+  static inline size_t GetBucketIndex(uint64_t value) {
+    if (value < kSubBucketsCount) {
+      return static_cast<size_t>(value);
+    }
+    value = std::min(value, (uint64_t{1} << kMaxValueBits) - 1);
+    // the value is in [kSubBucketsCount, 2 * kSubBucketsCount) << shift:
+    const size_t shift = GetMostSignificantBit(value) - kSubBucketBits;
+    return shift * kSubBucketsCount + static_cast<size_t>(value >> shift);
+  }
+  // The highest value counted in the bucket.
+  static uint64_t GetBucketUpperBound(size_t index);
+
+  // Should be called only by the owning thread.
+  inline void Record(uint64_t value) {
+    // single writer - plain load and store instead of the locked increment:
+    auto& bucket = buckets_[GetBucketIndex(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+  // Can be called by any thread.
+  inline void RecordConcurrent(uint64_t value) {
+    buckets_[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  friend struct HistogramSnapshot;
+
+ private:
+  static inline size_t GetMostSignificantBit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBucketsCount> buckets_{};
+  std::atomic<uint64_t> sum_ = 0;
+};
+
+// Copy of the histogram(s), which can be merged and queried.
+struct HistogramSnapshot {
+  HistogramSnapshot() : buckets(LatencyHistogram::kBucketsCount) {}
+
+  void Add(const LatencyHistogram& histogram);
+  // Upper bound of the bucket of the percentile (0..100) in nanoseconds. 0 - no values.
+  uint64_t GetPercentile(double percentile) const;
+  // Number of values <= the bound, with the precision of the buckets.
+  uint64_t CountBelow(uint64_t bound) const;
+
+  std::vector<uint64_t> buckets;
+  uint64_t count = 0;
+  uint64_t sum = 0;
+};
@@ -1,23 +1,357 @@
 #include "Logger.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <sstream>
+#include <thread>
+#include <vector>
+#include "ProfiledMutex.h"
+#include "SpscRingBuffer.h"
 
-static std::mutex s_log_mutex;
+static ProfiledMutex s_log_mutex("Logger::s_log_mutex");
+static std::atomic<LogLevel> s_log_level = LogLevel::Trace;
 
-void Logger::LogDebug(const std::string& message) {
-  std::lock_guard<std::mutex> locker(s_log_mutex);
+namespace {
 
-  std::cout << message << std::endl;
+struct LogRecord {
+  bool is_error = false;
+  std::string message;
+};
+
+// Buffer of one logging thread - the thread is the only producer, the writer is the consumer.
+struct ThreadLogBuffer {
+  ThreadLogBuffer(size_t buffer_size, bool is_binary, uint32_t thread_index)
+      : records(buffer_size), events(is_binary ? buffer_size : 1), thread_index(thread_index) {}
+
+  SpscRingBuffer<LogRecord> records;
+  SpscRingBuffer<BinaryLogEvent> events;
+  const uint32_t thread_index;
+  // The thread has exited - the buffer can be removed, once it's empty.
+  std::atomic<bool> is_closed = false;
+};
+
+// Writes the messages of all the threads' buffers on the background thread.
+class AsyncLogWriter {
+ public:
+  ~AsyncLogWriter() { Stop(); }
+
+  bool Start(const LoggerConfig& config) {
+    std::lock_guard<std::mutex> locker(mutex_);
+    if (is_running_) {
+      return false;
+    }
+    config_ = config;
+    if (!config.binary_log_path.empty() && !OpenBinaryLog(config.binary_log_path)) {
+      return false;
+    }
+    ++generation_;
+    is_binary_ = binary_log_.is_open();
+    is_running_ = true;
+    thread_ = std::thread(&AsyncLogWriter::Run, this);
+    return true;
+  }
+
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> locker(mutex_);
+      if (!is_running_) {
+        return;
+      }
+      is_running_ = false;
+      is_binary_ = false;
+    }
+    wake_up_.notify_one();
+    thread_.join();
+
+    std::lock_guard<std::mutex> locker(mutex_);
+    buffers_.clear();
+    binary_log_.close();
+  }
+
+  bool IsBinary() const { return is_binary_.load(std::memory_order_acquire); }
+
+  // Returns false if the writer isn't running - the message should be written right away.
+  bool Write(bool is_error, std::string message) {
+    if (!is_running_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    auto buffer = GetThreadBuffer();
+    if (!buffer) {
+      return false;
+    }
+
+    LogRecord record{is_error, std::move(message)};
+    while (!buffer->records.TryPush(std::move(record))) {
+      if (config_.overflow_policy == LogOverflowPolicy::Drop) {
+        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+      if (!is_running_.load(std::memory_order_acquire)) {
+        return false;
+      }
+      wake_up_.notify_one();
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  void WriteBinary(const BinaryLogEvent& event) {
+    if (!is_binary_.load(std::memory_order_acquire)) {
+      return;
+    }
+    auto buffer = GetThreadBuffer();
+    if (!buffer) {
+      return;
+    }
+
+    // only the used part of the payload is copied into the slot:
+    BinaryLogEvent* slot = nullptr;
+    while (!(slot = buffer->events.TryReserve())) {
+      if (config_.overflow_policy == LogOverflowPolicy::Drop) {
+        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      if (!is_running_.load(std::memory_order_acquire)) {
+        return;
+      }
+      wake_up_.notify_one();
+      std::this_thread::yield();
+    }
+    slot->descriptor_id = event.descriptor_id;
+    slot->size = event.size;
+    slot->is_truncated = event.is_truncated;
+    slot->timestamp = event.timestamp;
+    std::memcpy(slot->payload, event.payload, event.size);
+    buffer->events.Commit();
+  }
+
+  uint32_t RegisterBinaryDescriptor(BinaryLogDescriptor descriptor) {
+    std::lock_guard<std::mutex> locker(descriptors_mutex_);
+    descriptor.id = ++descriptors_counter_;
+    pending_descriptors_.push_back(std::move(descriptor));
+    return descriptors_counter_;
+  }
+
+ private:
+  // Thread-local reference to the buffer, which closes it on thread exit.
+  struct ThreadBufferHolder {
+    ~ThreadBufferHolder() {
+      if (buffer) {
+        buffer->is_closed = true;
+      }
+    }
+    std::shared_ptr<ThreadLogBuffer> buffer;
+    size_t generation = 0;
+  };
+
+  ThreadLogBuffer* GetThreadBuffer() {
+    thread_local ThreadBufferHolder holder;
+    // the buffer is registered once per thread and per Start():
+    if (!holder.buffer || holder.generation != generation_.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> locker(mutex_);
+      if (!is_running_) {
+        return nullptr;
+      }
+      holder.buffer = std::make_shared<ThreadLogBuffer>(config_.buffer_size, is_binary_,
+                                                        threads_counter_++);
+      holder.generation = generation_;
+      buffers_.push_back(holder.buffer);
+    }
+    return holder.buffer.get();
+  }
+
+  void Run() {
+    std::unique_lock<std::mutex> locker(mutex_);
+    while (is_running_) {
+      wake_up_.wait_for(locker, config_.flush_interval);
+      auto buffers = buffers_;
+      locker.unlock();
+      WriteBuffered(buffers);
+      locker.lock();
+
+      buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                    [](const auto& buffer) {
+                                      return buffer->is_closed && buffer->records.IsEmpty() &&
+                                             buffer->events.IsEmpty();
+                                    }),
+                     buffers_.end());
+    }
+
+    // flush the rest on shutdown:
+    auto buffers = buffers_;
+    locker.unlock();
+    WriteBuffered(buffers);
+  }
+
+  void WriteBuffered(const std::vector<std::shared_ptr<ThreadLogBuffer>>& buffers) {
+    std::string debug_batch;
+    std::string error_batch;
+    LogRecord record;
+    for (const auto& buffer : buffers) {
+      while (buffer->records.TryPop(record)) {
+        auto& batch = record.is_error ? error_batch : debug_batch;
+        batch += record.message;
+        batch += '\n';
+      }
+    }
+
+    const auto dropped = dropped_count_.exchange(0, std::memory_order_relaxed);
+    if (binary_log_.is_open()) {
+      WriteBinaryBuffered(buffers, dropped);
+    } else if (dropped > 0) {
+      error_batch += "Logger: " + std::to_string(dropped) + " messages were dropped\n";
+    }
+
+    std::lock_guard<ProfiledMutex> locker(s_log_mutex);
+    if (!debug_batch.empty()) {
+      std::cout << debug_batch << std::flush;
+    }
+    if (!error_batch.empty()) {
+      std::cerr << error_batch << std::flush;
+    }
+  }
+
+  bool OpenBinaryLog(const std::string& path) {
+    binary_log_.open(path, std::ios::binary | std::ios::trunc);
+    if (!binary_log_.is_open()) {
+      std::lock_guard<ProfiledMutex> locker(s_log_mutex);
+      std::cerr << "Logger: ERROR - can't open the binary log=" << path << std::endl;
+      return false;
+    }
+
+    const auto system_now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch());
+    const auto steady_now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch());
+    std::string header(kBinaryLogMagic, sizeof(kBinaryLogMagic));
+    AppendBinaryValue(header, static_cast<uint64_t>(system_now.count()));
+    AppendBinaryValue(header, static_cast<uint64_t>(steady_now.count()));
+    binary_log_.write(header.data(), header.size());
+    return true;
+  }
+
+  // Should be called only by the writer thread.
+  void WriteBinaryBuffered(const std::vector<std::shared_ptr<ThreadLogBuffer>>& buffers,
+                           size_t dropped) {
+    std::vector<BinaryLogDescriptor> descriptors;
+    {
+      std::lock_guard<std::mutex> locker(descriptors_mutex_);
+      descriptors.swap(pending_descriptors_);
+    }
+    // descriptors go first, so the decoder knows them before their events:
+    std::string batch;
+    for (const auto& descriptor : descriptors) {
+      AppendBinaryValue(batch, BinaryLogRecordType::Descriptor);
+      AppendBinaryValue(batch, descriptor.id);
+      AppendBinaryValue(batch, descriptor.level);
+      AppendBinaryString(batch, descriptor.file);
+      AppendBinaryValue(batch, descriptor.line);
+      AppendBinaryValue(batch, static_cast<uint16_t>(descriptor.parts.size()));
+      for (const auto& [type, literal] : descriptor.parts) {
+        AppendBinaryValue(batch, type);
+        if (type == BinaryLogArgType::Literal) {
+          AppendBinaryString(batch, literal);
+        }
+      }
+    }
+
+    for (const auto& buffer : buffers) {
+      while (const auto* event = buffer->events.Front()) {
+        AppendBinaryValue(batch, BinaryLogRecordType::Event);
+        AppendBinaryValue(batch, event->descriptor_id);
+        AppendBinaryValue(batch, buffer->thread_index);
+        AppendBinaryValue(batch, event->timestamp);
+        AppendBinaryValue(batch, static_cast<uint8_t>(event->is_truncated));
+        AppendBinaryValue(batch, event->size);
+        batch.append(event->payload, event->size);
+        buffer->events.Pop();
+      }
+    }
+
+    if (dropped > 0) {
+      AppendBinaryValue(batch, BinaryLogRecordType::Dropped);
+      AppendBinaryValue(batch, static_cast<uint64_t>(dropped));
+    }
+    binary_log_.write(batch.data(), batch.size());
+    binary_log_.flush();
+  }
+
+ private:
+  LoggerConfig config_;
+  std::atomic<bool> is_running_ = false;
+  std::atomic<bool> is_binary_ = false;
+  std::atomic<size_t> generation_ = 0;
+  std::atomic<size_t> dropped_count_ = 0;
+
+  // guards buffers_ and the start/stop
+  std::mutex mutex_;
+  std::condition_variable wake_up_;
+  std::vector<std::shared_ptr<ThreadLogBuffer>> buffers_;
+  uint32_t threads_counter_ = 0;
+  std::thread thread_;
+
+  std::ofstream binary_log_;
+  // descriptors, which are not written to the binary log yet
+  std::mutex descriptors_mutex_;
+  uint32_t descriptors_counter_ = 0;
+  std::vector<BinaryLogDescriptor> pending_descriptors_;
+};
+
+AsyncLogWriter s_async_writer;
+}  // namespace
+
+void Logger::LogDebug(const std::string& message) { Log(LogLevel::Debug, message); }
+
+void Logger::LogError(const std::string& message) { Log(LogLevel::Error, message); }
+
+void Logger::Log(LogLevel level, const std::string& message) {
+  if (!IsEnabled(level)) {
+    return;
+  }
+
+  if (s_async_writer.IsBinary()) {
+    // the text message is stored as a single string argument:
+    static BinaryLogSite text_sites[] = {{LogLevel::Trace, "", 0},
+                                         {LogLevel::Debug, "", 0},
+                                         {LogLevel::Info, "", 0},
+                                         {LogLevel::Error, "", 0}};
+    BinaryLogRecord{text_sites[static_cast<size_t>(level)]} << message;
+    return;
+  }
+
+  const bool is_error = level == LogLevel::Error;
+  if (s_async_writer.Write(is_error, message)) {
+    return;
+  }
+  std::lock_guard<ProfiledMutex> locker(s_log_mutex);
+
+  (is_error ? std::cerr : std::cout) << message << std::endl;
+}
+
+void Logger::SetLevel(LogLevel level) { s_log_level.store(level, std::memory_order_relaxed); }
+
+bool Logger::IsEnabled(LogLevel level) {
+  return level != LogLevel::Off && level >= s_log_level.load(std::memory_order_relaxed);
 }
 
-void Logger::LogError(const std::string& message) {
-  std::lock_guard<std::mutex> locker(s_log_mutex);
+bool Logger::StartAsync(const LoggerConfig& config) { return s_async_writer.Start(config); }
+
+void Logger::StopAsync() { s_async_writer.Stop(); }
+
+bool Logger::IsBinary() { return s_async_writer.IsBinary(); }
 
-  std::cerr << message << std::endl;
+uint32_t Logger::RegisterBinaryDescriptor(BinaryLogDescriptor descriptor) {
+  return s_async_writer.RegisterBinaryDescriptor(std::move(descriptor));
 }
 
+void Logger::WriteBinary(const BinaryLogEvent& event) { s_async_writer.WriteBinary(event); }
+
 std::string Logger::to_string(std::ostream& stream) {
   return static_cast<std::stringstream&>(stream).str();
-}
\ No newline at end of file
+}
@@ -1,20 +1,141 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include "BinaryLogFormat.h"
+
+// Levels of the log messages. Messages below NAMEDPIPE_MIN_LOG_LEVEL are compiled out - by
+// default, the debug messages are compiled only to debug builds. Can be overridden via the
+// NAMEDPIPE_MIN_LOG_LEVEL option of cmake.
+#define NAMEDPIPE_LOG_LEVEL_TRACE 0
+#define NAMEDPIPE_LOG_LEVEL_DEBUG 1
+#define NAMEDPIPE_LOG_LEVEL_INFO 2
+#define NAMEDPIPE_LOG_LEVEL_ERROR 3
+#define NAMEDPIPE_LOG_LEVEL_OFF 4
+
+#ifndef NAMEDPIPE_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define NAMEDPIPE_MIN_LOG_LEVEL NAMEDPIPE_LOG_LEVEL_INFO
+#else
+#define NAMEDPIPE_MIN_LOG_LEVEL NAMEDPIPE_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+enum class LogLevel {
+  Trace = NAMEDPIPE_LOG_LEVEL_TRACE,
+  Debug = NAMEDPIPE_LOG_LEVEL_DEBUG,
+  Info = NAMEDPIPE_LOG_LEVEL_INFO,
+  Error = NAMEDPIPE_LOG_LEVEL_ERROR,
+  Off = NAMEDPIPE_LOG_LEVEL_OFF
+};
+
+// What the async logger does, when the thread's buffer is full.
+enum class LogOverflowPolicy {
+  Drop,  // the message is dropped, the number of dropped messages is logged later
+  Block  // the thread waits until the buffer is flushed
+};
+
+struct LoggerConfig {
+  // Number of messages, which each thread can buffer.
+  size_t buffer_size = 4096;
+  LogOverflowPolicy overflow_policy = LogOverflowPolicy::Drop;
+  // How often the background thread writes the buffered messages.
+  std::chrono::milliseconds flush_interval = std::chrono::milliseconds(10);
+  // Not empty - the messages are written to the binary log file instead of std::cout and
+  // std::cerr (see BinaryLogFormat.h). The file can be rendered by NamedPipeLogDecode.
+  std::string binary_log_path;
+};
 
 // Logger class to log messages to std::cout or std::cerr
 // This class also avoids the torn writes to a stream,
 // cause both server and client can have multiple threads to write to the log.
 // Thus, we need to have some kind of synchronization.
+//
+// By default every message is written right away under the global lock. After StartAsync()
+// messages are put to the lock-free buffer of the calling thread and written in batches by
+// the background thread, so the logging threads don't wait for each other and for the stream.
 class Logger final {
  public:
   static void LogDebug(const std::string& message);
 
   static void LogError(const std::string& error);
 
+  // Errors are written to std::cerr, other levels - to std::cout.
+  static void Log(LogLevel level, const std::string& message);
+
+  // Runtime threshold - messages below the level are skipped (LogLevel::Trace by default).
+  static void SetLevel(LogLevel level);
+  static bool IsEnabled(LogLevel level);
+
+  // Starts the background thread. Returns false if it's already started.
+  static bool StartAsync(const LoggerConfig& config = LoggerConfig{});
+  // Writes all the buffered messages and stops the background thread - further messages are
+  // written right away. Should be called, when other threads don't log anymore.
+  static void StopAsync();
+
+  // Binary log is written - the log macros should use BinaryLogRecord.
+  static bool IsBinary();
+  // Returns the id of the registered descriptor.
+  static uint32_t RegisterBinaryDescriptor(BinaryLogDescriptor descriptor);
+  static void WriteBinary(const BinaryLogEvent& event);
+
   // Helper method to convert std::ostream to std::string
   // this is just helper for stringstream one liners:
   // For more details, see https://github.com/stan-dev/math/issues/590
   static std::string to_string(std::ostream& stream);
 };
+
+// Levelled logging of the stream expression, e.g.:
+//   NAMEDPIPE_LOG_DEBUG(kLogTag << ": created handle=" << handle);
+// The expression is evaluated and formatted only if the level is enabled at runtime, and isn't
+// compiled at all below NAMEDPIPE_MIN_LOG_LEVEL. In the binary mode the message isn't formatted
+// at all - only the raw values are appended to the log.
+#define NAMEDPIPE_LOG(level, ...)                                                  \
+  do {                                                                             \
+    if (Logger::IsEnabled(level)) {                                                \
+      if (Logger::IsBinary()) {                                                    \
+        static BinaryLogSite binary_log_site(level, __FILE__, __LINE__);           \
+        BinaryLogRecord{binary_log_site} << __VA_ARGS__;                           \
+      } else {                                                                     \
+        Logger::Log(level, Logger::to_string(std::stringstream() << __VA_ARGS__)); \
+      }                                                                            \
+    }                                                                              \
+  } while (false)
+
+// Keeps the disabled expression compiled (so its variables are still used), but no code is
+// generated for it.
+#define NAMEDPIPE_LOG_DISABLED(...)                          \
+  do {                                                       \
+    if (false) {                                             \
+      Logger::to_string(std::stringstream() << __VA_ARGS__); \
+    }                                                        \
+  } while (false)
+
+#if NAMEDPIPE_MIN_LOG_LEVEL <= NAMEDPIPE_LOG_LEVEL_TRACE
+#define NAMEDPIPE_LOG_TRACE(...) NAMEDPIPE_LOG(LogLevel::Trace, __VA_ARGS__)
+#else
+#define NAMEDPIPE_LOG_TRACE(...) NAMEDPIPE_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if NAMEDPIPE_MIN_LOG_LEVEL <= NAMEDPIPE_LOG_LEVEL_DEBUG
+#define NAMEDPIPE_LOG_DEBUG(...) NAMEDPIPE_LOG(LogLevel::Debug, __VA_ARGS__)
+#else
+#define NAMEDPIPE_LOG_DEBUG(...) NAMEDPIPE_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if NAMEDPIPE_MIN_LOG_LEVEL <= NAMEDPIPE_LOG_LEVEL_INFO
+#define NAMEDPIPE_LOG_INFO(...) NAMEDPIPE_LOG(LogLevel::Info, __VA_ARGS__)
+#else
+#define NAMEDPIPE_LOG_INFO(...) NAMEDPIPE_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if NAMEDPIPE_MIN_LOG_LEVEL <= NAMEDPIPE_LOG_LEVEL_ERROR
+#define NAMEDPIPE_LOG_ERROR(...) NAMEDPIPE_LOG(LogLevel::Error, __VA_ARGS__)
+#else
+#define NAMEDPIPE_LOG_ERROR(...) NAMEDPIPE_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#include "BinaryLogRecord.h"
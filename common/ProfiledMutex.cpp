@@ -0,0 +1,76 @@
+#include "ProfiledMutex.h"
+
+#include "Logger.h"
+
+#if defined(NAMEDPIPE_PROFILE_LOCKS)
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+
+namespace {
+struct LocksRegistry {
+  // std::mutex - the registry mustn't profile itself
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<LockProfiler::LockStats>> locks;
+};
+
+LocksRegistry& GetRegistry() {
+  // constructed on the first use, as the locks can be static objects too
+  static LocksRegistry registry;
+  return registry;
+}
+
+void WritePercentiles(std::ostream& out, const char* name, const HistogramSnapshot& histogram) {
+  out << " " << name << "_p50=" << histogram.GetPercentile(50) / 1e3 << "us " << name
+      << "_p99=" << histogram.GetPercentile(99) / 1e3 << "us " << name
+      << "_max=" << histogram.GetPercentile(100) / 1e3 << "us " << name
+      << "_total=" << histogram.sum / 1e3 << "us";
+}
+}  // namespace
+
+bool LockProfiler::IsEnabled() { return true; }
+
+LockProfiler::LockStats& LockProfiler::GetStats(const char* name) {
+  auto& registry = GetRegistry();
+  std::lock_guard<std::mutex> locker(registry.mutex);
+  auto& stats = registry.locks[name];
+  if (!stats) {
+    stats = std::make_unique<LockStats>();
+  }
+  return *stats;
+}
+
+std::string LockProfiler::GetReport() {
+  auto& registry = GetRegistry();
+  std::lock_guard<std::mutex> locker(registry.mutex);
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1);
+  for (const auto& [name, stats] : registry.locks) {
+    HistogramSnapshot wait_time;
+    wait_time.Add(stats->wait_time);
+    HistogramSnapshot hold_time;
+    hold_time.Add(stats->hold_time);
+    ss << "lock=" << name
+       << " acquisitions=" << stats->acquisitions.load(std::memory_order_relaxed)
+       << " contended=" << stats->contended.load(std::memory_order_relaxed);
+    WritePercentiles(ss, "wait", wait_time);
+    WritePercentiles(ss, "hold", hold_time);
+    ss << "\n";
+  }
+  return ss.str();
+}
+
+#else
+
+bool LockProfiler::IsEnabled() { return false; }
+
+std::string LockProfiler::GetReport() { return {}; }
+
+#endif
+
+void LockProfiler::LogReport() {
+  if (IsEnabled()) {
+    Logger::Log(LogLevel::Info, "LockProfiler: contention of the locks:\n" + GetReport());
+  }
+}
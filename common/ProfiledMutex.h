@@ -0,0 +1,98 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#if defined(NAMEDPIPE_PROFILE_LOCKS)
+#include <chrono>
+#include <cstdint>
+#include "LatencyHistogram.h"
+#endif
+
+// Contention statistics of the ProfiledMutex'es, aggregated per lock name.
+class LockProfiler {
+ public:
+  // NAMEDPIPE_PROFILE_LOCKS build option.
+  static bool IsEnabled();
+  // One line per lock: acquisitions, contended acquisitions and percentiles of the wait and hold
+  // times. Empty, if the profiling isn't compiled.
+  static std::string GetReport();
+  // Logs the report, if the profiling is compiled.
+  static void LogReport();
+
+#if defined(NAMEDPIPE_PROFILE_LOCKS)
+  struct LockStats {
+    std::atomic<uint64_t> acquisitions = 0;
+    // acquisitions, which had to wait for another owner
+    std::atomic<uint64_t> contended = 0;
+    LatencyHistogram wait_time;
+    LatencyHistogram hold_time;
+  };
+  // Stats of all the locks with the name - they live till the process exit.
+  static LockStats& GetStats(const char* name);
+#endif
+};
+
+#if defined(NAMEDPIPE_PROFILE_LOCKS)
+
+// Mutex, which records how long the threads wait for it and how long they hold it.
+// The uncontended lock costs two extra clock reads.
+class ProfiledMutex {
+ public:
+  // name must be a string literal, locks with the same name share the stats.
+  explicit ProfiledMutex(const char* name) : stats_(LockProfiler::GetStats(name)) {}
+  ProfiledMutex(const ProfiledMutex&) = delete;
+  ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+  void lock() {
+    uint64_t wait_ns = 0;
+    if (!mutex_.try_lock()) {
+      const auto begin = Now();
+      mutex_.lock();
+      wait_ns = Now() - begin;
+      stats_.contended.fetch_add(1, std::memory_order_relaxed);
+    }
+    OnLocked(wait_ns);
+  }
+
+  bool try_lock() {
+    if (!mutex_.try_lock()) {
+      return false;
+    }
+    OnLocked(0);
+    return true;
+  }
+
+  void unlock() {
+    stats_.hold_time.RecordConcurrent(Now() - locked_ns_);
+    mutex_.unlock();
+  }
+
+ private:
+  static inline uint64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void OnLocked(uint64_t wait_ns) {
+    stats_.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    stats_.wait_time.RecordConcurrent(wait_ns);
+    // written and read only by the owner:
+    locked_ns_ = Now();
+  }
+
+ private:
+  std::mutex mutex_;
+  LockProfiler::LockStats& stats_;
+  uint64_t locked_ns_ = 0;
+};
+
+#else
+
+// Plain std::mutex - the name is used only by the NAMEDPIPE_PROFILE_LOCKS builds.
+class ProfiledMutex : public std::mutex {
+ public:
+  explicit constexpr ProfiledMutex(const char*) noexcept {}
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "RequestControl.h"
+
+#include <algorithm>
+#include <cstring>
+#include "DataDeserializer.h"
+#include "DataSerializer.h"
+
+void RequestControl::AppendDeadline(RawDataType& data, uint64_t deadline_ns) {
+  AppendTimeHeader(data, 'd', deadline_ns);
+}
+
+std::pair<bool, uint64_t> RequestControl::ParseDeadline(const RawDataType& data,
+                                                        size_t& seek_idx) {
+  return ParseTimeHeader(data, 'd', seek_idx);
+}
+
+void RequestControl::AppendSendTime(RawDataType& data, uint64_t send_ns) {
+  AppendTimeHeader(data, 'q', send_ns);
+}
+
+void RequestControl::WriteSendTime(RawDataType& data, size_t offset, uint64_t send_ns) {
+  std::memcpy(&data[offset + 2], &send_ns, sizeof(send_ns));
+}
+
+std::pair<bool, uint64_t> RequestControl::ParseSendTime(const RawDataType& data,
+                                                        size_t& seek_idx) {
+  return ParseTimeHeader(data, 'q', seek_idx);
+}
+
+void RequestControl::AppendPriority(RawDataType& data, RequestPriority priority) {
+  data.push_back('#');
+  data.push_back('p');
+  data.push_back(static_cast<char>(priority));
+}
+
+std::pair<bool, RequestPriority> RequestControl::ParsePriority(const RawDataType& data,
+                                                               size_t& seek_idx) {
+  size_t idx = seek_idx;
+  if (data.size() < idx + kPriorityHeaderSize || data[idx++] != '#' || data[idx++] != 'p' ||
+      static_cast<uint8_t>(data[idx]) >= kRequestPrioritiesCount) {
+    return std::make_pair(false, RequestPriority::Normal);
+  }
+  seek_idx = idx + 1;
+  return std::make_pair(true, static_cast<RequestPriority>(data[idx]));
+}
+
+void RequestControl::AppendChunk(RawDataType& data, const ChunkHeader& header,
+                                 const char* payload, size_t size) {
+  data.push_back('#');
+  data.push_back('k');
+  DataSerializer::AppendToRawData<int>(data, header.request_id);
+  data.push_back(static_cast<char>((header.is_first ? kFirstChunk : 0) |
+                                   (header.is_last ? kLastChunk : 0)));
+  data.insert(data.end(), payload, payload + size);
+}
+
+std::pair<bool, RequestControl::ChunkHeader> RequestControl::ParseChunk(
+    const RawDataType& data) {
+  size_t idx = 0;
+  if (data.size() < kChunkHeaderSize || data[idx++] != '#' || data[idx++] != 'k') {
+    return std::make_pair(false, ChunkHeader{});
+  }
+
+  ChunkHeader header;
+  const auto [success, request_id] = RegularTypeParaser::Parse<RequestId>(data, idx);
+  if (!success) {
+    return std::make_pair(false, ChunkHeader{});
+  }
+  header.request_id = request_id;
+  header.is_first = (data[idx] & kFirstChunk) != 0;
+  header.is_last = (data[idx] & kLastChunk) != 0;
+  return std::make_pair(true, header);
+}
+
+size_t RequestControl::AppendCancel(RawDataType& data, const std::vector<RequestId>& request_ids,
+                                    size_t first) {
+  const auto count = std::min(request_ids.size() - std::min(first, request_ids.size()),
+                              kMaxCancelIds);
+  data.push_back('#');
+  data.push_back('x');
+  DataSerializer::AppendToRawData<int>(data, static_cast<int>(count));
+  for (size_t i = first; i < first + count; ++i) {
+    DataSerializer::AppendToRawData<int>(data, request_ids[i]);
+  }
+  return count;
+}
+
+bool RequestControl::ParseCancel(const RawDataType& data, std::vector<RequestId>& request_ids) {
+  size_t idx = 0;
+  if (data.size() < 2 || data[idx++] != '#' || data[idx++] != 'x') {
+    return false;
+  }
+
+  const auto [success, count] = RegularTypeParaser::Parse<int>(data, idx);
+  if (!success || count < 0) {
+    return false;
+  }
+  for (int i = 0; i < count; ++i) {
+    const auto [is_parsed, request_id] = RegularTypeParaser::Parse<RequestId>(data, idx);
+    if (!is_parsed) {
+      return false;
+    }
+    request_ids.push_back(request_id);
+  }
+  return true;
+}
+
+void RequestControl::AppendStatus(RawDataType& data, int error) {
+  data.push_back('#');
+  data.push_back('e');
+  DataSerializer::AppendToRawData<int>(data, error);
+}
+
+std::pair<bool, int> RequestControl::ParseStatus(const RawDataType& data, size_t& seek_idx) {
+  size_t idx = seek_idx;
+  if (data.size() < idx + 2 || data[idx++] != '#' || data[idx++] != 'e') {
+    return std::make_pair(false, 0);
+  }
+
+  const auto [success, error] = RegularTypeParaser::Parse<int>(data, idx);
+  if (!success) {
+    return std::make_pair(false, 0);
+  }
+  seek_idx = idx;
+  return std::make_pair(true, error);
+}
+
+void RequestControl::AppendBusy(RawDataType& data, uint32_t retry_after_us) {
+  data.push_back('#');
+  data.push_back('b');
+  DataSerializer::AppendToRawData<int>(data, static_cast<int>(retry_after_us));
+}
+
+std::pair<bool, uint32_t> RequestControl::ParseBusy(const RawDataType& data, size_t& seek_idx) {
+  size_t idx = seek_idx;
+  if (data.size() < idx + 2 || data[idx++] != '#' || data[idx++] != 'b') {
+    return std::make_pair(false, 0u);
+  }
+
+  const auto [success, retry_after_us] = RegularTypeParaser::Parse<int>(data, idx);
+  if (!success || retry_after_us < 0) {
+    return std::make_pair(false, 0u);
+  }
+  seek_idx = idx;
+  return std::make_pair(true, static_cast<uint32_t>(retry_after_us));
+}
+
+void RequestControl::AppendTimeHeader(RawDataType& data, char tag, uint64_t value) {
+  const auto offset = data.size();
+  data.resize(offset + 2 + sizeof(value));
+  data[offset] = '#';
+  data[offset + 1] = tag;
+  std::memcpy(&data[offset + 2], &value, sizeof(value));
+}
+
+std::pair<bool, uint64_t> RequestControl::ParseTimeHeader(const RawDataType& data, char tag,
+                                                          size_t& seek_idx) {
+  size_t idx = seek_idx;
+  if (data.size() < idx + 2 + sizeof(uint64_t) || data[idx++] != '#' || data[idx++] != tag) {
+    return std::make_pair(false, uint64_t{0});
+  }
+
+  uint64_t value = 0;
+  std::memcpy(&value, &data[idx], sizeof(value));
+  seek_idx = idx + sizeof(value);
+  return std::make_pair(true, value);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Types.h"
+
+// Frames, which let the server drop the requests, whose responses aren't needed anymore, and
+// reject the requests, which it can't serve in time:
+//  - deadline header of the request, which goes after the request id and the trace header:
+//    #d<deadline>, raw 8-byte steady_clock nanoseconds (see Tracer::Now() - the clock is
+//    system-wide). The server doesn't execute the request after its deadline;
+//  - send time header, which goes after the deadline header: #q<send time>, raw 8-byte
+//    steady_clock nanoseconds of the write of the request by the client. The server measures the
+//    queueing delay of the request from it (see AdmissionControl);
+//  - cancel frame: #x<int count><int request id>... - the server doesn't execute the queued
+//    requests with these ids, and doesn't send the responses of the ones being executed;
+//  - status response: #r<request id>#e<int error> - is sent instead of the response of the
+//    dropped request (ERROR_TIMEOUT - expired, ERROR_CANCELLED - cancelled), so every awaited
+//    request still gets exactly one response frame;
+//  - busy response: #r<request id>#b<int retry after> - the overloaded server rejected the
+//    request without executing it, the client should retry after the given microseconds;
+//  - priority header, which goes after the send time header: #p<1-byte RequestPriority>, only
+//    if the priority isn't normal. The server executes the queued requests of the higher
+//    priority first;
+//  - chunk frame: #k<int request id><1-byte flags><payload> - the request, which is longer than
+//    kMaxChunkPayload, is sent as a few chunks, so it fits into the read buffer of the server,
+//    and the frames of the higher priority can be sent between its chunks. The server assembles
+//    the request from its chunks (see FrameQueue).
+class RequestControl {
+ public:
+  static constexpr size_t kDeadlineHeaderSize = 2 + sizeof(uint64_t);
+  static constexpr size_t kSendTimeHeaderSize = 2 + sizeof(uint64_t);
+  static constexpr size_t kPriorityHeaderSize = 2 + 1;
+  static constexpr size_t kChunkHeaderSize = 2 + 1 + sizeof(RequestId) + 1;
+  static constexpr size_t kMaxChunkPayload = 2048;
+
+  struct ChunkHeader {
+    RequestId request_id = -1;
+    bool is_first = false;
+    bool is_last = false;
+  };
+  // Ids per cancel frame, so the frame fits into the read buffer of the server.
+  static constexpr size_t kMaxCancelIds = 512;
+
+  static void AppendDeadline(RawDataType& data, uint64_t deadline_ns);
+  // Returns false, if there is no header at seek_idx.
+  static std::pair<bool, uint64_t> ParseDeadline(const RawDataType& data, size_t& seek_idx);
+
+  static void AppendSendTime(RawDataType& data, uint64_t send_ns);
+  // Writes the send time into the header at the offset - the header must be already there.
+  static void WriteSendTime(RawDataType& data, size_t offset, uint64_t send_ns);
+  // Returns false, if there is no header at seek_idx.
+  static std::pair<bool, uint64_t> ParseSendTime(const RawDataType& data, size_t& seek_idx);
+
+  static void AppendPriority(RawDataType& data, RequestPriority priority);
+  // Returns false, if there is no header at seek_idx.
+  static std::pair<bool, RequestPriority> ParsePriority(const RawDataType& data,
+                                                        size_t& seek_idx);
+
+  // Appends the chunk frame with the size bytes of the payload.
+  static void AppendChunk(RawDataType& data, const ChunkHeader& header, const char* payload,
+                          size_t size);
+  // Returns false, if the data isn't a chunk frame. The payload starts at kChunkHeaderSize.
+  static std::pair<bool, ChunkHeader> ParseChunk(const RawDataType& data);
+
+  // Appends the cancel frame of at most kMaxCancelIds ids, starting from the first one.
+  // Returns the number of the appended ids.
+  static size_t AppendCancel(RawDataType& data, const std::vector<RequestId>& request_ids,
+                             size_t first = 0);
+  // Returns false, if the data isn't a cancel frame. The ids are appended to request_ids.
+  static bool ParseCancel(const RawDataType& data, std::vector<RequestId>& request_ids);
+
+  static void AppendStatus(RawDataType& data, int error);
+  // Returns false, if there is no status at seek_idx.
+  static std::pair<bool, int> ParseStatus(const RawDataType& data, size_t& seek_idx);
+
+  static void AppendBusy(RawDataType& data, uint32_t retry_after_us);
+  // Returns false, if there is no busy response at seek_idx.
+  static std::pair<bool, uint32_t> ParseBusy(const RawDataType& data, size_t& seek_idx);
+
+ private:
+  // flags of the chunk frame
+  static constexpr char kFirstChunk = 1;
+  static constexpr char kLastChunk = 2;
+
+  // Raw 8-byte header: #<tag><value>.
+  static void AppendTimeHeader(RawDataType& data, char tag, uint64_t value);
+  static std::pair<bool, uint64_t> ParseTimeHeader(const RawDataType& data, char tag,
+                                                   size_t& seek_idx);
+
+  RequestControl() = delete;
+};
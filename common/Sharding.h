@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include "Types.h"
+
+// In the sharded mode the ClassHandle space is partitioned between N server processes: the shard
+// owning the handle is encoded in its low part (handle % shards_count). Thus, the owner of any
+// handle is known without asking the servers.
+
+// Index of the shard, which owns the handle.
+inline size_t GetShardOfHandle(ClassHandle handle, size_t shards_count) {
+  return shards_count > 1 ? static_cast<size_t>(handle) % shards_count : 0;
+}
+
+// Name of the pipe served by the shard: <pipe_name>_shard<index>.
+inline std::string GetShardPipeName(const std::string& pipe_name, size_t shard_index) {
+  return pipe_name + "_shard" + std::to_string(shard_index);
+}
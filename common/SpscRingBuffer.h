@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free queue for a single producer thread and a single consumer thread.
+// The capacity is rounded up to the power of two.
+template <typename T>
+class SpscRingBuffer {
+ public:
+  explicit SpscRingBuffer(size_t capacity) : slots_(RoundUpToPowerOfTwo(capacity)) {
+    mask_ = slots_.size() - 1;
+  }
+
+  // Producer side. The value is moved only if there is a free slot.
+  bool TryPush(T&& value) {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+      return false;
+    }
+    slots_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Producer side - the free slot, which is published by Commit(), so the value can be filled
+  // in place. nullptr - the buffer is full.
+  T* TryReserve() {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+      return nullptr;
+    }
+    return &slots_[tail & mask_];
+  }
+
+  void Commit() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Consumer side.
+  bool TryPop(T& value) {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side - the oldest value, which stays in the buffer until Pop().
+  // nullptr - the buffer is empty.
+  T* Front() {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &slots_[head & mask_];
+  }
+
+  void Pop() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  bool IsEmpty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+ private:
+  std::vector<T> slots_;
+  size_t mask_ = 0;
+  // The indices are only incremented, the producer and the consumer write to different lines:
+  alignas(64) std::atomic<size_t> head_ = 0;
+  alignas(64) std::atomic<size_t> tail_ = 0;
+};
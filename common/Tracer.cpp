@@ -0,0 +1,217 @@
+#include "Tracer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "Logger.h"
+
+static constexpr auto kLogTag = "Tracer";
+
+namespace {
+
+struct Span {
+  uint64_t trace_id = 0;
+  const char* name = nullptr;
+  uint64_t begin_ns = 0;
+  uint64_t end_ns = 0;
+};
+
+// Spans of one thread. The thread appends them, Tracer::Stop() reads the published ones.
+struct ThreadSpans {
+  ThreadSpans(size_t buffer_size, uint32_t thread_index)
+      : spans(buffer_size), thread_index(thread_index) {}
+
+  std::vector<Span> spans;
+  std::atomic<size_t> size = 0;
+  const uint32_t thread_index;
+};
+
+std::mutex s_tracer_mutex;
+std::atomic<bool> s_is_enabled = false;
+// sample_rate scaled to the range of uint64_t
+std::atomic<uint64_t> s_sample_threshold = 0;
+std::atomic<size_t> s_generation = 0;
+std::atomic<size_t> s_dropped_count = 0;
+TraceConfig s_config;
+std::vector<std::shared_ptr<ThreadSpans>> s_buffers;
+uint32_t s_threads_counter = 0;
+
+thread_local uint64_t s_current_trace = 0;
+
+ThreadSpans* GetThreadSpans() {
+  struct ThreadSpansHolder {
+    std::shared_ptr<ThreadSpans> spans;
+    size_t generation = 0;
+  };
+  thread_local ThreadSpansHolder holder;
+  // the buffer is registered once per thread and per Start():
+  if (!holder.spans || holder.generation != s_generation.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> locker(s_tracer_mutex);
+    if (!s_is_enabled) {
+      return nullptr;
+    }
+    holder.spans = std::make_shared<ThreadSpans>(s_config.buffer_size, s_threads_counter++);
+    holder.generation = s_generation;
+    s_buffers.push_back(holder.spans);
+  }
+  return holder.spans.get();
+}
+
+// xorshift64* - the sampling must be cheaper than a clock read.
+uint64_t NextRandom() {
+  thread_local uint64_t state =
+      std::hash<std::thread::id>{}(std::this_thread::get_id()) ^ Tracer::Now() ^ 1;
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545F4914F6CDD1DULL;
+}
+
+// Chrome trace time - microseconds with the nanoseconds fraction.
+void WriteMicroseconds(std::ostream& out, uint64_t nanoseconds) {
+  out << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000;
+}
+
+void WriteSpans(std::ostream& out, const std::vector<std::shared_ptr<ThreadSpans>>& buffers) {
+  // one event per line, so the traces can be merged line by line (see NamedPipeTraceMerge)
+  out << "{\"traceEvents\":[\n";
+  out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << s_config.process_id
+      << ",\"args\":{\"name\":\"" << s_config.process_name << "\"}}";
+  for (const auto& buffer : buffers) {
+    const auto size = buffer->size.load(std::memory_order_acquire);
+    for (size_t i = 0; i < size; ++i) {
+      const auto& span = buffer->spans[i];
+      out << ",\n{\"name\":\"" << span.name << "\",\"cat\":\"namedpipe\",\"ph\":\"X\",\"ts\":";
+      WriteMicroseconds(out, span.begin_ns);
+      out << ",\"dur\":";
+      WriteMicroseconds(out, span.end_ns >= span.begin_ns ? span.end_ns - span.begin_ns : 0);
+      out << ",\"pid\":" << s_config.process_id << ",\"tid\":" << buffer->thread_index
+          << ",\"args\":{\"trace_id\":\"" << std::hex << span.trace_id << std::dec << "\"}}";
+    }
+  }
+  out << "\n]}\n";
+}
+
+}  // namespace
+
+bool Tracer::Start(const TraceConfig& config) {
+  std::lock_guard<std::mutex> locker(s_tracer_mutex);
+  if (s_is_enabled) {
+    return false;
+  }
+  s_config = config;
+  const auto rate = std::min(std::max(config.sample_rate, 0.0), 1.0);
+  s_sample_threshold =
+      rate >= 1.0 ? std::numeric_limits<uint64_t>::max()
+                  : static_cast<uint64_t>(rate * static_cast<double>(
+                                                     std::numeric_limits<uint64_t>::max()));
+  s_dropped_count = 0;
+  ++s_generation;
+  s_is_enabled = true;
+  return true;
+}
+
+bool Tracer::Stop() {
+  std::vector<std::shared_ptr<ThreadSpans>> buffers;
+  {
+    std::lock_guard<std::mutex> locker(s_tracer_mutex);
+    if (!s_is_enabled) {
+      return false;
+    }
+    s_is_enabled = false;
+    buffers.swap(s_buffers);
+  }
+
+  if (const auto dropped = s_dropped_count.load(); dropped > 0) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": " << dropped
+                                       << " spans were dropped - the buffers are full"));
+  }
+  if (s_config.output_path.empty()) {
+    return true;
+  }
+
+  std::ofstream file(s_config.output_path, std::ios::trunc);
+  WriteSpans(file, buffers);
+  if (!file.flush()) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - failed to write the trace="
+                                       << s_config.output_path));
+    return false;
+  }
+  return true;
+}
+
+bool Tracer::IsEnabled() { return s_is_enabled.load(std::memory_order_relaxed); }
+
+uint64_t Tracer::SampleTrace() {
+  const auto threshold = s_sample_threshold.load(std::memory_order_relaxed);
+  if (threshold == 0 || !s_is_enabled.load(std::memory_order_relaxed) ||
+      NextRandom() > threshold) {
+    return 0;
+  }
+  // any non-zero id
+  return NextRandom() | 1;
+}
+
+void Tracer::RecordSpan(uint64_t trace_id, const char* name, uint64_t begin_ns,
+                        uint64_t end_ns) {
+  if (!s_is_enabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  auto* buffer = GetThreadSpans();
+  if (!buffer) {
+    return;
+  }
+
+  const auto size = buffer->size.load(std::memory_order_relaxed);
+  if (size == buffer->spans.size()) {
+    s_dropped_count.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->spans[size] = Span{trace_id, name, begin_ns, end_ns};
+  buffer->size.store(size + 1, std::memory_order_release);
+}
+
+void Tracer::SetCurrentTrace(uint64_t trace_id) { s_current_trace = trace_id; }
+
+uint64_t Tracer::GetCurrentTrace() { return s_current_trace; }
+
+void Tracer::WriteHeader(RawDataType& data, size_t offset, const TraceContext& context) {
+  data[offset++] = '#';
+  data[offset++] = 't';
+  for (const uint64_t value : {context.trace_id, context.client_send_ns, context.server_send_ns}) {
+    std::memcpy(&data[offset], &value, sizeof(value));
+    offset += sizeof(value);
+  }
+}
+
+void Tracer::AppendHeader(RawDataType& data, const TraceContext& context) {
+  const auto offset = data.size();
+  data.resize(offset + TraceContext::kHeaderSize);
+  WriteHeader(data, offset, context);
+}
+
+std::pair<bool, TraceContext> Tracer::ParseHeader(const RawDataType& data, size_t& seek_idx) {
+  size_t idx = seek_idx;
+  if (data.size() < idx + TraceContext::kHeaderSize || data[idx++] != '#' || data[idx++] != 't') {
+    return std::make_pair(false, TraceContext{});
+  }
+
+  TraceContext context;
+  for (uint64_t* value : {&context.trace_id, &context.client_send_ns, &context.server_send_ns}) {
+    std::memcpy(value, &data[idx], sizeof(*value));
+    idx += sizeof(*value);
+  }
+  seek_idx = idx;
+  return std::make_pair(true, context);
+}
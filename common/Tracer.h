@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include "Types.h"
+
+// Runtime configuration of the Tracer.
+struct TraceConfig {
+  // Fraction of the requests, which are traced by the client, e.g. 0.001 - 0.1% of requests.
+  // The server traces the requests, which carry the trace header.
+  double sample_rate = 0.001;
+  // Spans per thread - further spans are dropped.
+  size_t buffer_size = 65536;
+  // Chrome/Perfetto JSON, which is written by Tracer::Stop().
+  std::string output_path;
+  // Process in the trace, so traces of the client and the server can be merged (see
+  // NamedPipeTraceMerge).
+  uint32_t process_id = 0;
+  std::string process_name;
+};
+
+// Trace header of the request, which goes right after the request id: #t<trace id><client send
+// time><server send time>, raw 8-byte values. The response echoes the header of its request with
+// the server send time stamped, so the client can record the spans without remembering the
+// requests. The times are steady_clock nanoseconds - the clock is system-wide, so the times of the
+// client and the server on the same machine are comparable.
+struct TraceContext {
+  static constexpr size_t kHeaderSize = 2 + 3 * sizeof(uint64_t);
+
+  inline bool IsTraced() const { return trace_id != 0; }
+
+  // 0 - the request isn't traced
+  uint64_t trace_id = 0;
+  uint64_t client_send_ns = 0;
+  uint64_t server_send_ns = 0;
+};
+
+// Records spans of the sampled requests into per-thread buffers and exports them as the Chrome
+// trace event JSON, which is viewed by chrome://tracing or ui.perfetto.dev.
+// Requests, which are not sampled, cost a single check of the trace id.
+class Tracer {
+ public:
+  static bool Start(const TraceConfig& config);
+  // Stops the tracing and writes the recorded spans to TraceConfig::output_path.
+  static bool Stop();
+  static bool IsEnabled();
+
+  // Trace id for a new request on the client. 0 - the request isn't sampled.
+  static uint64_t SampleTrace();
+
+  static inline uint64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  static void RecordSpan(uint64_t trace_id, const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+  // Trace of the request, which is processed by the calling thread (see TraceSpan).
+  static void SetCurrentTrace(uint64_t trace_id);
+  static uint64_t GetCurrentTrace();
+
+  // Writes the header at the offset, the data must be large enough.
+  static void WriteHeader(RawDataType& data, size_t offset, const TraceContext& context);
+  static void AppendHeader(RawDataType& data, const TraceContext& context);
+  // Returns false, if there is no header at seek_idx.
+  static std::pair<bool, TraceContext> ParseHeader(const RawDataType& data, size_t& seek_idx);
+
+ private:
+  Tracer() = delete;
+};
+
+// Sets the current trace of the thread for the scope.
+class CurrentTraceScope {
+ public:
+  explicit CurrentTraceScope(uint64_t trace_id) { Tracer::SetCurrentTrace(trace_id); }
+  ~CurrentTraceScope() { Tracer::SetCurrentTrace(0); }
+};
+
+// Records the span from the construction till the destruction, if the request is traced.
+// name must be a string literal.
+class TraceSpan {
+ public:
+  // Span of the current trace of the thread.
+  explicit TraceSpan(const char* name) : TraceSpan(Tracer::GetCurrentTrace(), name) {}
+  TraceSpan(uint64_t trace_id, const char* name)
+      : trace_id_(trace_id), name_(name), begin_ns_(trace_id != 0 ? Tracer::Now() : 0) {}
+  ~TraceSpan() {
+    if (trace_id_ != 0) {
+      Tracer::RecordSpan(trace_id_, name_, begin_ns_, Tracer::Now());
+    }
+  }
+
+ private:
+  const uint64_t trace_id_;
+  const char* const name_;
+  const uint64_t begin_ns_;
+};
@@ -1,10 +1,21 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 using RawDataType = std::vector<char>;
 
 enum class ExecutionPolicy { Sync = 0, Async };
 
+// Priority of the request: the higher ones overtake the queued lower ones on the client and on
+// the server (see RequestControl.h). The requests of different priorities aren't ordered.
+enum class RequestPriority : uint8_t { High = 0, Normal, Bulk };
+constexpr size_t kRequestPrioritiesCount = 3;
+
+// Encoding of the values of a frame (see WireFormat.h): the compact one is opted in by the client
+// per request, the server parses both and answers in the encoding of the request id.
+enum class WireEncoding : uint8_t { Fixed = 0, Compact };
+
 using ClassHandle = int;
 using RequestId = int;
@@ -0,0 +1,161 @@
+#pragma once
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Types.h"
+
+// Tags of the serialized values (see DataSerializer and RegularTypeParaser).
+// Fixed encoding - a char tag and the value as it is in memory:
+//   bool   - 'b' and '0' or '1';
+//   int    - 'i' and 4 bytes;
+//   double - 'd' and 8 bytes;
+//   string - 's', the int length and the characters.
+// Compact encoding - the tags don't collide with the fixed ones, nor with '#' of the commands, so
+// both encodings are parsed by the same parser:
+//   bool   - one byte, kCompactFalse or kCompactTrue;
+//   int    - one byte kSmallIntTag | v for the zigzag value v < 64 (-32..31), otherwise 'I' and
+//            the LEB128 varint of the zigzag value (1-5 bytes);
+//   double - as the fixed one;
+//   string - one byte kShortStringTag | n and the characters for the length n < 32, otherwise
+//            'S', the varint length and the characters.
+// The zigzag value keeps the small negative ints short: 0, -1, 1, -2... -> 0, 1, 2, 3...
+constexpr char kCompactIntTag = 'I';
+constexpr char kCompactStringTag = 'S';
+constexpr uint8_t kSmallIntTag = 0x80;
+constexpr uint8_t kSmallIntLimit = 64;
+constexpr uint8_t kShortStringTag = 0xC0;
+constexpr uint8_t kShortStringLimit = 32;
+constexpr uint8_t kCompactFalse = 0xE0;
+constexpr uint8_t kCompactTrue = 0xE1;
+// the int takes up to 5 groups of 7 bits
+constexpr size_t kMaxVarintSize = 5;
+
+inline uint32_t EncodeZigZag(int value) {
+  return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int DecodeZigZag(uint32_t value) {
+  return static_cast<int>((value >> 1) ^ (0u - (value & 1)));
+}
+
+inline size_t GetLowestSetBit(uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward64(&index, value);
+  return index;
+#else
+  return __builtin_ctzll(value);
+#endif
+}
+
+inline void AppendVarint(RawDataType& data, uint32_t value) {
+  while (value >= 0x80) {
+    data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  data.push_back(static_cast<char>(value));
+}
+
+// Decodes the varint at idx without a branch per byte: up to 8 bytes are loaded at once, the
+// lowest clear continuation bit ends the varint, and the 7-bit groups are packed by the masks.
+// Returns false, if the varint is truncated or longer than kMaxVarintSize.
+// NOTE: the word is little-endian, as Windows is.
+inline bool ReadVarint(const char* data, size_t size, size_t& idx, uint32_t& value) {
+  if (idx >= size) {
+    return false;
+  }
+  const auto available = size - idx;
+  uint64_t word = 0;
+  if (available >= sizeof(word)) {
+    // the fixed-size copy is a single load
+    std::memcpy(&word, data + idx, sizeof(word));
+  } else {
+    // the varint at the end of the data
+    for (size_t i = 0; i < available; ++i) {
+      word |= static_cast<uint64_t>(static_cast<uint8_t>(data[idx + i])) << (8 * i);
+    }
+  }
+
+  // the continuation bits of the first kMaxVarintSize bytes, which are clear
+  const uint64_t stops = ~word & 0x0000008080808080ull;
+  if (stops == 0) {
+    return false;
+  }
+  // all the bytes of the varint - till the lowest clear continuation bit
+  const auto stop_bit = GetLowestSetBit(stops);
+  const uint64_t mask = (uint64_t{2} << stop_bit) - 1;
+  const auto length = (stop_bit + 1) / 8;
+  if (length > available) {
+    return false;
+  }
+
+  const uint64_t bytes = word & mask;
+  value = static_cast<uint32_t>((bytes & 0x7F) | ((bytes >> 1) & 0x3F80) |
+                                ((bytes >> 2) & 0x1FC000) | ((bytes >> 3) & 0xFE00000) |
+                                ((bytes >> 4) & 0xF0000000));
+  idx += length;
+  return true;
+}
+
+// Int of either encoding at idx. Returns false, if there is no int.
+inline bool ReadWireInt(const char* data, size_t size, size_t& idx, int& value) {
+  if (idx >= size) {
+    return false;
+  }
+  const auto tag = static_cast<uint8_t>(data[idx]);
+  if (tag == 'i') {
+    if (idx + 1 + sizeof(int) > size) {
+      return false;
+    }
+    std::memcpy(&value, data + idx + 1, sizeof(int));
+    idx += 1 + sizeof(int);
+    return true;
+  }
+  if (tag >= kSmallIntTag && tag < kSmallIntTag + kSmallIntLimit) {
+    value = DecodeZigZag(tag - kSmallIntTag);
+    ++idx;
+    return true;
+  }
+  size_t varint_idx = idx + 1;
+  uint32_t zigzag = 0;
+  if (tag != kCompactIntTag || !ReadVarint(data, size, varint_idx, zigzag)) {
+    return false;
+  }
+  value = DecodeZigZag(zigzag);
+  idx = varint_idx;
+  return true;
+}
+
+// Length of the string of either encoding at idx - idx is moved to its characters. Returns
+// false, if there is no string header.
+inline bool ReadWireStringSize(const char* data, size_t size, size_t& idx, size_t& length) {
+  if (idx >= size) {
+    return false;
+  }
+  const auto tag = static_cast<uint8_t>(data[idx]);
+  size_t header_idx = idx + 1;
+  if (tag == 's') {
+    int fixed_length = 0;
+    if (!ReadWireInt(data, size, header_idx, fixed_length) || fixed_length < 0) {
+      return false;
+    }
+    length = static_cast<size_t>(fixed_length);
+  } else if (tag >= kShortStringTag && tag < kShortStringTag + kShortStringLimit) {
+    length = tag - kShortStringTag;
+  } else {
+    uint32_t varint = 0;
+    if (tag != kCompactStringTag || !ReadVarint(data, size, header_idx, varint)) {
+      return false;
+    }
+    length = varint;
+  }
+  if (header_idx + length > size) {
+    return false;
+  }
+  idx = header_idx;
+  return true;
+}
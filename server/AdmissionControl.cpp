@@ -0,0 +1,38 @@
+#include "AdmissionControl.h"
+
+#include <algorithm>
+
+AdmissionControl::AdmissionControl(std::chrono::microseconds target,
+                                   std::chrono::microseconds interval)
+    : target_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(target).count()),
+      interval_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::max(interval, target))
+                       .count()) {}
+
+bool AdmissionControl::Admit(uint64_t sent_ns, uint64_t now_ns) {
+  if (!IsEnabled()) {
+    return true;
+  }
+
+  const auto delay = GetDelay(sent_ns, now_ns);
+  auto first_above = first_above_ns_.load(std::memory_order_relaxed);
+  if (delay < target_ns_) {
+    // the store is skipped, while the delay is low, so the threads don't bounce the cache line
+    if (first_above != 0) {
+      first_above_ns_.store(0, std::memory_order_relaxed);
+    }
+    return true;
+  }
+  if (first_above == 0) {
+    // the other thread may have marked it meanwhile - then its time is kept
+    first_above_ns_.compare_exchange_strong(first_above, now_ns, std::memory_order_relaxed);
+    first_above = first_above != 0 ? first_above : now_ns;
+  }
+
+  const bool is_overloaded = now_ns - std::min(first_above, now_ns) > interval_ns_;
+  return delay <= (is_overloaded ? target_ns_ : interval_ns_);
+}
+
+uint32_t AdmissionControl::GetRetryAfter(uint64_t sent_ns, uint64_t now_ns) const {
+  return static_cast<uint32_t>(std::min(GetDelay(sent_ns, now_ns), interval_ns_) / 1000);
+}
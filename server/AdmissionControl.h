@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Adaptive admission of the requests by their queueing delay - the time from the send of the
+// request by the client till its execution. The variant of CoDel from Facebook's "Fail at Scale":
+// a queue, whose delay is below the target at least once per interval, is just absorbing a
+// burst, so the requests are admitted, unless they have waited longer than the interval. Once
+// the delay has stayed above the target for the whole interval, the server is overloaded and the
+// requests, which have waited longer than the target, are rejected - the server spends its time
+// only on the fresh ones, and the delay of the admitted requests (thus, their p99 latency) stays
+// bounded. The rejected requests are answered with the busy response (see RequestControl.h)
+// without execution.
+// The control is shared by all the connections - the server is overloaded as a whole, the queues
+// of the connections are just the parts of its queue. Admit() is lock-free.
+class AdmissionControl {
+ public:
+  // target - zero disables the control, every request is admitted.
+  AdmissionControl(std::chrono::microseconds target, std::chrono::microseconds interval);
+
+  inline bool IsEnabled() const { return target_ns_ != 0; }
+
+  // Records the delay of the request, which was sent (or read) at sent_ns, and returns whether
+  // it should be executed.
+  bool Admit(uint64_t sent_ns, uint64_t now_ns);
+  // Microseconds, after which the client should retry the rejected request: the queue needs
+  // about as long as the request has waited to drain, but not longer than the interval.
+  uint32_t GetRetryAfter(uint64_t sent_ns, uint64_t now_ns) const;
+
+ private:
+  static inline uint64_t GetDelay(uint64_t sent_ns, uint64_t now_ns) {
+    return now_ns > sent_ns ? now_ns - sent_ns : 0;
+  }
+
+ private:
+  const uint64_t target_ns_;
+  const uint64_t interval_ns_;
+  // when the delay went above the target, 0 - it's below it
+  std::atomic<uint64_t> first_above_ns_ = 0;
+};
@@ -1,12 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "ProfiledMutex.h"
+#include "RegistrySnapshot.h"
 #include "Types.h"
+#include "WriteAheadLog.h"
 
 // Manager of custom class instances.
 // In future, would be better to remove signleton pattern!
+//
+// When a WriteAheadLog is attached, creates, mutations and destroys are recorded to it as
+// the serialized state of the instance (Type::Serialize), so the registry can be rebuilt after
+// restart via Restore(). A record is enqueued under the lock, which orders the change itself
+// (the lock of the handle, or the registry lock for creates), so the log order is the order the
+// changes were applied in. Waiting for the flush is performed outside of all locks, so
+// concurrent requests can share one group commit of the log.
+//
+// The registry can also be backed by the mapped SnapshotFile: instances from the snapshot are
+// served directly from the mapped memory and materialized (deserialized into instances_) only
+// when they are about to be mutated - see GetForWrite().
 template <class Type>
 class ClassRegistry {
  public:
@@ -15,17 +35,107 @@ class ClassRegistry {
   template <typename... Args>
   ClassHandle Create(Args... args);
 
+  // Whether the instance exists (either materialized or in the snapshot).
+  bool Contains(ClassHandle handle) const;
+
+  // Same as GetForWrite, kept for the existing callers.
   std::weak_ptr<Type> GetClassObjectByHandle(ClassHandle handle);
 
+  // Calls reader(const Type&) on the instance under the lock of its handle, so it doesn't see
+  // the instance in the middle of a mutation. Instances from the snapshot are deserialized into a
+  // temporary object, which is not stored in the registry.
+  // Returns false if there is no such instance.
+  template <class Reader>
+  bool Read(ClassHandle handle, Reader&& reader);
+
+  // Instance, which can be mutated. Materializes the instance from the snapshot and, while a
+  // new snapshot is being written, makes a private copy of the instance captured by it.
+  // NOTE: the change isn't logged and isn't ordered with the others - use Mutate() for that.
+  std::shared_ptr<Type> GetForWrite(ClassHandle handle);
+
+  // Calls mutation(Type&) on the instance under the lock of its handle and, if it returns true,
+  // records the new state of the instance to the log under the same lock.
+  // Returns false if there is no such instance.
+  template <class Mutation>
+  bool Mutate(ClassHandle handle, Mutation&& mutation);
+
+  // Serialized state of the instance. Instances from the snapshot are not deserialized at all.
+  std::pair<bool, std::string> GetSerialized(ClassHandle handle);
+
+  // Number of instances (both materialized and in the snapshot).
+  size_t GetInstancesCount() const;
+
+  // Removes the instance from the registry. Returns false if there is no such instance.
+  bool Destroy(ClassHandle handle);
+
+  // Sharded mode: new handles are allocated only from the partition of the shard, i.e.
+  // handle % shards_count == shard_index. Should be called before AttachSnapshot() and Restore().
+  void SetHandlePartition(size_t shard_index, size_t shards_count);
+
+  // Attach (or detach with nullptr) the log of mutations.
+  void AttachLog(std::shared_ptr<WriteAheadLog> log);
+
+  // Use the mapped snapshot as a base of the registry. Should be called before Restore().
+  void AttachSnapshot(std::shared_ptr<const SnapshotFile> snapshot);
+
+  // Applies the record read from the log. Doesn't log anything.
+  void Restore(const WalRecord& record);
+
+  // Writes all the instances into the slot of the snapshot at path, which isn't the base.
+  // Requests are not blocked while the snapshot is written: the registry lock is held only to
+  // capture the view, and mutations of captured instances are made on copies (copy-on-write).
+  // A mutation, which got the instance before the view was captured, may still be in progress,
+  // thus, each instance is serialized under the lock of its handle.
+  // The written snapshot becomes the base, so the next one overwrites the older slot, and the
+  // newest complete snapshot is never overwritten. The log is truncated only up to the LSN of
+  // the older snapshot, so a crash while the next one is written can't lose the records.
+  bool WriteSnapshot(const std::string& path);
+
+ private:
+  struct Entry {
+    std::shared_ptr<Type> instance;
+    // Snapshot epoch, when the instance was created (or copied) - instances from older epochs
+    // may be referenced by the snapshot in progress.
+    uint64_t epoch = 0;
+  };
+
  private:
   ClassRegistry() = default;
 
+  std::shared_ptr<WriteAheadLog> GetLog() const;
+  std::mutex& GetHandleMutex(ClassHandle handle);
+
+  // Should be called under the lock:
+  bool IsInSnapshot(ClassHandle handle) const;
+  bool FindInSnapshot(ClassHandle handle, std::string_view& blob) const;
+
  private:
   // This class can be accessible from different Client threads. Thus, need to
   // provide a synchronization!
-  mutable std::mutex mutex_;
-  ClassHandle handle_counter_;
-  std::unordered_map<ClassHandle, std::shared_ptr<Type>> instances_;
+  mutable ProfiledMutex mutex_{"ClassRegistry::mutex_"};
+  ClassHandle handle_counter_ = 0;
+  ClassHandle handle_step_ = 1;
+  std::unordered_map<ClassHandle, Entry> instances_;
+  std::shared_ptr<WriteAheadLog> log_;
+
+  // Locks of the handles (striped) - mutations and destroys of a handle are applied and logged
+  // under its lock. The lock order: the lock of a handle, then mutex_.
+  std::array<std::mutex, 64> handle_mutexes_;
+
+  // Base snapshot and handles destroyed since it was taken:
+  std::shared_ptr<const SnapshotFile> snapshot_;
+  std::unordered_set<ClassHandle> destroyed_;
+
+  // Copy-on-write state of the snapshot in progress:
+  uint64_t epoch_ = 0;
+  bool is_snapshot_in_progress_ = false;
+  // handles destroyed while the snapshot is written - they may be in the written snapshot
+  std::unordered_set<ClassHandle> destroyed_in_snapshot_;
+
+  // Only one snapshot at a time:
+  std::mutex snapshot_mutex_;
+  uint64_t snapshot_sequence_ = 0;
+  int snapshot_slot_ = 1;
 };
 
 template <class Type>
@@ -38,22 +148,349 @@ template <class Type>
 template <typename... Args>
 ClassHandle ClassRegistry<Type>::Create(Args... args) {
   auto instance = std::make_shared<Type>(args...);
+  auto log = GetLog();
+  // nobody else sees the instance yet, thus, it is serialized outside of the lock
+  const auto payload = log ? instance->Serialize() : std::string{};
+  ClassHandle handle = -1;
+  uint64_t lsn = 0;
   {
-    std::lock_guard<std::mutex> locker(mutex_);
-    const auto handle = handle_counter_++;
+    std::lock_guard<ProfiledMutex> locker(mutex_);
+    handle = handle_counter_;
+    handle_counter_ += handle_step_;
 
-    instances_.insert({handle, instance});
-    return handle;
+    instances_.insert({handle, Entry{instance, epoch_}});
+    // the instance can be mutated as soon as the lock is released - its create goes first
+    if (log) {
+      lsn = log->Enqueue(WalRecordType::Create, handle, payload);
+    }
   }
+
+  if (lsn != 0) {
+    log->WaitForDurability(lsn);
+  }
+  return handle;
+}
+
+template <class Type>
+bool ClassRegistry<Type>::Contains(ClassHandle handle) const {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  return instances_.count(handle) > 0 || IsInSnapshot(handle);
 }
 
 template <class Type>
 std::weak_ptr<Type> ClassRegistry<Type>::GetClassObjectByHandle(ClassHandle handle) {
-  std::lock_guard<std::mutex> locker(mutex_);
+  return GetForWrite(handle);
+}
+
+template <class Type>
+template <class Reader>
+bool ClassRegistry<Type>::Read(ClassHandle handle, Reader&& reader) {
+  // the instance isn't read in the middle of a mutation
+  std::lock_guard<std::mutex> handle_locker(GetHandleMutex(handle));
+  std::shared_ptr<const Type> instance;
+  std::string_view blob;
+  // keeps the blob mapped even if another snapshot is attached meanwhile
+  std::shared_ptr<const SnapshotFile> snapshot;
+  {
+    std::lock_guard<ProfiledMutex> locker(mutex_);
+    auto iter = instances_.find(handle);
+    if (iter != instances_.end()) {
+      instance = iter->second.instance;
+    } else if (FindInSnapshot(handle, blob)) {
+      snapshot = snapshot_;
+    } else {
+      return false;
+    }
+  }
+
+  if (instance) {
+    reader(*instance);
+  } else {
+    // the mapped memory is immutable - no need to hold the registry lock
+    const Type temporary = Type::Deserialize(std::string(blob));
+    reader(temporary);
+  }
+  return true;
+}
+
+template <class Type>
+std::shared_ptr<Type> ClassRegistry<Type>::GetForWrite(ClassHandle handle) {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
   auto iter = instances_.find(handle);
-  if (iter == instances_.end()) {
-    return std::weak_ptr<Type>{};
+  if (iter != instances_.end()) {
+    auto& entry = iter->second;
+    if (is_snapshot_in_progress_ && entry.epoch < epoch_) {
+      // the snapshot in progress keeps the old instance
+      entry.instance = std::make_shared<Type>(*entry.instance);
+      entry.epoch = epoch_;
+    }
+    return entry.instance;
+  }
+
+  std::string_view blob;
+  if (!FindInSnapshot(handle, blob)) {
+    return nullptr;
+  }
+
+  auto instance = std::make_shared<Type>(Type::Deserialize(std::string(blob)));
+  instances_.insert({handle, Entry{instance, epoch_}});
+  return instance;
+}
+
+template <class Type>
+template <class Mutation>
+bool ClassRegistry<Type>::Mutate(ClassHandle handle, Mutation&& mutation) {
+  std::unique_lock<std::mutex> handle_locker(GetHandleMutex(handle));
+  auto instance = GetForWrite(handle);
+  if (!instance) {
+    return false;
+  }
+  if (!mutation(*instance)) {
+    return true;
+  }
+
+  auto log = GetLog();
+  if (!log) {
+    return true;
+  }
+  const auto lsn = log->Enqueue(WalRecordType::Mutate, handle, instance->Serialize());
+  handle_locker.unlock();
+
+  if (lsn != 0) {
+    log->WaitForDurability(lsn);
+  }
+  return true;
+}
+
+template <class Type>
+std::pair<bool, std::string> ClassRegistry<Type>::GetSerialized(ClassHandle handle) {
+  // the instance isn't serialized in the middle of a mutation
+  std::lock_guard<std::mutex> handle_locker(GetHandleMutex(handle));
+  std::shared_ptr<Type> instance;
+  {
+    std::lock_guard<ProfiledMutex> locker(mutex_);
+    auto iter = instances_.find(handle);
+    if (iter != instances_.end()) {
+      instance = iter->second.instance;
+    } else {
+      std::string_view blob;
+      if (!FindInSnapshot(handle, blob)) {
+        return std::make_pair(false, std::string{});
+      }
+      return std::make_pair(true, std::string(blob));
+    }
+  }
+  return std::make_pair(true, instance->Serialize());
+}
+
+template <class Type>
+size_t ClassRegistry<Type>::GetInstancesCount() const {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  // destroyed_ contains only the handles from the snapshot
+  size_t count = snapshot_ ? snapshot_->GetRecordsCount() - destroyed_.size() : 0;
+  for (const auto& [handle, entry] : instances_) {
+    if (!IsInSnapshot(handle)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+template <class Type>
+bool ClassRegistry<Type>::Destroy(ClassHandle handle) {
+  // a mutation in progress is logged before the destroy
+  std::unique_lock<std::mutex> handle_locker(GetHandleMutex(handle));
+  std::shared_ptr<WriteAheadLog> log;
+  {
+    std::lock_guard<ProfiledMutex> locker(mutex_);
+    const bool in_snapshot = IsInSnapshot(handle);
+    if (in_snapshot) {
+      destroyed_.insert(handle);
+    }
+    if (instances_.erase(handle) == 0 && !in_snapshot) {
+      return false;
+    }
+    if (is_snapshot_in_progress_) {
+      destroyed_in_snapshot_.insert(handle);
+    }
+    log = log_;
+  }
+
+  if (!log) {
+    return true;
+  }
+  const auto lsn = log->Enqueue(WalRecordType::Destroy, handle, std::string{});
+  handle_locker.unlock();
+
+  if (lsn != 0) {
+    log->WaitForDurability(lsn);
+  }
+  return true;
+}
+
+template <class Type>
+void ClassRegistry<Type>::SetHandlePartition(size_t shard_index, size_t shards_count) {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  handle_step_ = static_cast<ClassHandle>(std::max<size_t>(shards_count, 1));
+  // the first handle of the partition, which is not less than the current counter
+  const auto shard = static_cast<ClassHandle>(shard_index) % handle_step_;
+  handle_counter_ += (shard - handle_counter_ % handle_step_ + handle_step_) % handle_step_;
+}
+
+template <class Type>
+void ClassRegistry<Type>::AttachLog(std::shared_ptr<WriteAheadLog> log) {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  log_ = std::move(log);
+}
+
+template <class Type>
+void ClassRegistry<Type>::AttachSnapshot(std::shared_ptr<const SnapshotFile> snapshot) {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  snapshot_ = std::move(snapshot);
+  destroyed_.clear();
+  if (snapshot_) {
+    handle_counter_ = std::max(handle_counter_, snapshot_->GetNextHandle());
+    snapshot_sequence_ = std::max(snapshot_sequence_, snapshot_->GetSequence());
+    snapshot_slot_ = snapshot_->GetSlot();
+  }
+}
+
+template <class Type>
+void ClassRegistry<Type>::Restore(const WalRecord& record) {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  switch (record.type) {
+    case WalRecordType::Create:
+    case WalRecordType::Mutate:
+      instances_[record.handle] =
+          Entry{std::make_shared<Type>(Type::Deserialize(record.payload)), epoch_};
+      destroyed_.erase(record.handle);
+      break;
+    case WalRecordType::Destroy:
+      instances_.erase(record.handle);
+      if (snapshot_ && snapshot_->Contains(record.handle)) {
+        destroyed_.insert(record.handle);
+      }
+      break;
+  }
+  handle_counter_ = std::max(handle_counter_, record.handle + handle_step_);
+}
+
+template <class Type>
+bool ClassRegistry<Type>::WriteSnapshot(const std::string& path) {
+  std::lock_guard<std::mutex> snapshot_locker(snapshot_mutex_);
+
+  // The LSN has to be captured before the view: every record up to it was appended after its
+  // change was applied to the registry, thus, the change is visible in the view. Records after
+  // it are replayed on top of the snapshot (replay is idempotent).
+  auto log = GetLog();
+  const uint64_t wal_lsn = log ? log->GetLastLsn() : 0;
+
+  std::vector<std::pair<ClassHandle, std::shared_ptr<Type>>> materialized;
+  std::shared_ptr<const SnapshotFile> base;
+  std::unordered_set<ClassHandle> destroyed;
+  ClassHandle next_handle = 0;
+  {
+    std::lock_guard<ProfiledMutex> locker(mutex_);
+    ++epoch_;
+    is_snapshot_in_progress_ = true;
+
+    materialized.reserve(instances_.size());
+    for (const auto& [handle, entry] : instances_) {
+      materialized.emplace_back(handle, entry.instance);
+    }
+    base = snapshot_;
+    destroyed = destroyed_;
+    next_handle = handle_counter_;
+  }
+
+  std::sort(materialized.begin(), materialized.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+  // never overwrite the slot, which is mapped as a base - it holds the newest snapshot
+  snapshot_slot_ = base ? 1 - base->GetSlot() : 1 - snapshot_slot_;
+  const auto sequence = ++snapshot_sequence_;
+
+  // Merge the base snapshot with materialized instances - both are sorted by handle.
+  SnapshotWriter writer(GetSnapshotSlotPath(path, snapshot_slot_));
+  bool success = writer.Begin();
+  const size_t base_count = base ? base->GetRecordsCount() : 0;
+  size_t base_idx = 0;
+  size_t materialized_idx = 0;
+  while (success && (base_idx < base_count || materialized_idx < materialized.size())) {
+    const bool take_base =
+        materialized_idx == materialized.size() ||
+        (base_idx < base_count &&
+         base->GetRecord(base_idx).handle < materialized[materialized_idx].first);
+    if (take_base) {
+      const auto& record = base->GetRecord(base_idx++);
+      if (destroyed.count(record.handle) == 0) {
+        success = writer.Add(record.handle, base->GetBlob(record));
+      }
+    } else {
+      const auto& [handle, instance] = materialized[materialized_idx++];
+      // materialized instance overrides its stale version in the base
+      if (base_idx < base_count && base->GetRecord(base_idx).handle == handle) {
+        ++base_idx;
+      }
+      std::string blob;
+      {
+        std::lock_guard<std::mutex> handle_locker(GetHandleMutex(handle));
+        blob = instance->Serialize();
+      }
+      success = writer.Add(handle, blob);
+    }
   }
+  success = success && writer.Finish(sequence, wal_lsn, next_handle);
+  std::shared_ptr<const SnapshotFile> written =
+      success ? SnapshotFile::Open(GetSnapshotSlotPath(path, snapshot_slot_), snapshot_slot_)
+              : nullptr;
 
-  return iter->second;
-}
\ No newline at end of file
+  {
+    std::lock_guard<ProfiledMutex> locker(mutex_);
+    is_snapshot_in_progress_ = false;
+    if (written) {
+      // The written snapshot becomes the base. The handles destroyed after the view was captured
+      // may be in it, the ones destroyed before are not.
+      destroyed_.insert(destroyed_in_snapshot_.begin(), destroyed_in_snapshot_.end());
+      std::unordered_set<ClassHandle> still_destroyed;
+      for (const auto handle : destroyed_) {
+        if (written->Contains(handle)) {
+          still_destroyed.insert(handle);
+        }
+      }
+      snapshot_ = written;
+      destroyed_ = std::move(still_destroyed);
+    }
+    destroyed_in_snapshot_.clear();
+  }
+
+  // The records up to the older snapshot, which is still on disk, won't be replayed anymore.
+  // The ones after it are kept, so the next snapshot can overwrite it.
+  if (written && log && base) {
+    log->Truncate(base->GetWalLsn());
+  }
+  return written != nullptr;
+}
+
+template <class Type>
+std::shared_ptr<WriteAheadLog> ClassRegistry<Type>::GetLog() const {
+  std::lock_guard<ProfiledMutex> locker(mutex_);
+  return log_;
+}
+
+template <class Type>
+std::mutex& ClassRegistry<Type>::GetHandleMutex(ClassHandle handle) {
+  // Fibonacci hashing - the handles of a shard (handle % shards_count) still use all the locks
+  const auto hash = static_cast<uint32_t>(handle) * 2654435769u;
+  return handle_mutexes_[(hash >> 26) % handle_mutexes_.size()];
+}
+
+template <class Type>
+bool ClassRegistry<Type>::IsInSnapshot(ClassHandle handle) const {
+  return snapshot_ && destroyed_.count(handle) == 0 && snapshot_->Contains(handle);
+}
+
+template <class Type>
+bool ClassRegistry<Type>::FindInSnapshot(ClassHandle handle, std::string_view& blob) const {
+  return snapshot_ && destroyed_.count(handle) == 0 && snapshot_->Find(handle, blob);
+}
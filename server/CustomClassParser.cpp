@@ -5,6 +5,8 @@
 #include "DataDeserializer.h"
 #include "DataSerializer.h"
 #include "Logger.h"
+#include "ServerMetrics.h"
+#include "Tracer.h"
 
 const std::string CustomClassParser::kClassName = typeid(CustomClass).name();
 
@@ -13,55 +15,73 @@ static const std::string kPrintToStringMethodName = "PrintToString";
 static const std::string kSetIntegerValMethodName = "SetIntegerValue";
 static const std::string kSetStringValueMethodName = "SetStringValue";
 
-static const auto kInvalidResponse = std::make_pair(false, ServerResponse{});
 static const auto kInvalidHandlePair = std::make_pair(false, -1);
 
 static constexpr auto kLogTag = "CustomClassParser";
 
-CustomClassParser::CustomClassParser(size_t client_id, RequestId request_id)
-    : client_id_(client_id), request_id_(request_id) {}
+// The callbacks of the responses only log the result, thus, they aren't created (and don't
+// allocate), when the debug messages aren't logged.
+static bool IsDebugLogged() {
+#if NAMEDPIPE_MIN_LOG_LEVEL <= NAMEDPIPE_LOG_LEVEL_DEBUG
+  return Logger::IsEnabled(LogLevel::Debug);
+#else
+  return false;
+#endif
+}
+
+CustomClassParser::CustomClassParser(size_t client_id, RequestId request_id,
+                                     WireEncoding encoding)
+    : client_id_(client_id), request_id_(request_id), encoding_(encoding) {}
 
-std::pair<bool, ServerResponse> CustomClassParser::Parse(const RawDataType& data, size_t& idx) {
-  if (data.empty() || data[idx++] != '#') {
-    return kInvalidResponse;
+bool CustomClassParser::Parse(const RawDataType& data, size_t& idx, ServerResponse& response) {
+  if (data.size() <= idx || data[idx++] != '#') {
+    return false;
   }
 
-  // Check that class name is the same as the CustomClass:
-  if (auto [success, str] = RegularTypeParaser::Parse<std::string>(data, idx); success) {
-    if (str != kClassName) {
-      return kInvalidResponse;
-    }
-  } else {
-    return kInvalidResponse;
+  // Check that class name is the same as the CustomClass (without copying it):
+  if (auto [success, str] = RegularTypeParaser::Parse<std::string_view>(data, idx);
+      !success || str != kClassName) {
+    return false;
   }
 
+  auto& response_data = response.GetMutableData();
   // perform actual checking the command:
   if (auto [success, handle] = ParseCreateClass(data, idx); success) {
-    return std::make_pair(true, CreateServerResponseOnCreateClassRequest(handle));
+    DataSerializer::AppendToRawData<ClassHandle>(response_data, handle, encoding_);
+    SetCallbacksOnCreateClass(handle, response);
+    return true;
+  }
+  // Bulk commands don't address a specific instance:
+  if (ParseCountInstances(data, idx, response_data)) {
+    return true;
   }
+
   // All other commands requires to use the instance handle:
-  auto [handle, instance] = GetClassInstaceFromRequest(data, idx);
-  if (!instance) {
-    Logger::LogError(Logger::to_string(
-        std::stringstream() << kLogTag << ": [client=" << client_id_ << ", request=" << request_id_
-                            << "] ERROR - invalid handle of CustomClass=" << handle << "!"));
-    return kInvalidResponse;
+  auto handle = RegularTypeParaser::Parse<ClassHandle>(data, idx).second;
+  bool contains = false;
+  {
+    const TraceSpan registry_span("server.registry");
+    contains = ClassRegistry<CustomClass>::GetInstance().Contains(handle);
+  }
+  if (!contains) {
+    LogInvalidHandle(handle);
+    return false;
   }
 
   // Try to parse method call (#m keyword)
-  if (auto [success, response_data, method_name] = ParseMethodCall(*instance.get(), data, idx);
-      success) {
-    return std::make_pair(true,
-                          CreateServerResponseOnMethodCall(handle, response_data, method_name));
-  } else if (auto [success, response_data] = ParseGetInstance(*instance.get(), data, idx);
-             success) {
-    return std::make_pair(true, ServerResponse(response_data, nullptr, nullptr));
+  if (auto [success, method_name] = ParseMethodCall(handle, data, idx, response_data); success) {
+    SetCallbacksOnMethodCall(handle, method_name, response);
+    return true;
+  } else if (ParseGetInstance(handle, data, idx, response_data)) {
+    return true;
+  } else if (ParseDestroyInstance(handle, data, idx, response_data)) {
+    return true;
   }
 
   Logger::LogError(Logger::to_string(std::stringstream()
                                      << kLogTag << ": [client=" << client_id_ << ", request="
                                      << request_id_ << "] ERROR - Cannot process the request!"));
-  return std::make_pair(true, ServerResponse{});
+  return true;
 }
 
 std::pair<bool, ClassHandle> CustomClassParser::ParseCreateClass(const RawDataType& data,
@@ -71,6 +91,8 @@ std::pair<bool, ClassHandle> CustomClassParser::ParseCreateClass(const RawDataTy
   if (data.size() < tmp_idx + 2 || (data[tmp_idx++] != '#' || data[tmp_idx++] != 'c')) {
     return kInvalidHandlePair;
   }
+  StageTimer timer(MetricsStage::Create);
+  const TraceSpan execute_span("server.execute");
 
   // no attributes given - call default ctor
   if (data.size() == tmp_idx) {
@@ -113,67 +135,134 @@ std::pair<bool, ClassHandle> CustomClassParser::ParseCreateClass(const RawDataTy
   return kInvalidHandlePair;
 }
 
-std::tuple<bool, RawDataType, std::string> CustomClassParser::ParseMethodCall(
-    CustomClass& instance, const RawDataType& data, size_t& seek_idx) {
+std::pair<bool, std::string_view> CustomClassParser::ParseMethodCall(
+    ClassHandle handle, const RawDataType& data, size_t& seek_idx, RawDataType& response_data) {
   size_t tmp_idx = seek_idx;
   if (!IsMethodCall(data, tmp_idx)) {
-    return std::make_tuple(false, RawDataType{}, std::string{});
+    return std::make_pair(false, std::string_view{});
   }
 
   seek_idx = tmp_idx;
 
   // Get actual method name:
-  auto [success, method_name] = RegularTypeParaser::Parse<std::string>(data, seek_idx);
+  auto [success, method_name] = RegularTypeParaser::Parse<std::string_view>(data, seek_idx);
   if (!success) {
     Logger::LogError(Logger::to_string(
         std::stringstream() << kLogTag << ": [client=" << client_id_ << ", request=" << request_id_
                             << "] ERROR - can't parse the method's name!"));
-    return std::make_tuple(true, RawDataType{}, std::string{});
+    return std::make_pair(true, std::string_view{});
   }
 
-  if (method_name == kPrintToCoutMethodName) {
-    ParsePrintToCoutCall(instance);
-    return std::make_tuple(true, RawDataType{}, kPrintToCoutMethodName);
-  } else if (method_name == kPrintToStringMethodName) {
-    auto ret = ParsePrintToStringCall(instance);
-    auto data = DataSerializer::SerializeToRawData<std::string>(ret);
-    return std::make_tuple(true, data, kPrintToStringMethodName);
-  } else if (method_name == kSetIntegerValMethodName) {
-    auto ret = ParseSetIntegerValueMethodCall(instance, data, seek_idx);
+  auto& registry = ClassRegistry<CustomClass>::GetInstance();
+  if (IsMutatingMethod(method_name)) {
+    StageTimer timer(method_name == kSetIntegerValMethodName ? MetricsStage::SetIntegerValue
+                                                             : MetricsStage::SetStringValue);
+    const TraceSpan execute_span("server.execute");
     // TODO:
     // Check if ret.first is successfull. If not, return error
-    auto data = DataSerializer::SerializeToRawData<bool>(ret.second);
-    return std::make_tuple(ret.first, data, kSetIntegerValMethodName);
-  } else if (method_name == kSetStringValueMethodName) {
-    // TODO:
-    // Check if ret.first is successfull. If not, return error
-    auto ret = ParseSetStringValue(instance, data, seek_idx);
-    auto data = DataSerializer::SerializeToRawData<bool>(ret.second);
-    return std::make_tuple(ret.first, data, kSetIntegerValMethodName);
+    std::pair<bool, bool> ret(false, false);
+    // structured bindings can't be captured
+    const bool is_set_integer = method_name == kSetIntegerValMethodName;
+    // the new state is logged under the lock of the handle, in the order of the mutations
+    const bool found = registry.Mutate(handle, [&](CustomClass& instance) {
+      ret = is_set_integer ? ParseSetIntegerValueMethodCall(instance, data, seek_idx)
+                           : ParseSetStringValue(instance, data, seek_idx);
+      return ret.first;
+    });
+    if (!found) {
+      LogInvalidHandle(handle);
+      return std::make_pair(true, std::string_view{});
+    }
+    if (ret.first) {
+      DataSerializer::AppendToRawData<bool>(response_data, ret.second, encoding_);
+    }
+    return std::make_pair(ret.first, method_name);
+  }
+
+  // Const methods don't need to materialize the instance from the snapshot, and they are called
+  // under the lock of the handle, so they don't race with the mutations:
+  const TraceSpan execute_span("server.execute");
+  const bool is_print_to_cout = method_name == kPrintToCoutMethodName;
+  const bool is_print_to_string = method_name == kPrintToStringMethodName;
+  std::string printed;
+  const bool found = registry.Read(handle, [&](const CustomClass& instance) {
+    if (is_print_to_cout) {
+      StageTimer timer(MetricsStage::PrintToCout);
+      ParsePrintToCoutCall(instance);
+    } else if (is_print_to_string) {
+      StageTimer timer(MetricsStage::PrintToString);
+      printed = ParsePrintToStringCall(instance);
+    }
+  });
+  if (!found) {
+    LogInvalidHandle(handle);
+    return std::make_pair(true, std::string_view{});
   }
 
-  return std::make_tuple(true, RawDataType{}, std::string{});
+  if (is_print_to_string) {
+    DataSerializer::AppendToRawData<std::string>(response_data, printed, encoding_);
+  }
+  if (is_print_to_cout || is_print_to_string) {
+    return std::make_pair(true, method_name);
+  }
+  return std::make_pair(true, std::string_view{});
 }
 
-std::pair<bool, RawDataType> CustomClassParser::ParseGetInstance(CustomClass& instance,
-                                                                 const RawDataType& data,
-                                                                 size_t& seek_idx) {
+bool CustomClassParser::ParseGetInstance(ClassHandle handle, const RawDataType& data,
+                                         size_t& seek_idx, RawDataType& response_data) {
   size_t idx = seek_idx;
   // check for keyword get instance - 'g':
   if (data.size() < idx + 2 || (data[idx++] != '#' || data[idx++] != 'g')) {
-    return std::make_pair(false, RawDataType{});
+    return false;
   }
+  StageTimer timer(MetricsStage::Get);
+  const TraceSpan execute_span("server.execute");
 
-  std::string str = instance.Serialize();
-  RawDataType response_data = DataSerializer::SerializeToRawData(str);
-  return std::make_pair(true, std::move(response_data));
+  // Instances from the snapshot are returned as is, without deserialization
+  auto [success, str] = ClassRegistry<CustomClass>::GetInstance().GetSerialized(handle);
+  if (success) {
+    DataSerializer::AppendToRawData<std::string>(response_data, str, encoding_);
+  }
+  return true;
 }
 
-void CustomClassParser::ParsePrintToCoutCall(CustomClass& instance) {
+bool CustomClassParser::ParseCountInstances(const RawDataType& data, size_t& seek_idx,
+                                            RawDataType& response_data) {
+  size_t idx = seek_idx;
+  // check for keyword count instances - 'n':
+  if (data.size() < idx + 2 || (data[idx++] != '#' || data[idx++] != 'n')) {
+    return false;
+  }
+
+  seek_idx = idx;
+  StageTimer timer(MetricsStage::CountInstances);
+  const TraceSpan execute_span("server.execute");
+  const auto count = ClassRegistry<CustomClass>::GetInstance().GetInstancesCount();
+  DataSerializer::AppendToRawData<int>(response_data, static_cast<int>(count), encoding_);
+  return true;
+}
+
+bool CustomClassParser::ParseDestroyInstance(ClassHandle handle, const RawDataType& data,
+                                             size_t& seek_idx, RawDataType& response_data) {
+  size_t idx = seek_idx;
+  // check for keyword destroy instance - 'd':
+  if (data.size() < idx + 2 || (data[idx++] != '#' || data[idx++] != 'd')) {
+    return false;
+  }
+
+  seek_idx = idx;
+  StageTimer timer(MetricsStage::Destroy);
+  const TraceSpan execute_span("server.execute");
+  const bool destroyed = ClassRegistry<CustomClass>::GetInstance().Destroy(handle);
+  DataSerializer::AppendToRawData<bool>(response_data, destroyed, encoding_);
+  return true;
+}
+
+void CustomClassParser::ParsePrintToCoutCall(const CustomClass& instance) {
   return instance.PrintToCout();
 }
 
-std::string CustomClassParser::ParsePrintToStringCall(CustomClass& instance) {
+std::string CustomClassParser::ParsePrintToStringCall(const CustomClass& instance) {
   return instance.PrintToString();
 }
 
@@ -205,6 +294,16 @@ std::pair<bool, bool> CustomClassParser::ParseSetStringValue(CustomClass& instan
   return std::make_pair(true, ret);
 }
 
+void CustomClassParser::LogInvalidHandle(ClassHandle handle) const {
+  Logger::LogError(Logger::to_string(
+      std::stringstream() << kLogTag << ": [client=" << client_id_ << ", request=" << request_id_
+                          << "] ERROR - invalid handle of CustomClass=" << handle << "!"));
+}
+
+bool CustomClassParser::IsMutatingMethod(std::string_view method_name) {
+  return method_name == kSetIntegerValMethodName || method_name == kSetStringValueMethodName;
+}
+
 bool CustomClassParser::IsMethodCall(const RawDataType& data, size_t& seek_idx) {
   size_t tmp_idx = seek_idx;
   // verify that current operation is method call operation (#m)
@@ -215,57 +314,50 @@ bool CustomClassParser::IsMethodCall(const RawDataType& data, size_t& seek_idx)
   return true;
 }
 
-std::pair<ClassHandle, std::shared_ptr<CustomClass>> CustomClassParser::GetClassInstaceFromRequest(
-    const RawDataType& data, size_t& seek_idx) {
-  auto handle = RegularTypeParaser::Parse<ClassHandle>(data, seek_idx).second;
-  auto instance = ClassRegistry<CustomClass>::GetInstance().GetClassObjectByHandle(handle);
-  return std::make_pair(handle, instance.lock());
-}
-
-ServerResponse CustomClassParser::CreateServerResponseOnCreateClassRequest(ClassHandle handle) {
-  std::stringstream ss;
-  DataSerializer::Serialize<ClassHandle>(ss, handle);
-
-  std::string str = ss.str();
-  using IterType = decltype(str.begin());
-  auto data = RawDataType{std::move_iterator<IterType>(str.begin()),
-                          std::move_iterator<IterType>(str.end())};
+void CustomClassParser::SetCallbacksOnCreateClass(ClassHandle handle,
+                                                  ServerResponse& response) const {
+  if (!IsDebugLogged()) {
+    return;
+  }
 
   auto req_id = request_id_;
   auto success_callback = [req_id, handle](ServerResponse::ClientId client_id) {
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << "Successfully sent response to client=" << client_id
-                            << " on creating the class: " << handle << "; request_id=" << req_id));
+    NAMEDPIPE_LOG_DEBUG("Successfully sent response to client=" << client_id
+                        << " on creating the class: " << handle << "; request_id=" << req_id);
   };
 
   auto failure_callback = [req_id, handle](ServerResponse::ClientId client_id,
                                            ServerResponse::ErrorCode error) {
-    Logger::LogDebug(Logger::to_string(std::stringstream()
-                                       << "Failed to send response to client=" << client_id
-                                       << " on creating the class: " << handle
-                                       << ", error=" << error << "; request_id=" << req_id));
+    NAMEDPIPE_LOG_DEBUG("Failed to send response to client=" << client_id
+                        << " on creating the class: " << handle << ", error=" << error
+                        << "; request_id=" << req_id);
   };
 
-  return ServerResponse(data, success_callback, failure_callback);
+  response.SetCallbacks(success_callback, failure_callback);
 }
 
-ServerResponse CustomClassParser::CreateServerResponseOnMethodCall(
-    ClassHandle handle, RawDataType data, const std::string& method_name) {
+void CustomClassParser::SetCallbacksOnMethodCall(ClassHandle handle, std::string_view method_name,
+                                                 ServerResponse& response) const {
+  if (!IsDebugLogged()) {
+    return;
+  }
+
+  // the name refers to the request data, which is reused for the next request
   auto req_id = request_id_;
-  auto success_callback = [req_id, handle, method_name](ServerResponse::ClientId client_id) {
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << "Successfully sent response to client=" << client_id
-                            << " on call method=" << method_name
-                            << " on class with handle=" << handle << "; request_id=" << req_id));
+  auto success_callback = [req_id, handle, method_name = std::string(method_name)](
+                              ServerResponse::ClientId client_id) {
+    NAMEDPIPE_LOG_DEBUG("Successfully sent response to client=" << client_id
+                        << " on call method=" << method_name << " on class with handle="
+                        << handle << "; request_id=" << req_id);
   };
 
-  auto failure_callback = [req_id, handle, method_name](ServerResponse::ClientId client_id,
-                                                        ServerResponse::ErrorCode error) {
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << "Failed to send response to client=" << client_id
-                            << " on call method=" << method_name << " on class with handle="
-                            << handle << ", error=" << error << "; request_id=" << req_id));
+  auto failure_callback = [req_id, handle, method_name = std::string(method_name)](
+                              ServerResponse::ClientId client_id,
+                              ServerResponse::ErrorCode error) {
+    NAMEDPIPE_LOG_DEBUG("Failed to send response to client=" << client_id << " on call method="
+                        << method_name << " on class with handle=" << handle << ", error="
+                        << error << "; request_id=" << req_id);
   };
 
-  return ServerResponse(data, success_callback, failure_callback);
-}
\ No newline at end of file
+  response.SetCallbacks(success_callback, failure_callback);
+}
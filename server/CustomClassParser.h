@@ -1,7 +1,7 @@
 #pragma once
 
 #include <any>
-#include <tuple>
+#include <string_view>
 #include <typeinfo>
 #include <utility>
 
@@ -12,30 +12,40 @@
 // Class to parse the raw data of CustomClass object
 class CustomClassParser {
  public:
-  CustomClassParser(size_t client_id, RequestId request);
+  // The results are serialized in the encoding of the request.
+  CustomClassParser(size_t client_id, RequestId request,
+                    WireEncoding encoding = WireEncoding::Fixed);
 
-  std::pair<bool, ServerResponse> Parse(const RawDataType& data, size_t& idx);
+  // Parses the CustomClass command and serializes its result into the response.
+  // Returns false, if the data isn't a valid CustomClass command.
+  bool Parse(const RawDataType& data, size_t& idx, ServerResponse& response);
 
   std::pair<bool, ClassHandle> ParseCreateClass(const RawDataType& data, size_t& seek_idx);
 
-  // Return type - {success of operation, return value of method call, method
-  // call name}
-  std::tuple<bool, RawDataType, std::string> ParseMethodCall(CustomClass& instance,
-                                                             const RawDataType& data,
-                                                             size_t& seek_idx);
+  // Return type - {success of operation, method call name}. The return value of the method call
+  // is appended to the response_data, the name refers to the data.
+  std::pair<bool, std::string_view> ParseMethodCall(ClassHandle handle, const RawDataType& data,
+                                                    size_t& seek_idx, RawDataType& response_data);
 
   // Parse getting the object:
-  std::pair<bool, RawDataType> ParseGetInstance(CustomClass& instance, const RawDataType& data,
-                                                size_t& seek_idx);
+  bool ParseGetInstance(ClassHandle handle, const RawDataType& data, size_t& seek_idx,
+                        RawDataType& response_data);
+
+  // Parse counting all the instances (#n). Response - int, number of instances.
+  bool ParseCountInstances(const RawDataType& data, size_t& seek_idx, RawDataType& response_data);
+
+  // Parse destroying the object (#d). Response - bool, whether the instance was destroyed.
+  bool ParseDestroyInstance(ClassHandle handle, const RawDataType& data, size_t& seek_idx,
+                            RawDataType& response_data);
 
  public:
   static const std::string kClassName;
 
  private:
   // Methods to parse the method call request
-  void ParsePrintToCoutCall(CustomClass& instance);
+  void ParsePrintToCoutCall(const CustomClass& instance);
 
-  std::string ParsePrintToStringCall(CustomClass& instance);
+  std::string ParsePrintToStringCall(const CustomClass& instance);
 
   std::pair<bool, bool> ParseSetIntegerValueMethodCall(CustomClass& instance,
                                                        const RawDataType& data, size_t& seek_idx);
@@ -43,22 +53,24 @@ class CustomClassParser {
   std::pair<bool, bool> ParseSetStringValue(CustomClass& instance, const RawDataType& data,
                                             size_t& seek_idx);
 
+  void LogInvalidHandle(ClassHandle handle) const;
+
+  // Whether the method changes the state of the instance (thus, should be logged).
+  static bool IsMutatingMethod(std::string_view method_name);
+
   // Aux method to check whether next str request from data flow is actually
   // method call.
   bool IsMethodCall(const RawDataType& data, size_t& seek_idx);
 
-  // Aux method to parse the data from request into class handle (and pointer)
-  std::pair<ClassHandle, std::shared_ptr<CustomClass>> GetClassInstaceFromRequest(
-      const RawDataType& data, size_t& seek_idx);
-
  private:
-  // response data:
-  ServerResponse CreateServerResponseOnCreateClassRequest(ClassHandle handle);
+  // response callbacks:
+  void SetCallbacksOnCreateClass(ClassHandle handle, ServerResponse& response) const;
 
-  ServerResponse CreateServerResponseOnMethodCall(ClassHandle handle, RawDataType ret,
-                                                  const std::string& method_name);
+  void SetCallbacksOnMethodCall(ClassHandle handle, std::string_view method_name,
+                                ServerResponse& response) const;
 
  private:
   const size_t client_id_ = -1;
   const RequestId request_id_ = -1;
+  const WireEncoding encoding_ = WireEncoding::Fixed;
 };
\ No newline at end of file
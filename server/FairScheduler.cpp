@@ -0,0 +1,110 @@
+#include "FairScheduler.h"
+
+#include <algorithm>
+#include <iterator>
+
+FairScheduler::FairScheduler(FairSchedulerConfig config)
+    : config_(std::move(config)),
+      default_quantum_(config_.quantum != 0
+                           ? config_.quantum
+                           : (config_.cost == FairCost::Bytes ? kDefaultBytesQuantum : 1)),
+      free_slots_(config_.slots_count) {}
+
+void FairScheduler::AddConnection(uint64_t client_id, const std::string& client_name) {
+  if (!IsEnabled()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> locker(mutex_);
+  auto& client = clients_[client_id];
+  if (client.connections_count++ == 0) {
+    const auto iter = config_.client_quanta.find(client_name);
+    client.quantum = iter != config_.client_quanta.end() && iter->second != 0 ? iter->second
+                                                                             : default_quantum_;
+  }
+}
+
+void FairScheduler::RemoveConnection(uint64_t client_id) {
+  if (!IsEnabled()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> locker(mutex_);
+  const auto iter = clients_.find(client_id);
+  if (iter != clients_.end() && --iter->second.connections_count == 0) {
+    clients_.erase(iter);
+  }
+}
+
+void FairScheduler::Acquire(uint64_t client_id, size_t bytes, RequestPriority priority) {
+  if (!IsEnabled()) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> locker(mutex_);
+  auto& client = clients_[client_id];
+  if (client.quantum == 0) {
+    // the connection wasn't added - the client gets the default quantum
+    client.quantum = default_quantum_;
+  }
+  Waiter waiter;
+  waiter.cost = config_.cost == FairCost::Bytes ? std::max<size_t>(bytes, 1) : 1;
+  const auto index = static_cast<size_t>(priority);
+  auto& waiters = client.waiters[index];
+  waiters.push_back(&waiter);
+  if (waiters.size() == 1) {
+    // the client joins the round - in its turn, if its credit still covers the request
+    if (client.deficit >= waiter.cost) {
+      rounds_[index].push_front(client_id);
+    } else {
+      rounds_[index].push_back(client_id);
+    }
+  }
+  Dispatch();
+  waiter.cv.wait(locker, [&waiter] { return waiter.is_granted; });
+}
+
+void FairScheduler::Release() {
+  if (!IsEnabled()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> locker(mutex_);
+  ++free_slots_;
+  Dispatch();
+}
+
+void FairScheduler::Dispatch() {
+  while (free_slots_ > 0) {
+    const auto round = std::find_if(rounds_.begin(), rounds_.end(),
+                                    [](const auto& clients) { return !clients.empty(); });
+    if (round == rounds_.end()) {
+      break;
+    }
+    const auto client_id = round->front();
+    auto& client = clients_[client_id];
+    auto& waiters = client.waiters[std::distance(rounds_.begin(), round)];
+    auto* waiter = waiters.front();
+    if (client.deficit < waiter->cost) {
+      // The turn is over: the credit is topped up for the next round. The large request
+      // collects the credit over a few rounds, while the small ones of the others are executed.
+      client.deficit += client.quantum;
+      round->pop_front();
+      round->push_back(client_id);
+      continue;
+    }
+
+    client.deficit -= waiter->cost;
+    waiters.pop_front();
+    waiter->is_granted = true;
+    --free_slots_;
+    waiter->cv.notify_one();
+    // the client stays in its turn, while its credit covers its next request
+    if (waiters.empty() || client.deficit < waiters.front()->cost) {
+      round->pop_front();
+      if (!waiters.empty()) {
+        round->push_back(client_id);
+      }
+    }
+  }
+}
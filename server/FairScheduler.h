@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "Types.h"
+
+// What a request costs in the FairScheduler.
+enum class FairCost : uint8_t {
+  Frames = 0,
+  // bytes of the request, so the clients, which send large values, get a proportionally smaller
+  // share of the requests
+  Bytes
+};
+
+struct FairSchedulerConfig {
+  // Requests, which are executed at once by all the connections. Zero - the scheduler is
+  // disabled, every connection executes its requests right away.
+  size_t slots_count = 0;
+  FairCost cost = FairCost::Frames;
+  // Credit, which a client gets per round: frames or bytes. Zero - one frame or the largest
+  // frame in bytes (see kDefaultBytesQuantum), so any request is executed in one round.
+  uint32_t quantum = 0;
+  // Quanta of the particular client programs - the file names of their executables in lower
+  // case, e.g. "namedpipeclient.exe" - which override the default one.
+  std::unordered_map<std::string, uint32_t> client_quanta;
+};
+
+// Deficit round robin of the requests of the clients over a limited number of execution slots.
+// A client is a process (see GetNamedPipeClientProcessId()) - all its connections share one
+// flow, so a client, which opens more connections (e.g. a ConnectionPool), doesn't get more of
+// the slots. Every connection reads its frames ahead into its own FrameQueue and waits in
+// Acquire() for a slot for its front request; the waiting requests of all the connections of a
+// client are its queue. The waiting clients are served in rounds: the client at the front of the
+// round gets its quantum of credit, if the credit doesn't cover the cost of its next request
+// yet, and is moved to the back of the round; otherwise, the cost is subtracted and the request
+// is executed. So a client, which floods the server, can take only its share of the slots - the
+// requests of the others wait at most one round, no matter how many requests the flooding client
+// has queued. The client, whose credit still covers its next request, stays in its turn at the
+// front of the round, so a client with a larger quantum gets proportionally more requests per
+// round.
+// NOTE: every connection has at most one request in the scheduler - it's executed by the thread
+// of the connection. Thus, a client takes at most as many slots at once as it has connections.
+// There is a round per priority of the requests, and a lower priority round is served only when
+// the higher ones are empty - so an urgent request waits only for the other urgent ones. The
+// credit of a client is shared by its rounds.
+class FairScheduler {
+ public:
+  static constexpr uint32_t kDefaultBytesQuantum = 4096;
+
+  explicit FairScheduler(FairSchedulerConfig config);
+
+  inline bool IsEnabled() const { return config_.slots_count != 0; }
+
+  // Adds the connection of the client to its flow - client_name is the file name of the
+  // executable of the client, which picks its quantum (empty - the default one).
+  void AddConnection(uint64_t client_id, const std::string& client_name);
+  // Forgets the client, once its last connection is removed.
+  void RemoveConnection(uint64_t client_id);
+
+  // Blocks till the request of the connection of the client gets a slot.
+  void Acquire(uint64_t client_id, size_t bytes,
+               RequestPriority priority = RequestPriority::Normal);
+  // Frees the slot of the executed request.
+  void Release();
+
+ private:
+  // Request of a connection, which waits for a slot.
+  struct Waiter {
+    uint64_t cost = 0;
+    bool is_granted = false;
+    std::condition_variable cv;
+  };
+
+  struct ClientState {
+    uint32_t quantum = 0;
+    uint64_t deficit = 0;
+    size_t connections_count = 0;
+    // waiting requests in the order of their arrival, a queue per priority
+    std::array<std::deque<Waiter*>, kRequestPrioritiesCount> waiters;
+  };
+
+  // Grants the free slots to the waiting clients. Should be called under the lock.
+  void Dispatch();
+
+ private:
+  const FairSchedulerConfig config_;
+  const uint32_t default_quantum_;
+
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, ClientState> clients_;
+  // waiting clients in the order of the round, a round per priority
+  std::array<std::deque<uint64_t>, kRequestPrioritiesCount> rounds_;
+  size_t free_slots_;
+};
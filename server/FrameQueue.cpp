@@ -0,0 +1,120 @@
+#include "FrameQueue.h"
+
+#include <sstream>
+#include "DataDeserializer.h"
+#include "Logger.h"
+#include "RequestControl.h"
+#include "Tracer.h"
+
+static constexpr auto kLogTag = "FrameQueue";
+
+FrameQueue::FrameQueue() : frames_(kMaxFrames) {
+  // the frame is read into the back of the free ones
+  for (size_t i = kMaxFrames; i > 0; --i) {
+    free_frames_.push_back(static_cast<uint8_t>(i - 1));
+  }
+}
+
+QueuedFrame& FrameQueue::Front() {
+  front_lane_ = 0;
+  while (front_lane_ + 1 < lanes_.size() && lanes_[front_lane_].size == 0) {
+    ++front_lane_;
+  }
+  const auto& lane = lanes_[front_lane_];
+  return frames_[lane.frames[lane.head]];
+}
+
+bool FrameQueue::Push(uint64_t read_ns) {
+  const auto index = free_frames_.back();
+  auto& frame = frames_[index];
+
+  cancelled_ids_.clear();
+  if (RequestControl::ParseCancel(frame.data, cancelled_ids_)) {
+    for (const auto request_id : cancelled_ids_) {
+      for (auto& queued : frames_) {
+        if (queued.request_id == request_id) {
+          queued.is_cancelled = true;
+          break;
+        }
+      }
+    }
+    return false;
+  }
+  if (RequestControl::ParseChunk(frame.data).first && !AssembleChunk(frame.data)) {
+    return false;
+  }
+
+  // #r<request id>, then the optional trace, deadline, send time and priority headers:
+  size_t idx = 2;
+  frame.request_id = -1;
+  frame.priority = RequestPriority::Normal;
+  frame.deadline_ns = 0;
+  frame.sent_ns = 0;
+  frame.read_ns = read_ns;
+  if (frame.data.size() >= idx && frame.data[0] == '#' && frame.data[1] == 'r') {
+    if (auto [success, request_id] = RegularTypeParaser::Parse<RequestId>(frame.data, idx);
+        success) {
+      frame.request_id = request_id;
+      Tracer::ParseHeader(frame.data, idx);
+      frame.deadline_ns = RequestControl::ParseDeadline(frame.data, idx).second;
+      frame.sent_ns = RequestControl::ParseSendTime(frame.data, idx).second;
+      frame.priority = RequestControl::ParsePriority(frame.data, idx).second;
+    }
+  }
+  frame.is_cancelled = false;
+
+  auto& lane = lanes_[static_cast<size_t>(frame.priority)];
+  lane.frames[(lane.head + lane.size) % kMaxFrames] = index;
+  ++lane.size;
+  free_frames_.pop_back();
+  back_frame_ = index;
+  ++size_;
+  return true;
+}
+
+void FrameQueue::Pop() {
+  auto& lane = lanes_[front_lane_];
+  const auto index = lane.frames[lane.head];
+  // the popped frame can't be matched by a cancel anymore
+  frames_[index].request_id = -1;
+  free_frames_.push_back(index);
+  lane.head = (lane.head + 1) % kMaxFrames;
+  --lane.size;
+  --size_;
+}
+
+bool FrameQueue::AssembleChunk(RawDataType& data) {
+  const auto header = RequestControl::ParseChunk(data).second;
+  Assembly* assembly = nullptr;
+  for (auto& item : assemblies_) {
+    if (item.is_used ? item.request_id == header.request_id : assembly == nullptr) {
+      assembly = &item;
+    }
+  }
+  if (header.is_first) {
+    if (assembly == nullptr || assembly->is_used) {
+      if (assemblies_.size() >= kMaxFrames) {
+        Logger::LogError(Logger::to_string(std::stringstream()
+                                           << kLogTag << ": ERROR - too many chunked requests, "
+                                           << "dropping the request=" << header.request_id));
+        return false;
+      }
+      assembly = &assemblies_.emplace_back();
+    }
+    assembly->request_id = header.request_id;
+    assembly->is_used = true;
+    assembly->data.clear();
+  } else if (assembly == nullptr || !assembly->is_used) {
+    // the beginning of the request is lost
+    return false;
+  }
+
+  assembly->data.insert(assembly->data.end(),
+                        std::next(data.begin(), RequestControl::kChunkHeaderSize), data.end());
+  if (!header.is_last) {
+    return false;
+  }
+  assembly->is_used = false;
+  std::swap(data, assembly->data);
+  return true;
+}
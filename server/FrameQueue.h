@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Types.h"
+
+// Request of the connection, which is read ahead of its execution.
+struct QueuedFrame {
+  inline bool IsExpired(uint64_t now_ns) const {
+    return deadline_ns != 0 && now_ns >= deadline_ns;
+  }
+
+  RawDataType data;
+  RequestId request_id = -1;
+  RequestPriority priority = RequestPriority::Normal;
+  // steady_clock nanoseconds of the deadline header, 0 - the request has no deadline
+  uint64_t deadline_ns = 0;
+  // steady_clock nanoseconds of the send time header, 0 - there is no header, thus, the client
+  // doesn't expect the busy response
+  uint64_t sent_ns = 0;
+  // when the server has read the request
+  uint64_t read_ns = 0;
+  bool is_cancelled = false;
+};
+
+// Requests of one connection, which are read from the pipe, but not executed yet.
+// The server executes the requests of a connection one by one, so a cancel frame, which is queued
+// in the pipe behind its request, is seen only if the frames are read ahead: the server reads all
+// the frames, which are already in the pipe, before executing the front request and before
+// sending its response (see Server::ReadFrames()). Cancels for the requests, which are not in the
+// queue, are ignored - they are either executed or still in the pipe, where the deadline header
+// expires them.
+// The requests are queued in a lane per priority, and the front one is the oldest request of the
+// highest priority - so an urgent request overtakes the queued bulk ones. The chunks of a long
+// request are assembled here, the request is queued, once its last chunk is read.
+// The frames are a pool of reused buffers, so queueing doesn't allocate after the warm-up.
+class FrameQueue {
+ public:
+  static constexpr size_t kMaxFrames = 64;
+
+  FrameQueue();
+
+  inline bool IsEmpty() const { return size_ == 0; }
+  inline bool IsFull() const { return size_ == kMaxFrames; }
+
+  // The request, which is executed next - the oldest one of the highest priority.
+  QueuedFrame& Front();
+  // Buffer of the next frame - the frame is read into it and then passed to Push().
+  inline RawDataType& GetBackData() { return frames_[free_frames_.back()].data; }
+
+  // Queues the request, which is read into GetBackData() at read_ns, applies the cancel frame to
+  // the queued requests or assembles the chunk. Returns false, if nothing is queued.
+  bool Push(uint64_t read_ns);
+  // The request, which was queued by the last Push() - the assembled one for the chunks.
+  inline const QueuedFrame& Back() const { return frames_[back_frame_]; }
+  // Removes the request, which was returned by the last Front(). The requests, which are read
+  // ahead meanwhile, don't change it, even if they overtake it.
+  void Pop();
+
+ private:
+  // Indices of the frames of one priority in the order of their arrival.
+  struct Lane {
+    std::array<uint8_t, kMaxFrames> frames{};
+    size_t head = 0;
+    size_t size = 0;
+  };
+
+  // Request, which is being assembled from its chunks.
+  struct Assembly {
+    RequestId request_id = -1;
+    bool is_used = false;
+    RawDataType data;
+  };
+
+  // Moves the chunk into its assembly. Returns true, if the request is complete - then it's
+  // swapped into the chunk's buffer.
+  bool AssembleChunk(RawDataType& data);
+
+ private:
+  std::vector<QueuedFrame> frames_;
+  std::vector<uint8_t> free_frames_;
+  std::array<Lane, kRequestPrioritiesCount> lanes_;
+  // lane of the last Front()
+  size_t front_lane_ = 0;
+  // frame of the last Push()
+  size_t back_frame_ = 0;
+  size_t size_ = 0;
+  std::vector<Assembly> assemblies_;
+  // ids of the cancel frame, reused by every cancel
+  std::vector<RequestId> cancelled_ids_;
+};
@@ -2,7 +2,7 @@
 
 #include <windows.h>
 #include <memory>
-#include <mutex>
+#include "ProfiledMutex.h"
 
 // Separate struct to handle the pipe
 struct PipeInstance {
@@ -13,7 +13,7 @@ struct PipeInstance {
 
   // TODO - need to double check whether we really need this mutex when Server /
   // Thread is destroyed
-  std::mutex mutex;
+  ProfiledMutex mutex{"PipeInstance::mutex"};
 
   // Closing the pipe
   bool Close();
@@ -0,0 +1,227 @@
+#include "RegistrySnapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include "Logger.h"
+
+static constexpr auto kLogTag = "RegistrySnapshot";
+
+static constexpr char kSnapshotMagic[8] = {'N', 'P', 'S', 'N', 'A', 'P', '0', '1'};
+static constexpr size_t kWriteBufferSize = 1 << 20;
+
+std::string GetSnapshotSlotPath(const std::string& path, int slot) {
+  return path + "." + std::to_string(slot);
+}
+
+std::shared_ptr<SnapshotFile> OpenLatestSnapshot(const std::string& path) {
+  auto first = SnapshotFile::Open(GetSnapshotSlotPath(path, 0), 0);
+  auto second = SnapshotFile::Open(GetSnapshotSlotPath(path, 1), 1);
+  if (!first || !second) {
+    return first ? first : second;
+  }
+  return first->GetSequence() > second->GetSequence() ? first : second;
+}
+
+// ---- SnapshotFile:
+SnapshotFile::~SnapshotFile() {
+  if (view_) {
+    UnmapViewOfFile(view_);
+  }
+  if (mapping_handle_) {
+    CloseHandle(mapping_handle_);
+  }
+  if (file_handle_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_handle_);
+  }
+}
+
+std::shared_ptr<SnapshotFile> SnapshotFile::Open(const std::string& path, int slot) {
+  std::shared_ptr<SnapshotFile> snapshot(new SnapshotFile());
+  snapshot->slot_ = slot;
+  snapshot->file_handle_ = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (snapshot->file_handle_ == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(snapshot->file_handle_, &size) ||
+      static_cast<uint64_t>(size.QuadPart) < kSnapshotHeaderSize) {
+    return nullptr;
+  }
+
+  snapshot->mapping_handle_ =
+      CreateFileMapping(snapshot->file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!snapshot->mapping_handle_) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't map the snapshot=" << path
+                                       << ", error=" << GetLastError()));
+    return nullptr;
+  }
+
+  snapshot->view_ = reinterpret_cast<const char*>(
+      MapViewOfFile(snapshot->mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+  if (!snapshot->view_) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't map the snapshot=" << path
+                                       << ", error=" << GetLastError()));
+    return nullptr;
+  }
+
+  // Only the header is validated - touching the records would page in the whole file.
+  const auto* header = reinterpret_cast<const SnapshotHeader*>(snapshot->view_);
+  const auto file_size = static_cast<uint64_t>(size.QuadPart);
+  if (std::memcmp(header->magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+      !header->is_complete || header->heap_offset + header->heap_size > file_size ||
+      header->records_offset + header->records_count * sizeof(SnapshotRecord) > file_size) {
+    Logger::LogError(Logger::to_string(std::stringstream() << kLogTag << ": ignoring incomplete "
+                                                           << "or invalid snapshot=" << path));
+    return nullptr;
+  }
+
+  snapshot->header_ = header;
+  snapshot->heap_ = snapshot->view_ + header->heap_offset;
+  snapshot->records_ =
+      reinterpret_cast<const SnapshotRecord*>(snapshot->view_ + header->records_offset);
+  return snapshot;
+}
+
+const SnapshotRecord* SnapshotFile::FindRecord(ClassHandle handle) const {
+  const auto* end = records_ + GetRecordsCount();
+  const auto* iter = std::lower_bound(
+      records_, end, handle,
+      [](const SnapshotRecord& record, ClassHandle value) { return record.handle < value; });
+  if (iter == end || iter->handle != handle) {
+    return nullptr;
+  }
+  return iter;
+}
+
+bool SnapshotFile::Find(ClassHandle handle, std::string_view& blob) const {
+  if (const auto* record = FindRecord(handle)) {
+    blob = GetBlob(*record);
+    return true;
+  }
+  return false;
+}
+
+bool SnapshotFile::Contains(ClassHandle handle) const { return FindRecord(handle) != nullptr; }
+
+std::string_view SnapshotFile::GetBlob(const SnapshotRecord& record) const {
+  return std::string_view(heap_ + record.offset, record.size);
+}
+
+// ---- SnapshotWriter:
+SnapshotWriter::SnapshotWriter(const std::string& path) : path_(path) {}
+
+SnapshotWriter::~SnapshotWriter() {
+  if (file_handle_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_handle_);
+  }
+}
+
+bool SnapshotWriter::Begin() {
+  file_handle_ = CreateFile(path_.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_handle_ == INVALID_HANDLE_VALUE) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't create the snapshot="
+                                       << path_ << ", error=" << GetLastError()));
+    return false;
+  }
+
+  buffer_.reserve(kWriteBufferSize);
+  // placeholder of the header - it is written last, see Finish()
+  const char empty_header[kSnapshotHeaderSize] = {};
+  return Write(empty_header, sizeof(empty_header));
+}
+
+bool SnapshotWriter::Add(ClassHandle handle, std::string_view blob) {
+  if (!records_.empty() && records_.back().handle >= handle) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - handles must be added in order, "
+                                       << "handle=" << handle));
+    has_failed_ = true;
+    return false;
+  }
+
+  records_.push_back(SnapshotRecord{handle, static_cast<uint32_t>(blob.size()), heap_size_});
+  heap_size_ += blob.size();
+  return Write(blob.data(), blob.size());
+}
+
+bool SnapshotWriter::Finish(uint64_t sequence, uint64_t wal_lsn, ClassHandle next_handle) {
+  // keep the record array aligned:
+  const char padding[sizeof(uint64_t)] = {};
+  const auto padding_size = (sizeof(uint64_t) - heap_size_ % sizeof(uint64_t)) % sizeof(uint64_t);
+  Write(padding, padding_size);
+
+  Write(reinterpret_cast<const char*>(records_.data()), records_.size() * sizeof(SnapshotRecord));
+  if (!FlushBuffer() || has_failed_ || !FlushFileBuffers(file_handle_)) {
+    return false;
+  }
+
+  SnapshotHeader header = {};
+  std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+  header.sequence = sequence;
+  header.wal_lsn = wal_lsn;
+  header.heap_offset = kSnapshotHeaderSize;
+  header.heap_size = heap_size_;
+  header.records_offset = kSnapshotHeaderSize + heap_size_ + padding_size;
+  header.records_count = records_.size();
+  header.next_handle = next_handle;
+  header.is_complete = 1;
+
+  LARGE_INTEGER position;
+  position.QuadPart = 0;
+  DWORD bytes_written = 0;
+  if (!SetFilePointerEx(file_handle_, position, nullptr, FILE_BEGIN) ||
+      !WriteFile(file_handle_, &header, sizeof(header), &bytes_written, nullptr) ||
+      !FlushFileBuffers(file_handle_)) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't write header of snapshot="
+                                       << path_ << ", error=" << GetLastError()));
+    return false;
+  }
+
+  CloseHandle(file_handle_);
+  file_handle_ = INVALID_HANDLE_VALUE;
+  return true;
+}
+
+bool SnapshotWriter::Write(const char* data, size_t size) {
+  if (has_failed_) {
+    return false;
+  }
+
+  while (size > 0) {
+    const auto chunk = std::min(size, kWriteBufferSize - buffer_.size());
+    buffer_.insert(buffer_.end(), data, data + chunk);
+    data += chunk;
+    size -= chunk;
+
+    if (buffer_.size() == kWriteBufferSize && !FlushBuffer()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SnapshotWriter::FlushBuffer() {
+  size_t offset = 0;
+  while (offset < buffer_.size()) {
+    DWORD bytes_written = 0;
+    if (!WriteFile(file_handle_, buffer_.data() + offset,
+                   static_cast<DWORD>(buffer_.size() - offset), &bytes_written, nullptr)) {
+      Logger::LogError(Logger::to_string(std::stringstream()
+                                         << kLogTag << ": ERROR - can't write the snapshot="
+                                         << path_ << ", error=" << GetLastError()));
+      has_failed_ = true;
+      return false;
+    }
+    offset += bytes_written;
+  }
+  buffer_.clear();
+  return true;
+}
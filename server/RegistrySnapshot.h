@@ -0,0 +1,118 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Types.h"
+
+// Flat, memory-mappable snapshot of all the instances of ClassRegistry.
+//
+// File layout:
+//   <SnapshotHeader, padded to kSnapshotHeaderSize><string heap><SnapshotRecord array>
+// The record array is sorted by handle, so a lookup is a binary search right in the mapped
+// memory - opening a snapshot costs O(1) regardless of the number of instances.
+// Each record points to the serialized state of the instance (Type::Serialize) in the heap.
+//
+// The snapshot is written into one of two slots (<path>.0 and <path>.1): the slot, which is
+// currently mapped by the server, is never overwritten. The header is written last, so a crash
+// in the middle of writing leaves an incomplete slot, which is ignored on startup.
+
+struct SnapshotHeader {
+  char magic[8];
+  uint64_t sequence;
+  // All the records of the write-ahead log up to this LSN are reflected in the snapshot.
+  uint64_t wal_lsn;
+  uint64_t heap_offset;
+  uint64_t heap_size;
+  uint64_t records_offset;
+  uint64_t records_count;
+  ClassHandle next_handle;
+  uint32_t is_complete;
+};
+
+struct SnapshotRecord {
+  ClassHandle handle;
+  uint32_t size;
+  // offset of serialized instance in the heap
+  uint64_t offset;
+};
+
+static constexpr size_t kSnapshotHeaderSize = 64;
+static_assert(sizeof(SnapshotHeader) <= kSnapshotHeaderSize, "Snapshot header is too large");
+
+// Read-only view of the mapped snapshot file.
+class SnapshotFile {
+ public:
+  ~SnapshotFile();
+
+  // Maps the file and validates the header. Returns nullptr if the snapshot is missing or
+  // incomplete.
+  static std::shared_ptr<SnapshotFile> Open(const std::string& path, int slot);
+
+  // Binary search of the handle in the record array.
+  bool Find(ClassHandle handle, std::string_view& blob) const;
+  bool Contains(ClassHandle handle) const;
+
+  inline size_t GetRecordsCount() const { return static_cast<size_t>(header_->records_count); }
+  inline const SnapshotRecord& GetRecord(size_t index) const { return records_[index]; }
+  std::string_view GetBlob(const SnapshotRecord& record) const;
+
+  inline uint64_t GetSequence() const { return header_->sequence; }
+  inline uint64_t GetWalLsn() const { return header_->wal_lsn; }
+  inline ClassHandle GetNextHandle() const { return header_->next_handle; }
+  inline int GetSlot() const { return slot_; }
+
+ private:
+  SnapshotFile() = default;
+
+  // non-movable, non-copyable
+  SnapshotFile(const SnapshotFile& other) = delete;
+  SnapshotFile& operator=(const SnapshotFile& other) = delete;
+
+  const SnapshotRecord* FindRecord(ClassHandle handle) const;
+
+ private:
+  HANDLE file_handle_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_handle_ = nullptr;
+  const char* view_ = nullptr;
+  const SnapshotHeader* header_ = nullptr;
+  const SnapshotRecord* records_ = nullptr;
+  const char* heap_ = nullptr;
+  int slot_ = 0;
+};
+
+// Streams instances into the snapshot file.
+// Instances must be added in the increasing order of handles.
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(const std::string& path);
+  ~SnapshotWriter();
+
+  bool Begin();
+  bool Add(ClassHandle handle, std::string_view blob);
+  bool Finish(uint64_t sequence, uint64_t wal_lsn, ClassHandle next_handle);
+
+ private:
+  // non-movable, non-copyable
+  SnapshotWriter(const SnapshotWriter& other) = delete;
+  SnapshotWriter& operator=(const SnapshotWriter& other) = delete;
+
+  bool Write(const char* data, size_t size);
+  bool FlushBuffer();
+
+ private:
+  const std::string path_;
+  HANDLE file_handle_ = INVALID_HANDLE_VALUE;
+  std::vector<char> buffer_;
+  std::vector<SnapshotRecord> records_;
+  uint64_t heap_size_ = 0;
+  bool has_failed_ = false;
+};
+
+std::string GetSnapshotSlotPath(const std::string& path, int slot);
+
+// Opens the complete snapshot with the highest sequence among both slots.
+std::shared_ptr<SnapshotFile> OpenLatestSnapshot(const std::string& path);
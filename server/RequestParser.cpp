@@ -3,7 +3,12 @@
 #include <sstream>
 #include "CustomClassParser.h"
 #include "DataDeserializer.h"
+#include "DataSerializer.h"
 #include "Logger.h"
+#include "ProfiledMutex.h"
+#include "RequestControl.h"
+#include "ServerMetrics.h"
+#include "Tracer.h"
 
 constexpr auto kLogTag = "RequestParser";
 
@@ -11,36 +16,53 @@ RequestParser::RequestParser(size_t client_id) : client_id_(client_id) {}
 
 bool RequestParser::ParseRequest(const RawDataType& request, ServerResponse& response) const {
   size_t idx = 0;
-  response = ServerResponse{};
+  response.Reset();
 
-  // Try to parse a request id
+  // Try to parse a request id - the response is serialized in its encoding
+  const auto encoding = RegularTypeParaser::GetEncoding(request, 2);
   auto request_id = ParseRequestId(request, idx);
+  // and the trace header of the sampled request
+  const auto trace = Tracer::ParseHeader(request, idx).second;
+  if (trace.IsTraced()) {
+    Tracer::RecordSpan(trace.trace_id, "pipe.request", trace.client_send_ns, Tracer::Now());
+  }
+  // the deadline, the send time and the priority are already handled by the server (see
+  // FrameQueue)
+  RequestControl::ParseDeadline(request, idx);
+  RequestControl::ParseSendTime(request, idx);
+  RequestControl::ParsePriority(request, idx);
+  const CurrentTraceScope trace_scope(trace.trace_id);
+  const TraceSpan parse_span(trace.trace_id, "server.parse");
 
   const auto tmp_idx = idx;  // just for debug purposes
   if (auto [success, value] = RegularTypeParaser::Parse<int>(request, idx); success) {
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << kLogTag << ": [client=" << client_id_ << ", request=" << request_id
-                            << "] Received int value from client: " << value));
+    NAMEDPIPE_LOG_DEBUG(kLogTag << ": [client=" << client_id_ << ", request=" << request_id
+                        << "] Received int value from client: " << value);
     return true;
   } else if (auto [success, value] = RegularTypeParaser::Parse<double>(request, idx); success) {
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << kLogTag << ": [client=" << client_id_ << ", request=" << request_id
-                            << "] Received double value from client: " << value));
+    NAMEDPIPE_LOG_DEBUG(kLogTag << ": [client=" << client_id_ << ", request=" << request_id
+                        << "] Received double value from client: " << value);
     return true;
   } else if (auto [success, value] = RegularTypeParaser::Parse<std::string>(request, idx);
              success) {
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << kLogTag << ": [client=" << client_id_ << ", request=" << request_id
-                            << "] Received std::string value from client: " << value.c_str()));
+    NAMEDPIPE_LOG_DEBUG(kLogTag << ": [client=" << client_id_ << ", request=" << request_id
+                        << "] Received std::string value from client: " << value.c_str());
     return true;
-  } else if (auto [success, resp] = CustomClassParser(client_id_, request_id).Parse(request, idx);
-             success) {
-    auto req_str = std::string(std::next(request.begin(), tmp_idx), request.end());
-    Logger::LogDebug(Logger::to_string(
-        std::stringstream() << kLogTag << ": [client=" << client_id_ << ", request=" << request_id
-                            << "] Processed CustomClass request=" << req_str));
+  } else if (auto [success, resp] = ParseAdminRequest(request, idx); success) {
+    NAMEDPIPE_LOG_DEBUG(kLogTag << ": [client=" << client_id_ << ", request=" << request_id
+                        << "] Processed admin request");
     response = std::move(resp);
     response.SetRequestId(request_id);
+    response.SetTraceContext(trace);
+    response.SetEncoding(encoding);
+    return true;
+  } else if (CustomClassParser(client_id_, request_id, encoding).Parse(request, idx, response)) {
+    NAMEDPIPE_LOG_DEBUG(kLogTag << ": [client=" << client_id_ << ", request=" << request_id
+                        << "] Processed CustomClass request="
+                        << std::string(std::next(request.begin(), tmp_idx), request.end()));
+    response.SetRequestId(request_id);
+    response.SetTraceContext(trace);
+    response.SetEncoding(encoding);
     return true;
   }
 
@@ -64,4 +86,20 @@ RequestId RequestParser::ParseRequestId(const RawDataType& request, size_t& seek
   }
 
   return -1;
+}
+
+std::pair<bool, ServerResponse> RequestParser::ParseAdminRequest(const RawDataType& request,
+                                                                 size_t& seek_idx) const {
+  size_t idx = seek_idx;
+  // check for keyword admin - 'a':
+  if (request.size() < idx + 2 || (request[idx++] != '#' || request[idx++] != 'a')) {
+    return std::make_pair(false, ServerResponse{});
+  }
+
+  seek_idx = idx;
+  // the lock report is empty, unless the locks are profiled:
+  const auto snapshot =
+      ServerMetrics::GetInstance().GetSnapshot().ToString() + LockProfiler::GetReport();
+  return std::make_pair(
+      true, ServerResponse(DataSerializer::SerializeToRawData(snapshot), nullptr, nullptr));
 }
\ No newline at end of file
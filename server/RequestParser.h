@@ -1,5 +1,6 @@
 #pragma once
 
+#include <utility>
 #include "ServerResponse.h"
 #include "Types.h"
 
@@ -8,10 +9,16 @@ class RequestParser {
  public:
   explicit RequestParser(size_t client_id);
 
+  // The response is reset and serialized in place - the connection reuses one response for all
+  // its requests, so the data of the response isn't reallocated.
   bool ParseRequest(const RawDataType& request, ServerResponse& response) const;
 
  private:
   RequestId ParseRequestId(const RawDataType& request, size_t& seek_idx) const;
 
+  // Admin request (#a) - the response is the snapshot of the ServerMetrics (std::string).
+  std::pair<bool, ServerResponse> ParseAdminRequest(const RawDataType& request,
+                                                    size_t& seek_idx) const;
+
   const size_t client_id_ = -1;
 };
\ No newline at end of file
@@ -1,32 +1,81 @@
 #include "Server.h"
 
+#include <algorithm>
+#include <cctype>
 #include <sstream>
+#include "ClassRegistry.h"
+#include "CustomClass.h"
+#include "DataDeserializer.h"
 #include "DataSerializer.h"
 #include "Logger.h"
+#include "RequestControl.h"
 #include "RequestParser.h"
+#include "ServerMetrics.h"
+#include "Tracer.h"
 
 static constexpr auto kLogTag = "Server";
 
 static constexpr DWORD kBuffSize = 4096;
 
 namespace {
-RawDataType CreateRequestIdData(RequestId request) {
-  std::stringstream ss;
-  ss << "#r";
-  DataSerializer::Serialize<int>(ss, request);
+void AppendRequestIdData(RawDataType &data, RequestId request, WireEncoding encoding) {
+  data.push_back('#');
+  data.push_back('r');
+  DataSerializer::AppendToRawData<int>(data, request, encoding);
+}
+
+// Whether the client has sent more frames, which can be read without blocking.
+bool HasPendingData(HANDLE pipe_handle) {
+  DWORD bytes_available = 0;
+  return PeekNamedPipe(pipe_handle, nullptr, 0, nullptr, &bytes_available, nullptr) &&
+         bytes_available > 0;
+}
+
+// The connection, whose client process isn't known, is a client of the FairScheduler on its own -
+// its id is above the process ids.
+constexpr uint64_t kConnectionSchedulerIdsBase = uint64_t{1} << 32;
 
-  return DataSerializer::ConvertToRawData(ss.str());
+// Client of the FairScheduler, which the connection belongs to: the id of the client process and
+// the file name of its executable in lower case, which picks the quantum of the client.
+std::pair<uint64_t, std::string> GetSchedulerClient(size_t client_id, HANDLE pipe_handle) {
+  ULONG process_id = 0;
+  if (!GetNamedPipeClientProcessId(pipe_handle, &process_id)) {
+    Logger::LogError(Logger::to_string(
+        std::stringstream() << kLogTag << ": ERROR - the process of client_id=" << client_id
+                            << " is unknown, error=" << GetLastError()));
+    return std::make_pair(kConnectionSchedulerIdsBase + client_id, std::string());
+  }
+
+  std::string name;
+  if (HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process_id)) {
+    char path[MAX_PATH] = {};
+    DWORD size = MAX_PATH;
+    if (QueryFullProcessImageName(process, 0, path, &size)) {
+      const std::string full_path(path, size);
+      name = full_path.substr(full_path.find_last_of('\\') + 1);
+      std::transform(name.begin(), name.end(), name.begin(),
+                     [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    }
+    CloseHandle(process);
+  }
+  return std::make_pair(uint64_t{process_id}, std::move(name));
 }
 }  // namespace
 
-Server::Server(const std::string &pipe_name) : pipe_name_(pipe_name) {}
+Server::Server(const std::string &pipe_name) : Server(ServerConfig{pipe_name}) {}
+
+Server::Server(ServerConfig config)
+    : config_(std::move(config)),
+      pipe_name_(config_.pipe_name),
+      admission_(config_.admission_target, config_.admission_interval),
+      scheduler_(config_.scheduler_config) {}
 
 Server::~Server() {
   is_closed_.store(true);
 
   std::unordered_map<size_t, std::shared_ptr<PipeInstance>> pipes;
   {
-    std::lock_guard<std::mutex> locker(pipes_mutex_);
+    std::lock_guard<ProfiledMutex> locker(pipes_mutex_);
     pipes = std::move(pipes_);
   }
   // close all handles:
@@ -35,7 +84,7 @@ Server::~Server() {
 
     // This is tricky one - we need to guarantee the thread-safe access to the
     // pipe instance
-    std::lock_guard<std::mutex> locker(pipe_instance->mutex);
+    std::lock_guard<ProfiledMutex> locker(pipe_instance->mutex);
     pipe_instance->Close();
   }
 
@@ -43,9 +92,50 @@ Server::~Server() {
   for (auto &thread : threads_) {
     thread.join();
   }
+
+  if (snapshot_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> locker(snapshot_mutex_);
+    }
+    snapshot_cv_.notify_one();
+    snapshot_thread_.join();
+  }
+
+  if (metrics_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> locker(metrics_mutex_);
+    }
+    metrics_cv_.notify_one();
+    metrics_thread_.join();
+  }
+
+  if (capture_) {
+    capture_->Close();
+  }
+
+  if (wal_) {
+    ClassRegistry<CustomClass>::GetInstance().AttachLog(nullptr);
+    wal_->Close();
+  }
 }
 
 bool Server::Start() {
+  // Handles restored from the snapshot and the log are already in the partition of the shard.
+  ClassRegistry<CustomClass>::GetInstance().SetHandlePartition(config_.shard_index,
+                                                               config_.shards_count);
+  if (!InitializePersistence()) {
+    return false;
+  }
+  if (!config_.metrics_path.empty()) {
+    metrics_thread_ = std::thread(&Server::MetricsLoop, this);
+  }
+  if (!config_.capture_path.empty()) {
+    capture_ = std::make_unique<TrafficCapture>(config_.capture_path);
+    if (!capture_->Open()) {
+      return false;
+    }
+  }
+
   // Same idea as in multi-threaded named pipe server
   // First, create a named pipe with read-write method
   // after that continuously waiting for new clients to a pipe
@@ -76,7 +166,7 @@ bool Server::Start() {
     if (connected || (GetLastError() == ERROR_PIPE_CONNECTED)) {
       auto client_id = client_ids_counter_++;
       {
-        std::lock_guard<std::mutex> locker(pipes_mutex_);
+        std::lock_guard<ProfiledMutex> locker(pipes_mutex_);
         pipes_[client_id] = std::make_shared<PipeInstance>(client_id, pipe_handle);
       }
 
@@ -94,6 +184,95 @@ bool Server::Start() {
   return true;
 }
 
+bool Server::InitializePersistence() {
+  auto &registry = ClassRegistry<CustomClass>::GetInstance();
+
+  uint64_t snapshot_lsn = 0;
+  if (!config_.snapshot_path.empty()) {
+    // Mapping doesn't read the instances - they are served from the mapped memory on demand.
+    if (auto snapshot = OpenLatestSnapshot(config_.snapshot_path)) {
+      snapshot_lsn = snapshot->GetWalLsn();
+      Logger::LogDebug(Logger::to_string(
+          std::stringstream() << kLogTag << ": mapped the snapshot with "
+                              << snapshot->GetRecordsCount() << " instances, sequence="
+                              << snapshot->GetSequence() << ", lsn=" << snapshot_lsn));
+      registry.AttachSnapshot(std::move(snapshot));
+    }
+  }
+
+  if (!config_.wal_path.empty()) {
+    // The log is truncated by the snapshots, and it is read only once - replay and open share
+    // the same pass.
+    size_t records_count = 0;
+    wal_ = std::make_shared<WriteAheadLog>(config_.wal_path, config_.wal_durability,
+                                           config_.wal_batch_interval);
+    const bool success = wal_->Open(
+        [&](const WalRecord &record) {
+          registry.Restore(record);
+          ++records_count;
+        },
+        snapshot_lsn);
+    if (!success) {
+      Logger::LogError(Logger::to_string(std::stringstream()
+                                         << kLogTag << ": ERROR - failed to open the log="
+                                         << config_.wal_path));
+      wal_ = nullptr;
+      return false;
+    }
+    Logger::LogDebug(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": replayed " << records_count
+                                       << " records from the log=" << config_.wal_path
+                                       << ", last lsn=" << wal_->GetLastLsn()));
+
+    registry.AttachLog(wal_);
+  }
+
+  if (!config_.snapshot_path.empty()) {
+    snapshot_thread_ = std::thread(&Server::SnapshotLoop, this);
+  }
+  return true;
+}
+
+void Server::SnapshotLoop() {
+  auto &registry = ClassRegistry<CustomClass>::GetInstance();
+  auto write_snapshot = [&] {
+    const auto begin = std::chrono::steady_clock::now();
+    const bool success = registry.WriteSnapshot(config_.snapshot_path);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - begin);
+    Logger::LogDebug(Logger::to_string(
+        std::stringstream() << kLogTag << ": wrote the snapshot=" << config_.snapshot_path
+                            << ", success=" << success << ", took=" << elapsed.count() << "ms"));
+  };
+
+  // The last snapshot is written on shutdown, so the next start doesn't need to replay the log.
+  auto is_closed = [this] { return is_closed_.load(); };
+  std::unique_lock<std::mutex> locker(snapshot_mutex_);
+  while (!is_closed_) {
+    if (config_.snapshot_interval.count() > 0) {
+      snapshot_cv_.wait_for(locker, config_.snapshot_interval, is_closed);
+    } else {
+      snapshot_cv_.wait(locker, is_closed);
+    }
+
+    locker.unlock();
+    write_snapshot();
+    locker.lock();
+  }
+}
+
+void Server::MetricsLoop() {
+  auto is_closed = [this] { return is_closed_.load(); };
+  std::unique_lock<std::mutex> locker(metrics_mutex_);
+  while (!is_closed_) {
+    metrics_cv_.wait_for(locker, config_.metrics_interval, is_closed);
+
+    locker.unlock();
+    ServerMetrics::GetInstance().WritePrometheus(config_.metrics_path);
+    locker.lock();
+  }
+}
+
 void Server::HandleClientConnection(size_t client_id, HANDLE pipe_handle) {
   if (pipe_handle == nullptr) {
     Logger::LogError(
@@ -107,22 +286,106 @@ void Server::HandleClientConnection(size_t client_id, HANDLE pipe_handle) {
 
   std::shared_ptr<PipeInstance> pipe = nullptr;
   {
-    std::lock_guard<std::mutex> locker(pipes_mutex_);
+    std::lock_guard<ProfiledMutex> locker(pipes_mutex_);
     pipe = pipes_[client_id];
   }
+  auto& metrics = ServerMetrics::GetInstance();
+  metrics.BindClient(client_id);
+  // all the connections of the client process share its requests in the FairScheduler
+  uint64_t scheduler_client = kConnectionSchedulerIdsBase + client_id;
+  if (scheduler_.IsEnabled()) {
+    const auto [process_client, client_name] = GetSchedulerClient(client_id, pipe_handle);
+    scheduler_client = process_client;
+    scheduler_.AddConnection(scheduler_client, client_name);
+  }
+
+  // The buffers are reused for all the requests of the client, so the request path doesn't
+  // allocate, once they have grown to the size of the messages.
+  FrameQueue frames;
+  ServerResponse response;
+  RawDataType response_headers;
+
   // block and wait till server is up or client is alive
   while (!is_closed_) {
     // Here need to understand whether this is correct place to set a mutex
     // Overall, this is required in order to properly shutdown the Server.
     // Maybe it is not needed due to blocking behaviour of ReadFile and other
     // operations on this pipe.
-    std::lock_guard<std::mutex> locker(pipe->mutex);
+    std::lock_guard<ProfiledMutex> locker(pipe->mutex);
+
+    if (!ReadFrames(client_id, pipe_handle, frames)) {
+      pipe->Close();
+      break;
+    }
+
+    // The expired and cancelled requests aren't executed. The request can be cancelled while
+    // it's executed - then the frames are read ahead once more, and its response isn't sent.
+    // Every request is seen by the admission control, but only the ones with the send time
+    // header can be rejected - their client handles the busy response. The executed request
+    // waits for its turn in the FairScheduler, so a flooding client can't starve the others:
+    auto &frame = frames.Front();
+    const auto now = Tracer::Now();
+    const auto sent_ns = frame.sent_ns != 0 ? frame.sent_ns : frame.read_ns;
+    metrics.RecordLatency(MetricsStage::Queue,
+                          std::chrono::nanoseconds(now > sent_ns ? now - sent_ns : 0));
+    const bool is_dropped = frame.is_cancelled || frame.IsExpired(now);
+    const bool is_admitted = admission_.Admit(sent_ns, now) || frame.sent_ns == 0;
+    const bool is_executed = !is_dropped && is_admitted;
+    if (is_executed) {
+      if (scheduler_.IsEnabled()) {
+        StageTimer timer(MetricsStage::Schedule);
+        scheduler_.Acquire(scheduler_client, frame.data.size(), frame.priority);
+      }
+      ParseClientRequest(client_id, pipe_handle, frame.data, response);
+      scheduler_.Release();
+      if (response.IsValid() && !ReadFrames(client_id, pipe_handle, frames)) {
+        pipe->Close();
+        break;
+      }
+    } else {
+      response.Reset();
+    }
+    if (!is_dropped && !is_admitted) {
+      SetBusyResponse(client_id, frame, now, response);
+    } else if (frame.is_cancelled || frame.IsExpired(Tracer::Now())) {
+      // One-way requests have no response - there is nothing to replace with the status.
+      if (!is_executed || response.IsValid()) {
+        SetStatusResponse(client_id, frame, response);
+      }
+    }
+
+    if (response.IsValid()) {
+      if (!SendResponseToClient(client_id, pipe_handle, response, response_headers)) {
+        Logger::LogError(
+            Logger::to_string(std::stringstream()
+                              << kLogTag << ": ERROR: Failed to send back a response to client_id="
+                              << client_id << " -  closing the client!"));
+        scheduler_.RemoveConnection(scheduler_client);
+        return;
+      }
+    }
+    frames.Pop();
+  }
+  scheduler_.RemoveConnection(scheduler_client);
 
-    std::vector<char> data(kBuffSize);
+  Logger::LogDebug(Logger::to_string(std::stringstream() << kLogTag << ": the thread for client="
+                                                         << client_id << " is terminating..."));
+}
+
+bool Server::ReadFrames(size_t client_id, HANDLE pipe_handle, FrameQueue &frames) {
+  auto &metrics = ServerMetrics::GetInstance();
+  // blocks, only if there is no request to execute
+  while (frames.IsEmpty() || (!frames.IsFull() && HasPendingData(pipe_handle))) {
+    auto &data = frames.GetBackData();
+    data.resize(kBuffSize);
     DWORD bytes_read = 0;
-    // read data from client
-    BOOL success = ReadFile(pipe_handle, data.data(), data.size() * sizeof(char), &bytes_read,
-                            nullptr);  // not overlapped I/O
+    BOOL success = false;
+    {
+      StageTimer timer(MetricsStage::Read);
+      // read data from client
+      success = ReadFile(pipe_handle, data.data(), data.size() * sizeof(char), &bytes_read,
+                         nullptr);  // not overlapped I/O
+    }
 
     if (!success || bytes_read == 0) {
       if (GetLastError() == ERROR_BROKEN_PIPE) {
@@ -134,45 +397,92 @@ void Server::HandleClientConnection(size_t client_id, HANDLE pipe_handle) {
                                            << kLogTag << ": ERROR: ReadFile is failed, client_id="
                                            << client_id << ", error=" << GetLastError()));
       }
-
-      pipe->Close();
-      break;
+      return false;
     }
 
     data.resize(bytes_read);  // aka shrink to fit
-    ServerResponse response = ParseClientRequest(client_id, pipe_handle, data);
-    if (response.IsValid()) {
-      if (!SendResponseToClient(client_id, pipe_handle, response)) {
-        Logger::LogError(
-            Logger::to_string(std::stringstream()
-                              << kLogTag << ": ERROR: Failed to send back a response to client_id="
-                              << client_id << " -  closing the client!"));
-        return;
-      }
+    metrics.RecordRequest(bytes_read);
+    // the whole request is captured, once its chunks are assembled - the cancels aren't replayed
+    if (frames.Push(Tracer::Now()) && capture_) {
+      capture_->Append(client_id, false, frames.Back().data);
     }
   }
+  return true;
+}
 
-  Logger::LogDebug(Logger::to_string(std::stringstream() << kLogTag << ": the thread for client="
-                                                         << client_id << " is terminating..."));
+void Server::SetStatusResponse(size_t client_id, const QueuedFrame &frame,
+                               ServerResponse &response) {
+  const auto error = frame.is_cancelled ? ERROR_CANCELLED : ERROR_TIMEOUT;
+  if (frame.is_cancelled) {
+    ServerMetrics::GetInstance().RecordCancelledRequest();
+  } else {
+    ServerMetrics::GetInstance().RecordExpiredRequest();
+  }
+  NAMEDPIPE_LOG_DEBUG(kLogTag << ": [client=" << client_id << ", request=" << frame.request_id
+                      << "] dropped the request, error=" << error);
+
+  // the response of the executed request is never sent
+  response.HandleFailure(static_cast<ServerResponse::ClientId>(client_id), error);
+  const auto trace = response.GetTraceContext();
+  response.Reset();
+  RequestControl::AppendStatus(response.GetMutableData(), error);
+  response.SetRequestId(frame.request_id);
+  response.SetTraceContext(trace);
+  response.SetEncoding(RegularTypeParaser::GetEncoding(frame.data, 2));
 }
 
-ServerResponse Server::ParseClientRequest(size_t client_id, HANDLE pipe_handle,
-                                          const RawDataType &data) {
-  ServerResponse response;
-  RequestParser(client_id).ParseRequest(data, response);
-  return response;
+void Server::SetBusyResponse(size_t client_id, const QueuedFrame &frame, uint64_t now_ns,
+                             ServerResponse &response) {
+  ServerMetrics::GetInstance().RecordRejectedRequest();
+  const auto retry_after_us = admission_.GetRetryAfter(frame.sent_ns, now_ns);
+  NAMEDPIPE_LOG_DEBUG(kLogTag << ": [client=" << client_id << ", request=" << frame.request_id
+                      << "] rejected the request, retry after=" << retry_after_us << "us");
+
+  // the response is set without the execution, thus, there are no callbacks to fail
+  size_t idx = 2;
+  RegularTypeParaser::Parse<RequestId>(frame.data, idx);
+  const auto trace = Tracer::ParseHeader(frame.data, idx).second;
+  response.Reset();
+  RequestControl::AppendBusy(response.GetMutableData(), retry_after_us);
+  response.SetRequestId(frame.request_id);
+  response.SetTraceContext(trace);
+  response.SetEncoding(RegularTypeParaser::GetEncoding(frame.data, 2));
 }
 
-bool Server::SendResponseToClient(size_t client_id, HANDLE pipe_handle, ServerResponse &response) {
-  auto data = response.GetData();
-  auto data_to_send = CreateRequestIdData(response.GetRequestId());
-  data_to_send.insert(data_to_send.end(), data.begin(), data.end());
+void Server::ParseClientRequest(size_t client_id, HANDLE pipe_handle, const RawDataType &data,
+                                ServerResponse &response) {
+  StageTimer timer(MetricsStage::Parse);
+  RequestParser(client_id).ParseRequest(data, response);
+}
 
-  auto bytes_to_write = data_to_send.size() * sizeof(char);
+bool Server::SendResponseToClient(size_t client_id, HANDLE pipe_handle, ServerResponse &response,
+                                  RawDataType &headers) {
+  StageTimer timer(MetricsStage::Send);
+  auto trace = response.GetTraceContext();
+  const TraceSpan send_span(trace.trace_id, "server.send");
+  headers.clear();
+  AppendRequestIdData(headers, response.GetRequestId(), response.GetEncoding());
+  if (trace.IsTraced()) {
+    trace.server_send_ns = Tracer::Now();
+    Tracer::AppendHeader(headers, trace);
+  }
+  // The headers are written in front of the payload - the frame is sent as is (a message of the
+  // pipe can't be gathered from several buffers):
+  const auto [has_headroom, offset] = response.PrependHeaders(headers);
+  if (!has_headroom) {
+    Logger::LogError(Logger::to_string(
+        std::stringstream() << kLogTag
+                            << ": ERROR: the response headers don't fit, size="
+                            << headers.size()));
+    return false;
+  }
+  const auto &data = response.GetMutableData();
+  const auto *frame = data.data() + offset;
+  auto bytes_to_write = (data.size() - offset) * sizeof(char);
 
   DWORD bytes_written = 0;
   // Send back reply to a client:
-  BOOL success = WriteFile(pipe_handle, data_to_send.data(), bytes_to_write, &bytes_written,
+  BOOL success = WriteFile(pipe_handle, frame, bytes_to_write, &bytes_written,
                            nullptr);  // not overlapped I/O
 
   if (!success || bytes_written != bytes_to_write) {
@@ -183,6 +493,12 @@ bool Server::SendResponseToClient(size_t client_id, HANDLE pipe_handle, ServerRe
                                        << client_id << ", error=" << error));
     return false;
   } else {
+    ServerMetrics::GetInstance().RecordResponse(bytes_written);
+    if (capture_) {
+      // the capture needs the whole frame - it's copied only, when the traffic is captured
+      headers.assign(frame, frame + bytes_to_write);
+      capture_->Append(client_id, true, headers);
+    }
     response.HandleSuccess(client_id);
   }
   return true;
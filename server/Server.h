@@ -2,14 +2,22 @@
 
 #include <windows.h>
 #include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include "AdmissionControl.h"
+#include "FairScheduler.h"
+#include "FrameQueue.h"
 #include "PipeInstance.h"
+#include "ProfiledMutex.h"
+#include "ServerConfig.h"
 #include "ServerResponse.h"
+#include "TrafficCapture.h"
 #include "Types.h"
+#include "WriteAheadLog.h"
 
 // This class is the starting point of the NamedPipeDemo::server module.
 // It will create a named pipe and wait till clients will connect to that pipe.
@@ -20,6 +28,7 @@
 class Server {
  public:
   explicit Server(const std::string& pipe_name);
+  explicit Server(ServerConfig config);
   ~Server();
 
   // This blocks the calling thread.
@@ -31,19 +40,54 @@ class Server {
   Server(const Server& other) = delete;
   Server& operator=(const Server& other) = delete;
 
+  // Maps the latest snapshot, replays the write-ahead log on top of it into the ClassRegistry
+  // and starts logging new mutations and writing periodic snapshots.
+  bool InitializePersistence();
+  void SnapshotLoop();
+  // Periodically dumps the ServerMetrics to ServerConfig::metrics_path.
+  void MetricsLoop();
+
   void HandleClientConnection(size_t client_id, HANDLE pipe_handle);
-  ServerResponse ParseClientRequest(size_t client_id, HANDLE pipe_handle, const RawDataType& data);
-  bool SendResponseToClient(size_t client_id, HANDLE pipe_handle, ServerResponse& response);
+  // Reads the frames, which are already in the pipe, into the queue - blocks, only if the queue
+  // is empty. false - the client is disconnected or the read failed.
+  bool ReadFrames(size_t client_id, HANDLE pipe_handle, FrameQueue& frames);
+  // Replaces the response of the expired or cancelled request with its status (see
+  // RequestControl.h).
+  void SetStatusResponse(size_t client_id, const QueuedFrame& frame, ServerResponse& response);
+  // Sets the busy response of the request, which is rejected by the AdmissionControl.
+  void SetBusyResponse(size_t client_id, const QueuedFrame& frame, uint64_t now_ns,
+                       ServerResponse& response);
+  void ParseClientRequest(size_t client_id, HANDLE pipe_handle, const RawDataType& data,
+                          ServerResponse& response);
+  // headers - buffer of the connection for the request id and the trace headers, which are
+  // written into the headroom of the response, so the payload isn't copied.
+  bool SendResponseToClient(size_t client_id, HANDLE pipe_handle, ServerResponse& response,
+                            RawDataType& headers);
 
  private:
+  const ServerConfig config_;
   const std::string pipe_name_;
 
+  AdmissionControl admission_;
+  FairScheduler scheduler_;
+
+  std::shared_ptr<WriteAheadLog> wal_;
+  std::unique_ptr<TrafficCapture> capture_;
+
+  std::mutex snapshot_mutex_;
+  std::condition_variable snapshot_cv_;
+  std::thread snapshot_thread_;
+
+  std::mutex metrics_mutex_;
+  std::condition_variable metrics_cv_;
+  std::thread metrics_thread_;
+
   size_t client_ids_counter_ = 0;
   std::atomic_bool is_closed_ = false;
 
   // Pipes data can be accessed from multiple threads, so, synchronization
   // required
-  mutable std::mutex pipes_mutex_;
+  mutable ProfiledMutex pipes_mutex_{"Server::pipes_mutex_"};
   std::unordered_map<size_t, std::shared_ptr<PipeInstance>> pipes_;
 
   // Container of threads, which are processing active clients:
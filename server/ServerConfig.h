@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include "FairScheduler.h"
+#include "Logger.h"
+#include "Tracer.h"
+#include "WriteAheadLog.h"
+
+// Runtime configuration of the Server.
+struct ServerConfig {
+  std::string pipe_name = "\\\\.\\pipe\\demo_pipe";
+
+  // Sharded mode: the server owns only handles with handle % shards_count == shard_index.
+  size_t shard_index = 0;
+  size_t shards_count = 1;
+
+  // Path to the write-ahead log of ClassRegistry mutations. Empty - logging is disabled.
+  std::string wal_path;
+  WalDurability wal_durability = WalDurability::Batched;
+  // How long the batched log waits for more records before flushing a group.
+  std::chrono::microseconds wal_batch_interval = std::chrono::microseconds(1000);
+
+  // Base path of the registry snapshot (<path>.0 and <path>.1). Empty - snapshots are disabled.
+  std::string snapshot_path;
+  // How often the snapshot is written in background. Zero - only on shutdown.
+  std::chrono::seconds snapshot_interval = std::chrono::seconds(300);
+
+  // File, where the ServerMetrics are dumped in Prometheus text format. Empty - no dumps, the
+  // metrics are available only via the admin request (#a).
+  std::string metrics_path;
+  std::chrono::seconds metrics_interval = std::chrono::seconds(10);
+
+  // Spans of the traced requests are written to trace_config.output_path on shutdown. Empty -
+  // tracing is disabled. The requests are sampled by the client.
+  TraceConfig trace_config;
+
+  // Every received request and sent response is appended to the file, so the traffic can be
+  // replayed by CaptureReplay. Empty - no capture.
+  std::string capture_path;
+
+  // Admission control of the requests by their queueing delay (see AdmissionControl). Zero
+  // target - every request is executed.
+  std::chrono::microseconds admission_target = std::chrono::microseconds(0);
+  std::chrono::microseconds admission_interval = std::chrono::microseconds(100000);
+
+  // Deficit round robin of the requests of the clients over the execution slots. Disabled by
+  // default - every connection executes its requests right away.
+  FairSchedulerConfig scheduler_config;
+
+  // Messages are written by the background thread of the Logger (see Logger::StartAsync()).
+  bool is_async_logging = true;
+  LoggerConfig logger_config;
+};
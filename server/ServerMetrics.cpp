@@ -0,0 +1,246 @@
+#include "ServerMetrics.h"
+
+#include <windows.h>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include "Logger.h"
+
+static constexpr auto kLogTag = "ServerMetrics";
+
+namespace {
+// Names of MetricsStage: request processing stages and the executed commands.
+constexpr const char* kStageNames[] = {"read",          "queue",          "schedule",
+                                       "parse",         "send",           "create",
+                                       "get",           "destroy",        "count",
+                                       "PrintToCout",   "PrintToString",  "SetIntegerValue",
+                                       "SetStringValue"};
+static_assert(std::size(kStageNames) == kMetricsStagesCount);
+
+constexpr size_t kCommandsBegin = static_cast<size_t>(MetricsStage::Create);
+
+// Bucket bounds of the exported Prometheus histograms, in seconds.
+constexpr double kPrometheusBounds[] = {1e-6,  5e-6,  1e-5, 5e-5, 1e-4, 5e-4, 1e-3,
+                                        5e-3,  1e-2,  5e-2, 0.1,  0.5,  1.0,  5.0};
+
+void AddCounters(ClientCounters& total, const ClientCounters& counters) {
+  total.requests += counters.requests;
+  total.bytes_in += counters.bytes_in;
+  total.bytes_out += counters.bytes_out;
+  total.expired += counters.expired;
+  total.cancelled += counters.cancelled;
+  total.rejected += counters.rejected;
+}
+
+// Single writer counter - see LatencyHistogram::Record().
+inline void Increment(std::atomic<uint64_t>& counter, uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void WritePrometheusHistogram(std::ostream& out, const std::string& labels,
+                              const HistogramSnapshot& histogram) {
+  for (const auto bound : kPrometheusBounds) {
+    const auto bound_ns = static_cast<uint64_t>(bound * 1e9);
+    out << "namedpipe_latency_seconds_bucket{" << labels << ",le=\"" << bound << "\"} "
+        << histogram.CountBelow(bound_ns) << "\n";
+  }
+  out << "namedpipe_latency_seconds_bucket{" << labels << ",le=\"+Inf\"} " << histogram.count
+      << "\n";
+  out << "namedpipe_latency_seconds_sum{" << labels << "} " << histogram.sum / 1e9 << "\n";
+  out << "namedpipe_latency_seconds_count{" << labels << "} " << histogram.count << "\n";
+}
+
+void WritePrometheusCounter(std::ostream& out, const std::string& name, const std::string& help,
+                            const std::vector<ClientCounters>& clients,
+                            const ClientCounters& total, uint64_t ClientCounters::*counter) {
+  out << "# HELP " << name << " " << help << "\n";
+  out << "# TYPE " << name << " counter\n";
+  for (const auto& client : clients) {
+    out << name << "{client=\"" << client.client_id << "\"} " << client.*counter << "\n";
+  }
+  out << name << "{client=\"all\"} " << total.*counter << "\n";
+}
+}  // namespace
+
+std::string MetricsSnapshot::ToString() const {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1);
+  for (size_t i = 0; i < stages.size(); ++i) {
+    const auto& histogram = stages[i];
+    if (histogram.count == 0) {
+      continue;
+    }
+    ss << (i < kCommandsBegin ? "stage=" : "method=") << kStageNames[i]
+       << " count=" << histogram.count << " p50=" << histogram.GetPercentile(50) / 1e3
+       << "us p90=" << histogram.GetPercentile(90) / 1e3
+       << "us p99=" << histogram.GetPercentile(99) / 1e3
+       << "us p99.9=" << histogram.GetPercentile(99.9) / 1e3
+       << "us max=" << histogram.GetPercentile(100) / 1e3 << "us\n";
+  }
+  for (const auto& client : clients) {
+    ss << "client=" << client.client_id << " requests=" << client.requests
+       << " bytes_in=" << client.bytes_in << " bytes_out=" << client.bytes_out
+       << " expired=" << client.expired << " cancelled=" << client.cancelled
+       << " rejected=" << client.rejected << "\n";
+  }
+  ss << "total requests=" << total.requests << " bytes_in=" << total.bytes_in
+     << " bytes_out=" << total.bytes_out << " expired=" << total.expired
+     << " cancelled=" << total.cancelled << " rejected=" << total.rejected << "\n";
+  return ss.str();
+}
+
+std::string MetricsSnapshot::ToPrometheus() const {
+  std::stringstream ss;
+  ss << "# HELP namedpipe_latency_seconds Latency of the request processing stages and of the "
+        "executed commands.\n";
+  ss << "# TYPE namedpipe_latency_seconds histogram\n";
+  for (size_t i = 0; i < stages.size(); ++i) {
+    const auto labels =
+        std::string(i < kCommandsBegin ? "stage=\"" : "stage=\"execute\",method=\"") +
+        kStageNames[i] + "\"";
+    WritePrometheusHistogram(ss, labels, stages[i]);
+  }
+
+  WritePrometheusCounter(ss, "namedpipe_requests_total", "Requests received from the clients.",
+                         clients, total, &ClientCounters::requests);
+  WritePrometheusCounter(ss, "namedpipe_received_bytes_total", "Bytes received from the clients.",
+                         clients, total, &ClientCounters::bytes_in);
+  WritePrometheusCounter(ss, "namedpipe_sent_bytes_total", "Bytes sent to the clients.", clients,
+                         total, &ClientCounters::bytes_out);
+  WritePrometheusCounter(ss, "namedpipe_expired_requests_total",
+                         "Requests, which were dropped after their deadline.", clients, total,
+                         &ClientCounters::expired);
+  WritePrometheusCounter(ss, "namedpipe_cancelled_requests_total",
+                         "Requests, which were cancelled by the clients.", clients, total,
+                         &ClientCounters::cancelled);
+  WritePrometheusCounter(ss, "namedpipe_rejected_requests_total",
+                         "Requests, which were rejected by the overloaded server.", clients,
+                         total, &ClientCounters::rejected);
+  return ss.str();
+}
+
+// Metrics of one thread. Only the thread writes them.
+struct ServerMetrics::ThreadMetrics {
+  std::array<LatencyHistogram, kMetricsStagesCount> histograms;
+  std::atomic<int64_t> client_id = -1;
+  std::atomic<uint64_t> requests = 0;
+  std::atomic<uint64_t> bytes_in = 0;
+  std::atomic<uint64_t> bytes_out = 0;
+  std::atomic<uint64_t> expired = 0;
+  std::atomic<uint64_t> cancelled = 0;
+  std::atomic<uint64_t> rejected = 0;
+  // The thread has exited - the metrics are moved to the retired ones on the next snapshot.
+  std::atomic<bool> is_closed = false;
+};
+
+ServerMetrics& ServerMetrics::GetInstance() {
+  static ServerMetrics instance;
+  return instance;
+}
+
+ServerMetrics::ThreadMetrics& ServerMetrics::GetThreadMetrics() {
+  // Thread-local reference to the metrics, which closes them on thread exit.
+  struct ThreadMetricsHolder {
+    ~ThreadMetricsHolder() {
+      if (metrics) {
+        metrics->is_closed = true;
+      }
+    }
+    std::shared_ptr<ThreadMetrics> metrics;
+  };
+
+  thread_local ThreadMetricsHolder holder;
+  if (!holder.metrics) {
+    holder.metrics = std::make_shared<ThreadMetrics>();
+    std::lock_guard<std::mutex> locker(mutex_);
+    threads_.push_back(holder.metrics);
+  }
+  return *holder.metrics;
+}
+
+void ServerMetrics::BindClient(size_t client_id) {
+  GetThreadMetrics().client_id.store(static_cast<int64_t>(client_id), std::memory_order_relaxed);
+}
+
+void ServerMetrics::RecordLatency(MetricsStage stage,
+                                  std::chrono::steady_clock::duration elapsed) {
+  const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  GetThreadMetrics().histograms[static_cast<size_t>(stage)].Record(
+      static_cast<uint64_t>(std::max<int64_t>(nanoseconds, 0)));
+}
+
+void ServerMetrics::RecordRequest(size_t bytes) {
+  auto& metrics = GetThreadMetrics();
+  Increment(metrics.requests, 1);
+  Increment(metrics.bytes_in, bytes);
+}
+
+void ServerMetrics::RecordResponse(size_t bytes) {
+  Increment(GetThreadMetrics().bytes_out, bytes);
+}
+
+void ServerMetrics::RecordExpiredRequest() { Increment(GetThreadMetrics().expired, 1); }
+
+void ServerMetrics::RecordCancelledRequest() { Increment(GetThreadMetrics().cancelled, 1); }
+
+void ServerMetrics::RecordRejectedRequest() { Increment(GetThreadMetrics().rejected, 1); }
+
+MetricsSnapshot ServerMetrics::GetSnapshot() {
+  std::lock_guard<std::mutex> locker(mutex_);
+  MetricsSnapshot snapshot = retired_;
+  for (auto iter = threads_.begin(); iter != threads_.end();) {
+    const auto& metrics = **iter;
+    // the thread doesn't write anymore, once it's closed:
+    const bool is_closed = metrics.is_closed.load(std::memory_order_acquire);
+
+    const ClientCounters counters{metrics.client_id.load(std::memory_order_relaxed),
+                                  metrics.requests.load(std::memory_order_relaxed),
+                                  metrics.bytes_in.load(std::memory_order_relaxed),
+                                  metrics.bytes_out.load(std::memory_order_relaxed),
+                                  metrics.expired.load(std::memory_order_relaxed),
+                                  metrics.cancelled.load(std::memory_order_relaxed),
+                                  metrics.rejected.load(std::memory_order_relaxed)};
+    auto add_thread_metrics = [&](MetricsSnapshot& target) {
+      for (size_t i = 0; i < kMetricsStagesCount; ++i) {
+        target.stages[i].Add(metrics.histograms[i]);
+      }
+      AddCounters(target.total, counters);
+    };
+
+    add_thread_metrics(snapshot);
+    if (is_closed) {
+      add_thread_metrics(retired_);
+      iter = threads_.erase(iter);
+      continue;
+    }
+    if (counters.client_id >= 0) {
+      snapshot.clients.push_back(counters);
+    }
+    ++iter;
+  }
+  return snapshot;
+}
+
+bool ServerMetrics::WritePrometheus(const std::string& path) {
+  const auto text = GetSnapshot().ToPrometheus();
+
+  // scrapers must not see a partially written file:
+  const auto tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    file << text;
+    if (!file.flush()) {
+      Logger::LogError(Logger::to_string(std::stringstream()
+                                         << kLogTag << ": ERROR - failed to write=" << tmp_path));
+      return false;
+    }
+  }
+  if (!MoveFileEx(tmp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - failed to replace=" << path
+                                       << ", error=" << GetLastError()));
+    return false;
+  }
+  return true;
+}
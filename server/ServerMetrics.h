@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "LatencyHistogram.h"
+
+// Stages of the request processing, each has its own latency histogram.
+enum class MetricsStage : uint8_t {
+  // ReadFile of the request, including the wait for the client to send it
+  Read = 0,
+  // From the send of the request by the client (or its read) till its execution
+  Queue,
+  // Wait for the execution slot of the FairScheduler
+  Schedule,
+  // RequestParser::ParseRequest, including the execution
+  Parse,
+  // Server::SendResponseToClient
+  Send,
+  // Execution of the CustomClass commands, methods (#m) are tracked per method name:
+  Create,
+  Get,
+  Destroy,
+  CountInstances,
+  PrintToCout,
+  PrintToString,
+  SetIntegerValue,
+  SetStringValue,
+  StagesCount
+};
+
+constexpr size_t kMetricsStagesCount = static_cast<size_t>(MetricsStage::StagesCount);
+
+// Traffic of one client (connection).
+struct ClientCounters {
+  int64_t client_id = -1;
+  uint64_t requests = 0;
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+  // requests, which were dropped without execution or whose responses weren't sent
+  uint64_t expired = 0;
+  uint64_t cancelled = 0;
+  // requests, which were rejected by the AdmissionControl
+  uint64_t rejected = 0;
+};
+
+// Aggregated metrics of all the server threads.
+struct MetricsSnapshot {
+  MetricsSnapshot() : stages(kMetricsStagesCount) {}
+
+  // Compact text with the percentiles - the response on the admin request.
+  std::string ToString() const;
+  // Prometheus text exposition format.
+  std::string ToPrometheus() const;
+
+  // indexed by MetricsStage
+  std::vector<HistogramSnapshot> stages;
+  // connected clients
+  std::vector<ClientCounters> clients;
+  // all the clients, including the disconnected ones
+  ClientCounters total;
+};
+
+// Latency histograms and traffic counters of the server.
+// Every thread records into its own histograms and counters, so recording is a few plain stores
+// without any lock or contended cache line. Snapshots are aggregated on demand - see the admin
+// request (#a) in RequestParser and ServerConfig::metrics_path.
+class ServerMetrics {
+ public:
+  static ServerMetrics& GetInstance();
+
+  // Labels the counters of the calling thread with the client, which it serves.
+  void BindClient(size_t client_id);
+
+  void RecordLatency(MetricsStage stage, std::chrono::steady_clock::duration elapsed);
+  // Received request and sent response of the calling thread's client.
+  void RecordRequest(size_t bytes);
+  void RecordResponse(size_t bytes);
+  // Request of the calling thread's client, which was dropped after its deadline or cancelled.
+  void RecordExpiredRequest();
+  void RecordCancelledRequest();
+  // Request of the calling thread's client, which was rejected by the overloaded server.
+  void RecordRejectedRequest();
+
+  MetricsSnapshot GetSnapshot();
+  // Writes the snapshot in Prometheus format, replacing the file atomically.
+  bool WritePrometheus(const std::string& path);
+
+ private:
+  ServerMetrics() = default;
+
+  struct ThreadMetrics;
+  ThreadMetrics& GetThreadMetrics();
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<ThreadMetrics>> threads_;
+  // metrics of the exited threads
+  MetricsSnapshot retired_;
+};
+
+// Records the latency of the stage from the construction till the destruction.
+class StageTimer {
+ public:
+  explicit StageTimer(MetricsStage stage)
+      : stage_(stage), begin_(std::chrono::steady_clock::now()) {}
+  ~StageTimer() {
+    ServerMetrics::GetInstance().RecordLatency(stage_, std::chrono::steady_clock::now() - begin_);
+  }
+
+ private:
+  const MetricsStage stage_;
+  const std::chrono::steady_clock::time_point begin_;
+};
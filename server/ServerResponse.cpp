@@ -1,14 +1,41 @@
 #include "ServerResponse.h"
 
+#include <algorithm>
+#include <iterator>
+
 ServerResponse::ServerResponse(RawDataType data, SuccessCallbackType success_callback,
                                FailureCallbackType failure_callback)
-    : data_(std::move(data)),
+    : data_(kHeadroom),
       success_callback_(std::move(success_callback)),
-      failure_callback_(std::move(failure_callback)) {}
+      failure_callback_(std::move(failure_callback)) {
+  data_.insert(data_.end(), data.begin(), data.end());
+}
+
+bool ServerResponse::IsValid() const { return data_.size() > kHeadroom; }
+
+void ServerResponse::Reset() {
+  data_.resize(kHeadroom);
+  success_callback_ = nullptr;
+  failure_callback_ = nullptr;
+  request_id_ = -1;
+  trace_ = TraceContext{};
+  encoding_ = WireEncoding::Fixed;
+}
 
-bool ServerResponse::IsValid() const { return !data_.empty(); }
+std::pair<bool, size_t> ServerResponse::PrependHeaders(const RawDataType& headers) {
+  if (data_.size() < kHeadroom || headers.size() > kHeadroom) {
+    return std::make_pair(false, size_t{0});
+  }
+  const auto offset = kHeadroom - headers.size();
+  std::copy(headers.begin(), headers.end(), std::next(data_.begin(), offset));
+  return std::make_pair(true, offset);
+}
 
-RawDataType ServerResponse::GetData() const { return data_; }
+void ServerResponse::SetCallbacks(SuccessCallbackType success_callback,
+                                  FailureCallbackType failure_callback) {
+  success_callback_ = std::move(success_callback);
+  failure_callback_ = std::move(failure_callback);
+}
 
 void ServerResponse::HandleSuccess(ClientId client_id) {
   if (success_callback_) {
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <functional>
+#include <utility>
+#include "DataSerializer.h"
+#include "Tracer.h"
 #include "Types.h"
 
 // Class, which encapsulate the response from the server on the client's
@@ -17,6 +20,11 @@ class ServerResponse final {
   using ClientId = int;
   using ErrorCode = int;
 
+  // Bytes, which are reserved in front of the data for the request id and the trace headers, so
+  // the headers are written right before the payload and the frame is sent by one write without
+  // copying the payload.
+  static constexpr size_t kHeadroom = 2 + DataSerializer::kMaxIntSize + TraceContext::kHeaderSize;
+
   // first paramter - client id
   using SuccessCallbackType = std::function<void(ClientId)>;
   // first paramter - client_id, second - error
@@ -32,7 +40,20 @@ class ServerResponse final {
 
   bool IsValid() const;
 
-  RawDataType GetData() const;
+  // Makes the response invalid for the next request of the connection and reserves the headroom.
+  // The capacity of the data is kept, so the next response is serialized in place without
+  // allocations.
+  void Reset();
+
+  // Data to serialize the response into, after Reset() - only appended to, see
+  // DataSerializer::AppendToRawData().
+  inline RawDataType& GetMutableData() { return data_; }
+
+  // Copies the headers into the end of the headroom. Returns the offset of the frame - the headers
+  // and the payload - in the data, false - the headers don't fit.
+  std::pair<bool, size_t> PrependHeaders(const RawDataType& headers);
+
+  void SetCallbacks(SuccessCallbackType success_callback, FailureCallbackType failure_callback);
 
   // Called when response is successfully sent.
   void HandleSuccess(ClientId client_id);
@@ -43,9 +64,23 @@ class ServerResponse final {
 
   inline RequestId GetRequestId() const { return request_id_; }
 
+  // Trace of the request, which is echoed in the response.
+  inline void SetTraceContext(const TraceContext& trace) { trace_ = trace; }
+
+  inline const TraceContext& GetTraceContext() const { return trace_; }
+
+  // Encoding of the request, which the response is serialized in (see WireFormat.h).
+  inline void SetEncoding(WireEncoding encoding) { encoding_ = encoding; }
+
+  inline WireEncoding GetEncoding() const { return encoding_; }
+
  private:
+  // the headroom and the payload, empty - the invalid response isn't reset yet, so the default
+  // one doesn't allocate
   RawDataType data_;
   SuccessCallbackType success_callback_;
   FailureCallbackType failure_callback_;
   RequestId request_id_ = -1;
+  TraceContext trace_;
+  WireEncoding encoding_ = WireEncoding::Fixed;
 };
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "TrafficCapture.h"
+
+#include <cstring>
+#include <sstream>
+#include "Logger.h"
+
+static constexpr auto kLogTag = "TrafficCapture";
+
+static constexpr size_t kWriteBufferSize = 1 << 20;
+// The server is usually terminated, not closed, so the buffer mustn't keep the frames for long.
+static constexpr auto kFlushInterval = std::chrono::milliseconds(100);
+
+TrafficCapture::TrafficCapture(const std::string& path) : path_(path) {}
+
+TrafficCapture::~TrafficCapture() { Close(); }
+
+bool TrafficCapture::Open() {
+  std::lock_guard<std::mutex> locker(mutex_);
+  file_handle_ = CreateFile(path_.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_handle_ == INVALID_HANDLE_VALUE) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't create the capture="
+                                       << path_ << ", error=" << GetLastError()));
+    return false;
+  }
+
+  start_time_ = std::chrono::steady_clock::now();
+  last_flush_time_ = start_time_;
+  CaptureFileHeader header = {};
+  std::memcpy(header.magic, kCaptureMagic, sizeof(kCaptureMagic));
+  header.start_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count();
+  buffer_.reserve(kWriteBufferSize);
+  const auto* header_data = reinterpret_cast<const char*>(&header);
+  buffer_.insert(buffer_.end(), header_data, header_data + sizeof(header));
+  return true;
+}
+
+void TrafficCapture::Close() {
+  std::lock_guard<std::mutex> locker(mutex_);
+  if (file_handle_ == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  FlushBuffer();
+  CloseHandle(file_handle_);
+  file_handle_ = INVALID_HANDLE_VALUE;
+}
+
+void TrafficCapture::Append(size_t client_id, bool is_response, const RawDataType& data) {
+  CaptureFrameHeader header = {};
+  header.client_id = static_cast<uint32_t>(client_id);
+  header.size = static_cast<uint32_t>(data.size()) | (is_response ? kCaptureResponseFlag : 0);
+  const auto* header_data = reinterpret_cast<const char*>(&header);
+
+  std::lock_guard<std::mutex> locker(mutex_);
+  if (file_handle_ == INVALID_HANDLE_VALUE || has_failed_) {
+    return;
+  }
+  // stamped under the lock, so the frames are in the order of their timestamps:
+  const auto now = std::chrono::steady_clock::now();
+  header.timestamp_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_time_).count();
+  if (buffer_.size() + sizeof(header) + data.size() > kWriteBufferSize && !FlushBuffer()) {
+    return;
+  }
+  buffer_.insert(buffer_.end(), header_data, header_data + sizeof(header));
+  buffer_.insert(buffer_.end(), data.begin(), data.end());
+  if (now - last_flush_time_ >= kFlushInterval) {
+    FlushBuffer();
+  }
+}
+
+bool TrafficCapture::FlushBuffer() {
+  if (buffer_.empty() || has_failed_) {
+    return !has_failed_;
+  }
+
+  DWORD bytes_written = 0;
+  if (!WriteFile(file_handle_, buffer_.data(), static_cast<DWORD>(buffer_.size()), &bytes_written,
+                 nullptr) ||
+      bytes_written != buffer_.size()) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't write the capture=" << path_
+                                       << ", error=" << GetLastError()
+                                       << " - capturing is stopped"));
+    has_failed_ = true;
+    return false;
+  }
+  buffer_.clear();
+  last_flush_time_ = std::chrono::steady_clock::now();
+  return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <windows.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "CaptureFormat.h"
+#include "Types.h"
+
+// Appends every request, which the server queues, and every response, which it sends, with
+// the timestamp and the client id to the capture file (see CaptureFormat.h). The capture can be
+// replayed against another server by CaptureReplay.
+// Frames are buffered and written, when the buffer is full or every kFlushInterval, so a capture
+// costs a copy of the frame under the lock on the request path.
+class TrafficCapture {
+ public:
+  explicit TrafficCapture(const std::string& path);
+  ~TrafficCapture();
+
+  // Creates the file, an existing capture is overwritten.
+  bool Open();
+  // Writes the buffered frames and closes the file.
+  void Close();
+
+  void Append(size_t client_id, bool is_response, const RawDataType& data);
+
+ private:
+  // non-movable, non-copyable
+  TrafficCapture(const TrafficCapture& other) = delete;
+  TrafficCapture& operator=(const TrafficCapture& other) = delete;
+
+  // Should be called under the lock:
+  bool FlushBuffer();
+
+ private:
+  const std::string path_;
+  std::chrono::steady_clock::time_point start_time_;
+
+  std::mutex mutex_;
+  HANDLE file_handle_ = INVALID_HANDLE_VALUE;
+  std::vector<char> buffer_;
+  std::chrono::steady_clock::time_point last_flush_time_;
+  bool has_failed_ = false;
+};
@@ -0,0 +1,407 @@
+#include "WriteAheadLog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include "Logger.h"
+
+static constexpr auto kLogTag = "WriteAheadLog";
+
+// <u32 body size><u32 checksum>
+static constexpr size_t kRecordHeaderSize = 2 * sizeof(uint32_t);
+// <u8 type><u64 lsn><i32 handle>
+static constexpr size_t kRecordBodyPrefixSize = 1 + sizeof(uint64_t) + sizeof(ClassHandle);
+
+namespace {
+
+// FNV-1a - it is enough to detect a torn write at the tail of the log.
+uint32_t CalculateChecksum(const char* data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+template <class Type>
+void AppendValue(std::string& buffer, Type value) {
+  char raw[sizeof(Type)];
+  std::memcpy(raw, &value, sizeof(Type));
+  buffer.append(raw, sizeof(Type));
+}
+
+template <class Type>
+Type ReadValue(const char* data) {
+  Type value;
+  std::memcpy(&value, data, sizeof(Type));
+  return value;
+}
+
+void AppendRecord(std::string& buffer, WalRecordType type, uint64_t lsn, ClassHandle handle,
+                  const std::string& payload) {
+  const auto body_size = static_cast<uint32_t>(kRecordBodyPrefixSize + payload.size());
+  const size_t record_offset = buffer.size();
+
+  AppendValue<uint32_t>(buffer, body_size);
+  AppendValue<uint32_t>(buffer, 0);  // checksum placeholder
+  buffer.push_back(static_cast<char>(type));
+  AppendValue<uint64_t>(buffer, lsn);
+  AppendValue<ClassHandle>(buffer, handle);
+  buffer.append(payload);
+
+  const auto checksum =
+      CalculateChecksum(buffer.data() + record_offset + kRecordHeaderSize, body_size);
+  std::memcpy(&buffer[record_offset + sizeof(uint32_t)], &checksum, sizeof(uint32_t));
+}
+
+bool ReadWholeFile(const std::string& path, std::string& content) {
+  HANDLE file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return false;
+  }
+
+  content.resize(static_cast<size_t>(size.QuadPart));
+  size_t offset = 0;
+  while (offset < content.size()) {
+    DWORD bytes_read = 0;
+    const auto chunk = static_cast<DWORD>(std::min<size_t>(content.size() - offset, 1 << 30));
+    if (!ReadFile(file, &content[offset], chunk, &bytes_read, nullptr) || bytes_read == 0) {
+      break;
+    }
+    offset += bytes_read;
+  }
+  content.resize(offset);
+
+  CloseHandle(file);
+  return true;
+}
+
+bool WriteWholeFile(const std::string& path, const char* data, size_t size) {
+  HANDLE file = CreateFile(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  size_t offset = 0;
+  while (offset < size) {
+    DWORD bytes_written = 0;
+    const auto chunk = static_cast<DWORD>(std::min<size_t>(size - offset, 1 << 30));
+    if (!WriteFile(file, data + offset, chunk, &bytes_written, nullptr)) {
+      break;
+    }
+    offset += bytes_written;
+  }
+
+  const bool success = offset == size && FlushFileBuffers(file);
+  CloseHandle(file);
+  return success;
+}
+
+// Offset of the first record with LSN greater than lsn (or the end of the valid records).
+size_t FindRecordAfter(const std::string& content, uint64_t lsn) {
+  size_t offset = 0;
+  while (content.size() >= offset + kRecordHeaderSize) {
+    const auto body_size = ReadValue<uint32_t>(content.data() + offset);
+    const char* body = content.data() + offset + kRecordHeaderSize;
+    if (body_size < kRecordBodyPrefixSize ||
+        content.size() < offset + kRecordHeaderSize + body_size ||
+        ReadValue<uint64_t>(body + 1) > lsn) {
+      break;
+    }
+    offset += kRecordHeaderSize + body_size;
+  }
+  return offset;
+}
+
+// Parses records from content and returns the number of bytes occupied by valid records.
+size_t ParseRecords(const std::string& content, uint64_t from_lsn, uint64_t& last_lsn,
+                    const WriteAheadLog::ReplayCallback& callback) {
+  size_t offset = 0;
+  WalRecord record;
+  while (content.size() >= offset + kRecordHeaderSize) {
+    const auto body_size = ReadValue<uint32_t>(content.data() + offset);
+    const auto checksum = ReadValue<uint32_t>(content.data() + offset + sizeof(uint32_t));
+    const char* body = content.data() + offset + kRecordHeaderSize;
+
+    if (body_size < kRecordBodyPrefixSize ||
+        content.size() < offset + kRecordHeaderSize + body_size ||
+        CalculateChecksum(body, body_size) != checksum) {
+      break;
+    }
+
+    record.type = static_cast<WalRecordType>(body[0]);
+    record.lsn = ReadValue<uint64_t>(body + 1);
+    record.handle = ReadValue<ClassHandle>(body + 1 + sizeof(uint64_t));
+    record.payload.assign(body + kRecordBodyPrefixSize, body_size - kRecordBodyPrefixSize);
+
+    if (record.lsn > from_lsn) {
+      if (callback) {
+        callback(record);
+      }
+      last_lsn = record.lsn;
+    }
+    offset += kRecordHeaderSize + body_size;
+  }
+  return offset;
+}
+}  // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string& path, WalDurability durability,
+                             std::chrono::microseconds batch_interval)
+    : path_(path), durability_(durability), batch_interval_(batch_interval) {}
+
+WriteAheadLog::~WriteAheadLog() { Close(); }
+
+bool WriteAheadLog::Open(const ReplayCallback& callback, uint64_t from_lsn) {
+  std::lock_guard<std::mutex> locker(mutex_);
+  if (!is_closed_) {
+    return true;
+  }
+
+  // Continue the LSN sequence and cut off the torn tail (if any), otherwise new records
+  // would be appended after garbage and lost on the next replay.
+  std::string content;
+  uint64_t last_lsn = from_lsn;
+  size_t valid_size = 0;
+  if (ReadWholeFile(path_, content)) {
+    valid_size = ParseRecords(content, from_lsn, last_lsn, callback);
+  }
+
+  file_handle_ = CreateFile(path_.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_handle_ == INVALID_HANDLE_VALUE) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't open the log=" << path_
+                                       << ", error=" << GetLastError()));
+    return false;
+  }
+
+  LARGE_INTEGER position;
+  position.QuadPart = static_cast<LONGLONG>(valid_size);
+  if (!SetFilePointerEx(file_handle_, position, nullptr, FILE_BEGIN) ||
+      !SetEndOfFile(file_handle_)) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't truncate the log=" << path_
+                                       << ", error=" << GetLastError()));
+    CloseHandle(file_handle_);
+    file_handle_ = INVALID_HANDLE_VALUE;
+    return false;
+  }
+
+  if (valid_size != content.size()) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": dropped " << content.size() - valid_size
+                                       << " bytes of torn records at the end of the log"));
+  }
+
+  next_lsn_ = last_lsn + 1;
+  written_lsn_ = last_lsn;
+  is_closed_ = false;
+  has_failed_ = false;
+  writer_thread_ = std::thread(&WriteAheadLog::WriterLoop, this);
+
+  Logger::LogDebug(Logger::to_string(std::stringstream() << kLogTag << ": opened the log="
+                                                         << path_ << ", next lsn=" << next_lsn_));
+  return true;
+}
+
+void WriteAheadLog::Close() {
+  {
+    std::lock_guard<std::mutex> locker(mutex_);
+    if (is_closed_) {
+      return;
+    }
+    is_closed_ = true;
+  }
+  pending_cv_.notify_one();
+
+  // the writer drains all pending records before exiting
+  if (writer_thread_.joinable()) {
+    writer_thread_.join();
+  }
+
+  CloseHandle(file_handle_);
+  file_handle_ = INVALID_HANDLE_VALUE;
+}
+
+uint64_t WriteAheadLog::Append(WalRecordType type, ClassHandle handle,
+                               const std::string& payload) {
+  const auto lsn = Enqueue(type, handle, payload);
+  return lsn != 0 && WaitForDurability(lsn) ? lsn : 0;
+}
+
+uint64_t WriteAheadLog::Enqueue(WalRecordType type, ClassHandle handle,
+                                const std::string& payload) {
+  std::lock_guard<std::mutex> locker(mutex_);
+  if (is_closed_ || has_failed_) {
+    return 0;
+  }
+
+  const auto lsn = next_lsn_++;
+  AppendRecord(pending_, type, lsn, handle, payload);
+  pending_cv_.notify_one();
+  return lsn;
+}
+
+bool WriteAheadLog::WaitForDurability(uint64_t lsn) {
+  if (durability_ != WalDurability::PerRequest) {
+    return true;
+  }
+
+  std::unique_lock<std::mutex> locker(mutex_);
+  durable_cv_.wait(locker, [this, lsn] { return written_lsn_ >= lsn || has_failed_; });
+  return written_lsn_ >= lsn;
+}
+
+void WriteAheadLog::Sync() {
+  std::unique_lock<std::mutex> locker(mutex_);
+  const auto lsn = next_lsn_ - 1;
+  durable_cv_.wait(locker,
+                   [this, lsn] { return written_lsn_ >= lsn || has_failed_ || is_closed_; });
+}
+
+uint64_t WriteAheadLog::GetLastLsn() {
+  std::lock_guard<std::mutex> locker(mutex_);
+  return next_lsn_ - 1;
+}
+
+bool WriteAheadLog::Truncate(uint64_t up_to_lsn) {
+  // the writer doesn't append anything meanwhile - the records are appended to the new file
+  std::lock_guard<std::mutex> file_locker(file_mutex_);
+  if (file_handle_ == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  std::string content;
+  if (!ReadWholeFile(path_, content)) {
+    return false;
+  }
+  const size_t offset = FindRecordAfter(content, up_to_lsn);
+  if (offset == 0) {
+    return true;
+  }
+
+  // The log is replaced at once, thus, a crash leaves either the old or the new one.
+  const auto tmp_path = path_ + ".tmp";
+  if (!WriteWholeFile(tmp_path, content.data() + offset, content.size() - offset)) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - failed to write=" << tmp_path
+                                       << ", error=" << GetLastError()));
+    DeleteFile(tmp_path.c_str());
+    return false;
+  }
+
+  CloseHandle(file_handle_);
+  const bool success = MoveFileEx(tmp_path.c_str(), path_.c_str(),
+                                  MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+  if (!success) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - failed to replace the log="
+                                       << path_ << ", error=" << GetLastError()));
+  }
+
+  // continue appending to the end of the log (either new or old one)
+  LARGE_INTEGER position;
+  position.QuadPart = 0;
+  file_handle_ = CreateFile(path_.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_handle_ == INVALID_HANDLE_VALUE ||
+      !SetFilePointerEx(file_handle_, position, nullptr, FILE_END)) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - can't reopen the log=" << path_
+                                       << ", error=" << GetLastError()));
+    std::lock_guard<std::mutex> locker(mutex_);
+    has_failed_ = true;
+    durable_cv_.notify_all();
+    return false;
+  }
+
+  Logger::LogDebug(Logger::to_string(std::stringstream()
+                                     << kLogTag << ": dropped " << offset << " bytes of records"
+                                     << " up to lsn=" << up_to_lsn << " from the log=" << path_));
+  return success;
+}
+
+void WriteAheadLog::WriterLoop() {
+  std::string batch;
+
+  std::unique_lock<std::mutex> locker(mutex_);
+  while (true) {
+    pending_cv_.wait(locker, [this] { return !pending_.empty() || is_closed_; });
+    if (pending_.empty()) {
+      break;  // closed and drained
+    }
+
+    if (durability_ == WalDurability::Batched && !is_closed_) {
+      // Let more requests join this batch - nobody is waiting for it anyway.
+      pending_cv_.wait_for(locker, batch_interval_, [this] { return is_closed_; });
+    }
+
+    // Everything appended while this batch is being written will form the next group.
+    batch.swap(pending_);
+    const auto batch_lsn = next_lsn_ - 1;
+    locker.unlock();
+
+    bool success = false;
+    {
+      std::lock_guard<std::mutex> file_locker(file_mutex_);
+      success = WriteBatch(batch);
+    }
+    batch.clear();
+
+    locker.lock();
+    if (success) {
+      written_lsn_ = batch_lsn;
+    } else {
+      has_failed_ = true;
+    }
+    durable_cv_.notify_all();
+  }
+}
+
+bool WriteAheadLog::WriteBatch(const std::string& batch) {
+  size_t offset = 0;
+  while (offset < batch.size()) {
+    DWORD bytes_written = 0;
+    const auto bytes_to_write = static_cast<DWORD>(batch.size() - offset);
+    if (!WriteFile(file_handle_, batch.data() + offset, bytes_to_write, &bytes_written,
+                   nullptr)) {
+      Logger::LogError(Logger::to_string(std::stringstream()
+                                         << kLogTag << ": ERROR - failed to write to the log="
+                                         << path_ << ", error=" << GetLastError()));
+      return false;
+    }
+    offset += bytes_written;
+  }
+
+  // FlushFileBuffers is the closest thing to fdatasync on Windows.
+  if (durability_ != WalDurability::None && !FlushFileBuffers(file_handle_)) {
+    Logger::LogError(Logger::to_string(std::stringstream()
+                                       << kLogTag << ": ERROR - failed to flush the log=" << path_
+                                       << ", error=" << GetLastError()));
+    return false;
+  }
+
+  return true;
+}
+
+uint64_t WriteAheadLog::Replay(const std::string& path, const ReplayCallback& callback,
+                               uint64_t from_lsn) {
+  std::string content;
+  uint64_t last_lsn = from_lsn;
+  if (!ReadWholeFile(path, content)) {
+    return last_lsn;
+  }
+
+  ParseRecords(content, from_lsn, last_lsn, callback);
+  return last_lsn;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <windows.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Types.h"
+
+// How hard the log tries to make an appended record durable:
+enum class WalDurability {
+  // Records are handed to the OS by the background writer, but never flushed explicitly.
+  None = 0,
+  // The background writer flushes every batch, but Append() doesn't wait for it.
+  Batched,
+  // Append() blocks until its record is flushed. Concurrent appends share one flush.
+  PerRequest
+};
+
+enum class WalRecordType : char { Create = 'c', Mutate = 'm', Destroy = 'd' };
+
+struct WalRecord {
+  WalRecordType type = WalRecordType::Create;
+  uint64_t lsn = 0;
+  ClassHandle handle = -1;
+  // Serialized state of the instance (empty for Destroy records)
+  std::string payload;
+};
+
+// Append-only log of ClassRegistry mutations.
+// Records are accumulated in memory by Append() and written by a single background thread, so
+// one FlushFileBuffers call (group commit) covers all records appended while the previous flush
+// was in progress.
+//
+// On-disk format of a record:
+//   <u32 body size><u32 checksum of body><body>
+//   body = <u8 type><u64 lsn><i32 handle><payload>
+class WriteAheadLog {
+ public:
+  using ReplayCallback = std::function<void(const WalRecord&)>;
+
+ public:
+  WriteAheadLog(const std::string& path, WalDurability durability,
+                std::chrono::microseconds batch_interval = std::chrono::microseconds(1000));
+  ~WriteAheadLog();
+
+  // Opens (or creates) the log file and starts the background writer.
+  // The records with LSN greater than from_lsn (the LSN of the snapshot) are passed to the
+  // callback in the same pass over the file. The next LSN continues the sequence found in the
+  // existing file, but not below from_lsn - the log truncated by a snapshot may be empty.
+  bool Open(const ReplayCallback& callback = nullptr, uint64_t from_lsn = 0);
+
+  // Writes all the pending records and stops the background writer.
+  void Close();
+
+  // Appends a record and returns its LSN (0 - failure).
+  // With WalDurability::PerRequest blocks until the record is flushed to disk.
+  uint64_t Append(WalRecordType type, ClassHandle handle, const std::string& payload);
+
+  // Appends a record without waiting for the flush and returns its LSN (0 - failure).
+  // Records are ordered as the calls, so the caller, which orders its changes by a lock, can
+  // call it under that lock and wait for the durability (WaitForDurability) after releasing it.
+  uint64_t Enqueue(WalRecordType type, ClassHandle handle, const std::string& payload);
+
+  // With WalDurability::PerRequest blocks until the record with lsn is flushed to disk.
+  // Returns false, if the record can't be written.
+  bool WaitForDurability(uint64_t lsn);
+
+  // Blocks until everything appended so far is written (and flushed, unless durability is None).
+  void Sync();
+
+  // LSN of the last appended record (it is not necessarily written yet).
+  uint64_t GetLastLsn();
+
+  // Drops the records with LSN up to up_to_lsn, which are covered by a written snapshot, so
+  // neither the file nor the replay on start grow with the whole history. The records after it
+  // are copied into a new file, which replaces the log.
+  bool Truncate(uint64_t up_to_lsn);
+
+  inline WalDurability GetDurability() const { return durability_; }
+
+  // Reads all valid records from the log at path with LSN greater than from_lsn.
+  // Reading stops at the first torn or corrupted record.
+  // Returns the LSN of the last valid record (or from_lsn if there are none).
+  static uint64_t Replay(const std::string& path, const ReplayCallback& callback,
+                         uint64_t from_lsn = 0);
+
+ private:
+  // non-movable, non-copyable
+  WriteAheadLog(const WriteAheadLog& other) = delete;
+  WriteAheadLog& operator=(const WriteAheadLog& other) = delete;
+
+  void WriterLoop();
+  bool WriteBatch(const std::string& batch);
+
+ private:
+  const std::string path_;
+  const WalDurability durability_;
+  const std::chrono::microseconds batch_interval_;
+
+  // The writer thread and Truncate() access the file under file_mutex_:
+  std::mutex file_mutex_;
+  HANDLE file_handle_ = INVALID_HANDLE_VALUE;
+
+  std::mutex mutex_;
+  std::condition_variable pending_cv_;
+  std::condition_variable durable_cv_;
+  // Records, which were appended, but not yet handed to the writer thread:
+  std::string pending_;
+  uint64_t next_lsn_ = 1;
+  uint64_t written_lsn_ = 0;
+  bool is_closed_ = true;
+  bool has_failed_ = false;
+
+  std::thread writer_thread_;
+};
@@ -1,13 +1,260 @@
+#include <windows.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ProfiledMutex.h"
 #include "Server.h"
+#include "ServerConfig.h"
+#include "Sharding.h"
 
-int main(int argc, int** argv) {
+static void PrintUsage() {
+  std::cerr << "Usage: NamedPipeServer [options]\n"
+            << "  --pipe <name>                        - full name of the pipe to serve\n"
+            << "  --wal <path>                         - log registry mutations to the file\n"
+            << "  --wal-durability none|batched|request - durability of the log (batched)\n"
+            << "  --snapshot <path>                    - map and periodically write snapshots\n"
+            << "  --snapshot-interval <seconds>        - period of snapshots, 0 - on exit (300)\n"
+            << "  --shards <count>                     - start a shard process per partition\n"
+            << "  --shard <index>                      - serve only one partition of --shards\n"
+            << "  --log sync|drop|block                - log right away or in background, and\n"
+            << "                                         drop or wait on overflow (drop)\n"
+            << "  --metrics <path>                     - dump the metrics in Prometheus format\n"
+            << "  --metrics-interval <seconds>         - period of the metrics dumps (10)\n"
+            << "  --trace <path>                       - write spans of the requests traced by\n"
+            << "                                         the client as Chrome trace JSON\n"
+            << "  --capture <path>                     - capture the requests and responses to\n"
+            << "                                         the file, see NamedPipeReplayBench\n"
+            << "  --binary-log <path>                  - log in binary format to the file, which\n"
+            << "                                         is rendered by NamedPipeLogDecode\n"
+            << "  --admission-target <us>              - when overloaded, reject requests, which\n"
+            << "                                         wait longer, 0 - admit all (0)\n"
+            << "  --admission-interval <us>            - how long the delay must stay above the\n"
+            << "                                         target to be an overload (100000)\n"
+            << "  --fair-slots <count>                 - execute at most count requests at once,\n"
+            << "                                         deficit round robin of the clients, 0 -\n"
+            << "                                         no scheduling (0)\n"
+            << "  --fair-cost frames|bytes             - cost of a request in the round (frames)\n"
+            << "  --fair-quantum <n>                   - credit of a client per round, 0 - one\n"
+            << "                                         frame or 4096 bytes (0)\n"
+            << "  --fair-client-quantum <exe>:<n>      - credit per round of the client processes\n"
+            << "                                         of the executable, e.g.\n"
+            << "                                         NamedPipeClient.exe:4\n"
+            << std::endl;
+}
+
+// Parses the whole text as a number. Returns false on garbage or overflow.
+template <class Type>
+static bool ParseNumber(std::string_view text, Type& value) {
+  const auto end = text.data() + text.size();
+  const auto [ptr, error] = std::from_chars(text.data(), end, value);
+  return error == std::errc() && ptr == end;
+}
+
+// Parses the value of the duration option.
+template <class Duration>
+static bool ParseDuration(std::string_view text, Duration& duration) {
+  typename Duration::rep count = 0;
+  if (!ParseNumber(text, count) || count < 0) {
+    return false;
+  }
+  duration = Duration(count);
+  return true;
+}
+
+// Parses the command line into the config. Returns false on unknown or invalid option.
+static bool ParseArguments(int argc, char** argv, ServerConfig& config, bool& is_shard) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+
+    if (arg == "--pipe" && has_value) {
+      config.pipe_name = argv[++i];
+    } else if (arg == "--wal" && has_value) {
+      config.wal_path = argv[++i];
+    } else if (arg == "--wal-durability" && has_value) {
+      const std::string value = argv[++i];
+      if (value == "none") {
+        config.wal_durability = WalDurability::None;
+      } else if (value == "batched") {
+        config.wal_durability = WalDurability::Batched;
+      } else if (value == "request") {
+        config.wal_durability = WalDurability::PerRequest;
+      } else {
+        return false;
+      }
+    } else if (arg == "--snapshot" && has_value) {
+      config.snapshot_path = argv[++i];
+    } else if (arg == "--snapshot-interval" && has_value) {
+      if (!ParseDuration(argv[++i], config.snapshot_interval)) {
+        return false;
+      }
+    } else if (arg == "--metrics" && has_value) {
+      config.metrics_path = argv[++i];
+    } else if (arg == "--metrics-interval" && has_value) {
+      if (!ParseDuration(argv[++i], config.metrics_interval)) {
+        return false;
+      }
+    } else if (arg == "--trace" && has_value) {
+      config.trace_config.output_path = argv[++i];
+    } else if (arg == "--capture" && has_value) {
+      config.capture_path = argv[++i];
+    } else if (arg == "--log" && has_value) {
+      const std::string value = argv[++i];
+      config.is_async_logging = value != "sync";
+      if (value == "drop") {
+        config.logger_config.overflow_policy = LogOverflowPolicy::Drop;
+      } else if (value == "block") {
+        config.logger_config.overflow_policy = LogOverflowPolicy::Block;
+      } else if (value != "sync") {
+        return false;
+      }
+    } else if (arg == "--binary-log" && has_value) {
+      config.is_async_logging = true;
+      config.logger_config.binary_log_path = argv[++i];
+    } else if (arg == "--admission-target" && has_value) {
+      if (!ParseDuration(argv[++i], config.admission_target)) {
+        return false;
+      }
+    } else if (arg == "--admission-interval" && has_value) {
+      if (!ParseDuration(argv[++i], config.admission_interval)) {
+        return false;
+      }
+    } else if (arg == "--fair-slots" && has_value) {
+      if (!ParseNumber(argv[++i], config.scheduler_config.slots_count)) {
+        return false;
+      }
+    } else if (arg == "--fair-cost" && has_value) {
+      const std::string value = argv[++i];
+      if (value == "frames") {
+        config.scheduler_config.cost = FairCost::Frames;
+      } else if (value == "bytes") {
+        config.scheduler_config.cost = FairCost::Bytes;
+      } else {
+        return false;
+      }
+    } else if (arg == "--fair-quantum" && has_value) {
+      if (!ParseNumber(argv[++i], config.scheduler_config.quantum)) {
+        return false;
+      }
+    } else if (arg == "--fair-client-quantum" && has_value) {
+      const std::string_view value = argv[++i];
+      const auto separator = value.rfind(':');
+      uint32_t quantum = 0;
+      if (separator == 0 || separator == std::string_view::npos ||
+          !ParseNumber(value.substr(separator + 1), quantum)) {
+        return false;
+      }
+      // the file names are compared in lower case
+      std::string client_name(value.substr(0, separator));
+      std::transform(client_name.begin(), client_name.end(), client_name.begin(),
+                     [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+      config.scheduler_config.client_quanta[client_name] = quantum;
+    } else if (arg == "--shards" && has_value) {
+      if (!ParseNumber(argv[++i], config.shards_count)) {
+        return false;
+      }
+    } else if (arg == "--shard" && has_value) {
+      if (!ParseNumber(argv[++i], config.shard_index)) {
+        return false;
+      }
+      is_shard = true;
+    } else {
+      return false;
+    }
+  }
+  return config.shards_count > 0 && config.shard_index < config.shards_count;
+}
+
+// Starts a process per shard with the same arguments plus --shard <index> and waits for them.
+static int RunShards(int argc, char** argv, size_t shards_count) {
+  std::string command_line = std::string("\"") + argv[0] + "\"";
+  for (int i = 1; i < argc; ++i) {
+    command_line += std::string(" \"") + argv[i] + "\"";
+  }
+
+  std::vector<PROCESS_INFORMATION> processes;
+  for (size_t shard = 0; shard < shards_count; ++shard) {
+    std::string shard_command_line = command_line + " --shard " + std::to_string(shard);
+
+    STARTUPINFO startup_info = {};
+    startup_info.cb = sizeof(startup_info);
+    PROCESS_INFORMATION process_info = {};
+    if (!CreateProcess(nullptr, &shard_command_line[0], nullptr, nullptr, FALSE, 0, nullptr,
+                       nullptr, &startup_info, &process_info)) {
+      std::cerr << "ERROR - failed to start the shard=" << shard << ", error=" << GetLastError()
+                << std::endl;
+      for (auto& process : processes) {
+        TerminateProcess(process.hProcess, 1);
+      }
+      return -1;
+    }
+    processes.push_back(process_info);
+  }
+
+  for (auto& process : processes) {
+    WaitForSingleObject(process.hProcess, INFINITE);
+    CloseHandle(process.hThread);
+    CloseHandle(process.hProcess);
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  ServerConfig config;
+  bool is_shard = false;
+  if (!ParseArguments(argc, argv, config, is_shard)) {
+    PrintUsage();
+    return -1;
+  }
+
+  if (config.shards_count > 1) {
+    if (!is_shard) {
+      return RunShards(argc, argv, config.shards_count);
+    }
+
+    // every shard has its own pipe, log, snapshot, metrics, trace and capture:
+    const auto suffix = ".shard" + std::to_string(config.shard_index);
+    config.pipe_name = GetShardPipeName(config.pipe_name, config.shard_index);
+    if (!config.wal_path.empty()) {
+      config.wal_path += suffix;
+    }
+    if (!config.snapshot_path.empty()) {
+      config.snapshot_path += suffix;
+    }
+    if (!config.metrics_path.empty()) {
+      config.metrics_path += suffix;
+    }
+    if (!config.trace_config.output_path.empty()) {
+      config.trace_config.output_path += suffix;
+    }
+    if (!config.capture_path.empty()) {
+      config.capture_path += suffix;
+    }
+  }
+
+  if (config.is_async_logging) {
+    Logger::StartAsync(config.logger_config);
+  }
+  if (!config.trace_config.output_path.empty()) {
+    config.trace_config.process_id = GetCurrentProcessId();
+    config.trace_config.process_name = "NamedPipeServer " + config.pipe_name;
+    Tracer::Start(config.trace_config);
+  }
+
+  int result = 0;
   {
-    Server server{"\\\\.\\pipe\\demo_pipe"};
+    Server server{config};
     if (!server.Start()) {
       std::cerr << "FATAL FAILURE - closing a program!" << std::endl;
-      return -1;
+      result = -1;
     }
   }
-  return 0;
+  LockProfiler::LogReport();
+  Tracer::Stop();
+  Logger::StopAsync();
+  return result;
 }
@@ -0,0 +1,257 @@
+// Renders the binary log of the Logger (see BinaryLogFormat.h) to text:
+//   <UTC time> [thread <index>] <LEVEL> <file>:<line>: <message>
+// Events are sorted by time, the truncated messages end with "...".
+//
+// Usage: NamedPipeLogDecode <binary log> [output file]
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BinaryLogFormat.h"
+
+namespace {
+
+struct Event {
+  uint32_t descriptor_id = 0;
+  uint32_t thread_index = 0;
+  uint64_t timestamp = 0;
+  bool is_truncated = false;
+  std::string payload;
+};
+
+struct BinaryLog {
+  uint64_t system_start = 0;
+  uint64_t steady_start = 0;
+  std::unordered_map<uint32_t, BinaryLogDescriptor> descriptors;
+  std::vector<Event> events;
+  uint64_t dropped_count = 0;
+};
+
+bool ReadDescriptor(std::istream& stream, BinaryLog& log) {
+  BinaryLogDescriptor descriptor;
+  uint16_t parts_count = 0;
+  if (!ReadBinaryValue(stream, descriptor.id) || !ReadBinaryValue(stream, descriptor.level) ||
+      !ReadBinaryString(stream, descriptor.file) || !ReadBinaryValue(stream, descriptor.line) ||
+      !ReadBinaryValue(stream, parts_count)) {
+    return false;
+  }
+
+  for (uint16_t i = 0; i < parts_count; ++i) {
+    BinaryLogArgType type = BinaryLogArgType::Literal;
+    std::string literal;
+    if (!ReadBinaryValue(stream, type) ||
+        (type == BinaryLogArgType::Literal && !ReadBinaryString(stream, literal))) {
+      return false;
+    }
+    descriptor.parts.emplace_back(type, std::move(literal));
+  }
+  const auto id = descriptor.id;
+  log.descriptors[id] = std::move(descriptor);
+  return true;
+}
+
+bool ReadEvent(std::istream& stream, BinaryLog& log) {
+  Event event;
+  uint8_t is_truncated = 0;
+  uint16_t size = 0;
+  if (!ReadBinaryValue(stream, event.descriptor_id) ||
+      !ReadBinaryValue(stream, event.thread_index) || !ReadBinaryValue(stream, event.timestamp) ||
+      !ReadBinaryValue(stream, is_truncated) || !ReadBinaryValue(stream, size)) {
+    return false;
+  }
+  event.is_truncated = is_truncated != 0;
+  event.payload.resize(size);
+  if (size > 0 && !stream.read(&event.payload[0], size)) {
+    return false;
+  }
+  log.events.push_back(std::move(event));
+  return true;
+}
+
+// Returns false if the file is not a binary log. The log, which is cut in the middle of the
+// record (e.g. the process was killed), is read up to that record.
+bool ReadBinaryLog(std::istream& stream, BinaryLog& log) {
+  char magic[sizeof(kBinaryLogMagic)] = {};
+  if (!stream.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, kBinaryLogMagic, sizeof(magic)) != 0 ||
+      !ReadBinaryValue(stream, log.system_start) || !ReadBinaryValue(stream, log.steady_start)) {
+    return false;
+  }
+
+  BinaryLogRecordType type = BinaryLogRecordType::Event;
+  while (ReadBinaryValue(stream, type)) {
+    bool success = false;
+    switch (type) {
+      case BinaryLogRecordType::Descriptor:
+        success = ReadDescriptor(stream, log);
+        break;
+      case BinaryLogRecordType::Event:
+        success = ReadEvent(stream, log);
+        break;
+      case BinaryLogRecordType::Dropped: {
+        uint64_t dropped = 0;
+        success = ReadBinaryValue(stream, dropped);
+        log.dropped_count += dropped;
+        break;
+      }
+    }
+    if (!success) {
+      std::cerr << "WARNING - the log is truncated or corrupted at offset="
+                << static_cast<long long>(stream.tellg()) << std::endl;
+      break;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+bool ReadArgument(const std::string& payload, size_t& idx, T& value) {
+  if (idx + sizeof(T) > payload.size()) {
+    return false;
+  }
+  std::memcpy(&value, payload.data() + idx, sizeof(T));
+  idx += sizeof(T);
+  return true;
+}
+
+// Renders the argument the same way as std::ostream does for the text log.
+bool RenderArgument(BinaryLogArgType type, const std::string& payload, size_t& idx,
+                    std::ostream& out) {
+  switch (type) {
+    case BinaryLogArgType::Int32: {
+      int32_t value = 0;
+      return ReadArgument(payload, idx, value) && (out << value);
+    }
+    case BinaryLogArgType::UInt32: {
+      uint32_t value = 0;
+      return ReadArgument(payload, idx, value) && (out << value);
+    }
+    case BinaryLogArgType::Int64: {
+      int64_t value = 0;
+      return ReadArgument(payload, idx, value) && (out << value);
+    }
+    case BinaryLogArgType::UInt64: {
+      uint64_t value = 0;
+      return ReadArgument(payload, idx, value) && (out << value);
+    }
+    case BinaryLogArgType::Double: {
+      double value = 0;
+      return ReadArgument(payload, idx, value) && (out << value);
+    }
+    case BinaryLogArgType::Bool: {
+      uint8_t value = 0;
+      return ReadArgument(payload, idx, value) && (out << (value != 0));
+    }
+    case BinaryLogArgType::Char: {
+      char value = 0;
+      return ReadArgument(payload, idx, value) && (out << value);
+    }
+    case BinaryLogArgType::Pointer: {
+      uint64_t value = 0;
+      return ReadArgument(payload, idx, value) &&
+             (out << reinterpret_cast<const void*>(static_cast<uintptr_t>(value)));
+    }
+    case BinaryLogArgType::String: {
+      uint16_t size = 0;
+      if (!ReadArgument(payload, idx, size)) {
+        return false;
+      }
+      size = static_cast<uint16_t>(std::min<size_t>(size, payload.size() - idx));
+      out.write(payload.data() + idx, size);
+      idx += size;
+      return true;
+    }
+    case BinaryLogArgType::Literal:
+      break;
+  }
+  return false;
+}
+
+const char* GetLevelName(uint8_t level) {
+  static const char* kLevelNames[] = {"TRACE", "DEBUG", "INFO", "ERROR"};
+  return level < std::size(kLevelNames) ? kLevelNames[level] : "?";
+}
+
+void RenderTime(const BinaryLog& log, uint64_t timestamp, std::ostream& out) {
+  const uint64_t nanoseconds = log.system_start + (timestamp - log.steady_start);
+  const std::time_t seconds = static_cast<std::time_t>(nanoseconds / 1000000000);
+  const auto* utc = std::gmtime(&seconds);
+  out << std::put_time(utc, "%Y-%m-%d %H:%M:%S") << "." << std::setw(6) << std::setfill('0')
+      << (nanoseconds % 1000000000) / 1000 << std::setfill(' ');
+}
+
+void RenderEvent(const BinaryLog& log, const Event& event, std::ostream& out) {
+  RenderTime(log, event.timestamp, out);
+  out << " [thread " << event.thread_index << "] ";
+
+  auto descriptor = log.descriptors.find(event.descriptor_id);
+  if (descriptor == log.descriptors.end()) {
+    out << "<unknown descriptor=" << event.descriptor_id << ">\n";
+    return;
+  }
+
+  const auto& file = descriptor->second.file;
+  out << GetLevelName(descriptor->second.level) << " ";
+  if (descriptor->second.line > 0) {
+    out << file.substr(file.find_last_of("/\\") + 1) << ":" << descriptor->second.line << ": ";
+  }
+
+  size_t idx = 0;
+  bool is_complete = true;
+  for (const auto& [type, literal] : descriptor->second.parts) {
+    if (type == BinaryLogArgType::Literal) {
+      out << literal;
+    } else if (!RenderArgument(type, event.payload, idx, out)) {
+      is_complete = false;
+      break;
+    }
+  }
+  if (event.is_truncated || !is_complete) {
+    out << "...";
+  }
+  out << "\n";
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: NamedPipeLogDecode <binary log> [output file]" << std::endl;
+    return -1;
+  }
+
+  std::ifstream input(argv[1], std::ios::binary);
+  BinaryLog log;
+  if (!input.is_open() || !ReadBinaryLog(input, log)) {
+    std::cerr << "ERROR - " << argv[1] << " is not a binary log" << std::endl;
+    return -1;
+  }
+
+  std::ofstream output_file;
+  if (argc > 2) {
+    output_file.open(argv[2]);
+    if (!output_file.is_open()) {
+      std::cerr << "ERROR - can't open " << argv[2] << std::endl;
+      return -1;
+    }
+  }
+  std::ostream& out = argc > 2 ? output_file : std::cout;
+
+  std::stable_sort(
+      log.events.begin(), log.events.end(),
+      [](const Event& lhs, const Event& rhs) { return lhs.timestamp < rhs.timestamp; });
+  for (const auto& event : log.events) {
+    RenderEvent(log, event, out);
+  }
+  if (log.dropped_count > 0) {
+    out << log.dropped_count << " events were dropped\n";
+  }
+  return 0;
+}
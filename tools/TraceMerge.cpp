@@ -0,0 +1,56 @@
+// Merges the Chrome traces of the client and the server(s) (--trace <path>, see Tracer.h) into one
+// trace, so the spans of a request are shown on one timeline. Spans of the same request have the
+// same args.trace_id.
+//
+// Usage: NamedPipeTraceMerge <output file> <trace> [<trace>...]
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+constexpr auto kHeader = "{\"traceEvents\":[";
+constexpr auto kFooter = "]}";
+
+// Copies the events of the trace - every event is on its own line.
+bool CopyEvents(const std::string& path, std::ostream& out, bool& is_first_event) {
+  std::ifstream input(path);
+  std::string line;
+  if (!input.is_open() || !std::getline(input, line) || line != kHeader) {
+    return false;
+  }
+
+  while (std::getline(input, line) && line != kFooter) {
+    if (!line.empty() && line.back() == ',') {
+      line.pop_back();
+    }
+    out << (is_first_event ? "" : ",\n") << line;
+    is_first_event = false;
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: NamedPipeTraceMerge <output file> <trace> [<trace>...]" << std::endl;
+    return -1;
+  }
+
+  std::ofstream out(argv[1], std::ios::trunc);
+  if (!out.is_open()) {
+    std::cerr << "ERROR - can't open " << argv[1] << std::endl;
+    return -1;
+  }
+
+  out << kHeader << "\n";
+  bool is_first_event = true;
+  for (int i = 2; i < argc; ++i) {
+    if (!CopyEvents(argv[i], out, is_first_event)) {
+      std::cerr << "ERROR - " << argv[i] << " is not a trace of NamedPipeDemo" << std::endl;
+      return -1;
+    }
+  }
+  out << "\n" << kFooter << "\n";
+  return 0;
+}